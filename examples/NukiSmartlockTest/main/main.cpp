@@ -74,7 +74,6 @@ bool keyTurnerState() {
 void requestLogEntries() {
     uint8_t result = nukiLock.retrieveLogEntries(0, 10, 0, true);
     if (result == 1) {
-        vTaskDelay(pdMS_TO_TICKS(5000));
         nukiLock.getLogEntries(&requestedLogEntries);
         std::list<NukiLock::LogEntry>::iterator it = requestedLogEntries.begin();
         while (it != requestedLogEntries.end()) {
@@ -89,7 +88,6 @@ void requestLogEntries() {
 void requestKeyPadEntries() {
     uint8_t result = nukiLock.retrieveKeypadEntries(0, 10);
     if (result == 1) {
-        vTaskDelay(pdMS_TO_TICKS(5000));
         nukiLock.getKeypadEntries(&requestedKeypadEntries);
         std::list<Nuki::KeypadEntry>::iterator it = requestedKeypadEntries.begin();
         while (it != requestedKeypadEntries.end()) {
@@ -104,7 +102,6 @@ void requestKeyPadEntries() {
 void requestAuthorizationEntries() {
     uint8_t result = nukiLock.retrieveAuthorizationEntries(0, 10);
     if (result == 1) {
-        vTaskDelay(pdMS_TO_TICKS(5000));
         nukiLock.getAuthorizationEntries(&requestedAuthorizationEntries);
         std::list<Nuki::AuthorizationEntry>::iterator it = requestedAuthorizationEntries.begin();
         while (it != requestedAuthorizationEntries.end()) {
@@ -139,7 +136,6 @@ void addTimeControl(uint8_t weekdays, uint8_t hour, uint8_t minute, NukiLock::Lo
 void requestTimeControlEntries() {
     Nuki::CmdResult result = nukiLock.retrieveTimeControlEntries();
     if (result == Nuki::CmdResult::Success) {
-        vTaskDelay(pdMS_TO_TICKS(5000));
         nukiLock.getTimeControlEntries(&requestedTimeControlEntries);
         std::list<NukiLock::TimeControlEntry>::iterator it = requestedTimeControlEntries.begin();
         while (it != requestedTimeControlEntries.end()) {
@@ -0,0 +1,263 @@
+/**
+ * @file advertisement_bench.cpp
+ * Host (Linux) benchmark: cost of NukiBle::onResult for the advertisements a gateway receives.
+ *
+ * usage: nuki_advertisement_bench [advertisements per scenario] [rate per second, 0 = unpaced]
+ *
+ * Synthetic advertisements are passed to onResult on the benchmark thread, like the scanner task does:
+ * - matching:        iBeacon of the paired lock (address and keyturner UUID match), every 8th with the
+ *                    status update flag set
+ * - foreign:         other devices (flags, name, manufacturer data, 16 bit service UUIDs)
+ * - foreign-ibeacon: iBeacons of other devices
+ * - pairing:         unpaired client, lock in pairing mode (pairing service data)
+ * - unpaired-foreign: unpaired client, other devices with service data
+ * Every scenario reports ns/advert and the heap allocations/advert made on the benchmark thread (operator new).
+ * With a rate the advertisements are paced and the share of one core spent in onResult is reported.
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ */
+
+#include "NukiLock.h"
+#include "BleScanner.h"
+#include "SmartLockEmulator.h"
+#include "esp_timer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+thread_local bool countAllocations = false;
+thread_local uint64_t allocationCount = 0;
+thread_local uint64_t allocatedBytes = 0;
+
+// counts the allocations of the benchmark thread, all forms allocate with malloc() and release with free()
+void* countedAllocation(size_t size) {
+  if (countAllocations) {
+    allocationCount++;
+    allocatedBytes += size;
+  }
+  void* pointer = malloc(size ? size : 1);
+  if (pointer == nullptr) {
+    throw std::bad_alloc();
+  }
+  return pointer;
+}
+
+} // namespace
+
+void* operator new(size_t size) {
+  return countedAllocation(size);
+}
+
+void* operator new[](size_t size) {
+  return countedAllocation(size);
+}
+
+// not inlined, so the compiler does not see free() called on the pointer of an operator new
+__attribute__((noinline)) void operator delete(void* pointer) noexcept {
+  free(pointer);
+}
+
+__attribute__((noinline)) void operator delete[](void* pointer) noexcept {
+  free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+  operator delete(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+  operator delete[](pointer);
+}
+
+namespace {
+
+const NimBLEAddress lockAddress("54:d2:72:00:00:01", 0);
+const uint32_t nukiId = 0x2A000001;
+
+class EventCounter : public Nuki::SmartlockEventHandler {
+  public:
+    void notify(Nuki::EventType eventType) override {
+      events++;
+    }
+    uint32_t events = 0;
+};
+
+struct Scenario {
+  std::string name;
+  BleScanner::Subscriber* subscriber;
+  std::vector<NimBLEAdvertisedDevice> advertisements;
+};
+
+NimBLEAddress randomAddress(std::mt19937& random) {
+  uint8_t address[6];
+  for (uint8_t& byte : address) {
+    byte = random();
+  }
+  return NimBLEAddress(address, 1);
+}
+
+void appendField(std::vector<uint8_t>& payload, const uint8_t type, const std::vector<uint8_t>& data) {
+  payload.push_back(1 + data.size());
+  payload.push_back(type);
+  payload.insert(payload.end(), data.begin(), data.end());
+}
+
+std::vector<uint8_t> iBeacon(const uint8_t* uuid, const uint32_t majorMinor, const uint8_t txPower) {
+  std::vector<uint8_t> payload = {0x02, 0x01, 0x06};
+  std::vector<uint8_t> data = {0x4C, 0x00, 0x02, 0x15};
+  // proximity uuid is big endian
+  for (int i = 15; i >= 0; i--) {
+    data.push_back(uuid[i]);
+  }
+  data.insert(data.end(), {(uint8_t)(majorMinor >> 24), (uint8_t)(majorMinor >> 16), (uint8_t)(majorMinor >> 8),
+                           (uint8_t)majorMinor, txPower});
+  appendField(payload, 0xFF, data);
+  return payload;
+}
+
+std::vector<uint8_t> foreignDevice(std::mt19937& random, const int index) {
+  std::vector<uint8_t> payload = {0x02, 0x01, 0x06};
+  std::string name = "Device_" + std::to_string(index);
+  appendField(payload, 0x09, std::vector<uint8_t>(name.begin(), name.end()));
+  std::vector<uint8_t> manufacturerData(2 + random() % 20);
+  for (uint8_t& byte : manufacturerData) {
+    byte = random();
+  }
+  appendField(payload, 0xFF, manufacturerData);
+  appendField(payload, 0x03, {0x0F, 0x18, 0x0A, 0x18});
+  return payload;
+}
+
+std::vector<uint8_t> foreignServiceData(std::mt19937& random) {
+  // 16 bit service data, e.g. a thermometer
+  std::vector<uint8_t> payload = {0x02, 0x01, 0x06};
+  std::vector<uint8_t> data = {0x95, 0xFE};
+  for (int i = 0; i < 12; i++) {
+    data.push_back(random());
+  }
+  appendField(payload, 0x16, data);
+  return payload;
+}
+
+std::vector<uint8_t> pairingAdvertisement() {
+  std::vector<uint8_t> payload = {0x02, 0x01, 0x06};
+  const uint8_t* uuid = NukiLock::keyturnerPairingServiceUUID.getValue();
+  std::vector<uint8_t> data(uuid, uuid + 16);
+  data.push_back(0x01);
+  appendField(payload, 0x21, data);
+  std::string name = "Nuki_2A000001";
+  appendField(payload, 0x09, std::vector<uint8_t>(name.begin(), name.end()));
+  return payload;
+}
+
+void run(const Scenario& scenario, const size_t count, const double rate) {
+  int64_t handleNs = 0;
+  allocationCount = 0;
+  allocatedBytes = 0;
+  auto start = std::chrono::steady_clock::now();
+
+  for (size_t i = 0; i < count; i++) {
+    const NimBLEAdvertisedDevice& advertisement = scenario.advertisements[i % scenario.advertisements.size()];
+    if (rate > 0) {
+      std::this_thread::sleep_until(start + std::chrono::nanoseconds((int64_t)(i * 1e9 / rate)));
+    }
+    auto callStart = std::chrono::steady_clock::now();
+    countAllocations = true;
+    scenario.subscriber->onResult(&advertisement);
+    countAllocations = false;
+    handleNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - callStart).count();
+  }
+  int64_t elapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+  printf("  %-17s %10zu %12.1f %12.2f %12.1f", scenario.name.c_str(), count, (double)handleNs / count,
+         (double)allocationCount / count, (double)allocatedBytes / count);
+  if (rate > 0) {
+    printf(" %10.0f %8.3f%%", count / (elapsedNs / 1e9), 100.0 * handleNs / elapsedNs);
+  }
+  printf("\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  size_t count = argc > 1 ? atoll(argv[1]) : 200000;
+  double rate = argc > 2 ? atof(argv[2]) : 0;
+
+  esp_log_level_set("*", ESP_LOG_WARN);
+
+  // pair once, the emulator stays silent afterwards so only synthetic advertisements reach the lock
+  NukiEmulator::SmartLockEmulator emulator(lockAddress, nukiId);
+  emulator.setPairingMode(true);
+  emulator.begin();
+  emulator.startAdvertising(50 * 1000);
+
+  BleScanner::Scanner scanner;
+  scanner.initialize();
+  NukiLock::NukiLock pairedLock("advertisements", 1);
+  pairedLock.initialize();
+  pairedLock.registerBleScanner(&scanner);
+  pairedLock.unPairNuki();
+
+  int64_t pairingStart = esp_timer_get_time();
+  while (pairedLock.pairNuki() != Nuki::PairingResult::Success) {
+    if (esp_timer_get_time() - pairingStart > 30 * 1000 * 1000) {
+      printf("pairing failed\n");
+      return 1;
+    }
+    vTaskDelay(pdMS_TO_TICKS(50));
+  }
+  emulator.stopAdvertising();
+  emulator.end();
+  NimBLEHost::flush();
+
+  EventCounter eventCounter;
+  pairedLock.setEventHandler(&eventCounter);
+  NukiLock::NukiLock unpairedLock("advertisements-unpaired", 2);
+  unpairedLock.setEventHandler(&eventCounter);
+
+  std::mt19937 random(1);
+  const size_t poolSize = 256;
+  std::vector<Scenario> scenarios = {
+    {"matching", &pairedLock, {}},
+    {"foreign", &pairedLock, {}},
+    {"foreign-ibeacon", &pairedLock, {}},
+    {"pairing", &unpairedLock, {}},
+    {"unpaired-foreign", &unpairedLock, {}},
+  };
+  for (size_t i = 0; i < poolSize; i++) {
+    scenarios[0].advertisements.emplace_back(lockAddress, -60,
+        iBeacon(NukiLock::keyturnerServiceUUID.getValue(), nukiId, i % 8 == 0 ? 0xC5 : 0xC4));
+    scenarios[1].advertisements.emplace_back(randomAddress(random), -80, foreignDevice(random, i));
+    uint8_t uuid[16];
+    for (uint8_t& byte : uuid) {
+      byte = random();
+    }
+    scenarios[2].advertisements.emplace_back(randomAddress(random), -80, iBeacon(uuid, random(), 0xC5));
+    scenarios[3].advertisements.emplace_back(lockAddress, -60, pairingAdvertisement());
+    scenarios[4].advertisements.emplace_back(randomAddress(random), -80, foreignServiceData(random));
+  }
+
+  printf("%zu advertisements per scenario, %s\n\n", count, rate > 0 ? (std::to_string((int)rate) + " per second").c_str() : "unpaced");
+  printf("  %-17s %10s %12s %12s %12s", "scenario", "adverts", "ns/advert", "allocs/adv", "bytes/adv");
+  if (rate > 0) {
+    printf(" %10s %9s", "adverts/s", "cpu");
+  }
+  printf("\n");
+  for (const Scenario& scenario : scenarios) {
+    run(scenario, count, rate);
+  }
+  printf("\nevents notified: %u\n", eventCounter.events);
+
+  pairedLock.unPairNuki();
+  return 0;
+}
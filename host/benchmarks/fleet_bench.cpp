@@ -0,0 +1,316 @@
+/**
+ * @file fleet_bench.cpp
+ * Host (Linux) benchmark: one gateway driving a fleet of emulated Smart Locks and Openers from several tasks.
+ *
+ * usage: nuki_fleet_bench [devices 1..16] [tasks] [seconds] [packet latency us] [direct|alt] [opener share 0..1]
+ *
+ * Every device is a NukiLock or NukiOpener paired with its own emulated peer. The tasks pick a random device
+ * and a random command (state 50%, battery report 15%, config 25%, lock action 10%) until the time is up,
+ * calls for the same device serialize on its nukiBleSemaphore. The report shows the throughput, the latency
+ * percentiles per command (and of the unsuccessful calls: semaphore timeouts, busy locks, command timeouts)
+ * and the fairness over devices and tasks (Jain's index, 1 = perfectly even).
+ *
+ * direct: initialize(), every instance creates its NimBLE client up front, at most NIMBLE_MAX_CONNECTIONS
+ *         devices (a further instance would get no client).
+ * alt:    initialize(true), clients are created on connect, instances beyond NIMBLE_MAX_CONNECTIONS wait for
+ *         a free client until their connect retries run out.
+ * NIMBLE_MAX_CONNECTIONS of the host build is 3 like on the ESP, configure with
+ * -DNUKI_HOST_MAX_CONNECTIONS=<n> to change it. Connections are dropped after the disconnect timeout of
+ * NukiBle (updateConnectionState() is called every 50 ms like in a gateway loop).
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ */
+
+#include "NukiLock.h"
+#include "NukiOpener.h"
+#include "BleScanner.h"
+#include "SmartLockEmulator.h"
+#include "OpenerEmulator.h"
+#include "esp_timer.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+enum FleetCommand {
+  State,
+  Battery,
+  Config,
+  Action,
+  FleetCommandCount
+};
+
+const char* commandNames[FleetCommandCount] = {"state", "battery", "config", "action"};
+
+struct Device {
+  std::string name;
+  bool opener = false;
+  std::unique_ptr<NukiEmulator::KeyturnerEmulator> emulator;
+  std::unique_ptr<NukiLock::NukiLock> lock;
+  std::unique_ptr<NukiOpener::NukiOpener> nukiOpener;
+  uint32_t actions = 0;
+
+  Nuki::NukiBle* client() {
+    return opener ? (Nuki::NukiBle*)nukiOpener.get() : (Nuki::NukiBle*)lock.get();
+  }
+};
+
+struct Sample {
+  uint8_t device;
+  uint8_t command;
+  Nuki::CmdResult result;
+  int64_t latencyUs;
+};
+
+Nuki::CmdResult run(Device& device, const FleetCommand command, const int iteration) {
+  if (device.opener) {
+    NukiOpener::OpenerState state;
+    NukiOpener::BatteryReport batteryReport;
+    NukiOpener::Config config;
+    switch (command) {
+      case State:
+        return device.nukiOpener->requestOpenerState(&state);
+      case Battery:
+        return device.nukiOpener->requestBatteryReport(&batteryReport);
+      case Config:
+        return device.nukiOpener->requestConfig(&config);
+      default:
+        return device.nukiOpener->lockAction((iteration % 2) ? NukiOpener::LockAction::DeactivateRTO
+                                             : NukiOpener::LockAction::ActivateRTO);
+    }
+  }
+  NukiLock::KeyTurnerState state;
+  NukiLock::BatteryReport batteryReport;
+  NukiLock::Config config;
+  switch (command) {
+    case State:
+      return device.lock->requestKeyTurnerState(&state);
+    case Battery:
+      return device.lock->requestBatteryReport(&batteryReport);
+    case Config:
+      return device.lock->requestConfig(&config);
+    default:
+      return device.lock->lockAction((iteration % 2) ? NukiLock::LockAction::Lock : NukiLock::LockAction::Unlock);
+  }
+}
+
+FleetCommand pickCommand(std::mt19937& random) {
+  int roll = random() % 100;
+  if (roll < 50) {
+    return State;
+  }
+  if (roll < 65) {
+    return Battery;
+  }
+  if (roll < 90) {
+    return Config;
+  }
+  return Action;
+}
+
+int64_t percentile(std::vector<int64_t>& sortedSamples, const double p) {
+  if (sortedSamples.empty()) {
+    return 0;
+  }
+  size_t rank = (size_t)std::ceil(p / 100.0 * sortedSamples.size());
+  return sortedSamples[std::max<size_t>(rank, 1) - 1];
+}
+
+double jainIndex(const std::vector<uint32_t>& counts) {
+  double sum = 0;
+  double squares = 0;
+  for (uint32_t count : counts) {
+    sum += count;
+    squares += (double)count * count;
+  }
+  return squares > 0 ? sum * sum / (counts.size() * squares) : 0;
+}
+
+void printLatencies(const char* name, std::vector<int64_t> latenciesUs) {
+  std::sort(latenciesUs.begin(), latenciesUs.end());
+  printf("  %-8s %7zu %9.2f %9.2f %9.2f %9.2f\n", name, latenciesUs.size(), percentile(latenciesUs, 50) / 1000.0,
+         percentile(latenciesUs, 95) / 1000.0, percentile(latenciesUs, 99) / 1000.0,
+         latenciesUs.empty() ? 0 : latenciesUs.back() / 1000.0);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  int deviceCount = argc > 1 ? std::min(std::max(atoi(argv[1]), 1), 16) : 4;
+  int taskCount = argc > 2 ? std::max(atoi(argv[2]), 1) : 4;
+  double seconds = argc > 3 ? atof(argv[3]) : 10;
+  int64_t packetUs = argc > 4 ? atoll(argv[4]) : 7500;
+  bool altConnect = argc > 5 ? strcmp(argv[5], "alt") == 0 : false;
+  double openerShare = argc > 6 ? atof(argv[6]) : 0.25;
+  const int64_t actionDurationUs = 500 * 1000;
+
+  if (!altConnect && deviceCount > NIMBLE_MAX_CONNECTIONS) {
+    printf("direct mode supports at most NIMBLE_MAX_CONNECTIONS (%d) devices, use alt or rebuild with "
+           "-DNUKI_HOST_MAX_CONNECTIONS=%d\n", NIMBLE_MAX_CONNECTIONS, deviceCount);
+    return 2;
+  }
+
+  esp_log_level_set("*", ESP_LOG_WARN);
+
+  NukiEmulator::LinkProfile profile;
+  profile.connectUs = 6 * packetUs;
+  profile.discoveryUs = 2 * packetUs;
+  profile.subscribeUs = packetUs;
+  profile.writeUs = packetUs;
+  profile.indicationUs = packetUs;
+
+  BleScanner::Scanner scanner;
+  scanner.initialize();
+
+  std::vector<Device> devices(deviceCount);
+  int openers = (int)std::lround(deviceCount * openerShare);
+  for (int i = 0; i < deviceCount; i++) {
+    Device& device = devices[i];
+    char address[18];
+    snprintf(address, sizeof(address), "54:d2:72:00:01:%02x", static_cast<uint8_t>(i + 1));
+    // spread the openers over the fleet
+    device.opener = openers > 0 && (i * openers) / deviceCount != ((i + 1) * openers) / deviceCount;
+    device.name = std::string(device.opener ? "opener" : "lock") + std::to_string(i);
+    if (device.opener) {
+      device.emulator.reset(new NukiEmulator::OpenerEmulator(NimBLEAddress(address, 0), 0x2B000001 + i));
+      device.nukiOpener.reset(new NukiOpener::NukiOpener(device.name, 100 + i));
+    } else {
+      device.emulator.reset(new NukiEmulator::SmartLockEmulator(NimBLEAddress(address, 0), 0x2A000001 + i));
+      device.lock.reset(new NukiLock::NukiLock(device.name, 100 + i));
+    }
+    device.emulator->setLinkProfile(profile);
+    device.emulator->setActionDuration(actionDurationUs);
+    device.emulator->setSecurityPin(1234);
+    device.emulator->begin();
+    device.emulator->startAdvertising(100 * 1000);
+
+    device.client()->initialize(altConnect);
+    device.client()->unPairNuki();
+  }
+
+  auto shutdown = [&devices]() {
+    for (Device& device : devices) {
+      device.client()->unPairNuki();
+      device.emulator->end();
+    }
+    // deliver the disconnects before the clients are destroyed
+    NimBLEHost::flush();
+  };
+
+  // pair one after the other, an unpaired client remembers any device it has seen in pairing mode
+  for (Device& device : devices) {
+    device.client()->registerBleScanner(&scanner);
+    device.emulator->setPairingMode(true);
+    int64_t pairingStart = esp_timer_get_time();
+    while (device.client()->pairNuki() != Nuki::PairingResult::Success) {
+      if (esp_timer_get_time() - pairingStart > 30 * 1000 * 1000) {
+        printf("pairing %s failed, %zu of NIMBLE_MAX_CONNECTIONS (%d) NimBLE clients in use\n", device.name.c_str(),
+               NimBLEDevice::getCreatedClientCount(), NIMBLE_MAX_CONNECTIONS);
+        shutdown();
+        return 1;
+      }
+      vTaskDelay(pdMS_TO_TICKS(50));
+    }
+    device.emulator->setPairingMode(false);
+    device.client()->saveSecurityPincode(1234);
+  }
+
+  std::atomic<bool> running{true};
+  std::thread connectionMonitor([&]() {
+    while (running) {
+      for (Device& device : devices) {
+        device.client()->updateConnectionState();
+      }
+      vTaskDelay(pdMS_TO_TICKS(50));
+    }
+  });
+
+  std::vector<std::vector<Sample>> samples(taskCount);
+  std::vector<std::thread> tasks;
+  int64_t start = esp_timer_get_time();
+  int64_t end = start + (int64_t)(seconds * 1000 * 1000);
+  for (int t = 0; t < taskCount; t++) {
+    tasks.emplace_back([&, t]() {
+      std::mt19937 random(1000 + t);
+      int iteration = 0;
+      while (esp_timer_get_time() < end) {
+        uint8_t index = random() % deviceCount;
+        FleetCommand command = pickCommand(random);
+        int64_t callStart = esp_timer_get_time();
+        Nuki::CmdResult result = run(devices[index], command, iteration++);
+        samples[t].push_back({index, (uint8_t)command, result, esp_timer_get_time() - callStart});
+      }
+    });
+  }
+  for (std::thread& task : tasks) {
+    task.join();
+  }
+  int64_t elapsedUs = esp_timer_get_time() - start;
+  running = false;
+  connectionMonitor.join();
+
+  std::vector<uint32_t> perDevice(deviceCount);
+  std::vector<uint32_t> perTask(taskCount);
+  std::array<std::vector<int64_t>, FleetCommandCount> latencies;
+  std::vector<int64_t> allLatencies;
+  std::vector<int64_t> unsuccessfulLatencies;
+  uint32_t succeeded = 0;
+  uint32_t busy = 0;
+  uint32_t timeouts = 0;
+  uint32_t failures = 0;
+  for (int t = 0; t < taskCount; t++) {
+    for (const Sample& sample : samples[t]) {
+      if (sample.result == Nuki::CmdResult::Success) {
+        succeeded++;
+        perDevice[sample.device]++;
+        perTask[t]++;
+        latencies[sample.command].push_back(sample.latencyUs);
+        allLatencies.push_back(sample.latencyUs);
+        continue;
+      }
+      unsuccessfulLatencies.push_back(sample.latencyUs);
+      if (sample.result == Nuki::CmdResult::Lock_Busy) {
+        busy++;
+      } else if (sample.result == Nuki::CmdResult::TimeOut) {
+        timeouts++;
+      } else {
+        failures++;
+      }
+    }
+  }
+
+  printf("%d devices (%d openers), %d tasks, %.1f s, %lld us per packet, %s connect, NIMBLE_MAX_CONNECTIONS %d\n\n",
+         deviceCount, openers, taskCount, elapsedUs / 1e6, (long long)packetUs, altConnect ? "alt" : "direct",
+         NIMBLE_MAX_CONNECTIONS);
+  printf("throughput: %.2f commands/s, %u succeeded, %u busy, %u timed out, %u failed\n\n",
+         succeeded / (elapsedUs / 1e6), succeeded, busy, timeouts, failures);
+  printf("  %-8s %7s %9s %9s %9s %9s\n", "[ms]", "n", "p50", "p95", "p99", "max");
+  for (int command = 0; command < FleetCommandCount; command++) {
+    printLatencies(commandNames[command], latencies[command]);
+  }
+  printLatencies("all", allLatencies);
+  printLatencies("unsucc.", unsuccessfulLatencies);
+
+  uint32_t minDevice = *std::min_element(perDevice.begin(), perDevice.end());
+  uint32_t maxDevice = *std::max_element(perDevice.begin(), perDevice.end());
+  printf("\nfairness: devices %.3f (min %u, max %u commands), tasks %.3f\n", jainIndex(perDevice), minDevice,
+         maxDevice, jainIndex(perTask));
+  for (int i = 0; i < deviceCount; i++) {
+    printf("  %-10s %6u\n", devices[i].name.c_str(), perDevice[i]);
+  }
+
+  shutdown();
+  return 0;
+}
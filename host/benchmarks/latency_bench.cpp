@@ -0,0 +1,282 @@
+/**
+ * @file latency_bench.cpp
+ * Host (Linux) benchmark: end-to-end latency of NukiLock commands against an emulated Smart Lock,
+ * with percentiles split into the phases of connectBle and the command state machines.
+ *
+ * usage: nuki_latency_bench [iterations] [packet latency us] [cold|warm] [response delay us]
+ *
+ * cold: the lock drops the connection before every command (like the lock's idle timeout does between
+ * commands of a home automation bridge), warm: the connection is kept and only the first call connects.
+ *
+ * The phases are derived from the link trace of the emulator:
+ * - connect:   call until the end of the connection setup (includes credentials and semaphore)
+ * - discovery: service and characteristic discovery of GDIO and USDIO
+ * - subscribe: CCCD writes, including the settle delay of NukiBle after each subscription
+ * - challenge: request of the challenge nonce until the challenge is delivered
+ * - command:   challenge delivered until the command is written (encryption and write)
+ * - accept:    command written until the first answer of the lock (ACCEPTED for lock actions,
+ *              the data or status for all other commands)
+ * - complete:  first answer until the call returns (state machine polling, COMPLETE status)
+ * A setter like setLedBrightness is a requestConfig followed by a setConfig, its phases add up both.
+ * NukiBle returns from a lock action when it is accepted, the benchmark waits for the motor afterwards.
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ */
+
+#include "NukiLock.h"
+#include "BleScanner.h"
+#include "SmartLockEmulator.h"
+#include "esp_timer.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+
+enum Phase {
+  Connect,
+  Discovery,
+  Subscribe,
+  Challenge,
+  Command,
+  Accept,
+  Complete,
+  PhaseCount
+};
+
+const char* phaseNames[PhaseCount] = {"connect", "discovery", "subscribe", "challenge", "command", "accept", "complete"};
+
+typedef std::array<int64_t, PhaseCount> PhaseDurations;
+
+struct Benchmark {
+  std::string name;
+  std::function<Nuki::CmdResult(int iteration)> call;
+  // time the lock keeps sending after the call returned
+  int64_t settleUs;
+  std::vector<int64_t> totalUs;
+  std::vector<PhaseDurations> phasesUs;
+  unsigned int failures = 0;
+};
+
+class TraceRecorder {
+  public:
+    void record(const NukiEmulator::TraceEvent& event) {
+      std::lock_guard<std::mutex> lock(mutex);
+      events.push_back(event);
+    }
+
+    std::vector<NukiEmulator::TraceEvent> take() {
+      std::lock_guard<std::mutex> lock(mutex);
+      std::vector<NukiEmulator::TraceEvent> result;
+      result.swap(events);
+      return result;
+    }
+
+  private:
+    std::mutex mutex;
+    std::vector<NukiEmulator::TraceEvent> events;
+};
+
+/**
+ * @brief Splits [startUs, endUs] of a call in phases, each trace event marks the start of a phase
+ */
+PhaseDurations breakDown(std::vector<NukiEmulator::TraceEvent> events, const int64_t startUs, const int64_t endUs) {
+  std::stable_sort(events.begin(), events.end(),
+  [](const NukiEmulator::TraceEvent& a, const NukiEmulator::TraceEvent& b) {
+    return a.startUs < b.startUs;
+  });
+
+  PhaseDurations durations{};
+  Phase phase = Connect;
+  int64_t mark = startUs;
+  auto enter = [&](const Phase next, const int64_t atUs) {
+    int64_t at = std::min(std::max(atUs, mark), endUs);
+    durations[phase] += at - mark;
+    phase = next;
+    mark = at;
+  };
+
+  for (const NukiEmulator::TraceEvent& event : events) {
+    if (event.startUs < startUs || event.startUs > endUs) {
+      continue;
+    }
+    switch (event.type) {
+      case NukiEmulator::TraceEventType::Connect:
+        enter(Connect, event.startUs);
+        break;
+      case NukiEmulator::TraceEventType::DiscoverService:
+      case NukiEmulator::TraceEventType::DiscoverCharacteristic:
+        enter(Discovery, event.startUs);
+        break;
+      case NukiEmulator::TraceEventType::Subscribe:
+        enter(Subscribe, event.startUs);
+        break;
+      case NukiEmulator::TraceEventType::Write:
+        if (event.command == Nuki::Command::RequestData && event.argument == (uint16_t)Nuki::Command::Challenge) {
+          enter(Challenge, event.startUs);
+        } else {
+          enter(Command, event.startUs);
+          enter(Accept, event.endUs);
+        }
+        break;
+      case NukiEmulator::TraceEventType::Indication:
+        if (event.command == Nuki::Command::Challenge) {
+          enter(Command, event.startUs);
+        } else if (phase == Accept) {
+          enter(Complete, event.startUs);
+        }
+        break;
+    }
+  }
+  enter(Complete, endUs);
+  return durations;
+}
+
+int64_t percentile(std::vector<int64_t> samples, const double p) {
+  if (samples.empty()) {
+    return 0;
+  }
+  std::sort(samples.begin(), samples.end());
+  size_t rank = (size_t)std::ceil(p / 100.0 * samples.size());
+  return samples[std::max<size_t>(rank, 1) - 1];
+}
+
+void printRow(const char* name, const std::vector<int64_t>& samplesUs) {
+  int64_t sum = 0;
+  for (int64_t sample : samplesUs) {
+    sum += sample;
+  }
+  printf("  %-10s %9.2f %9.2f %9.2f %9.2f\n", name, percentile(samplesUs, 50) / 1000.0,
+         percentile(samplesUs, 95) / 1000.0, percentile(samplesUs, 99) / 1000.0,
+         samplesUs.empty() ? 0 : sum / 1000.0 / samplesUs.size());
+}
+
+void report(const Benchmark& benchmark) {
+  printf("%s: n=%zu failed=%u\n", benchmark.name.c_str(), benchmark.totalUs.size(), benchmark.failures);
+  if (benchmark.totalUs.empty()) {
+    return;
+  }
+  printf("  %-10s %9s %9s %9s %9s\n", "phase [ms]", "p50", "p95", "p99", "mean");
+  for (int phase = 0; phase < PhaseCount; phase++) {
+    std::vector<int64_t> samplesUs;
+    for (const PhaseDurations& durations : benchmark.phasesUs) {
+      samplesUs.push_back(durations[phase]);
+    }
+    printRow(phaseNames[phase], samplesUs);
+  }
+  printRow("total", benchmark.totalUs);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  int iterations = argc > 1 ? atoi(argv[1]) : 50;
+  int64_t packetUs = argc > 2 ? atoll(argv[2]) : 7500;
+  bool cold = argc > 3 ? strcmp(argv[3], "warm") != 0 : true;
+  int64_t responseDelayUs = argc > 4 ? atoll(argv[4]) : 0;
+  const int64_t actionDurationUs = 500 * 1000;
+
+  esp_log_level_set("*", ESP_LOG_WARN);
+
+  // one connection event per packet, connection setup and discovery of a typical lock
+  NukiEmulator::LinkProfile profile;
+  profile.connectUs = 6 * packetUs;
+  profile.discoveryUs = 2 * packetUs;
+  profile.subscribeUs = packetUs;
+  profile.writeUs = packetUs;
+  profile.indicationUs = packetUs;
+
+  NukiEmulator::SmartLockEmulator emulator(NimBLEAddress("54:d2:72:00:00:01", 0), 0x2A000001);
+  emulator.setLinkProfile(profile);
+  emulator.setActionDuration(actionDurationUs);
+  emulator.setSecurityPin(1234);
+  for (Nuki::Command command : {Nuki::Command::RequestData, Nuki::Command::RequestConfig, Nuki::Command::SetConfig,
+                                Nuki::Command::LockAction}) {
+    emulator.setResponseDelay(command, responseDelayUs);
+  }
+  emulator.setPairingMode(true);
+  emulator.begin();
+  emulator.startAdvertising(100 * 1000);
+
+  BleScanner::Scanner scanner;
+  scanner.initialize();
+  NukiLock::NukiLock nukiLock("latency", 1);
+  nukiLock.initialize();
+  nukiLock.registerBleScanner(&scanner);
+  nukiLock.unPairNuki();
+
+  int64_t pairingStart = esp_timer_get_time();
+  while (nukiLock.pairNuki() != Nuki::PairingResult::Success) {
+    if (esp_timer_get_time() - pairingStart > 30 * 1000 * 1000) {
+      printf("pairing failed\n");
+      return 1;
+    }
+    vTaskDelay(pdMS_TO_TICKS(50));
+  }
+  emulator.setPairingMode(false);
+  nukiLock.saveSecurityPincode(1234);
+
+  TraceRecorder recorder;
+  emulator.setTraceListener([&recorder](const NukiEmulator::TraceEvent& event) {
+    recorder.record(event);
+  });
+
+  NukiLock::KeyTurnerState keyTurnerState;
+  NukiLock::BatteryReport batteryReport;
+  NukiLock::Config config;
+  std::vector<Benchmark> benchmarks = {
+    {
+      "lockAction", [&](int i) {
+        return nukiLock.lockAction((i % 2) ? NukiLock::LockAction::Lock : NukiLock::LockAction::Unlock);
+      }, actionDurationUs + responseDelayUs + 4 * packetUs
+    },
+    {"requestKeyTurnerState", [&](int) { return nukiLock.requestKeyTurnerState(&keyTurnerState); }, 0},
+    {"requestBatteryReport", [&](int) { return nukiLock.requestBatteryReport(&batteryReport); }, 0},
+    {"requestConfig", [&](int) { return nukiLock.requestConfig(&config); }, 0},
+    {"setLedBrightness", [&](int i) { return nukiLock.setLedBrightness(2 + i % 2); }, 0},
+  };
+
+  for (int i = 0; i < iterations; i++) {
+    for (Benchmark& benchmark : benchmarks) {
+      if (cold) {
+        emulator.disconnect();
+      }
+      NimBLEHost::flush();
+      recorder.take();
+
+      int64_t start = esp_timer_get_time();
+      Nuki::CmdResult result = benchmark.call(i);
+      int64_t end = esp_timer_get_time();
+
+      if (result == Nuki::CmdResult::Success) {
+        benchmark.totalUs.push_back(end - start);
+        benchmark.phasesUs.push_back(breakDown(recorder.take(), start, end));
+      } else {
+        benchmark.failures++;
+      }
+      // let the lock finish so late messages do not end up in the next call
+      vTaskDelay(pdMS_TO_TICKS(benchmark.settleUs / 1000 + 20));
+    }
+  }
+  emulator.setTraceListener(nullptr);
+
+  printf("link: %lld us per packet, response delay %lld us, %s connection, %d iterations\n\n",
+         (long long)packetUs, (long long)responseDelayUs, cold ? "cold" : "warm", iterations);
+  for (const Benchmark& benchmark : benchmarks) {
+    report(benchmark);
+    printf("\n");
+  }
+
+  nukiLock.unPairNuki();
+  emulator.end();
+  return 0;
+}
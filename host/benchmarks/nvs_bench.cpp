@@ -0,0 +1,166 @@
+/**
+ * @file nvs_bench.cpp
+ * Host (Linux) benchmark: NVS flash traffic of the credential and pincode persistence of NukiBle.
+ *
+ * usage: nuki_nvs_bench [cycles] [blocking|counted]
+ *
+ * Every cycle re-pairs a NukiLock with an emulated Smart Lock and changes its pincode:
+ * - unPairNuki:          deleteCredentials
+ * - pairNuki:            pairing with the emulator, then saveCredentials
+ * - setSecurityPin:      command to the emulator, then saveCredentials with a new pincode
+ * - saveSecurityPincode: the stored pincode, then a new one
+ * The NVS stand-in models the flash pages of the default partition (see NvsHost.h), the report gives per call
+ * the nvs_set calls, the flash program operations, the programmed bytes, page erases and the flash time.
+ * "blocking" (default) blocks the calling task for the flash time, so the wall time includes it, "counted" only
+ * counts it. The projection gives the re-pairings until the most erased page reaches 100000 erase cycles.
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ */
+
+#include "NukiLock.h"
+#include "BleScanner.h"
+#include "SmartLockEmulator.h"
+#include "NvsHost.h"
+#include "esp_timer.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace {
+
+const uint32_t FLASH_ENDURANCE_CYCLES = 100000;
+
+struct Operation {
+  std::string name;
+  uint32_t calls = 0;
+  uint32_t failures = 0;
+  NvsHost::FlashStatistics flash;
+  int64_t wallUs = 0;
+};
+
+void measure(Operation& operation, const std::function<bool()>& call) {
+  NvsHost::FlashStatistics before = NvsHost::getFlashStatistics();
+  int64_t start = esp_timer_get_time();
+  bool success = call();
+  int64_t wallUs = esp_timer_get_time() - start;
+  NvsHost::FlashStatistics after = NvsHost::getFlashStatistics();
+
+  operation.calls++;
+  operation.failures += !success;
+  operation.wallUs += wallUs;
+  operation.flash.setCalls += after.setCalls - before.setCalls;
+  operation.flash.unchangedSets += after.unchangedSets - before.unchangedSets;
+  operation.flash.commits += after.commits - before.commits;
+  operation.flash.flashWrites += after.flashWrites - before.flashWrites;
+  operation.flash.entryWrites += after.entryWrites - before.entryWrites;
+  operation.flash.stateWrites += after.stateWrites - before.stateWrites;
+  operation.flash.garbageCollections += after.garbageCollections - before.garbageCollections;
+  operation.flash.pageErases += after.pageErases - before.pageErases;
+  operation.flash.flashBusyUs += after.flashBusyUs - before.flashBusyUs;
+}
+
+void print(const Operation& operation) {
+  double calls = operation.calls ? operation.calls : 1;
+  printf("  %-27s %6u %8.2f %9.2f %8.2f %9.1f %8.3f %10.3f %10.3f\n", operation.name.c_str(), operation.calls,
+         operation.flash.setCalls / calls, operation.flash.unchangedSets / calls, operation.flash.flashWrites / calls,
+         operation.flash.entryWrites * 32 / calls, operation.flash.pageErases / calls,
+         operation.flash.flashBusyUs / calls / 1000.0, operation.wallUs / calls / 1000.0);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  int cycles = argc > 1 ? atoi(argv[1]) : 50;
+  bool blocking = argc > 2 ? strcmp(argv[2], "counted") != 0 : true;
+
+  esp_log_level_set("*", ESP_LOG_WARN);
+
+  NvsHost::FlashTiming timing;
+  timing.blocking = blocking;
+  NvsHost::setFlashTiming(timing);
+
+  NukiEmulator::SmartLockEmulator emulator(NimBLEAddress("54:d2:72:00:00:01", 0), 0x2A000001);
+  emulator.setSecurityPin(1234);
+  emulator.begin();
+  emulator.startAdvertising(20 * 1000);
+
+  BleScanner::Scanner scanner;
+  scanner.initialize();
+  NukiLock::NukiLock nukiLock("nvs", 1);
+  nukiLock.initialize();
+  nukiLock.registerBleScanner(&scanner);
+
+  Operation unpair{"unPairNuki"};
+  Operation pair{"pairNuki"};
+  Operation setPin{"setSecurityPin"};
+  Operation samePincode{"saveSecurityPincode (same)"};
+  Operation newPincode{"saveSecurityPincode (new)"};
+
+  uint16_t pin = 1234;
+  for (int i = 0; i < cycles; i++) {
+    measure(unpair, [&]() {
+      nukiLock.unPairNuki();
+      return true;
+    });
+
+    emulator.setPairingMode(true);
+    measure(pair, [&]() {
+      int64_t pairingStart = esp_timer_get_time();
+      while (nukiLock.pairNuki() != Nuki::PairingResult::Success) {
+        if (esp_timer_get_time() - pairingStart > 30 * 1000 * 1000) {
+          return false;
+        }
+        vTaskDelay(pdMS_TO_TICKS(20));
+      }
+      return true;
+    });
+    emulator.setPairingMode(false);
+    if (pair.failures) {
+      printf("pairing failed\n");
+      break;
+    }
+
+    // the pincode is only kept by saveCredentials if the lock was paired before
+    nukiLock.saveSecurityPincode(pin);
+    pin = pin == 1234 ? 4321 : 1234;
+    measure(setPin, [&]() {
+      return nukiLock.setSecurityPin(pin) == Nuki::CmdResult::Success;
+    });
+    measure(samePincode, [&]() {
+      return nukiLock.saveSecurityPincode(pin);
+    });
+    measure(newPincode, [&]() {
+      return nukiLock.saveSecurityPincode(pin + 1) && nukiLock.saveSecurityPincode(pin);
+    });
+  }
+  // two calls per measurement
+  newPincode.calls *= 2;
+
+  NvsHost::FlashStatistics total = NvsHost::getFlashStatistics();
+  printf("%d cycles, flash time %s\n\n", cycles, blocking ? "blocking" : "counted");
+  printf("  %-27s %6s %8s %9s %8s %9s %8s %10s %10s\n", "operation", "calls", "sets", "unchanged", "writes",
+         "bytes", "erases", "flash ms", "wall ms");
+  for (const Operation* operation : {&unpair, &pair, &setPin, &samePincode, &newPincode}) {
+    print(*operation);
+  }
+
+  uint64_t repairErases = unpair.flash.pageErases + pair.flash.pageErases;
+  printf("\ngarbage collections %llu, page erases %llu, most erased page %u cycles\n",
+         (unsigned long long)total.garbageCollections, (unsigned long long)total.pageErases,
+         total.maxPageEraseCycles);
+  printf("page erases per 1000 re-pairings: %.1f\n", pair.calls ? repairErases * 1000.0 / pair.calls : 0.0);
+  if (total.maxPageEraseCycles > 0) {
+    printf("cycles until a page reaches %u erases: %.0f\n", FLASH_ENDURANCE_CYCLES,
+           (double)cycles * FLASH_ENDURANCE_CYCLES / total.maxPageEraseCycles);
+  }
+
+  nukiLock.unPairNuki();
+  emulator.end();
+  NimBLEHost::flush();
+  return pair.failures + setPin.failures ? 1 : 0;
+}
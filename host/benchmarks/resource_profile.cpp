@@ -0,0 +1,112 @@
+/**
+ * @file resource_profile.cpp
+ * Host (Linux) benchmark: stack and heap use per command with a ResourceProfiler, against an emulated Smart Lock.
+ *
+ * usage: nuki_resource_profile [iterations] [stack probe bytes]
+ *
+ * Every call runs the public commands of NukiLock (states, battery report, config, advanced config, lock action,
+ * log, authorization, keypad and time control entries), the report lists the executeAction calls of the calling
+ * thread and the received messages of the BLE thread. Stack depths are those of the host build (x86-64, no
+ * size optimization), run the profiler on the target to size FreeRTOS task stacks.
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ */
+
+#include "NukiLock.h"
+#include "NukiResourceProfiler.h"
+#include "BleScanner.h"
+#include "SmartLockEmulator.h"
+#include "esp_timer.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <list>
+
+int main(int argc, char** argv) {
+  int iterations = argc > 1 ? atoi(argv[1]) : 5;
+  uint32_t stackProbeBytes = argc > 2 ? atoi(argv[2]) : 32 * 1024;
+  const int64_t packetUs = 1000;
+  const int64_t actionDurationUs = 100 * 1000;
+
+  esp_log_level_set("*", ESP_LOG_WARN);
+
+  NukiEmulator::LinkProfile profile;
+  profile.connectUs = 6 * packetUs;
+  profile.discoveryUs = 2 * packetUs;
+  profile.subscribeUs = packetUs;
+  profile.writeUs = packetUs;
+  profile.indicationUs = packetUs;
+
+  NukiEmulator::SmartLockEmulator emulator(NimBLEAddress("54:d2:72:00:00:01", 0), 0x2A000001);
+  emulator.setLinkProfile(profile);
+  emulator.setActionDuration(actionDurationUs);
+  emulator.setSecurityPin(1234);
+  emulator.addLogEntries(50);
+  emulator.setPairingMode(true);
+  emulator.begin();
+  emulator.startAdvertising(100 * 1000);
+
+  BleScanner::Scanner scanner;
+  scanner.initialize();
+  NukiLock::NukiLock nukiLock("profile", 1);
+  nukiLock.initialize();
+  nukiLock.registerBleScanner(&scanner);
+  nukiLock.unPairNuki();
+
+  int64_t pairingStart = esp_timer_get_time();
+  while (nukiLock.pairNuki() != Nuki::PairingResult::Success) {
+    if (esp_timer_get_time() - pairingStart > 30 * 1000 * 1000) {
+      printf("pairing failed\n");
+      return 1;
+    }
+    vTaskDelay(pdMS_TO_TICKS(50));
+  }
+  emulator.setPairingMode(false);
+  nukiLock.saveSecurityPincode(1234);
+
+  Nuki::ResourceProfiler profiler(stackProbeBytes);
+  nukiLock.setResourceProfiler(&profiler);
+
+  NukiLock::KeyTurnerState keyTurnerState;
+  NukiLock::BatteryReport batteryReport;
+  NukiLock::Config config;
+  NukiLock::AdvancedConfig advancedConfig;
+  unsigned int failures = 0;
+  for (int i = 0; i < iterations; i++) {
+    failures += nukiLock.requestKeyTurnerState(&keyTurnerState) != Nuki::CmdResult::Success;
+    failures += nukiLock.requestBatteryReport(&batteryReport) != Nuki::CmdResult::Success;
+    failures += nukiLock.requestConfig(&config) != Nuki::CmdResult::Success;
+    failures += nukiLock.requestAdvancedConfig(&advancedConfig) != Nuki::CmdResult::Success;
+    failures += nukiLock.lockAction((i % 2) ? NukiLock::LockAction::Lock : NukiLock::LockAction::Unlock)
+                != Nuki::CmdResult::Success;
+    vTaskDelay(pdMS_TO_TICKS((actionDurationUs + 4 * packetUs) / 1000 + 20));
+    // the streams are still running when the calls return
+    failures += nukiLock.retrieveLogEntries(0, 20, 1, true) != Nuki::CmdResult::Success;
+    vTaskDelay(pdMS_TO_TICKS(22 * packetUs / 1000 + 20));
+    failures += nukiLock.retrieveAuthorizationEntries(0, 10) != Nuki::CmdResult::Success;
+    vTaskDelay(pdMS_TO_TICKS(10 * packetUs / 1000 + 20));
+    failures += nukiLock.retrieveKeypadEntries(0, 10) != Nuki::CmdResult::Success;
+    vTaskDelay(pdMS_TO_TICKS(10 * packetUs / 1000 + 20));
+    failures += nukiLock.retrieveTimeControlEntries() != Nuki::CmdResult::Success;
+    vTaskDelay(pdMS_TO_TICKS(10 * packetUs / 1000 + 20));
+  }
+  NimBLEHost::flush();
+  nukiLock.setResourceProfiler(nullptr);
+
+  std::list<Nuki::ResourceUsageEntry> entries;
+  profiler.getUsage(&entries);
+  printf("%d iterations, %u failed commands, stack probe %u bytes\n\n", iterations, failures, stackProbeBytes);
+  printf("  %-8s %-8s %6s %12s %12s %12s %12s %12s\n", "call", "command", "calls", "stack peak",
+         "allocs peak", "bytes peak", "allocs/call", "retained");
+  for (const Nuki::ResourceUsageEntry& entry : entries) {
+    printf("  %-8s 0x%04x   %6u %12u %12u %12u %12.1f %12d\n",
+           entry.call == Nuki::ProfiledCall::ExecuteAction ? "execute" : "receive", (unsigned int)entry.command,
+           entry.usage.calls, entry.usage.peakStackBytes, entry.usage.peakHeapAllocations, entry.usage.peakHeapBytes,
+           (double)entry.usage.totalHeapAllocations / entry.usage.calls, entry.usage.peakHeapRetainedBytes);
+  }
+
+  nukiLock.unPairNuki();
+  emulator.end();
+  return failures ? 1 : 0;
+}
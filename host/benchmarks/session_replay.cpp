@@ -0,0 +1,224 @@
+/**
+ * @file session_replay.cpp
+ * Host (Linux) benchmark: records BLE sessions to a file and replays them through the receive path of NukiBle.
+ *
+ * usage: nuki_session_replay record <file> [iterations]
+ *        nuki_session_replay replay <file> [speed] [repeat] [lock|opener]
+ *
+ * record runs a scripted session (states, battery report, config, lock action, log, authorization and time
+ * control entries) against an emulated Smart Lock with a SessionFileRecorder attached. Recordings of real
+ * locks are made the same way on the ESP, with NukiBle::setSessionRecorder() and a file on a mounted
+ * file system.
+ *
+ * replay feeds the received frames of a recording into NukiBle::replayReturnMessage(). speed 1 keeps the
+ * recorded timing, 10 replays ten times faster, 0 replays without waiting (default). Logging is disabled
+ * during the replay, the report shows the time spent in the receive path per frame and per command.
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ */
+
+#include "NukiLock.h"
+#include "NukiOpener.h"
+#include "NukiSessionRecorder.h"
+#include "BleScanner.h"
+#include "SmartLockEmulator.h"
+#include "esp_timer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct CommandStatistics {
+  uint32_t frames = 0;
+  uint64_t bytes = 0;
+  int64_t handleNs = 0;
+};
+
+int64_t nowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+           std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int record(const char* path, const int iterations) {
+  const int64_t packetUs = 1000;
+  const int64_t actionDurationUs = 100 * 1000;
+  const uint16_t logEntryCount = 20;
+
+  esp_log_level_set("*", ESP_LOG_WARN);
+
+  NukiEmulator::LinkProfile profile;
+  profile.connectUs = 6 * packetUs;
+  profile.discoveryUs = 2 * packetUs;
+  profile.subscribeUs = packetUs;
+  profile.writeUs = packetUs;
+  profile.indicationUs = packetUs;
+
+  NukiEmulator::SmartLockEmulator emulator(NimBLEAddress("54:d2:72:00:00:01", 0), 0x2A000001);
+  emulator.setLinkProfile(profile);
+  emulator.setActionDuration(actionDurationUs);
+  emulator.setSecurityPin(1234);
+  emulator.addLogEntries(50);
+  emulator.setPairingMode(true);
+  emulator.begin();
+  emulator.startAdvertising(100 * 1000);
+
+  BleScanner::Scanner scanner;
+  scanner.initialize();
+  NukiLock::NukiLock nukiLock("recorder", 1);
+  nukiLock.initialize();
+  nukiLock.registerBleScanner(&scanner);
+  nukiLock.unPairNuki();
+
+  int64_t pairingStart = esp_timer_get_time();
+  while (nukiLock.pairNuki() != Nuki::PairingResult::Success) {
+    if (esp_timer_get_time() - pairingStart > 30 * 1000 * 1000) {
+      printf("pairing failed\n");
+      return 1;
+    }
+    vTaskDelay(pdMS_TO_TICKS(50));
+  }
+  emulator.setPairingMode(false);
+  nukiLock.saveSecurityPincode(1234);
+
+  Nuki::SessionFileRecorder recorder(path);
+  if (!recorder.isOpen()) {
+    return 1;
+  }
+  nukiLock.setSessionRecorder(&recorder);
+
+  NukiLock::KeyTurnerState keyTurnerState;
+  NukiLock::BatteryReport batteryReport;
+  NukiLock::Config config;
+  NukiLock::AdvancedConfig advancedConfig;
+  unsigned int failures = 0;
+  for (int i = 0; i < iterations; i++) {
+    failures += nukiLock.requestKeyTurnerState(&keyTurnerState) != Nuki::CmdResult::Success;
+    failures += nukiLock.requestBatteryReport(&batteryReport) != Nuki::CmdResult::Success;
+    failures += nukiLock.requestConfig(&config) != Nuki::CmdResult::Success;
+    failures += nukiLock.requestAdvancedConfig(&advancedConfig) != Nuki::CmdResult::Success;
+    failures += nukiLock.lockAction((i % 2) ? NukiLock::LockAction::Lock : NukiLock::LockAction::Unlock)
+                != Nuki::CmdResult::Success;
+    vTaskDelay(pdMS_TO_TICKS((actionDurationUs + 4 * packetUs) / 1000 + 20));
+    // the streams are still running when the calls return
+    failures += nukiLock.retrieveLogEntries(0, logEntryCount, 1, true) != Nuki::CmdResult::Success;
+    vTaskDelay(pdMS_TO_TICKS((logEntryCount + 2) * packetUs / 1000 + 20));
+    failures += nukiLock.retrieveAuthorizationEntries(0, 10) != Nuki::CmdResult::Success;
+    vTaskDelay(pdMS_TO_TICKS(10 * packetUs / 1000 + 20));
+    failures += nukiLock.retrieveTimeControlEntries() != Nuki::CmdResult::Success;
+    vTaskDelay(pdMS_TO_TICKS(10 * packetUs / 1000 + 20));
+  }
+  NimBLEHost::flush();
+  nukiLock.setSessionRecorder(nullptr);
+  recorder.close();
+
+  printf("recorded %u frames to %s, %u failed commands\n", recorder.getFrameCount(), path, failures);
+  nukiLock.unPairNuki();
+  emulator.end();
+  return failures ? 1 : 0;
+}
+
+int replay(Nuki::NukiBle& nukiBle, const char* path, const double speed, const int repeat) {
+  Nuki::SessionFileReader reader(path);
+  if (!reader.isOpen()) {
+    return 1;
+  }
+  nukiBle.setEventHandler(nullptr);
+  esp_log_level_set("*", ESP_LOG_NONE);
+
+  std::map<Nuki::Command, CommandStatistics> statistics;
+  std::vector<int64_t> frameNs;
+  uint32_t sentFrames = 0;
+  int64_t recordedUs = 0;
+  int64_t start = esp_timer_get_time();
+
+  for (int i = 0; i < repeat; i++) {
+    reader.rewind();
+    int64_t passStart = esp_timer_get_time();
+    Nuki::SessionFrame frame;
+    while (reader.next(&frame)) {
+      recordedUs = std::max(recordedUs, frame.timestampUs);
+      if (frame.direction == Nuki::FrameDirection::Sent) {
+        sentFrames++;
+        continue;
+      }
+      if (speed > 0) {
+        int64_t dueUs = passStart + (int64_t)(frame.timestampUs / speed);
+        int64_t waitUs = dueUs - esp_timer_get_time();
+        if (waitUs > 0) {
+          std::this_thread::sleep_for(std::chrono::microseconds(waitUs));
+        }
+      }
+      int64_t handleStart = nowNs();
+      nukiBle.replayReturnMessage(frame.command, frame.data.data(), frame.length);
+      int64_t handleNs = nowNs() - handleStart;
+
+      CommandStatistics& commandStatistics = statistics[frame.command];
+      commandStatistics.frames++;
+      commandStatistics.bytes += frame.length;
+      commandStatistics.handleNs += handleNs;
+      frameNs.push_back(handleNs);
+    }
+  }
+  int64_t elapsedUs = esp_timer_get_time() - start;
+  esp_log_level_set("*", ESP_LOG_WARN);
+
+  if (frameNs.empty()) {
+    printf("%s contains no received frames\n", path);
+    return 1;
+  }
+  std::sort(frameNs.begin(), frameNs.end());
+  int64_t totalNs = 0;
+  for (int64_t ns : frameNs) {
+    totalNs += ns;
+  }
+  char pace[32] = "full speed";
+  if (speed > 0) {
+    snprintf(pace, sizeof(pace), "%gx speed", speed);
+  }
+  printf("%s: %zu received frames (%u sent frames skipped), recorded duration %.2f ms, %d pass(es) at %s\n",
+         path, frameNs.size(), sentFrames, recordedUs / 1000.0, repeat, pace);
+  printf("replay took %.2f ms, receive path %.3f ms: mean %lld ns, p50 %lld ns, p99 %lld ns per frame\n\n",
+         elapsedUs / 1000.0, totalNs / 1e6, (long long)(totalNs / (int64_t)frameNs.size()),
+         (long long)frameNs[frameNs.size() / 2], (long long)frameNs[(frameNs.size() * 99) / 100]);
+  printf("  %-8s %8s %10s %12s\n", "command", "frames", "bytes", "ns/frame");
+  for (const auto& entry : statistics) {
+    printf("  0x%04x   %8u %10llu %12lld\n", (unsigned int)entry.first, entry.second.frames,
+           (unsigned long long)entry.second.bytes, (long long)(entry.second.handleNs / entry.second.frames));
+  }
+  return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    printf("usage: %s record <file> [iterations]\n", argv[0]);
+    printf("       %s replay <file> [speed] [repeat] [lock|opener]\n", argv[0]);
+    return 2;
+  }
+  const char* path = argv[2];
+
+  if (strcmp(argv[1], "record") == 0) {
+    return record(path, argc > 3 ? atoi(argv[3]) : 10);
+  }
+  if (strcmp(argv[1], "replay") == 0) {
+    double speed = argc > 3 ? atof(argv[3]) : 0;
+    int repeat = argc > 4 ? std::max(1, atoi(argv[4])) : 1;
+    if (argc > 5 && strcmp(argv[5], "opener") == 0) {
+      NukiOpener::NukiOpener nukiOpener("replay", 1);
+      return replay(nukiOpener, path, speed, repeat);
+    }
+    NukiLock::NukiLock nukiLock("replay", 1);
+    return replay(nukiLock, path, speed, repeat);
+  }
+  printf("unknown mode %s\n", argv[1]);
+  return 2;
+}
@@ -0,0 +1,1016 @@
+/**
+ * @file KeyturnerEmulator.cpp
+ * Host (Linux) only: the device side of the Nuki BLE protocol.
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ */
+
+#include "KeyturnerEmulator.h"
+#include "NukiUtils.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "sodium/crypto_scalarmult.h"
+#include "sodium/crypto_core_hsalsa20.h"
+#include "sodium/crypto_auth_hmacsha256.h"
+#include "sodium/crypto_secretbox.h"
+#include "sodium/crypto_box.h"
+#include "sodium/randombytes.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace NukiEmulator {
+
+namespace {
+
+// error codes are identical for lock and opener
+const uint8_t ERROR_BAD_CRC = 0xFD;
+const uint8_t ERROR_BAD_LENGTH = 0xFE;
+const uint8_t P_ERROR_NOT_PAIRING = 0x10;
+const uint8_t P_ERROR_BAD_AUTHENTICATOR = 0x11;
+const uint8_t P_ERROR_BAD_PARAMETER = 0x12;
+const uint8_t K_ERROR_BAD_PIN = 0x21;
+const uint8_t K_ERROR_BAD_NONCE = 0x22;
+const uint8_t K_ERROR_BAD_PARAMETER = 0x23;
+const uint8_t K_ERROR_CODE_INVALID = 0x2B;
+
+const size_t NONCE_LENGTH = 32;
+const size_t PIN_LENGTH = 2;
+// nonce(24) + authorization id(4) + length(2)
+const size_t ENCRYPTED_HEADER_LENGTH = crypto_secretbox_NONCEBYTES + 6;
+
+void appendU16(std::vector<uint8_t>& data, const uint16_t value) {
+  data.push_back(value & 0xFF);
+  data.push_back(value >> 8);
+}
+
+void appendU32(std::vector<uint8_t>& data, const uint32_t value) {
+  for (int i = 0; i < 4; i++) {
+    data.push_back((value >> (8 * i)) & 0xFF);
+  }
+}
+
+uint16_t readU16(const uint8_t* data) {
+  return (uint16_t)data[0] | ((uint16_t)data[1] << 8);
+}
+
+uint32_t readU32(const uint8_t* data) {
+  return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+void appendCrc(std::vector<uint8_t>& data) {
+  appendU16(data, (uint16_t)Nuki::calculateCrc(data.data(), 0, data.size()));
+}
+
+bool crcMatches(const uint8_t* data, size_t length) {
+  if (length < 2) {
+    return false;
+  }
+  return readU16(&data[length - 2]) == (uint16_t)Nuki::calculateCrc((uint8_t*)data, 0, length - 2);
+}
+
+bool isCommandWithPin(const Nuki::Command command) {
+  switch (command) {
+    case Nuki::Command::RequestConfig:
+    case Nuki::Command::RequestAdvancedConfig:
+    case Nuki::Command::LockAction:
+    case Nuki::Command::KeypadAction:
+    case Nuki::Command::SimpleLockAction:
+      return false;
+    default:
+      return true;
+  }
+}
+
+} // namespace
+
+struct tm utcNow() {
+  time_t now = time(nullptr);
+  struct tm utc;
+  gmtime_r(&now, &utc);
+  return utc;
+}
+
+KeyturnerEmulator::KeyturnerEmulator(const NimBLEAddress& address,
+                                     const uint32_t nukiId,
+                                     const NimBLEUUID& pairingServiceUUID,
+                                     const NimBLEUUID& deviceServiceUUID,
+                                     const NimBLEUUID& gdioUUID,
+                                     const NimBLEUUID& userDataUUID)
+  : liveness(std::make_shared<Liveness>()),
+    mutex(liveness->mutex),
+    address(address),
+    nukiId(nukiId),
+    pairingServiceUUID(pairingServiceUUID),
+    deviceServiceUUID(deviceServiceUUID),
+    gdioUUID(gdioUUID),
+    userDataUUID(userDataUUID),
+    lossGenerator(linkProfile.seed) {
+  crypto_box_keypair(publicKey, privateKey);
+}
+
+KeyturnerEmulator::~KeyturnerEmulator() {
+  shutdown();
+}
+
+void KeyturnerEmulator::begin() {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  if (!registered) {
+    NimBLEHost::addPeripheral(this);
+    registered = true;
+  }
+}
+
+void KeyturnerEmulator::end() {
+  {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    advertisingGeneration++;
+    if (!registered) {
+      return;
+    }
+    registered = false;
+  }
+  // removing the peripheral disconnects the client, which calls back into onDisconnect()
+  NimBLEHost::removePeripheral(this);
+}
+
+void KeyturnerEmulator::setLinkProfile(const LinkProfile& profile) {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  linkProfile = profile;
+  lossGenerator.seed(profile.seed);
+}
+
+LinkProfile KeyturnerEmulator::getLinkProfile() {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  return linkProfile;
+}
+
+NimBLEHost::LinkParameters KeyturnerEmulator::getLinkParameters() {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  return link;
+}
+
+void KeyturnerEmulator::setResponseDelay(const Nuki::Command command, const int64_t delayUs) {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  responseDelays[command] = delayUs;
+}
+
+void KeyturnerEmulator::setActionDuration(const int64_t durationUs) {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  actionDuration = durationUs;
+}
+
+void KeyturnerEmulator::setSecurityPin(const uint16_t pin) {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  securityPin = pin;
+}
+
+void KeyturnerEmulator::setPairingMode(const bool enabled) {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  pairingMode = enabled;
+}
+
+bool KeyturnerEmulator::isPairingMode() {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  return pairingMode;
+}
+
+size_t KeyturnerEmulator::getAuthorizationCount() {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  return authorizations.size();
+}
+
+void KeyturnerEmulator::startAdvertising(const int64_t intervalUs) {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  advertisingInterval = intervalUs;
+  scheduleAdvertisement(++advertisingGeneration, 0);
+}
+
+void KeyturnerEmulator::stopAdvertising() {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  advertisingGeneration++;
+}
+
+void KeyturnerEmulator::advertise(const int rssi) {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  std::vector<uint8_t> payload = {0x02, 0x01, 0x06};
+
+  if (pairingMode) {
+    // service data of the pairing service, announces the pairing mode
+    payload.push_back(2 + 16);
+    payload.push_back(0x21);
+    payload.insert(payload.end(), pairingServiceUUID.getValue(), pairingServiceUUID.getValue() + 16);
+    payload.push_back(0x01);
+
+    char name[16];
+    snprintf(name, sizeof(name), "Nuki_%08X", nukiId);
+    payload.push_back(1 + strlen(name));
+    payload.push_back(0x09);
+    payload.insert(payload.end(), name, name + strlen(name));
+  } else {
+    // iBeacon: apple company id, type, length, proximity uuid (big endian), major, minor, tx power
+    payload.push_back(1 + 25);
+    payload.push_back(0xFF);
+    payload.insert(payload.end(), {0x4C, 0x00, 0x02, 0x15});
+    const uint8_t* uuid = deviceServiceUUID.getValue();
+    for (int i = 15; i >= 0; i--) {
+      payload.push_back(uuid[i]);
+    }
+    payload.insert(payload.end(), {(uint8_t)(nukiId >> 24), (uint8_t)(nukiId >> 16),
+                                   (uint8_t)(nukiId >> 8), (uint8_t)nukiId});
+    // bit 0 of the tx power signals a state change
+    payload.push_back(stateChanged ? 0xC5 : 0xC4);
+  }
+
+  NimBLEHost::advertise(NimBLEAdvertisedDevice(address, rssi, payload));
+}
+
+void KeyturnerEmulator::disconnect() {
+  // not holding the mutex, the host calls back into onDisconnect()
+  NimBLEHost::disconnectPeripheral(this, 0x13);
+}
+
+bool KeyturnerEmulator::isConnected() {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  return connected;
+}
+
+Statistics KeyturnerEmulator::getStatistics() {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  return statistics;
+}
+
+void KeyturnerEmulator::resetStatistics() {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  statistics = Statistics();
+}
+
+void KeyturnerEmulator::setTraceListener(TraceListener listener) {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  traceListener = listener;
+}
+
+NimBLEAddress KeyturnerEmulator::getAddress() const {
+  return address;
+}
+
+bool KeyturnerEmulator::hasService(const NimBLEUUID& service) const {
+  return service == pairingServiceUUID || service == deviceServiceUUID;
+}
+
+bool KeyturnerEmulator::hasCharacteristic(const NimBLEUUID& service, const NimBLEUUID& characteristic) const {
+  return (service == pairingServiceUUID && characteristic == gdioUUID)
+         || (service == deviceServiceUUID && characteristic == userDataUUID);
+}
+
+int64_t KeyturnerEmulator::linkDelayUs(NimBLEHost::LinkOp op, size_t length) {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  int64_t now = esp_timer_get_time();
+  switch (op) {
+    case NimBLEHost::LinkOp::Connect:
+      trace(TraceEventType::Connect, now, now + linkProfile.connectUs);
+      return linkProfile.connectUs;
+    case NimBLEHost::LinkOp::DiscoverService:
+      trace(TraceEventType::DiscoverService, now, now + linkProfile.discoveryUs);
+      return linkProfile.discoveryUs;
+    case NimBLEHost::LinkOp::DiscoverCharacteristic:
+      trace(TraceEventType::DiscoverCharacteristic, now, now + linkProfile.discoveryUs);
+      return linkProfile.discoveryUs;
+    case NimBLEHost::LinkOp::Subscribe:
+      trace(TraceEventType::Subscribe, now, now + linkProfile.subscribeUs);
+      return linkProfile.subscribeUs;
+    case NimBLEHost::LinkOp::Write:
+      writeStartUs = now;
+      return transferUs(length, linkProfile.writeUs);
+  }
+  return 0;
+}
+
+bool KeyturnerEmulator::onConnect() {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  if (connected) {
+    // the keyturner accepts a single connection
+    return false;
+  }
+  connected = true;
+  connectionGeneration++;
+  statistics.connects++;
+  return true;
+}
+
+NimBLEHost::LinkParameters KeyturnerEmulator::negotiateLink(const NimBLEHost::LinkParameters& requested) {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  link = requested;
+  if (!linkProfile.phy2M) {
+    link.phy = BLE_GAP_LE_PHY_1M;
+  }
+  link.dataLength = std::min(requested.dataLength, std::max<uint16_t>(linkProfile.maxDataLength, 27));
+  return link;
+}
+
+void KeyturnerEmulator::onDisconnect() {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  if (!connected) {
+    return;
+  }
+  connected = false;
+  connectionGeneration++;
+  statistics.disconnects++;
+  challenges.clear();
+  pairingAuthorizationId = 0;
+}
+
+bool KeyturnerEmulator::onWrite(const NimBLEUUID& characteristic, const uint8_t* data, size_t length) {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  writeEndUs = esp_timer_get_time();
+  statistics.writes++;
+  if (lose()) {
+    // acknowledged on the link layer but never processed by the device
+    statistics.lostWrites++;
+    return true;
+  }
+  if (characteristic == gdioUUID) {
+    handlePlainMessage(data, length);
+  } else if (characteristic == userDataUUID) {
+    handleEncryptedMessage(data, length);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+void KeyturnerEmulator::markStateChanged() {
+  stateChanged = true;
+}
+
+uint32_t KeyturnerEmulator::getNukiId() const {
+  return nukiId;
+}
+
+void KeyturnerEmulator::shutdown() {
+  end();
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  liveness->alive = false;
+}
+
+void KeyturnerEmulator::handlePlainMessage(const uint8_t* data, size_t length) {
+  int64_t delay = 0;
+  if (length < 4 || !crcMatches(data, length)) {
+    sendError(0, ERROR_BAD_CRC, Nuki::Command::Empty, &delay);
+    return;
+  }
+  Nuki::Command command = (Nuki::Command)readU16(data);
+  const uint8_t* payload = &data[2];
+  size_t payloadLength = length - 4;
+  statistics.commands[command]++;
+  trace(TraceEventType::Write, writeStartUs, writeEndUs, command);
+  delay = responseDelay(command);
+
+  if (!pairingMode) {
+    sendError(0, P_ERROR_NOT_PAIRING, command, &delay);
+    return;
+  }
+
+  switch (command) {
+    case Nuki::Command::RequestData: {
+      if (payloadLength < 2 || (Nuki::Command)readU16(payload) != Nuki::Command::PublicKey) {
+        sendError(0, P_ERROR_BAD_PARAMETER, command, &delay);
+        return;
+      }
+      sendPlain(Nuki::Command::PublicKey, std::vector<uint8_t>(publicKey, publicKey + 32), &delay);
+      break;
+    }
+    case Nuki::Command::PublicKey: {
+      if (payloadLength != 32) {
+        sendError(0, ERROR_BAD_LENGTH, command, &delay);
+        return;
+      }
+      memcpy(pairingClientKey, payload, 32);
+      unsigned char sharedKeyS[32];
+      if (crypto_scalarmult_curve25519(sharedKeyS, privateKey, pairingClientKey) != 0) {
+        sendError(0, P_ERROR_BAD_PARAMETER, command, &delay);
+        return;
+      }
+      unsigned char in[16] = {0};
+      unsigned char sigma[] = "expand 32-byte k";
+      crypto_core_hsalsa20(pairingSecretKey, in, sharedKeyS, sigma);
+
+      randombytes_buf(pairingChallenge, sizeof(pairingChallenge));
+      sendPlain(Nuki::Command::Challenge, std::vector<uint8_t>(pairingChallenge, pairingChallenge + 32), &delay);
+      break;
+    }
+    case Nuki::Command::AuthorizationAuthenticator: {
+      unsigned char hmacPayload[96];
+      memcpy(&hmacPayload[0], pairingClientKey, 32);
+      memcpy(&hmacPayload[32], publicKey, 32);
+      memcpy(&hmacPayload[64], pairingChallenge, 32);
+      if (payloadLength != 32
+          || crypto_auth_hmacsha256_verify(payload, hmacPayload, sizeof(hmacPayload), pairingSecretKey) != 0) {
+        sendError(0, P_ERROR_BAD_AUTHENTICATOR, command, &delay);
+        return;
+      }
+      randombytes_buf(pairingChallenge, sizeof(pairingChallenge));
+      sendPlain(Nuki::Command::Challenge, std::vector<uint8_t>(pairingChallenge, pairingChallenge + 32), &delay);
+      break;
+    }
+    case Nuki::Command::AuthorizationData: {
+      // authenticator(32) id type(1) id(4) name(32) nonce(32)
+      if (payloadLength != 101) {
+        sendError(0, ERROR_BAD_LENGTH, command, &delay);
+        return;
+      }
+      unsigned char hmacPayload[69 + 32];
+      memcpy(&hmacPayload[0], &payload[32], 69);
+      memcpy(&hmacPayload[69], pairingChallenge, 32);
+      if (crypto_auth_hmacsha256_verify(payload, hmacPayload, sizeof(hmacPayload), pairingSecretKey) != 0) {
+        sendError(0, P_ERROR_BAD_AUTHENTICATOR, command, &delay);
+        return;
+      }
+      pairingAuthorizationId = nextAuthorizationId++;
+      memcpy(pairingAuthorization.secretKey, pairingSecretKey, 32);
+      pairingAuthorization.idType = payload[32];
+      pairingAuthorization.appId = readU32(&payload[33]);
+      pairingAuthorization.name = std::string((const char*)&payload[37], strnlen((const char*)&payload[37], 32));
+
+      // authenticator(32) authorization id(4) uuid(16) nonce(32)
+      std::vector<uint8_t> body;
+      appendU32(body, pairingAuthorizationId);
+      for (int i = 0; i < 4; i++) {
+        appendU32(body, nukiId);
+      }
+      randombytes_buf(pairingChallenge, sizeof(pairingChallenge));
+      body.insert(body.end(), pairingChallenge, pairingChallenge + 32);
+
+      std::vector<uint8_t> hmacData(body);
+      hmacData.insert(hmacData.end(), &payload[69], &payload[101]);
+      unsigned char authenticator[32];
+      crypto_auth_hmacsha256(authenticator, hmacData.data(), hmacData.size(), pairingSecretKey);
+
+      std::vector<uint8_t> response(authenticator, authenticator + 32);
+      response.insert(response.end(), body.begin(), body.end());
+      sendPlain(Nuki::Command::AuthorizationId, response, &delay);
+      break;
+    }
+    case Nuki::Command::AuthorizationIdConfirmation: {
+      // authenticator(32) authorization id(4)
+      if (payloadLength != 36 || pairingAuthorizationId == 0 || readU32(&payload[32]) != pairingAuthorizationId) {
+        sendError(0, P_ERROR_BAD_PARAMETER, command, &delay);
+        return;
+      }
+      unsigned char hmacPayload[36];
+      memcpy(&hmacPayload[0], &payload[32], 4);
+      memcpy(&hmacPayload[4], pairingChallenge, 32);
+      if (crypto_auth_hmacsha256_verify(payload, hmacPayload, sizeof(hmacPayload), pairingSecretKey) != 0) {
+        sendError(0, P_ERROR_BAD_AUTHENTICATOR, command, &delay);
+        return;
+      }
+      authorizations[pairingAuthorizationId] = pairingAuthorization;
+      ESP_LOGI("NukiEmulator", "%08X paired authorization %u (%s)", nukiId, pairingAuthorizationId,
+               pairingAuthorization.name.c_str());
+      pairingAuthorizationId = 0;
+      sendPlain(Nuki::Command::Status, {(uint8_t)Nuki::CommandStatus::Complete}, &delay);
+      break;
+    }
+    default:
+      sendError(0, P_ERROR_BAD_PARAMETER, command, &delay);
+      break;
+  }
+}
+
+void KeyturnerEmulator::handleEncryptedMessage(const uint8_t* data, size_t length) {
+  if (length < ENCRYPTED_HEADER_LENGTH) {
+    statistics.errors++;
+    return;
+  }
+  const uint8_t* nonce = data;
+  uint32_t authId = readU32(&data[crypto_secretbox_NONCEBYTES]);
+  uint16_t encryptedLength = readU16(&data[crypto_secretbox_NONCEBYTES + 4]);
+  auto authorization = authorizations.find(authId);
+  if (authorization == authorizations.end()) {
+    // without the shared key the device cannot answer at all
+    ESP_LOGW("NukiEmulator", "%08X unknown authorization id %u", nukiId, authId);
+    statistics.errors++;
+    return;
+  }
+  if (encryptedLength < crypto_secretbox_MACBYTES || length < ENCRYPTED_HEADER_LENGTH + encryptedLength) {
+    int64_t delay = 0;
+    sendError(authId, ERROR_BAD_LENGTH, Nuki::Command::Empty, &delay);
+    return;
+  }
+
+  std::vector<uint8_t> plain(encryptedLength - crypto_secretbox_MACBYTES);
+  if (crypto_secretbox_open_easy(plain.data(), &data[ENCRYPTED_HEADER_LENGTH], encryptedLength, nonce,
+                                 authorization->second.secretKey) != 0) {
+    ESP_LOGW("NukiEmulator", "%08X message of authorization id %u cannot be decrypted", nukiId, authId);
+    statistics.errors++;
+    return;
+  }
+  // authorization id(4) command(2) payload crc(2)
+  if (plain.size() < 8 || readU32(plain.data()) != authId || !crcMatches(plain.data(), plain.size())) {
+    int64_t delay = 0;
+    sendError(authId, ERROR_BAD_CRC, Nuki::Command::Empty, &delay);
+    return;
+  }
+  Nuki::Command command = (Nuki::Command)readU16(&plain[4]);
+  statistics.commands[command]++;
+  trace(TraceEventType::Write, writeStartUs, writeEndUs, command,
+        command == Nuki::Command::RequestData && plain.size() >= 10 ? readU16(&plain[6]) : 0);
+  handleCommand(authId, command, &plain[6], plain.size() - 8);
+}
+
+void KeyturnerEmulator::handleCommand(const uint32_t authId, const Nuki::Command command, const uint8_t* payload,
+                                      size_t length) {
+  int64_t delay = responseDelay(command);
+
+  if (command == Nuki::Command::RequestData) {
+    if (length < 2) {
+      sendError(authId, ERROR_BAD_LENGTH, command, &delay);
+      return;
+    }
+    switch ((Nuki::Command)readU16(payload)) {
+      case Nuki::Command::Challenge: {
+        std::vector<uint8_t> challenge(NONCE_LENGTH);
+        randombytes_buf(challenge.data(), challenge.size());
+        challenges[authId] = challenge;
+        sendEncrypted(authId, Nuki::Command::Challenge, challenge, &delay);
+        break;
+      }
+      case Nuki::Command::KeyturnerStates:
+        stateChanged = false;
+        sendEncrypted(authId, Nuki::Command::KeyturnerStates, states, &delay);
+        break;
+      case Nuki::Command::BatteryReport:
+        sendEncrypted(authId, Nuki::Command::BatteryReport, batteryReport, &delay);
+        break;
+      case Nuki::Command::Config:
+        sendEncrypted(authId, Nuki::Command::Config, config, &delay);
+        break;
+      default:
+        sendError(authId, K_ERROR_BAD_PARAMETER, command, &delay);
+        break;
+    }
+    return;
+  }
+
+  // every other command is answered to a challenge, most also carry the security pin
+  bool withPin = isCommandWithPin(command);
+  size_t trailer = NONCE_LENGTH + (withPin ? PIN_LENGTH : 0);
+  if (length < trailer) {
+    sendError(authId, ERROR_BAD_LENGTH, command, &delay);
+    return;
+  }
+  size_t bodyLength = length - trailer;
+  if (!checkNonce(authId, command, &payload[bodyLength], &delay)) {
+    return;
+  }
+  if (withPin && !checkPin(authId, command, &payload[bodyLength + NONCE_LENGTH], &delay)) {
+    return;
+  }
+  const uint8_t* body = payload;
+
+  switch (command) {
+    case Nuki::Command::RequestConfig:
+      sendEncrypted(authId, Nuki::Command::Config, config, &delay);
+      break;
+    case Nuki::Command::RequestAdvancedConfig:
+      sendEncrypted(authId, Nuki::Command::AdvancedConfig, advancedConfig, &delay);
+      break;
+    case Nuki::Command::SetConfig:
+      applyConfig(body, bodyLength);
+      sendStatus(authId, Nuki::CommandStatus::Complete, &delay);
+      break;
+    case Nuki::Command::SetAdvancedConfig:
+      applyAdvancedConfig(body, bodyLength);
+      sendStatus(authId, Nuki::CommandStatus::Complete, &delay);
+      break;
+    case Nuki::Command::ContinuousModeAction: {
+      // enabled(1) timeout(1), switched without accept (opener activate/deactivate CM)
+      if (bodyLength < 1) {
+        sendError(authId, ERROR_BAD_LENGTH, command, &delay);
+        return;
+      }
+      uint8_t action = body[0] ? 0x04 : 0x05;
+      if (!beginLockAction(action, authId)) {
+        sendError(authId, K_ERROR_BAD_PARAMETER, command, &delay);
+        return;
+      }
+      completeLockAction(action, authId);
+      markStateChanged();
+      sendStatus(authId, Nuki::CommandStatus::Complete, &delay);
+      break;
+    }
+    case Nuki::Command::LockAction:
+    case Nuki::Command::SimpleLockAction:
+    case Nuki::Command::KeypadAction: {
+      // lock action(1) app id(4) flags(1) [name suffix], keypad action: source(1) code(4) action(1)
+      size_t actionOffset = command == Nuki::Command::KeypadAction ? 5 : 0;
+      if (bodyLength <= actionOffset) {
+        sendError(authId, ERROR_BAD_LENGTH, command, &delay);
+        return;
+      }
+      uint8_t action = body[actionOffset];
+      if (!beginLockAction(action, authId)) {
+        sendError(authId, K_ERROR_BAD_PARAMETER, command, &delay);
+        return;
+      }
+      sendStatus(authId, Nuki::CommandStatus::Accepted, &delay);
+
+      uint64_t generation = connectionGeneration;
+      std::shared_ptr<Liveness> guard = liveness;
+      if (actionDuration > 0) {
+        // the motor is running: the states are sent while the action is in progress
+        NimBLEHost::post(delay + actionDuration / 2, [this, guard, generation, authId]() {
+          std::lock_guard<std::recursive_mutex> lock(guard->mutex);
+          if (!guard->alive || !connected || connectionGeneration != generation) {
+            return;
+          }
+          int64_t stepDelay = 0;
+          sendEncrypted(authId, Nuki::Command::KeyturnerStates, states, &stepDelay);
+        });
+      }
+      NimBLEHost::post(delay + actionDuration, [this, guard, generation, authId, action]() {
+        std::lock_guard<std::recursive_mutex> lock(guard->mutex);
+        if (!guard->alive) {
+          return;
+        }
+        // the action completes even if the client is gone
+        completeLockAction(action, authId);
+        markStateChanged();
+        if (!connected || connectionGeneration != generation) {
+          return;
+        }
+        int64_t stepDelay = 0;
+        sendEncrypted(authId, Nuki::Command::KeyturnerStates, states, &stepDelay);
+        sendStatus(authId, Nuki::CommandStatus::Complete, &stepDelay);
+      });
+      break;
+    }
+    case Nuki::Command::RequestLogEntries: {
+      // start index(4) count(2) sort order(1) total count(1)
+      if (bodyLength < 8) {
+        sendError(authId, ERROR_BAD_LENGTH, command, &delay);
+        return;
+      }
+      uint32_t startIndex = readU32(body);
+      uint16_t count = readU16(&body[4]);
+      bool descending = body[6] != 0;
+      bool totalCount = body[7] != 0;
+
+      std::vector<std::vector<uint8_t>> entries;
+      size_t total = logEntries.size();
+      // log indices start at 1, start index 0 is the oldest (ascending) or newest (descending) entry
+      size_t position;
+      if (startIndex == 0) {
+        position = descending ? total : 1;
+      } else {
+        position = startIndex;
+      }
+      while (entries.size() < count && position >= 1 && position <= total) {
+        entries.push_back(logEntries[position - 1]);
+        position = descending ? position - 1 : position + 1;
+      }
+      std::vector<uint8_t> countPayload;
+      if (totalCount) {
+        // logging enabled(1) count(2) door sensor enabled(1) door sensor logging enabled(1)
+        countPayload.push_back(0x01);
+        appendU16(countPayload, (uint16_t)total);
+        countPayload.push_back(0x00);
+        countPayload.push_back(0x00);
+      }
+      sendStream(authId, Nuki::Command::LogEntryCount, countPayload, Nuki::Command::LogEntry, entries, &delay);
+      break;
+    }
+    case Nuki::Command::RequestAuthorizationEntries: {
+      // offset(2) count(2)
+      if (bodyLength < 4) {
+        sendError(authId, ERROR_BAD_LENGTH, command, &delay);
+        return;
+      }
+      uint16_t offset = readU16(body);
+      uint16_t count = readU16(&body[2]);
+      std::vector<std::vector<uint8_t>> entries;
+      size_t index = 0;
+      for (const auto& authorization : authorizations) {
+        if (index++ < offset) {
+          continue;
+        }
+        if (entries.size() >= count) {
+          break;
+        }
+        Nuki::AuthorizationEntry entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.authId = authorization.first;
+        entry.idType = authorization.second.idType;
+        memcpy(entry.name, authorization.second.name.c_str(), std::min<size_t>(authorization.second.name.size(), 32));
+        entry.enabled = 1;
+        entry.remoteAllowed = 1;
+        entries.push_back(toBytes(entry));
+      }
+      std::vector<uint8_t> countPayload;
+      appendU16(countPayload, (uint16_t)authorizations.size());
+      sendStream(authId, Nuki::Command::AuthorizationEntryCount, countPayload, Nuki::Command::AuthorizationEntry,
+                 entries, &delay);
+      break;
+    }
+    case Nuki::Command::RequestTimeControlEntries: {
+      std::vector<uint8_t> countPayload = {(uint8_t)timeControlEntries.size()};
+      sendStream(authId, Nuki::Command::TimeControlEntryCount, countPayload, Nuki::Command::TimeControlEntry,
+                 timeControlEntries, &delay);
+      break;
+    }
+    case Nuki::Command::AddTimeControlEntry: {
+      // weekdays(1) hour(1) minute(1) action(1)
+      if (bodyLength < 4) {
+        sendError(authId, ERROR_BAD_LENGTH, command, &delay);
+        return;
+      }
+      uint8_t entryId = 1;
+      for (const auto& entry : timeControlEntries) {
+        entryId = std::max<uint8_t>(entryId, entry[0] + 1);
+      }
+      // entry id(1) enabled(1) weekdays(1) hour(1) minute(1) action(1)
+      std::vector<uint8_t> entry = {entryId, 0x01};
+      entry.insert(entry.end(), body, body + 4);
+      timeControlEntries.push_back(entry);
+      sendEncrypted(authId, Nuki::Command::TimeControlEntryId, {entryId}, &delay);
+      break;
+    }
+    case Nuki::Command::UpdateTimeControlEntry:
+    case Nuki::Command::RemoveTimeControlEntry: {
+      if (bodyLength < (command == Nuki::Command::UpdateTimeControlEntry ? 6u : 1u)) {
+        sendError(authId, ERROR_BAD_LENGTH, command, &delay);
+        return;
+      }
+      auto entry = std::find_if(timeControlEntries.begin(), timeControlEntries.end(),
+                                [body](const std::vector<uint8_t>& e) { return e[0] == body[0]; });
+      if (entry == timeControlEntries.end()) {
+        sendError(authId, K_ERROR_BAD_PARAMETER, command, &delay);
+        return;
+      }
+      if (command == Nuki::Command::UpdateTimeControlEntry) {
+        entry->assign(body, body + 6);
+      } else {
+        timeControlEntries.erase(entry);
+      }
+      sendStatus(authId, Nuki::CommandStatus::Complete, &delay);
+      break;
+    }
+    case Nuki::Command::RequestKeypadCodes: {
+      // offset(2) count(2)
+      if (bodyLength < 4) {
+        sendError(authId, ERROR_BAD_LENGTH, command, &delay);
+        return;
+      }
+      uint16_t offset = readU16(body);
+      uint16_t count = readU16(&body[2]);
+      std::vector<std::vector<uint8_t>> entries;
+      for (size_t i = offset; i < keypadEntries.size() && entries.size() < count; i++) {
+        entries.push_back(toBytes(keypadEntries[i]));
+      }
+      std::vector<uint8_t> countPayload;
+      appendU16(countPayload, (uint16_t)keypadEntries.size());
+      sendStream(authId, Nuki::Command::KeypadCodeCount, countPayload, Nuki::Command::KeypadCode, entries, &delay);
+      break;
+    }
+    case Nuki::Command::AddKeypadCode: {
+      if (bodyLength < sizeof(Nuki::NewKeypadEntry)) {
+        sendError(authId, ERROR_BAD_LENGTH, command, &delay);
+        return;
+      }
+      Nuki::NewKeypadEntry newEntry;
+      memcpy(&newEntry, body, sizeof(newEntry));
+      if (newEntry.code < 100000 || newEntry.code > 999999) {
+        sendError(authId, K_ERROR_CODE_INVALID, command, &delay);
+        return;
+      }
+      Nuki::KeypadEntry entry;
+      memset(&entry, 0, sizeof(entry));
+      entry.codeId = 1;
+      for (const auto& existing : keypadEntries) {
+        entry.codeId = std::max<uint16_t>(entry.codeId, existing.codeId + 1);
+      }
+      entry.code = newEntry.code;
+      memcpy(entry.name, newEntry.name, sizeof(entry.name));
+      entry.enabled = 1;
+      entry.timeLimited = newEntry.timeLimited;
+      entry.allowedWeekdays = newEntry.allowedWeekdays;
+      keypadEntries.push_back(entry);
+
+      std::vector<uint8_t> response;
+      appendU16(response, entry.codeId);
+      sendEncrypted(authId, Nuki::Command::KeypadCodeId, response, &delay);
+      break;
+    }
+    case Nuki::Command::UpdateKeypadCode:
+    case Nuki::Command::RemoveKeypadCode: {
+      if (bodyLength < (command == Nuki::Command::UpdateKeypadCode ? sizeof(Nuki::UpdatedKeypadEntry) : 2u)) {
+        sendError(authId, ERROR_BAD_LENGTH, command, &delay);
+        return;
+      }
+      uint16_t codeId = readU16(body);
+      auto entry = std::find_if(keypadEntries.begin(), keypadEntries.end(),
+                                [codeId](const Nuki::KeypadEntry& e) { return e.codeId == codeId; });
+      if (entry == keypadEntries.end()) {
+        sendError(authId, K_ERROR_BAD_PARAMETER, command, &delay);
+        return;
+      }
+      if (command == Nuki::Command::UpdateKeypadCode) {
+        Nuki::UpdatedKeypadEntry updated;
+        memcpy(&updated, body, sizeof(updated));
+        entry->code = updated.code;
+        memcpy(entry->name, updated.name, sizeof(entry->name));
+        entry->enabled = updated.enabled;
+        entry->timeLimited = updated.timeLimited;
+        entry->allowedWeekdays = updated.allowedWeekdays;
+      } else {
+        keypadEntries.erase(entry);
+      }
+      sendStatus(authId, Nuki::CommandStatus::Complete, &delay);
+      break;
+    }
+    case Nuki::Command::RemoveUserAuthorization: {
+      if (bodyLength < 4) {
+        sendError(authId, ERROR_BAD_LENGTH, command, &delay);
+        return;
+      }
+      if (authorizations.erase(readU32(body)) == 0) {
+        sendError(authId, K_ERROR_BAD_PARAMETER, command, &delay);
+        return;
+      }
+      sendStatus(authId, Nuki::CommandStatus::Complete, &delay);
+      break;
+    }
+    case Nuki::Command::SetSecurityPin: {
+      if (bodyLength < 2) {
+        sendError(authId, ERROR_BAD_LENGTH, command, &delay);
+        return;
+      }
+      securityPin = readU16(body);
+      sendStatus(authId, Nuki::CommandStatus::Complete, &delay);
+      break;
+    }
+    default:
+      // accepted without effect on the emulated device (time, calibration, reboot, ...)
+      sendStatus(authId, Nuki::CommandStatus::Complete, &delay);
+      break;
+  }
+}
+
+bool KeyturnerEmulator::checkNonce(const uint32_t authId, const Nuki::Command command, const uint8_t* nonce,
+                                   int64_t* delay) {
+  auto challenge = challenges.find(authId);
+  bool valid = challenge != challenges.end() && memcmp(challenge->second.data(), nonce, NONCE_LENGTH) == 0;
+  // a challenge can be used once
+  if (challenge != challenges.end()) {
+    challenges.erase(challenge);
+  }
+  if (!valid) {
+    sendError(authId, K_ERROR_BAD_NONCE, command, delay);
+  }
+  return valid;
+}
+
+bool KeyturnerEmulator::checkPin(const uint32_t authId, const Nuki::Command command, const uint8_t* pin,
+                                 int64_t* delay) {
+  if (readU16(pin) != securityPin) {
+    sendError(authId, K_ERROR_BAD_PIN, command, delay);
+    return false;
+  }
+  return true;
+}
+
+void KeyturnerEmulator::sendStream(const uint32_t authId, const Nuki::Command countCommand,
+                                   const std::vector<uint8_t>& count, const Nuki::Command entryCommand,
+                                   const std::vector<std::vector<uint8_t>>& entries, int64_t* delay) {
+  if (!count.empty()) {
+    sendEncrypted(authId, countCommand, count, delay);
+  }
+  for (const auto& entry : entries) {
+    sendEncrypted(authId, entryCommand, entry, delay);
+  }
+  sendStatus(authId, Nuki::CommandStatus::Complete, delay);
+}
+
+void KeyturnerEmulator::sendPlain(const Nuki::Command command, const std::vector<uint8_t>& payload, int64_t* delay) {
+  std::vector<uint8_t> message;
+  appendU16(message, (uint16_t)command);
+  message.insert(message.end(), payload.begin(), payload.end());
+  appendCrc(message);
+  if (indicate(gdioUUID, message, delay)) {
+    int64_t dueUs = esp_timer_get_time() + *delay;
+    trace(TraceEventType::Indication, dueUs, dueUs, command, payload.empty() ? 0 : payload[0]);
+  }
+}
+
+void KeyturnerEmulator::sendEncrypted(const uint32_t authId, const Nuki::Command command,
+                                      const std::vector<uint8_t>& payload, int64_t* delay) {
+  auto authorization = authorizations.find(authId);
+  if (authorization == authorizations.end()) {
+    return;
+  }
+  std::vector<uint8_t> plain;
+  appendU32(plain, authId);
+  appendU16(plain, (uint16_t)command);
+  plain.insert(plain.end(), payload.begin(), payload.end());
+  appendCrc(plain);
+
+  std::vector<uint8_t> message(ENCRYPTED_HEADER_LENGTH + plain.size() + crypto_secretbox_MACBYTES);
+  randombytes_buf(message.data(), crypto_secretbox_NONCEBYTES);
+  memcpy(&message[crypto_secretbox_NONCEBYTES], &authId, 4);
+  uint16_t encryptedLength = plain.size() + crypto_secretbox_MACBYTES;
+  memcpy(&message[crypto_secretbox_NONCEBYTES + 4], &encryptedLength, 2);
+  crypto_secretbox_easy(&message[ENCRYPTED_HEADER_LENGTH], plain.data(), plain.size(), message.data(),
+                        authorization->second.secretKey);
+  if (indicate(userDataUUID, message, delay)) {
+    int64_t dueUs = esp_timer_get_time() + *delay;
+    trace(TraceEventType::Indication, dueUs, dueUs, command, payload.empty() ? 0 : payload[0]);
+  }
+}
+
+void KeyturnerEmulator::sendStatus(const uint32_t authId, const Nuki::CommandStatus status, int64_t* delay) {
+  sendEncrypted(authId, Nuki::Command::Status, {(uint8_t)status}, delay);
+}
+
+void KeyturnerEmulator::sendError(const uint32_t authId, const uint8_t errorCode, const Nuki::Command command,
+                                  int64_t* delay) {
+  statistics.errors++;
+  std::vector<uint8_t> payload = {errorCode};
+  appendU16(payload, (uint16_t)command);
+  if (authorizations.find(authId) != authorizations.end()) {
+    sendEncrypted(authId, Nuki::Command::ErrorReport, payload, delay);
+  } else {
+    sendPlain(Nuki::Command::ErrorReport, payload, delay);
+  }
+}
+
+bool KeyturnerEmulator::indicate(const NimBLEUUID& characteristic, const std::vector<uint8_t>& data, int64_t* delay) {
+  // indications are sent one after the other, each one occupies the link for its transfer time
+  *delay += transferUs(data.size(), linkProfile.indicationUs);
+  statistics.indications++;
+  if (lose()) {
+    statistics.lostIndications++;
+    return false;
+  }
+  NimBLEHost::indicate(this, characteristic, data, *delay);
+  return true;
+}
+
+void KeyturnerEmulator::trace(const TraceEventType type, const int64_t startUs, const int64_t endUs,
+                              const Nuki::Command command, const uint16_t argument) {
+  if (traceListener) {
+    traceListener(TraceEvent{type, startUs, endUs, command, argument});
+  }
+}
+
+int64_t KeyturnerEmulator::transferUs(const size_t length, const int64_t packetUs) {
+  size_t packetSize = linkProfile.mtu > 3 ? linkProfile.mtu - 3 : 20;
+  size_t packets = std::max<size_t>(1, (length + packetSize - 1) / packetSize);
+  if (linkProfile.eventsPerPacket == 0 || link.interval == 0) {
+    return packets * packetUs;
+  }
+  // every fragment and its empty acknowledgement carry 10 bytes of preamble, access address, header and CRC,
+  // each is followed by a 150 us inter frame space. The 2M PHY halves the bits, not the spaces.
+  int64_t phyFactor = link.phy == BLE_GAP_LE_PHY_2M ? 2 : 1;
+  int64_t totalUs = 0;
+  size_t remaining = length;
+  for (size_t packet = 0; packet < packets; packet++) {
+    size_t chunk = std::min(remaining, packetSize);
+    remaining -= chunk;
+    // with the ATT and L2CAP headers
+    size_t bytes = chunk + 7;
+    size_t fragments = (bytes + link.dataLength - 1) / link.dataLength;
+    int64_t airUs = (int64_t)(bytes + fragments * 20) * 8 / phyFactor + (int64_t)fragments * 300;
+    totalUs += (int64_t)linkProfile.eventsPerPacket * link.interval * 1250 + airUs;
+  }
+  return totalUs;
+}
+
+int64_t KeyturnerEmulator::responseDelay(const Nuki::Command command) {
+  auto it = responseDelays.find(command);
+  return it == responseDelays.end() ? 0 : it->second;
+}
+
+bool KeyturnerEmulator::lose() {
+  if (linkProfile.lossRate <= 0) {
+    return false;
+  }
+  return std::uniform_real_distribution<double>(0, 1)(lossGenerator) < linkProfile.lossRate;
+}
+
+void KeyturnerEmulator::scheduleAdvertisement(const uint64_t generation, const int64_t delayUs) {
+  std::shared_ptr<Liveness> guard = liveness;
+  NimBLEHost::post(delayUs, [this, guard, generation]() {
+    std::lock_guard<std::recursive_mutex> lock(guard->mutex);
+    if (!guard->alive || generation != advertisingGeneration) {
+      return;
+    }
+    advertise();
+    if (advertisingInterval > 0) {
+      scheduleAdvertisement(generation, advertisingInterval);
+    }
+  });
+}
+
+} // namespace NukiEmulator
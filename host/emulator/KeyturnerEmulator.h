@@ -0,0 +1,318 @@
+#pragma once
+/**
+ * @file KeyturnerEmulator.h
+ * Host (Linux) only: the device side of the Nuki BLE protocol, to run NukiBle against an in-process peer.
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ *
+ * Implements the lock side of the pairing (public key exchange, HSalsa20 key derivation, HMAC
+ * authenticators, authorization id) on GDIO and the encrypted user specific data channel on USDIO
+ * (challenge, accepted/complete status, states, config, log/authorization/time control/keypad streams).
+ * Device specific payloads (states, config, lock actions) are provided by SmartLockEmulator / OpenerEmulator.
+ * The SmartLock Ultra pairing variant is not emulated.
+ */
+
+#include "NimBLEHost.h"
+#include "NukiConstants.h"
+
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace NukiEmulator {
+
+/**
+ * @brief Shared with pending host thread events, which must not touch a destroyed emulator
+ */
+struct Liveness {
+  std::recursive_mutex mutex;
+  bool alive = true;
+};
+
+/**
+ * @brief Radio model of the emulated link, all times in microseconds
+ *
+ * Messages are split in ATT packets of (mtu - 3) bytes, every packet costs writeUs (client to lock)
+ * or indicationUs (lock to client). Longer messages are delivered as a whole, only their transfer time grows.
+ * With eventsPerPacket set, a packet costs that many connection events of the negotiated interval instead, plus
+ * the air time of its link layer fragments, which depends on the PHY and data length the client negotiated.
+ */
+struct LinkProfile {
+  int64_t connectUs = 0;
+  int64_t discoveryUs = 0;
+  int64_t subscribeUs = 0;
+  int64_t writeUs = 0;
+  int64_t indicationUs = 0;
+  uint16_t mtu = 185;
+  // 0: writeUs / indicationUs
+  uint8_t eventsPerPacket = 0;
+  // what the lock agrees to when the client asks for the 2M PHY or data length extension
+  bool phy2M = true;
+  uint16_t maxDataLength = 251;
+  // probability a written message or an indication is lost
+  double lossRate = 0;
+  uint32_t seed = 1;
+};
+
+/**
+ * @brief Raw bytes of a packed protocol struct, as sent on the wire
+ */
+template<typename T>
+std::vector<uint8_t> toBytes(const T& value) {
+  return std::vector<uint8_t>((const uint8_t*)&value, (const uint8_t*)&value + sizeof(T));
+}
+
+/**
+ * @brief Current UTC time
+ */
+struct tm utcNow();
+
+/**
+ * @brief Sets the currentTime* fields of a keyturner / opener state to the current UTC time
+ */
+template<typename T>
+void setCurrentTime(T& state) {
+  struct tm now = utcNow();
+  state.currentTimeYear = now.tm_year + 1900;
+  state.currentTimeMonth = now.tm_mon + 1;
+  state.currentTimeDay = now.tm_mday;
+  state.currentTimeHour = now.tm_hour;
+  state.currentTimeMinute = now.tm_min;
+  state.currentTimeSecond = now.tm_sec;
+}
+
+/**
+ * @brief Sets the timeStamp* fields of a log entry to the current UTC time
+ */
+template<typename T>
+void setTimeStamp(T& entry) {
+  struct tm now = utcNow();
+  entry.timeStampYear = now.tm_year + 1900;
+  entry.timeStampMonth = now.tm_mon + 1;
+  entry.timeStampDay = now.tm_mday;
+  entry.timeStampHour = now.tm_hour;
+  entry.timeStampMinute = now.tm_min;
+  entry.timeStampSecond = now.tm_sec;
+}
+
+struct Statistics {
+  uint32_t connects = 0;
+  uint32_t disconnects = 0;
+  uint32_t writes = 0;
+  uint32_t indications = 0;
+  uint32_t lostWrites = 0;
+  uint32_t lostIndications = 0;
+  uint32_t errors = 0;
+  std::map<Nuki::Command, uint32_t> commands;
+};
+
+enum class TraceEventType {
+  Connect,
+  DiscoverService,
+  DiscoverCharacteristic,
+  Subscribe,
+  Write,
+  Indication
+};
+
+/**
+ * @brief A procedure or message on the link as seen by the device, in esp_timer_get_time() microseconds
+ *
+ * Procedures and writes span the time the client is blocked, an indication is stamped with the time it is
+ * due at the client (startUs == endUs). command is the decrypted command identifier of a message, argument
+ * the requested command of RequestData (writes) or the first payload byte, e.g. the status (indications).
+ */
+struct TraceEvent {
+  TraceEventType type;
+  int64_t startUs;
+  int64_t endUs;
+  Nuki::Command command;
+  uint16_t argument;
+};
+
+typedef std::function<void(const TraceEvent& event)> TraceListener;
+
+class KeyturnerEmulator : public NimBLEHost::Peripheral {
+  public:
+    KeyturnerEmulator(const NimBLEAddress& address,
+                      const uint32_t nukiId,
+                      const NimBLEUUID& pairingServiceUUID,
+                      const NimBLEUUID& deviceServiceUUID,
+                      const NimBLEUUID& gdioUUID,
+                      const NimBLEUUID& userDataUUID);
+    virtual ~KeyturnerEmulator();
+
+    /**
+     * @brief Makes the device reachable for NimBLE clients (and stops it again)
+     */
+    void begin();
+    void end();
+
+    void setLinkProfile(const LinkProfile& profile);
+    LinkProfile getLinkProfile();
+    /**
+     * @brief Parameters of the current (or last) connection
+     */
+    NimBLEHost::LinkParameters getLinkParameters();
+
+    /**
+     * @brief Processing time of the device before it answers a command (default 0)
+     */
+    void setResponseDelay(const Nuki::Command command, const int64_t delayUs);
+
+    /**
+     * @brief Time between the ACCEPTED and COMPLETE status of a lock action (default 0)
+     */
+    void setActionDuration(const int64_t durationUs);
+
+    void setSecurityPin(const uint16_t pin);
+    void setPairingMode(const bool enabled);
+    bool isPairingMode();
+    size_t getAuthorizationCount();
+
+    /**
+     * @brief Broadcasts the iBeacon (or the pairing advertisement in pairing mode) every intervalUs
+     */
+    void startAdvertising(const int64_t intervalUs);
+    void stopAdvertising();
+    void advertise(const int rssi = -60);
+
+    /**
+     * @brief Terminates the connection from the device side
+     */
+    void disconnect();
+    bool isConnected();
+
+    Statistics getStatistics();
+    void resetStatistics();
+
+    /**
+     * @brief Reports every procedure and message on the link, nullptr stops tracing.
+     * Called with the emulator mutex held, from the client task (procedures, writes, indications sent
+     * in answer to a write) or the host thread (delayed indications).
+     */
+    void setTraceListener(TraceListener listener);
+
+    NimBLEAddress getAddress() const override;
+    bool hasService(const NimBLEUUID& service) const override;
+    bool hasCharacteristic(const NimBLEUUID& service, const NimBLEUUID& characteristic) const override;
+    int64_t linkDelayUs(NimBLEHost::LinkOp op, size_t length) override;
+    bool onConnect() override;
+    void onDisconnect() override;
+    NimBLEHost::LinkParameters negotiateLink(const NimBLEHost::LinkParameters& requested) override;
+    bool onWrite(const NimBLEUUID& characteristic, const uint8_t* data, size_t length) override;
+
+  protected:
+    /**
+     * @brief Device specific hooks, all called with the emulator mutex held
+     */
+    virtual void applyConfig(const uint8_t* newConfig, size_t length) = 0;
+    virtual void applyAdvancedConfig(const uint8_t* newAdvancedConfig, size_t length) = 0;
+    /**
+     * @brief Starts a lock action, returning false rejects it with K_ERROR_BAD_PARAMETER
+     */
+    virtual bool beginLockAction(const uint8_t action, const uint32_t authId) = 0;
+    virtual void completeLockAction(const uint8_t action, const uint32_t authId) = 0;
+
+    /**
+     * @brief Sets the "state changed" flag in the beacon until the states are requested
+     */
+    void markStateChanged();
+    uint32_t getNukiId() const;
+
+    /**
+     * @brief Stops the device and drops pending host thread events, to be called by the destructor of
+     * the most derived class so no event runs a hook of a partially destroyed emulator
+     */
+    void shutdown();
+
+    std::shared_ptr<Liveness> liveness;
+    // guards all emulator state, held while host thread events run
+    std::recursive_mutex& mutex;
+    std::vector<uint8_t> states;
+    std::vector<uint8_t> config;
+    std::vector<uint8_t> advancedConfig;
+    std::vector<uint8_t> batteryReport;
+    // oldest entry first
+    std::vector<std::vector<uint8_t>> logEntries;
+    std::vector<std::vector<uint8_t>> timeControlEntries;
+    std::vector<Nuki::KeypadEntry> keypadEntries;
+
+  private:
+    struct Authorization {
+      unsigned char secretKey[32];
+      uint8_t idType;
+      uint32_t appId;
+      std::string name;
+    };
+
+    void handlePlainMessage(const uint8_t* data, size_t length);
+    void handleEncryptedMessage(const uint8_t* data, size_t length);
+    void handleCommand(const uint32_t authId, const Nuki::Command command, const uint8_t* payload, size_t length);
+    bool checkNonce(const uint32_t authId, const Nuki::Command command, const uint8_t* nonce, int64_t* delay);
+    bool checkPin(const uint32_t authId, const Nuki::Command command, const uint8_t* pin, int64_t* delay);
+    void sendStream(const uint32_t authId, const Nuki::Command countCommand, const std::vector<uint8_t>& count,
+                    const Nuki::Command entryCommand, const std::vector<std::vector<uint8_t>>& entries, int64_t* delay);
+
+    void sendPlain(const Nuki::Command command, const std::vector<uint8_t>& payload, int64_t* delay);
+    void sendEncrypted(const uint32_t authId, const Nuki::Command command, const std::vector<uint8_t>& payload,
+                       int64_t* delay);
+    void sendStatus(const uint32_t authId, const Nuki::CommandStatus status, int64_t* delay);
+    void sendError(const uint32_t authId, const uint8_t errorCode, const Nuki::Command command, int64_t* delay);
+    bool indicate(const NimBLEUUID& characteristic, const std::vector<uint8_t>& data, int64_t* delay);
+    void trace(const TraceEventType type, const int64_t startUs, const int64_t endUs,
+               const Nuki::Command command = Nuki::Command::Empty, const uint16_t argument = 0);
+    int64_t transferUs(const size_t length, const int64_t packetUs);
+    int64_t responseDelay(const Nuki::Command command);
+    bool lose();
+    void scheduleAdvertisement(const uint64_t generation, const int64_t delayUs);
+
+    const NimBLEAddress address;
+    const uint32_t nukiId;
+    const NimBLEUUID pairingServiceUUID;
+    const NimBLEUUID deviceServiceUUID;
+    const NimBLEUUID gdioUUID;
+    const NimBLEUUID userDataUUID;
+
+    bool registered = false;
+
+    LinkProfile linkProfile;
+    std::mt19937 lossGenerator;
+    std::map<Nuki::Command, int64_t> responseDelays;
+    int64_t actionDuration = 0;
+    uint16_t securityPin = 0;
+    bool pairingMode = false;
+    bool stateChanged = false;
+    uint64_t advertisingGeneration = 0;
+    int64_t advertisingInterval = 0;
+    Statistics statistics;
+    TraceListener traceListener;
+
+    unsigned char publicKey[32] = {};
+    unsigned char privateKey[32] = {};
+    std::map<uint32_t, Authorization> authorizations;
+    uint32_t nextAuthorizationId = 1;
+
+    // connection state
+    bool connected = false;
+    uint64_t connectionGeneration = 0;
+    NimBLEHost::LinkParameters link;
+    // the write in progress, traced once its command is known
+    int64_t writeStartUs = 0;
+    int64_t writeEndUs = 0;
+    std::map<uint32_t, std::vector<uint8_t>> challenges;
+    unsigned char pairingClientKey[32] = {};
+    unsigned char pairingSecretKey[32] = {};
+    unsigned char pairingChallenge[32] = {};
+    uint32_t pairingAuthorizationId = 0;
+    Authorization pairingAuthorization;
+};
+
+} // namespace NukiEmulator
@@ -0,0 +1,227 @@
+/**
+ * @file OpenerEmulator.cpp
+ * Host (Linux) only: an emulated Nuki Opener.
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ */
+
+#include "OpenerEmulator.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace NukiEmulator {
+
+OpenerEmulator::OpenerEmulator(const NimBLEAddress& address, const uint32_t nukiId)
+  : KeyturnerEmulator(address,
+                      nukiId,
+                      NukiOpener::openerPairingServiceUUID,
+                      NukiOpener::openerServiceUUID,
+                      NukiOpener::openerGdioUUID,
+                      NukiOpener::openerUserDataUUID) {
+  openerState = NukiOpener::OpenerState();
+  openerState.nukiState = NukiOpener::State::DoorMode;
+  openerState.lockState = NukiOpener::LockState::Locked;
+  openerState.trigger = NukiOpener::Trigger::System;
+  openerState.configUpdateCount = 1;
+  openerState.lastLockAction = NukiOpener::LockAction::DeactivateRTO;
+  openerState.lastLockActionTrigger = NukiOpener::Trigger::System;
+  openerState.lastLockActionCompletionStatus = NukiOpener::CompletionStatus::Success;
+  setCurrentTime(openerState);
+
+  openerConfig = NukiOpener::Config();
+  openerConfig.nukiId = nukiId;
+  snprintf((char*)openerConfig.name, sizeof(openerConfig.name), "Nuki_%08X", nukiId);
+  openerConfig.capabilities = 1;
+  openerConfig.pairingEnabled = 1;
+  openerConfig.buttonEnabled = 1;
+  openerConfig.ledFlashEnabled = 1;
+  openerConfig.dstMode = 1;
+  openerConfig.advertisingMode = Nuki::AdvertisingMode::Automatic;
+  openerConfig.firmwareVersion[0] = 1;
+  openerConfig.firmwareVersion[1] = 10;
+  openerConfig.hardwareRevision[0] = 2;
+  openerConfig.timeZoneId = Nuki::TimeZoneId::Europe_Berlin;
+
+  openerAdvancedConfig = NukiOpener::AdvancedConfig();
+  openerAdvancedConfig.electricStrikeDuration = 3000;
+  openerAdvancedConfig.rtoTimeout = 20;
+  openerAdvancedConfig.soundLevel = 100;
+  openerAdvancedConfig.singleButtonPressAction = NukiOpener::ButtonPressAction::ToggleRTO;
+  openerAdvancedConfig.doubleButtonPressAction = NukiOpener::ButtonPressAction::ToggleCM;
+  openerAdvancedConfig.batteryType = Nuki::BatteryType::Alkali;
+  openerAdvancedConfig.automaticBatteryTypeDetection = 1;
+
+  openerBatteryReport = NukiOpener::BatteryReport();
+  openerBatteryReport.batteryVoltage = 4500;
+  openerBatteryReport.lockAction = NukiOpener::LockAction::DeactivateRTO;
+  openerBatteryReport.startVoltage = 4500;
+  openerBatteryReport.lowestVoltage = 4400;
+  openerBatteryReport.startTemperature = 21;
+
+  publish();
+}
+
+OpenerEmulator::~OpenerEmulator() {
+  shutdown();
+}
+
+NukiOpener::OpenerState OpenerEmulator::getOpenerState() {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  return openerState;
+}
+
+void OpenerEmulator::setOpenerState(const NukiOpener::OpenerState& state) {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  openerState = state;
+  markStateChanged();
+  publish();
+}
+
+NukiOpener::Config OpenerEmulator::getConfig() {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  return openerConfig;
+}
+
+void OpenerEmulator::setConfig(const NukiOpener::Config& config) {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  openerConfig = config;
+  publish();
+}
+
+NukiOpener::AdvancedConfig OpenerEmulator::getAdvancedConfig() {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  return openerAdvancedConfig;
+}
+
+void OpenerEmulator::setAdvancedConfig(const NukiOpener::AdvancedConfig& advancedConfig) {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  openerAdvancedConfig = advancedConfig;
+  publish();
+}
+
+void OpenerEmulator::setBatteryReport(const NukiOpener::BatteryReport& batteryReport) {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  openerBatteryReport = batteryReport;
+  publish();
+}
+
+void OpenerEmulator::addLogEntries(const size_t count) {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  for (size_t i = 0; i < count; i++) {
+    appendLogEntry(0, (i % 2) ? NukiOpener::LockAction::DeactivateRTO : NukiOpener::LockAction::ActivateRTO,
+                   NukiOpener::Trigger::Button);
+  }
+}
+
+size_t OpenerEmulator::getLogEntryCount() {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  return logEntries.size();
+}
+
+void OpenerEmulator::applyConfig(const uint8_t* newConfig, size_t length) {
+  if (length < sizeof(NukiOpener::NewConfig)) {
+    return;
+  }
+  NukiOpener::NewConfig update;
+  memcpy(&update, newConfig, sizeof(update));
+  memcpy(openerConfig.name, update.name, sizeof(openerConfig.name));
+  openerConfig.latitude = update.latitude;
+  openerConfig.longitude = update.longitude;
+  openerConfig.capabilities = update.capabilities;
+  openerConfig.pairingEnabled = update.pairingEnabled;
+  openerConfig.buttonEnabled = update.buttonEnabled;
+  openerConfig.ledFlashEnabled = update.ledFlashEnabled;
+  openerConfig.timeZoneOffset = update.timeZoneOffset;
+  openerConfig.dstMode = update.dstMode;
+  openerConfig.fobAction1 = update.fobAction1;
+  openerConfig.fobAction2 = update.fobAction2;
+  openerConfig.fobAction3 = update.fobAction3;
+  openerConfig.operatingMode = update.operatingMode;
+  openerConfig.advertisingMode = update.advertisingMode;
+  openerConfig.timeZoneId = update.timeZoneId;
+  openerState.configUpdateCount++;
+  publish();
+}
+
+void OpenerEmulator::applyAdvancedConfig(const uint8_t* newAdvancedConfig, size_t length) {
+  if (length < sizeof(NukiOpener::NewAdvancedConfig)) {
+    return;
+  }
+  // the new advanced config is the advanced config without the trailing auto update flag
+  memcpy((void*)&openerAdvancedConfig, newAdvancedConfig, sizeof(NukiOpener::NewAdvancedConfig));
+  openerState.configUpdateCount++;
+  publish();
+}
+
+bool OpenerEmulator::beginLockAction(const uint8_t action, const uint32_t authId) {
+  switch ((NukiOpener::LockAction)action) {
+    case NukiOpener::LockAction::ElectricStrikeActuation:
+    case NukiOpener::LockAction::FobAction3:
+      openerState.lockState = NukiOpener::LockState::Opening;
+      break;
+    case NukiOpener::LockAction::ActivateRTO:
+    case NukiOpener::LockAction::DeactivateRTO:
+    case NukiOpener::LockAction::ActivateCM:
+    case NukiOpener::LockAction::DeactivateCM:
+    case NukiOpener::LockAction::FobAction1:
+    case NukiOpener::LockAction::FobAction2:
+      break;
+    default:
+      return false;
+  }
+  openerState.trigger = NukiOpener::Trigger::System;
+  publish();
+  return true;
+}
+
+void OpenerEmulator::completeLockAction(const uint8_t action, const uint32_t authId) {
+  switch ((NukiOpener::LockAction)action) {
+    case NukiOpener::LockAction::ActivateRTO:
+    case NukiOpener::LockAction::FobAction1:
+      openerState.lockState = NukiOpener::LockState::RTOactive;
+      break;
+    case NukiOpener::LockAction::ActivateCM:
+      openerState.nukiState = NukiOpener::State::ContinuousMode;
+      break;
+    case NukiOpener::LockAction::DeactivateCM:
+      openerState.nukiState = NukiOpener::State::DoorMode;
+      break;
+    default:
+      // the door has been opened (or ring to open was deactivated), the opener is back online
+      openerState.lockState = NukiOpener::LockState::Locked;
+      break;
+  }
+  openerState.lastLockAction = (NukiOpener::LockAction)action;
+  openerState.lastLockActionTrigger = NukiOpener::Trigger::System;
+  openerState.lastLockActionCompletionStatus = NukiOpener::CompletionStatus::Success;
+  openerBatteryReport.lockAction = (NukiOpener::LockAction)action;
+  setCurrentTime(openerState);
+  appendLogEntry(authId, (NukiOpener::LockAction)action, NukiOpener::Trigger::System);
+  publish();
+}
+
+void OpenerEmulator::appendLogEntry(const uint32_t authId, const NukiOpener::LockAction action,
+                                    const NukiOpener::Trigger trigger) {
+  NukiOpener::LogEntry entry = NukiOpener::LogEntry();
+  entry.index = logEntries.size() + 1;
+  setTimeStamp(entry);
+  entry.authId = authId;
+  snprintf((char*)entry.name, sizeof(entry.name), authId ? "Bluetooth %u" : "Manual", authId);
+  entry.loggingType = NukiOpener::LoggingType::LockAction;
+  // action, trigger, flags, completion status
+  entry.data[0] = (uint8_t)action;
+  entry.data[1] = (uint8_t)trigger;
+  entry.data[3] = (uint8_t)NukiOpener::CompletionStatus::Success;
+  logEntries.push_back(toBytes(entry));
+}
+
+void OpenerEmulator::publish() {
+  states = toBytes(openerState);
+  config = toBytes(openerConfig);
+  advancedConfig = toBytes(openerAdvancedConfig);
+  batteryReport = toBytes(openerBatteryReport);
+}
+
+} // namespace NukiEmulator
@@ -0,0 +1,50 @@
+#pragma once
+/**
+ * @file OpenerEmulator.h
+ * Host (Linux) only: an emulated Nuki Opener (services a92ae1xx / a92ae2xx).
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ */
+
+#include "KeyturnerEmulator.h"
+#include "NukiOpenerConstants.h"
+
+namespace NukiEmulator {
+
+class OpenerEmulator : public KeyturnerEmulator {
+  public:
+    OpenerEmulator(const NimBLEAddress& address, const uint32_t nukiId);
+    virtual ~OpenerEmulator();
+
+    NukiOpener::OpenerState getOpenerState();
+    void setOpenerState(const NukiOpener::OpenerState& state);
+    NukiOpener::Config getConfig();
+    void setConfig(const NukiOpener::Config& config);
+    NukiOpener::AdvancedConfig getAdvancedConfig();
+    void setAdvancedConfig(const NukiOpener::AdvancedConfig& advancedConfig);
+    void setBatteryReport(const NukiOpener::BatteryReport& batteryReport);
+
+    /**
+     * @brief Appends count lock action log entries, e.g. to emulate an opener with a long history
+     */
+    void addLogEntries(const size_t count);
+    size_t getLogEntryCount();
+
+  protected:
+    void applyConfig(const uint8_t* newConfig, size_t length) override;
+    void applyAdvancedConfig(const uint8_t* newAdvancedConfig, size_t length) override;
+    bool beginLockAction(const uint8_t action, const uint32_t authId) override;
+    void completeLockAction(const uint8_t action, const uint32_t authId) override;
+
+  private:
+    void appendLogEntry(const uint32_t authId, const NukiOpener::LockAction action, const NukiOpener::Trigger trigger);
+    void publish();
+
+    NukiOpener::OpenerState openerState;
+    NukiOpener::Config openerConfig;
+    NukiOpener::AdvancedConfig openerAdvancedConfig;
+    NukiOpener::BatteryReport openerBatteryReport;
+};
+
+} // namespace NukiEmulator
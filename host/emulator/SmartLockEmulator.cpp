@@ -0,0 +1,262 @@
+/**
+ * @file SmartLockEmulator.cpp
+ * Host (Linux) only: an emulated Nuki Smart Lock.
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ */
+
+#include "SmartLockEmulator.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace NukiEmulator {
+
+SmartLockEmulator::SmartLockEmulator(const NimBLEAddress& address, const uint32_t nukiId)
+  : KeyturnerEmulator(address,
+                      nukiId,
+                      NukiLock::keyturnerPairingServiceUUID,
+                      NukiLock::keyturnerServiceUUID,
+                      NukiLock::keyturnerGdioUUID,
+                      NukiLock::keyturnerUserDataUUID) {
+  lockState = NukiLock::KeyTurnerState();
+  lockState.nukiState = NukiLock::State::DoorMode;
+  lockState.lockState = NukiLock::LockState::Locked;
+  lockState.trigger = NukiLock::Trigger::System;
+  lockState.configUpdateCount = 1;
+  lockState.lockNgoTimer = 0;
+  lockState.lastLockAction = NukiLock::LockAction::Lock;
+  lockState.lastLockActionTrigger = NukiLock::Trigger::System;
+  lockState.lastLockActionCompletionStatus = NukiLock::CompletionStatus::Success;
+  lockState.doorSensorState = Nuki::DoorSensorState::Unavailable;
+  lockState.bleConnectionStrength = -60;
+  setCurrentTime(lockState);
+
+  lockConfig = NukiLock::Config();
+  lockConfig.nukiId = nukiId;
+  snprintf((char*)lockConfig.name, sizeof(lockConfig.name), "Nuki_%08X", nukiId);
+  lockConfig.pairingEnabled = 1;
+  lockConfig.buttonEnabled = 1;
+  lockConfig.ledEnabled = 1;
+  lockConfig.ledBrightness = 3;
+  lockConfig.dstMode = 1;
+  lockConfig.advertisingMode = Nuki::AdvertisingMode::Automatic;
+  lockConfig.firmwareVersion[0] = 4;
+  lockConfig.firmwareVersion[1] = 2;
+  lockConfig.hardwareRevision[0] = 5;
+  lockConfig.timeZoneId = Nuki::TimeZoneId::Europe_Berlin;
+  lockConfig.deviceType = 4;
+  lockConfig.capabilities = 1;
+  lockConfig.productVariant = 4;
+
+  lockAdvancedConfig = NukiLock::AdvancedConfig();
+  lockAdvancedConfig.totalDegrees = 720;
+  lockAdvancedConfig.singleButtonPressAction = NukiLock::ButtonPressAction::Intelligent;
+  lockAdvancedConfig.doubleButtonPressAction = NukiLock::ButtonPressAction::LockNgo;
+  lockAdvancedConfig.batteryType = Nuki::BatteryType::Alkali;
+  lockAdvancedConfig.automaticBatteryTypeDetection = 1;
+  lockAdvancedConfig.unlatchDuration = 3;
+  lockAdvancedConfig.autoLockTimeOut = 300;
+  lockAdvancedConfig.motorSpeed = NukiLock::MotorSpeed::Standard;
+
+  lockBatteryReport = NukiLock::BatteryReport();
+  lockBatteryReport.batteryVoltage = 5800;
+  lockBatteryReport.lockAction = NukiLock::LockAction::Lock;
+  lockBatteryReport.startVoltage = 5800;
+  lockBatteryReport.lowestVoltage = 5600;
+  lockBatteryReport.startTemperature = 21;
+
+  publish();
+}
+
+SmartLockEmulator::~SmartLockEmulator() {
+  shutdown();
+}
+
+NukiLock::KeyTurnerState SmartLockEmulator::getKeyTurnerState() {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  return lockState;
+}
+
+void SmartLockEmulator::setKeyTurnerState(const NukiLock::KeyTurnerState& state) {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  lockState = state;
+  markStateChanged();
+  publish();
+}
+
+NukiLock::Config SmartLockEmulator::getConfig() {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  return lockConfig;
+}
+
+void SmartLockEmulator::setConfig(const NukiLock::Config& config) {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  lockConfig = config;
+  publish();
+}
+
+NukiLock::AdvancedConfig SmartLockEmulator::getAdvancedConfig() {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  return lockAdvancedConfig;
+}
+
+void SmartLockEmulator::setAdvancedConfig(const NukiLock::AdvancedConfig& advancedConfig) {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  lockAdvancedConfig = advancedConfig;
+  publish();
+}
+
+void SmartLockEmulator::setBatteryReport(const NukiLock::BatteryReport& batteryReport) {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  lockBatteryReport = batteryReport;
+  publish();
+}
+
+void SmartLockEmulator::addLogEntries(const size_t count) {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  for (size_t i = 0; i < count; i++) {
+    appendLogEntry(0, (i % 2) ? NukiLock::LockAction::Lock : NukiLock::LockAction::Unlock, NukiLock::Trigger::Manual);
+  }
+}
+
+size_t SmartLockEmulator::getLogEntryCount() {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  return logEntries.size();
+}
+
+void SmartLockEmulator::applyConfig(const uint8_t* newConfig, size_t length) {
+  if (length < sizeof(NukiLock::NewConfig)) {
+    return;
+  }
+  NukiLock::NewConfig update;
+  memcpy(&update, newConfig, sizeof(update));
+  memcpy(lockConfig.name, update.name, sizeof(lockConfig.name));
+  lockConfig.latitude = update.latitude;
+  lockConfig.longitude = update.longitude;
+  lockConfig.autoUnlatch = update.autoUnlatch;
+  lockConfig.pairingEnabled = update.pairingEnabled;
+  lockConfig.buttonEnabled = update.buttonEnabled;
+  lockConfig.ledEnabled = update.ledEnabled;
+  lockConfig.ledBrightness = update.ledBrightness;
+  lockConfig.timeZoneOffset = update.timeZoneOffset;
+  lockConfig.dstMode = update.dstMode;
+  lockConfig.fobAction1 = update.fobAction1;
+  lockConfig.fobAction2 = update.fobAction2;
+  lockConfig.fobAction3 = update.fobAction3;
+  lockConfig.singleLock = update.singleLock;
+  lockConfig.advertisingMode = update.advertisingMode;
+  lockConfig.timeZoneId = update.timeZoneId;
+  lockState.configUpdateCount++;
+  publish();
+}
+
+void SmartLockEmulator::applyAdvancedConfig(const uint8_t* newAdvancedConfig, size_t length) {
+  if (length < sizeof(NukiLock::NewAdvancedConfig)) {
+    return;
+  }
+  NukiLock::NewAdvancedConfig update;
+  memcpy(&update, newAdvancedConfig, sizeof(update));
+  lockAdvancedConfig.unlockedPositionOffsetDegrees = update.unlockedPositionOffsetDegrees;
+  lockAdvancedConfig.lockedPositionOffsetDegrees = update.lockedPositionOffsetDegrees;
+  lockAdvancedConfig.singleLockedPositionOffsetDegrees = update.singleLockedPositionOffsetDegrees;
+  lockAdvancedConfig.unlockedToLockedTransitionOffsetDegrees = update.unlockedToLockedTransitionOffsetDegrees;
+  lockAdvancedConfig.lockNgoTimeout = update.lockNgoTimeout;
+  lockAdvancedConfig.singleButtonPressAction = update.singleButtonPressAction;
+  lockAdvancedConfig.doubleButtonPressAction = update.doubleButtonPressAction;
+  lockAdvancedConfig.detachedCylinder = update.detachedCylinder;
+  lockAdvancedConfig.batteryType = update.batteryType;
+  lockAdvancedConfig.automaticBatteryTypeDetection = update.automaticBatteryTypeDetection;
+  lockAdvancedConfig.unlatchDuration = update.unlatchDuration;
+  lockAdvancedConfig.autoLockTimeOut = update.autoLockTimeOut;
+  lockAdvancedConfig.autoUnLockDisabled = update.autoUnLockDisabled;
+  lockAdvancedConfig.nightModeEnabled = update.nightModeEnabled;
+  memcpy(lockAdvancedConfig.nightModeStartTime, update.nightModeStartTime, 2);
+  memcpy(lockAdvancedConfig.nightModeEndTime, update.nightModeEndTime, 2);
+  lockAdvancedConfig.nightModeAutoLockEnabled = update.nightModeAutoLockEnabled;
+  lockAdvancedConfig.nightModeAutoUnlockDisabled = update.nightModeAutoUnlockDisabled;
+  lockAdvancedConfig.nightModeImmediateLockOnStart = update.nightModeImmediateLockOnStart;
+  lockAdvancedConfig.autoLockEnabled = update.autoLockEnabled;
+  lockAdvancedConfig.immediateAutoLockEnabled = update.immediateAutoLockEnabled;
+  lockAdvancedConfig.autoUpdateEnabled = update.autoUpdateEnabled;
+  lockAdvancedConfig.motorSpeed = update.motorSpeed;
+  lockAdvancedConfig.enableSlowSpeedDuringNightMode = update.enableSlowSpeedDuringNightMode;
+  lockState.configUpdateCount++;
+  publish();
+}
+
+bool SmartLockEmulator::beginLockAction(const uint8_t action, const uint32_t authId) {
+  switch ((NukiLock::LockAction)action) {
+    case NukiLock::LockAction::Unlock:
+    case NukiLock::LockAction::LockNgo:
+    case NukiLock::LockAction::FobAction1:
+      lockState.lockState = NukiLock::LockState::Unlocking;
+      break;
+    case NukiLock::LockAction::Lock:
+    case NukiLock::LockAction::FullLock:
+    case NukiLock::LockAction::FobAction2:
+      lockState.lockState = NukiLock::LockState::Locking;
+      break;
+    case NukiLock::LockAction::Unlatch:
+    case NukiLock::LockAction::LockNgoUnlatch:
+    case NukiLock::LockAction::FobAction3:
+      lockState.lockState = NukiLock::LockState::Unlatching;
+      break;
+    default:
+      return false;
+  }
+  lockState.trigger = NukiLock::Trigger::System;
+  publish();
+  return true;
+}
+
+void SmartLockEmulator::completeLockAction(const uint8_t action, const uint32_t authId) {
+  switch ((NukiLock::LockAction)action) {
+    case NukiLock::LockAction::Unlock:
+    case NukiLock::LockAction::FobAction1:
+      lockState.lockState = NukiLock::LockState::Unlocked;
+      break;
+    case NukiLock::LockAction::Unlatch:
+    case NukiLock::LockAction::FobAction3:
+      lockState.lockState = NukiLock::LockState::Unlatched;
+      break;
+    case NukiLock::LockAction::LockNgo:
+    case NukiLock::LockAction::LockNgoUnlatch:
+      // the lock'n'go timer is not emulated, the lock is relocked right away
+    default:
+      lockState.lockState = NukiLock::LockState::Locked;
+      break;
+  }
+  lockState.lastLockAction = (NukiLock::LockAction)action;
+  lockState.lastLockActionTrigger = NukiLock::Trigger::System;
+  lockState.lastLockActionCompletionStatus = NukiLock::CompletionStatus::Success;
+  lockBatteryReport.lockAction = (NukiLock::LockAction)action;
+  setCurrentTime(lockState);
+  appendLogEntry(authId, (NukiLock::LockAction)action, NukiLock::Trigger::System);
+  publish();
+}
+
+void SmartLockEmulator::appendLogEntry(const uint32_t authId, const NukiLock::LockAction action,
+                                       const NukiLock::Trigger trigger) {
+  NukiLock::LogEntry entry = NukiLock::LogEntry();
+  entry.index = logEntries.size() + 1;
+  setTimeStamp(entry);
+  entry.authId = authId;
+  snprintf((char*)entry.name, sizeof(entry.name), authId ? "Bluetooth %u" : "Manual", authId);
+  entry.loggingType = NukiLock::LoggingType::LockAction;
+  // action, trigger, flags, completion status
+  entry.data[0] = (uint8_t)action;
+  entry.data[1] = (uint8_t)trigger;
+  entry.data[3] = (uint8_t)NukiLock::CompletionStatus::Success;
+  logEntries.push_back(toBytes(entry));
+}
+
+void SmartLockEmulator::publish() {
+  states = toBytes(lockState);
+  config = toBytes(lockConfig);
+  advancedConfig = toBytes(lockAdvancedConfig);
+  batteryReport = toBytes(lockBatteryReport);
+}
+
+} // namespace NukiEmulator
@@ -0,0 +1,50 @@
+#pragma once
+/**
+ * @file SmartLockEmulator.h
+ * Host (Linux) only: an emulated Nuki Smart Lock (keyturner services a92ee1xx / a92ee2xx).
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ */
+
+#include "KeyturnerEmulator.h"
+#include "NukiLockConstants.h"
+
+namespace NukiEmulator {
+
+class SmartLockEmulator : public KeyturnerEmulator {
+  public:
+    SmartLockEmulator(const NimBLEAddress& address, const uint32_t nukiId);
+    virtual ~SmartLockEmulator();
+
+    NukiLock::KeyTurnerState getKeyTurnerState();
+    void setKeyTurnerState(const NukiLock::KeyTurnerState& state);
+    NukiLock::Config getConfig();
+    void setConfig(const NukiLock::Config& config);
+    NukiLock::AdvancedConfig getAdvancedConfig();
+    void setAdvancedConfig(const NukiLock::AdvancedConfig& advancedConfig);
+    void setBatteryReport(const NukiLock::BatteryReport& batteryReport);
+
+    /**
+     * @brief Appends count lock action log entries, e.g. to emulate a lock with a long history
+     */
+    void addLogEntries(const size_t count);
+    size_t getLogEntryCount();
+
+  protected:
+    void applyConfig(const uint8_t* newConfig, size_t length) override;
+    void applyAdvancedConfig(const uint8_t* newAdvancedConfig, size_t length) override;
+    bool beginLockAction(const uint8_t action, const uint32_t authId) override;
+    void completeLockAction(const uint8_t action, const uint32_t authId) override;
+
+  private:
+    void appendLogEntry(const uint32_t authId, const NukiLock::LockAction action, const NukiLock::Trigger trigger);
+    void publish();
+
+    NukiLock::KeyTurnerState lockState;
+    NukiLock::Config lockConfig;
+    NukiLock::AdvancedConfig lockAdvancedConfig;
+    NukiLock::BatteryReport lockBatteryReport;
+};
+
+} // namespace NukiEmulator
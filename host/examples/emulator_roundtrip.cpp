@@ -0,0 +1,142 @@
+/**
+ * @file emulator_roundtrip.cpp
+ * Host (Linux) example: pairs a NukiLock with an emulated Smart Lock and times the round trips of
+ * lockAction, requestConfig and retrieveLogEntries over the emulated link.
+ *
+ * usage: nuki_emulator_roundtrip [iterations] [packet latency us] [mtu] [loss rate]
+ *
+ * NukiBle returns from a lock action once it is accepted, the example waits for the motor before the
+ * next command. A log request returns once the last entry of the stream arrived.
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ */
+
+#include "NukiLock.h"
+#include "BleScanner.h"
+#include "SmartLockEmulator.h"
+#include "esp_timer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <list>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Timing {
+  std::string name;
+  std::vector<int64_t> samplesUs;
+  unsigned int failures = 0;
+};
+
+template<typename F>
+void measure(Timing& timing, F call) {
+  int64_t start = esp_timer_get_time();
+  Nuki::CmdResult result = call();
+  int64_t elapsed = esp_timer_get_time() - start;
+  if (result == Nuki::CmdResult::Success) {
+    timing.samplesUs.push_back(elapsed);
+  } else {
+    timing.failures++;
+  }
+}
+
+void report(const Timing& timing) {
+  if (timing.samplesUs.empty()) {
+    printf("%-20s no successful calls, %u failed\n", timing.name.c_str(), timing.failures);
+    return;
+  }
+  int64_t sum = 0;
+  for (int64_t sample : timing.samplesUs) {
+    sum += sample;
+  }
+  printf("%-20s n=%-4zu min=%8.2f ms  mean=%8.2f ms  max=%8.2f ms  failed=%u\n", timing.name.c_str(),
+         timing.samplesUs.size(),
+         *std::min_element(timing.samplesUs.begin(), timing.samplesUs.end()) / 1000.0,
+         sum / 1000.0 / timing.samplesUs.size(),
+         *std::max_element(timing.samplesUs.begin(), timing.samplesUs.end()) / 1000.0,
+         timing.failures);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  int iterations = argc > 1 ? atoi(argv[1]) : 20;
+  int64_t packetUs = argc > 2 ? atoll(argv[2]) : 7500;
+  uint16_t mtu = argc > 3 ? atoi(argv[3]) : 185;
+  double lossRate = argc > 4 ? atof(argv[4]) : 0;
+  const int64_t actionDurationUs = 500 * 1000;
+  const uint16_t logEntryCount = 10;
+
+  esp_log_level_set("*", ESP_LOG_WARN);
+
+  // one connection event per packet, connection setup and discovery of a typical lock
+  NukiEmulator::LinkProfile profile;
+  profile.connectUs = 6 * packetUs;
+  profile.discoveryUs = 2 * packetUs;
+  profile.subscribeUs = packetUs;
+  profile.writeUs = packetUs;
+  profile.indicationUs = packetUs;
+  profile.mtu = mtu;
+  profile.lossRate = lossRate;
+
+  NukiEmulator::SmartLockEmulator emulator(NimBLEAddress("54:d2:72:00:00:01", 0), 0x2A000001);
+  emulator.setLinkProfile(profile);
+  emulator.setActionDuration(actionDurationUs);
+  emulator.addLogEntries(50);
+  emulator.setPairingMode(true);
+  emulator.begin();
+  emulator.startAdvertising(100 * 1000);
+
+  BleScanner::Scanner scanner;
+  scanner.initialize();
+  NukiLock::NukiLock nukiLock("emulator", 1);
+  nukiLock.initialize();
+  nukiLock.registerBleScanner(&scanner);
+  nukiLock.unPairNuki();
+
+  int64_t pairingStart = esp_timer_get_time();
+  while (nukiLock.pairNuki() != Nuki::PairingResult::Success) {
+    if (esp_timer_get_time() - pairingStart > 30 * 1000 * 1000) {
+      printf("pairing failed\n");
+      return 1;
+    }
+    vTaskDelay(pdMS_TO_TICKS(50));
+  }
+  printf("paired in %.2f ms\n", (esp_timer_get_time() - pairingStart) / 1000.0);
+  emulator.setPairingMode(false);
+
+  Timing lockActionTiming{"lockAction"};
+  Timing requestConfigTiming{"requestConfig"};
+  Timing logEntriesTiming{"retrieveLogEntries"};
+  for (int i = 0; i < iterations; i++) {
+    NukiLock::LockAction action = (i % 2) ? NukiLock::LockAction::Lock : NukiLock::LockAction::Unlock;
+    measure(lockActionTiming, [&]() { return nukiLock.lockAction(action); });
+    vTaskDelay(pdMS_TO_TICKS((actionDurationUs + 4 * packetUs) / 1000 + 20));
+
+    NukiLock::Config config;
+    measure(requestConfigTiming, [&]() { return nukiLock.requestConfig(&config); });
+
+    measure(logEntriesTiming, [&]() { return nukiLock.retrieveLogEntries(0, logEntryCount, 1, true); });
+  }
+
+  std::list<NukiLock::LogEntry> logEntries;
+  nukiLock.getLogEntries(&logEntries);
+  NukiEmulator::Statistics statistics = emulator.getStatistics();
+
+  printf("link: %lld us per packet, mtu %u, loss rate %.3f\n", (long long)packetUs, mtu, lossRate);
+  report(lockActionTiming);
+  report(requestConfigTiming);
+  report(logEntriesTiming);
+  printf("log entries received in last stream: %zu of %u\n", logEntries.size(), logEntryCount);
+  printf("emulator: %u connects, %u writes (%u lost), %u indications (%u lost), %u errors\n",
+         statistics.connects, statistics.writes, statistics.lostWrites, statistics.indications,
+         statistics.lostIndications, statistics.errors);
+
+  nukiLock.unPairNuki();
+  emulator.end();
+  return 0;
+}
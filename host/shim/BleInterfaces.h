@@ -0,0 +1,25 @@
+#pragma once
+/**
+ * @file BleInterfaces.h
+ * Host (Linux) stand-in for the interfaces of https://github.com/AzonInc/ble-scanner
+ */
+
+#include "NimBLEDevice.h"
+
+namespace BleScanner {
+
+class Subscriber {
+  public:
+    virtual ~Subscriber() {}
+    virtual void onResult(const NimBLEAdvertisedDevice* advertisedDevice) = 0;
+};
+
+class Publisher {
+  public:
+    virtual ~Publisher() {}
+    virtual void subscribe(Subscriber* subscriber) = 0;
+    virtual void unsubscribe(Subscriber* subscriber) = 0;
+    virtual void enableScanning(bool enable) = 0;
+};
+
+} // namespace BleScanner
@@ -0,0 +1,70 @@
+/**
+ * @file BleScanner.cpp
+ * Host (Linux) implementation of the ble-scanner stand-in.
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ */
+
+#include "BleScanner.h"
+
+#include <algorithm>
+
+namespace BleScanner {
+
+Scanner::Scanner() {}
+
+Scanner::~Scanner() {
+  if (initialized) {
+    NimBLEHost::removeScanListener(this);
+  }
+}
+
+void Scanner::initialize(const std::string& deviceName, const bool wantDuplicates, const uint16_t interval,
+                         const uint16_t window) {
+  if (!NimBLEDevice::isInitialized()) {
+    NimBLEDevice::init(deviceName);
+  }
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  if (!initialized) {
+    NimBLEHost::addScanListener(this);
+    initialized = true;
+  }
+}
+
+void Scanner::update() {
+  // advertisements are pushed by the host thread, nothing to restart
+}
+
+void Scanner::subscribe(Subscriber* subscriber) {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  if (std::find(subscribers.begin(), subscribers.end(), subscriber) == subscribers.end()) {
+    subscribers.push_back(subscriber);
+  }
+}
+
+void Scanner::unsubscribe(Subscriber* subscriber) {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  subscribers.erase(std::remove(subscribers.begin(), subscribers.end(), subscriber), subscribers.end());
+}
+
+void Scanner::enableScanning(bool enable) {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  scanningEnabled = enable;
+}
+
+bool Scanner::isScanning() const {
+  return initialized && scanningEnabled;
+}
+
+void Scanner::onAdvertisement(const NimBLEAdvertisedDevice* advertisedDevice) {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  if (!scanningEnabled) {
+    return;
+  }
+  for (Subscriber* subscriber : subscribers) {
+    subscriber->onResult(advertisedDevice);
+  }
+}
+
+} // namespace BleScanner
@@ -0,0 +1,40 @@
+#pragma once
+/**
+ * @file BleScanner.h
+ * Host (Linux) stand-in for the scanner of https://github.com/AzonInc/ble-scanner
+ *
+ * Receives the advertisements broadcast through NimBLEHost::advertise() while scanning is enabled.
+ */
+
+#include "BleInterfaces.h"
+#include "NimBLEHost.h"
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace BleScanner {
+
+class Scanner : public Publisher, public NimBLEHost::ScanListener {
+  public:
+    Scanner();
+    virtual ~Scanner();
+
+    void initialize(const std::string& deviceName = "blescanner", const bool wantDuplicates = false,
+                    const uint16_t interval = 23, const uint16_t window = 23);
+    void update();
+    void subscribe(Subscriber* subscriber) override;
+    void unsubscribe(Subscriber* subscriber) override;
+    void enableScanning(bool enable) override;
+    bool isScanning() const;
+
+    void onAdvertisement(const NimBLEAdvertisedDevice* advertisedDevice) override;
+
+  private:
+    std::recursive_mutex mutex;
+    std::vector<Subscriber*> subscribers;
+    bool initialized = false;
+    bool scanningEnabled = true;
+};
+
+} // namespace BleScanner
@@ -0,0 +1,54 @@
+/**
+ * @file Crc16.cpp
+ * Host (Linux) implementation of the Crc16 stand-in, same bit by bit algorithm as the original library.
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ */
+
+#include "Crc16.h"
+
+void Crc16::clearCrc() {
+  crc = 0;
+}
+
+unsigned int Crc16::fastCrc(uint8_t data[], uint8_t start, uint16_t length, uint8_t reflectIn, uint8_t reflectOut,
+                            unsigned short polynomial, unsigned short xorIn, unsigned short xorOut,
+                            unsigned short msbMask, unsigned short mask) {
+  unsigned int crc = xorIn;
+
+  for (uint32_t i = start; i < (uint32_t)start + length; i++) {
+    unsigned int c = data[i];
+    if (reflectIn != 0) {
+      c = reflect(c, 8);
+    }
+    for (unsigned int j = 0x80; j > 0; j >>= 1) {
+      unsigned int bit = crc & msbMask;
+      crc <<= 1;
+      if ((c & j) != 0) {
+        bit ^= msbMask;
+      }
+      if (bit != 0) {
+        crc ^= polynomial;
+      }
+    }
+  }
+
+  if (reflectOut != 0) {
+    crc = (reflect(crc, 16) ^ xorOut) & mask;
+  } else {
+    crc = (crc ^ xorOut) & mask;
+  }
+  return crc;
+}
+
+unsigned int Crc16::reflect(unsigned int data, uint8_t bits) {
+  unsigned int reflection = 0;
+  for (uint8_t bit = 0; bit < bits; bit++) {
+    if ((data & 0x01) != 0) {
+      reflection |= (1u << ((bits - 1) - bit));
+    }
+    data >>= 1;
+  }
+  return reflection;
+}
@@ -0,0 +1,20 @@
+#pragma once
+/**
+ * @file Crc16.h
+ * Host (Linux) stand-in for https://github.com/AzonInc/Crc16 (bitwise CRC16 with configurable model)
+ */
+
+#include <cstdint>
+
+class Crc16 {
+  public:
+    void clearCrc();
+    unsigned int fastCrc(uint8_t data[], uint8_t start, uint16_t length, uint8_t reflectIn, uint8_t reflectOut,
+                         unsigned short polynomial, unsigned short xorIn, unsigned short xorOut,
+                         unsigned short msbMask, unsigned short mask);
+
+  private:
+    unsigned int reflect(unsigned int data, uint8_t bits);
+
+    unsigned short crc = 0;
+};
@@ -0,0 +1,134 @@
+/**
+ * @file EspHost.cpp
+ * Host (Linux) implementation of the ESP-IDF system stand-ins (log, timer, random, watchdog, heap size).
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ */
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_task_wdt.h"
+#include "esp_random.h"
+#include "esp_heap_caps.h"
+
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <malloc.h>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+
+namespace {
+
+const std::chrono::steady_clock::time_point bootTime = std::chrono::steady_clock::now();
+
+std::mutex logMutex;
+esp_log_level_t defaultLogLevel = ESP_LOG_INFO;
+std::map<std::string, esp_log_level_t> tagLogLevels;
+
+std::mutex randomMutex;
+std::mt19937 randomGenerator{std::random_device{}()};
+
+const size_t NOTIONAL_HEAP_SIZE = 256 * 1024 * 1024;
+
+} // namespace
+
+const char* esp_err_to_name(esp_err_t code) {
+  switch (code) {
+    case ESP_OK:
+      return "ESP_OK";
+    case ESP_FAIL:
+      return "ESP_FAIL";
+    case ESP_ERR_NO_MEM:
+      return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:
+      return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE:
+      return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE:
+      return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND:
+      return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED:
+      return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT:
+      return "ESP_ERR_TIMEOUT";
+    default:
+      return "UNKNOWN ERROR";
+  }
+}
+
+void esp_log_level_set(const char* tag, esp_log_level_t level) {
+  std::lock_guard<std::mutex> lock(logMutex);
+  if (strcmp(tag, "*") == 0) {
+    defaultLogLevel = level;
+    tagLogLevels.clear();
+  } else {
+    tagLogLevels[tag] = level;
+  }
+}
+
+esp_log_level_t esp_log_level_get(const char* tag) {
+  std::lock_guard<std::mutex> lock(logMutex);
+  if (!tagLogLevels.empty()) {
+    auto it = tagLogLevels.find(tag);
+    if (it != tagLogLevels.end()) {
+      return it->second;
+    }
+  }
+  return defaultLogLevel;
+}
+
+uint32_t esp_log_timestamp(void) {
+  return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+void esp_log_write(esp_log_level_t level, const char* tag, const char* format, ...) {
+  static const char levelChars[] = {'N', 'E', 'W', 'I', 'D', 'V'};
+  char message[512];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(message, sizeof(message), format, args);
+  va_end(args);
+
+  std::lock_guard<std::mutex> lock(logMutex);
+  fprintf(stderr, "%c (%u) %s: %s\n", levelChars[level], esp_log_timestamp(), tag, message);
+}
+
+int64_t esp_timer_get_time(void) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - bootTime).count();
+}
+
+esp_err_t esp_task_wdt_add(TaskHandle_t task) {
+  return ESP_OK;
+}
+
+esp_err_t esp_task_wdt_delete(TaskHandle_t task) {
+  return ESP_OK;
+}
+
+esp_err_t esp_task_wdt_reset(void) {
+  return ESP_OK;
+}
+
+uint32_t esp_random(void) {
+  std::lock_guard<std::mutex> lock(randomMutex);
+  return randomGenerator();
+}
+
+void esp_fill_random(void* buf, size_t len) {
+  uint8_t* bytes = (uint8_t*)buf;
+  for (size_t i = 0; i < len; i++) {
+    bytes[i] = (uint8_t)(esp_random() & 0xFF);
+  }
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+  size_t allocated = mallinfo2().uordblks;
+  return allocated < NOTIONAL_HEAP_SIZE ? NOTIONAL_HEAP_SIZE - allocated : 0;
+}
@@ -0,0 +1,205 @@
+/**
+ * @file FreeRTOSHost.cpp
+ * Host (Linux) implementation of the FreeRTOS task and semaphore stand-ins.
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ */
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <pthread.h>
+#include <mutex>
+#include <string>
+#include <thread>
+
+struct tskTaskControlBlock {
+  std::string name;
+  TaskFunction_t taskCode = nullptr;
+  void* parameters = nullptr;
+  UBaseType_t priority = 0;
+};
+
+struct QueueDefinition {
+  std::mutex mutex;
+  std::condition_variable available;
+  UBaseType_t count = 0;
+  UBaseType_t maxCount = 1;
+  bool recursive = false;
+  TaskHandle_t holder = nullptr;
+  UBaseType_t depth = 0;
+};
+
+namespace {
+
+thread_local TaskHandle_t currentTask = nullptr;
+// tasks which were not created by xTaskCreate (the main thread, std::threads) get an implicit TCB
+thread_local std::unique_ptr<tskTaskControlBlock> implicitTask;
+
+void taskEntry(TaskHandle_t task) {
+  currentTask = task;
+  task->taskCode(task->parameters);
+}
+
+bool waitFor(QueueDefinition* semaphore, std::unique_lock<std::mutex>& lock, TickType_t ticksToWait,
+             const std::function<bool()>& ready) {
+  if (ticksToWait == portMAX_DELAY) {
+    semaphore->available.wait(lock, ready);
+    return true;
+  }
+  return semaphore->available.wait_for(lock, std::chrono::milliseconds(ticksToWait * portTICK_PERIOD_MS), ready);
+}
+
+SemaphoreHandle_t createSemaphore(UBaseType_t maxCount, UBaseType_t initialCount, bool recursive) {
+  SemaphoreHandle_t semaphore = new QueueDefinition();
+  semaphore->maxCount = maxCount;
+  semaphore->count = initialCount;
+  semaphore->recursive = recursive;
+  return semaphore;
+}
+
+} // namespace
+
+BaseType_t xTaskCreate(TaskFunction_t taskCode, const char* name, uint32_t stackDepth, void* parameters,
+                       UBaseType_t priority, TaskHandle_t* createdTask) {
+  TaskHandle_t task = new tskTaskControlBlock();
+  task->name = name ? name : "";
+  task->taskCode = taskCode;
+  task->parameters = parameters;
+  task->priority = priority;
+  if (createdTask) {
+    *createdTask = task;
+  }
+  std::thread(taskEntry, task).detach();
+  return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t taskCode, const char* name, uint32_t stackDepth, void* parameters,
+                                   UBaseType_t priority, TaskHandle_t* createdTask, BaseType_t coreId) {
+  return xTaskCreate(taskCode, name, stackDepth, parameters, priority, createdTask);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+  // Threads cannot be killed: a task deleting itself ends when its task function returns right
+  // after this call, deleting another task is not supported on the host.
+}
+
+void vTaskDelay(const TickType_t ticksToDelay) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ticksToDelay * portTICK_PERIOD_MS));
+}
+
+TickType_t xTaskGetTickCount(void) {
+  return (TickType_t)(esp_timer_get_time() / 1000 / portTICK_PERIOD_MS);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+  if (currentTask == nullptr) {
+    implicitTask.reset(new tskTaskControlBlock());
+    implicitTask->name = "main";
+    currentTask = implicitTask.get();
+  }
+  return currentTask;
+}
+
+char* pcTaskGetName(TaskHandle_t task) {
+  if (task == nullptr) {
+    task = xTaskGetCurrentTaskHandle();
+  }
+  return &task->name[0];
+}
+
+uint8_t* pxTaskGetStackStart(TaskHandle_t task) {
+  static thread_local uint8_t* stackStart = nullptr;
+  if (stackStart == nullptr) {
+    pthread_attr_t attributes;
+    void* address = nullptr;
+    size_t size = 0;
+    if (pthread_getattr_np(pthread_self(), &attributes) == 0) {
+      pthread_attr_getstack(&attributes, &address, &size);
+      pthread_attr_destroy(&attributes);
+    }
+    stackStart = (uint8_t*)address;
+  }
+  return stackStart;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+  return 0;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+  return createSemaphore(1, 1, false);
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void) {
+  return createSemaphore(1, 1, true);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) {
+  return createSemaphore(1, 0, false);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount) {
+  return createSemaphore(maxCount, initialCount, false);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore) {
+  delete semaphore;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticksToWait) {
+  std::unique_lock<std::mutex> lock(semaphore->mutex);
+  if (!waitFor(semaphore, lock, ticksToWait, [semaphore]() { return semaphore->count > 0; })) {
+    return pdFALSE;
+  }
+  semaphore->count--;
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+  std::lock_guard<std::mutex> lock(semaphore->mutex);
+  if (semaphore->count >= semaphore->maxCount) {
+    return pdFALSE;
+  }
+  semaphore->count++;
+  semaphore->available.notify_one();
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t semaphore, TickType_t ticksToWait) {
+  TaskHandle_t self = xTaskGetCurrentTaskHandle();
+  std::unique_lock<std::mutex> lock(semaphore->mutex);
+  if (semaphore->holder == self) {
+    semaphore->depth++;
+    return pdTRUE;
+  }
+  if (!waitFor(semaphore, lock, ticksToWait, [semaphore]() { return semaphore->count > 0; })) {
+    return pdFALSE;
+  }
+  semaphore->count--;
+  semaphore->holder = self;
+  semaphore->depth = 1;
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t semaphore) {
+  TaskHandle_t self = xTaskGetCurrentTaskHandle();
+  std::lock_guard<std::mutex> lock(semaphore->mutex);
+  if (semaphore->holder != self) {
+    return pdFALSE;
+  }
+  if (--semaphore->depth == 0) {
+    semaphore->holder = nullptr;
+    semaphore->count++;
+    semaphore->available.notify_one();
+  }
+  return pdTRUE;
+}
@@ -0,0 +1,41 @@
+/**
+ * @file HeapHost.cpp
+ * Host (Linux) operator new/delete calling the heap hooks of the heap capabilities stand-in.
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ *
+ * A program defining its own operator new/delete (e.g. nuki_advertisement_bench) replaces these ones,
+ * the heap hooks are not called then. Nothing else lives in this file, so the linker does not pull it in for them.
+ */
+
+#include "esp_heap_caps.h"
+
+#include <cstdlib>
+#include <new>
+
+void* operator new(size_t size) {
+  void* pointer = malloc(size ? size : 1);
+  if (pointer == nullptr) {
+    throw std::bad_alloc();
+  }
+#ifdef CONFIG_HEAP_USE_HOOKS
+  if (esp_heap_trace_alloc_hook) {
+    esp_heap_trace_alloc_hook(pointer, size, MALLOC_CAP_DEFAULT);
+  }
+#endif
+  return pointer;
+}
+
+void operator delete(void* pointer) noexcept {
+#ifdef CONFIG_HEAP_USE_HOOKS
+  if (pointer && esp_heap_trace_free_hook) {
+    esp_heap_trace_free_hook(pointer);
+  }
+#endif
+  free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+  operator delete(pointer);
+}
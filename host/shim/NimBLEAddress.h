@@ -0,0 +1,36 @@
+#pragma once
+/**
+ * @file NimBLEAddress.h
+ * Host (Linux) stand-in for the esp-nimble-cpp BLE address class.
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ *
+ * Like esp-nimble-cpp 2.x the byte array constructor takes the address in display
+ * (most significant byte first) order while getVal() returns the native little endian value.
+ */
+
+#include <cstdint>
+#include <string>
+
+class NimBLEAddress {
+  public:
+    NimBLEAddress();
+    NimBLEAddress(const std::string& stringAddress, uint8_t type);
+    NimBLEAddress(const uint8_t address[6], uint8_t type);
+    NimBLEAddress(uint64_t address, uint8_t type);
+
+    const uint8_t* getVal() const;
+    uint8_t getType() const;
+    bool isNull() const;
+    std::string toString() const;
+    operator std::string() const;
+    operator uint64_t() const;
+
+    bool operator==(const NimBLEAddress& rhs) const;
+    bool operator!=(const NimBLEAddress& rhs) const;
+
+  private:
+    uint8_t val[6] = {0};
+    uint8_t type = 0;
+};
@@ -0,0 +1,40 @@
+#pragma once
+/**
+ * @file NimBLEBeacon.h
+ * Host (Linux) stand-in for the esp-nimble-cpp iBeacon parser.
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ */
+
+#include "NimBLEUUID.h"
+
+#include <cstdint>
+
+class NimBLEBeacon {
+  public:
+    struct __attribute__((packed)) BeaconData {
+      uint16_t manufacturerId = 0x004c;
+      uint8_t subType = 0x02;
+      uint8_t subTypeLength = 0x15;
+      uint8_t proximityUUID[16] = {0};
+      uint16_t major = 0;
+      uint16_t minor = 0;
+      int8_t signalPower = 0;
+    };
+
+    NimBLEBeacon();
+
+    void setData(const uint8_t* data, uint8_t length);
+    const BeaconData& getData() const;
+    uint16_t getManufacturerId() const;
+    uint16_t getMajor() const;
+    uint16_t getMinor() const;
+    NimBLEUUID getProximityUUID() const;
+    int8_t getSignalPower() const;
+
+  private:
+    BeaconData beaconData;
+};
+
+typedef NimBLEBeacon BLEBeacon;
@@ -0,0 +1,230 @@
+#pragma once
+/**
+ * @file NimBLEDevice.h
+ * Host (Linux) stand-in for the subset of esp-nimble-cpp used by NukiBleEsp32.
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ *
+ * Clients connect to in-process peripherals registered through NimBLEHost.h instead of a radio.
+ * Callbacks (notifications, disconnects, scan results) run on a single "nimble_host" thread,
+ * the same way they run in the NimBLE host task on target.
+ */
+
+#include "NimBLEUUID.h"
+#include "NimBLEAddress.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#ifndef CONFIG_BT_NIMBLE_MAX_CONNECTIONS
+#define CONFIG_BT_NIMBLE_MAX_CONNECTIONS 3
+#endif
+#define NIMBLE_MAX_CONNECTIONS CONFIG_BT_NIMBLE_MAX_CONNECTIONS
+
+#define BLE_HS_CONN_HANDLE_NONE 0xffff
+#define BLE_ATT_MTU_DFLT 23
+
+#define BLE_GAP_LE_PHY_1M 1
+#define BLE_GAP_LE_PHY_2M 2
+#define BLE_GAP_LE_PHY_1M_MASK 0x01
+#define BLE_GAP_LE_PHY_2M_MASK 0x02
+#define BLE_GAP_LE_PHY_CODED_MASK 0x04
+#define BLE_GAP_LE_PHY_ANY_MASK 0x0F
+
+typedef enum {
+  ESP_PWR_LVL_N12 = 0,
+  ESP_PWR_LVL_N9  = 1,
+  ESP_PWR_LVL_N6  = 2,
+  ESP_PWR_LVL_N3  = 3,
+  ESP_PWR_LVL_N0  = 4,
+  ESP_PWR_LVL_P3  = 5,
+  ESP_PWR_LVL_P6  = 6,
+  ESP_PWR_LVL_P9  = 7,
+  ESP_PWR_LVL_INVALID = 0xFF,
+} esp_power_level_t;
+
+extern "C" void ble_hs_sched_reset(int reason);
+
+class NimBLEClient;
+class NimBLERemoteService;
+
+namespace NimBLEHost {
+class Peripheral;
+
+/**
+ * @brief Parameters of a connection as agreed by client and peripheral
+ */
+struct LinkParameters {
+  // connection interval in 1.25 ms units
+  uint16_t interval = 0;
+  // connection events the peripheral may skip
+  uint16_t latency = 0;
+  // in 10 ms units
+  uint16_t supervisionTimeout = 0;
+  // BLE_GAP_LE_PHY_1M or BLE_GAP_LE_PHY_2M
+  uint8_t phy = BLE_GAP_LE_PHY_1M;
+  // link layer payload octets, 27 without data length extension
+  uint16_t dataLength = 27;
+};
+}
+
+class NimBLEAdvertisedDevice {
+  public:
+    NimBLEAdvertisedDevice(const NimBLEAddress& address, int rssi, const std::vector<uint8_t>& payload);
+
+    NimBLEAddress getAddress() const;
+    int getRSSI() const;
+    std::string getName() const;
+    const std::vector<uint8_t>& getPayload() const;
+    bool haveName() const;
+    bool haveManufacturerData() const;
+    std::string getManufacturerData() const;
+    bool haveServiceUUID() const;
+    NimBLEUUID getServiceUUID() const;
+    bool isAdvertisingService(const NimBLEUUID& uuid) const;
+    bool haveServiceData() const;
+    std::string getServiceData(const NimBLEUUID& uuid) const;
+    std::string toString() const;
+
+  private:
+    bool findField(uint8_t type, size_t* offset, size_t* length, size_t start = 0) const;
+
+    NimBLEAddress address;
+    int rssi;
+    std::vector<uint8_t> payload;
+};
+
+class NimBLERemoteCharacteristic {
+  public:
+    typedef std::function<void (NimBLERemoteCharacteristic* pBLERemoteCharacteristic, uint8_t* pData, size_t length,
+                                bool isNotify)> notify_callback;
+
+    NimBLERemoteCharacteristic(NimBLERemoteService* service, const NimBLEUUID& uuid, uint16_t handle);
+
+    const NimBLEUUID& getUUID() const;
+    uint16_t getHandle() const;
+    NimBLERemoteService* getRemoteService() const;
+    bool canIndicate() const;
+    bool canNotify() const;
+    bool canWrite() const;
+    bool subscribe(bool notifications = true, const notify_callback notifyCallback = nullptr, bool response = true);
+    bool unsubscribe(bool response = true);
+    bool writeValue(const uint8_t* data, size_t length, bool response = false);
+
+  private:
+    friend class NimBLEClient;
+    friend class NimBLERemoteService;
+    friend struct NimBLEHostAccess;
+
+    NimBLERemoteService* service;
+    NimBLEUUID uuid;
+    uint16_t handle;
+    notify_callback callback = nullptr;
+};
+
+class NimBLERemoteService {
+  public:
+    NimBLERemoteService(NimBLEClient* client, const NimBLEUUID& uuid, uint16_t handle);
+    ~NimBLERemoteService();
+
+    const NimBLEUUID& getUUID() const;
+    uint16_t getHandle() const;
+    NimBLEClient* getClient() const;
+    NimBLERemoteCharacteristic* getCharacteristic(const NimBLEUUID& uuid);
+
+  private:
+    friend class NimBLEClient;
+    friend class NimBLERemoteCharacteristic;
+    friend struct NimBLEHostAccess;
+
+    NimBLEClient* client;
+    NimBLEUUID uuid;
+    uint16_t handle;
+    std::vector<NimBLERemoteCharacteristic*> characteristics;
+};
+
+class NimBLEClientCallbacks {
+  public:
+    virtual ~NimBLEClientCallbacks() {}
+    virtual void onConnect(NimBLEClient* pClient) {}
+    virtual void onDisconnect(NimBLEClient* pClient, int reason) {}
+};
+
+class NimBLEClient {
+  public:
+    bool connect(const NimBLEAddress& address, bool deleteAttributes = true);
+    int disconnect(uint8_t reason = 0x13);
+    bool isConnected() const;
+    void setClientCallbacks(NimBLEClientCallbacks* callbacks, bool deleteCallbacks = true);
+    void setConnectTimeout(uint32_t timeoutMs);
+    void setConnectionParams(uint16_t minInterval, uint16_t maxInterval, uint16_t latency, uint16_t timeout,
+                             uint16_t scanInterval = 16, uint16_t scanWindow = 16);
+    bool updateConnParams(uint16_t minInterval, uint16_t maxInterval, uint16_t latency, uint16_t timeout);
+    bool setDataLen(uint16_t txOctets);
+    bool updatePhy(uint8_t txPhysMask, uint8_t rxPhysMask, uint16_t phyOptions = 0);
+    bool getPhy(uint8_t* txPhy, uint8_t* rxPhy);
+    NimBLEAddress getPeerAddress() const;
+    uint16_t getConnHandle() const;
+    uint16_t getMTU() const;
+    int getRssi() const;
+    NimBLERemoteService* getService(const NimBLEUUID& uuid);
+    void deleteServices();
+
+  private:
+    friend class NimBLEDevice;
+    friend class NimBLERemoteService;
+    friend class NimBLERemoteCharacteristic;
+    friend struct NimBLEHostAccess;
+
+    NimBLEClient();
+    ~NimBLEClient();
+
+    NimBLEHost::LinkParameters currentLink();
+
+    NimBLEAddress peerAddress;
+    NimBLEHost::Peripheral* peripheral = nullptr;
+    NimBLEClientCallbacks* callbacks = nullptr;
+    bool connected = false;
+    uint16_t connHandle = BLE_HS_CONN_HANDLE_NONE;
+    uint32_t connectTimeoutMs = 30000;
+    // requested by setConnectionParams(), the defaults of NimBLE
+    uint16_t minInterval = 24;
+    uint16_t maxInterval = 40;
+    uint16_t latency = 0;
+    uint16_t supervisionTimeout = 256;
+    // of the current connection
+    NimBLEHost::LinkParameters link;
+    uint16_t nextHandle = 1;
+    std::vector<NimBLERemoteService*> services;
+};
+
+class NimBLEDevice {
+  public:
+    static bool init(const std::string& deviceName);
+    static bool deinit(bool clearAll = false);
+    static bool isInitialized();
+    static NimBLEClient* createClient();
+    static bool deleteClient(NimBLEClient* pClient);
+    static size_t getCreatedClientCount();
+    static NimBLEClient* getClientByPeerAddress(const NimBLEAddress& peerAddress);
+    static NimBLEClient* getDisconnectedClient();
+    static bool setPower(int8_t dbm);
+    static int getPower();
+};
+
+typedef NimBLEUUID BLEUUID;
+typedef NimBLEAddress BLEAddress;
+typedef NimBLEAdvertisedDevice BLEAdvertisedDevice;
+typedef NimBLERemoteCharacteristic BLERemoteCharacteristic;
+typedef NimBLERemoteService BLERemoteService;
+typedef NimBLEClientCallbacks BLEClientCallbacks;
+typedef NimBLEClient BLEClient;
+typedef NimBLEDevice BLEDevice;
@@ -0,0 +1,1007 @@
+/**
+ * @file NimBLEHost.cpp
+ * Host (Linux) implementation of the esp-nimble-cpp stand-in and the in-process "air" (NimBLEHost.h).
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ */
+
+#include "NimBLEDevice.h"
+#include "NimBLEBeacon.h"
+#include "NimBLEHost.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+const char* LOG_TAG = "NimBLEHost";
+
+std::string dataToHexString(const uint8_t* data, size_t length) {
+  static const char hex[] = "0123456789abcdef";
+  std::string result;
+  result.reserve(length * 2);
+  for (size_t i = 0; i < length; i++) {
+    result += hex[data[i] >> 4];
+    result += hex[data[i] & 0x0f];
+  }
+  return result;
+}
+
+void delayUs(int64_t us) {
+  if (us > 0) {
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+  }
+}
+
+/**
+ * Single thread executing timed events in due order, stands in for the NimBLE host task
+ */
+class HostTask {
+  public:
+    HostTask() : thread(&HostTask::run, this) {}
+
+    void post(int64_t delayUs, std::function<void()> function) {
+      std::lock_guard<std::mutex> lock(mutex);
+      events.emplace(esp_timer_get_time() + std::max<int64_t>(delayUs, 0), std::move(function));
+      wakeUp.notify_all();
+    }
+
+    void flush() {
+      int64_t target = esp_timer_get_time();
+      std::unique_lock<std::mutex> lock(mutex);
+      if (std::this_thread::get_id() == thread.get_id()) {
+        return;
+      }
+      idle.wait(lock, [this, target]() {
+        return !executing && (events.empty() || events.begin()->first > target);
+      });
+    }
+
+  private:
+    void run() {
+      std::unique_lock<std::mutex> lock(mutex);
+      while (true) {
+        if (events.empty()) {
+          wakeUp.wait(lock);
+          continue;
+        }
+        int64_t now = esp_timer_get_time();
+        auto next = events.begin();
+        if (next->first > now) {
+          wakeUp.wait_for(lock, std::chrono::microseconds(next->first - now));
+          continue;
+        }
+        std::function<void()> function = std::move(next->second);
+        events.erase(next);
+        executing = true;
+        lock.unlock();
+        function();
+        lock.lock();
+        executing = false;
+        idle.notify_all();
+      }
+    }
+
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    std::condition_variable idle;
+    std::multimap<int64_t, std::function<void()>> events;
+    bool executing = false;
+    std::thread thread;
+};
+
+HostTask& hostTask() {
+  // intentionally leaked, the host thread may still run while static objects are destroyed at exit
+  static HostTask* task = new HostTask();
+  return *task;
+}
+
+// Guards all client/attribute state, held while callbacks are delivered so attributes
+// cannot be deleted under a running notify callback
+std::recursive_mutex& hostMutex() {
+  static std::recursive_mutex* mutex = new std::recursive_mutex();
+  return *mutex;
+}
+
+std::vector<NimBLEHost::Peripheral*> peripherals;
+std::vector<NimBLEHost::ScanListener*> scanListeners;
+std::vector<NimBLEClient*> clients;
+bool initialized = false;
+int txPower = 9;
+uint16_t nextConnHandle = 0;
+
+NimBLEHost::Peripheral* findPeripheral(const NimBLEAddress& address) {
+  for (NimBLEHost::Peripheral* peripheral : peripherals) {
+    if (peripheral->getAddress() == address) {
+      return peripheral;
+    }
+  }
+  return nullptr;
+}
+
+} // namespace
+
+struct NimBLEHostAccess {
+  static NimBLEClient* connectedClient(NimBLEHost::Peripheral* peripheral) {
+    for (NimBLEClient* client : clients) {
+      if (client->connected && client->peripheral == peripheral) {
+        return client;
+      }
+    }
+    return nullptr;
+  }
+
+  static NimBLEHost::Peripheral* peripheralOf(const NimBLEClient* client) {
+    return client->connected ? client->peripheral : nullptr;
+  }
+
+  static bool negotiate(NimBLEClient* client, const NimBLEHost::LinkParameters& requested) {
+    NimBLEHost::Peripheral* peripheral = nullptr;
+    {
+      std::lock_guard<std::recursive_mutex> lock(hostMutex());
+      peripheral = peripheralOf(client);
+    }
+    if (peripheral == nullptr) {
+      return false;
+    }
+    // the peripheral is not called with the host mutex held, like in linkDelayUs()
+    NimBLEHost::LinkParameters agreed = peripheral->negotiateLink(requested);
+    std::lock_guard<std::recursive_mutex> lock(hostMutex());
+    if (peripheralOf(client) != peripheral) {
+      return false;
+    }
+    client->link = agreed;
+    return true;
+  }
+
+  static void deliver(NimBLEHost::Peripheral* peripheral, const NimBLEUUID& uuid, std::vector<uint8_t>& data) {
+    NimBLEClient* client = connectedClient(peripheral);
+    if (client == nullptr) {
+      return;
+    }
+    for (NimBLERemoteService* service : client->services) {
+      for (NimBLERemoteCharacteristic* characteristic : service->characteristics) {
+        if (characteristic->uuid == uuid && characteristic->callback) {
+          characteristic->callback(characteristic, data.data(), data.size(), false);
+          return;
+        }
+      }
+    }
+  }
+
+  static void terminateAll(int reason) {
+    std::lock_guard<std::recursive_mutex> lock(hostMutex());
+    for (NimBLEClient* client : clients) {
+      if (client->connected) {
+        terminate(client, reason);
+      }
+    }
+  }
+
+  static void terminate(NimBLEClient* client, int reason) {
+    NimBLEHost::Peripheral* peripheral = client->peripheral;
+    client->connected = false;
+    client->peripheral = nullptr;
+    client->connHandle = BLE_HS_CONN_HANDLE_NONE;
+    // subscriptions do not survive a connection with a non-bonded peer
+    for (NimBLERemoteService* service : client->services) {
+      for (NimBLERemoteCharacteristic* characteristic : service->characteristics) {
+        characteristic->callback = nullptr;
+      }
+    }
+    if (peripheral) {
+      peripheral->onDisconnect();
+    }
+    hostTask().post(0, [client, reason]() {
+      std::lock_guard<std::recursive_mutex> lock(hostMutex());
+      if (client->callbacks) {
+        client->callbacks->onDisconnect(client, reason);
+      }
+    });
+  }
+};
+
+// ---------------------------------------------------------------------------------------------------------------------
+// NimBLEUUID
+
+NimBLEUUID::NimBLEUUID() {}
+
+NimBLEUUID::NimBLEUUID(const std::string& uuid) {
+  std::string hex;
+  for (char c : uuid) {
+    if (isxdigit((unsigned char)c)) {
+      hex += c;
+    }
+  }
+  if (uuid.compare(0, 2, "0x") == 0 || uuid.compare(0, 2, "0X") == 0) {
+    hex.erase(0, 1);
+  }
+  if (hex.size() != 4 && hex.size() != 8 && hex.size() != 32) {
+    return;
+  }
+  size = hex.size() * 4;
+  size_t bytes = hex.size() / 2;
+  for (size_t i = 0; i < bytes; i++) {
+    value[bytes - 1 - i] = (uint8_t)strtoul(hex.substr(i * 2, 2).c_str(), nullptr, 16);
+  }
+}
+
+NimBLEUUID::NimBLEUUID(const char* uuid) : NimBLEUUID(std::string(uuid)) {}
+
+NimBLEUUID::NimBLEUUID(uint16_t uuid) {
+  size = 16;
+  value[0] = uuid & 0xff;
+  value[1] = uuid >> 8;
+}
+
+NimBLEUUID::NimBLEUUID(const uint8_t* data, size_t length) {
+  if (length != 2 && length != 4 && length != 16) {
+    return;
+  }
+  size = length * 8;
+  memcpy(value, data, length);
+}
+
+uint8_t NimBLEUUID::bitSize() const {
+  return size;
+}
+
+const uint8_t* NimBLEUUID::getValue() const {
+  return value;
+}
+
+std::string NimBLEUUID::toString() const {
+  char buf[40];
+  if (size == 16) {
+    snprintf(buf, sizeof(buf), "0x%04x", value[0] | (value[1] << 8));
+    return buf;
+  }
+  if (size == 32) {
+    snprintf(buf, sizeof(buf), "0x%08x", value[0] | (value[1] << 8) | (value[2] << 16) | ((uint32_t)value[3] << 24));
+    return buf;
+  }
+  if (size == 128) {
+    std::string result;
+    for (int i = 15; i >= 0; i--) {
+      snprintf(buf, sizeof(buf), "%02x", value[i]);
+      result += buf;
+      if (i == 12 || i == 10 || i == 8 || i == 6) {
+        result += '-';
+      }
+    }
+    return result;
+  }
+  return "";
+}
+
+NimBLEUUID::operator std::string() const {
+  return toString();
+}
+
+bool NimBLEUUID::operator==(const NimBLEUUID& rhs) const {
+  return size == rhs.size && memcmp(value, rhs.value, size / 8) == 0;
+}
+
+bool NimBLEUUID::operator!=(const NimBLEUUID& rhs) const {
+  return !(*this == rhs);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// NimBLEAddress
+
+NimBLEAddress::NimBLEAddress() {}
+
+NimBLEAddress::NimBLEAddress(const std::string& stringAddress, uint8_t type) : type(type) {
+  unsigned int bytes[6];
+  if (sscanf(stringAddress.c_str(), "%02x:%02x:%02x:%02x:%02x:%02x",
+             &bytes[5], &bytes[4], &bytes[3], &bytes[2], &bytes[1], &bytes[0]) == 6) {
+    for (int i = 0; i < 6; i++) {
+      val[i] = (uint8_t)bytes[i];
+    }
+  }
+}
+
+NimBLEAddress::NimBLEAddress(const uint8_t address[6], uint8_t type) : type(type) {
+  std::reverse_copy(address, address + 6, val);
+}
+
+NimBLEAddress::NimBLEAddress(uint64_t address, uint8_t type) : type(type) {
+  for (int i = 0; i < 6; i++) {
+    val[i] = (address >> (8 * i)) & 0xff;
+  }
+}
+
+const uint8_t* NimBLEAddress::getVal() const {
+  return val;
+}
+
+uint8_t NimBLEAddress::getType() const {
+  return type;
+}
+
+bool NimBLEAddress::isNull() const {
+  return *this == NimBLEAddress();
+}
+
+std::string NimBLEAddress::toString() const {
+  char buf[18];
+  snprintf(buf, sizeof(buf), "%02x:%02x:%02x:%02x:%02x:%02x", val[5], val[4], val[3], val[2], val[1], val[0]);
+  return buf;
+}
+
+NimBLEAddress::operator std::string() const {
+  return toString();
+}
+
+NimBLEAddress::operator uint64_t() const {
+  uint64_t address = 0;
+  for (int i = 5; i >= 0; i--) {
+    address = (address << 8) | val[i];
+  }
+  return address;
+}
+
+bool NimBLEAddress::operator==(const NimBLEAddress& rhs) const {
+  return memcmp(val, rhs.val, sizeof(val)) == 0;
+}
+
+bool NimBLEAddress::operator!=(const NimBLEAddress& rhs) const {
+  return !(*this == rhs);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// NimBLEBeacon
+
+NimBLEBeacon::NimBLEBeacon() {}
+
+void NimBLEBeacon::setData(const uint8_t* data, uint8_t length) {
+  if (length != sizeof(BeaconData)) {
+    ESP_LOGE(LOG_TAG, "Unable to set the data ... length passed in was %d and expected %d", length,
+             (int)sizeof(BeaconData));
+    return;
+  }
+  memcpy(&beaconData, data, length);
+}
+
+const NimBLEBeacon::BeaconData& NimBLEBeacon::getData() const {
+  return beaconData;
+}
+
+uint16_t NimBLEBeacon::getManufacturerId() const {
+  return beaconData.manufacturerId;
+}
+
+uint16_t NimBLEBeacon::getMajor() const {
+  return beaconData.major;
+}
+
+uint16_t NimBLEBeacon::getMinor() const {
+  return beaconData.minor;
+}
+
+NimBLEUUID NimBLEBeacon::getProximityUUID() const {
+  uint8_t reversed[16];
+  std::reverse_copy(beaconData.proximityUUID, beaconData.proximityUUID + 16, reversed);
+  return NimBLEUUID(reversed, 16);
+}
+
+int8_t NimBLEBeacon::getSignalPower() const {
+  return beaconData.signalPower;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// NimBLEAdvertisedDevice
+
+NimBLEAdvertisedDevice::NimBLEAdvertisedDevice(const NimBLEAddress& address, int rssi,
+    const std::vector<uint8_t>& payload)
+  : address(address),
+    rssi(rssi),
+    payload(payload) {
+}
+
+bool NimBLEAdvertisedDevice::findField(uint8_t type, size_t* offset, size_t* length, size_t start) const {
+  size_t i = start;
+  while (i + 1 < payload.size()) {
+    uint8_t fieldLength = payload[i];
+    if (fieldLength == 0 || i + 1 + fieldLength > payload.size()) {
+      return false;
+    }
+    if (payload[i + 1] == type) {
+      *offset = i + 2;
+      *length = fieldLength - 1;
+      return true;
+    }
+    i += 1 + fieldLength;
+  }
+  return false;
+}
+
+NimBLEAddress NimBLEAdvertisedDevice::getAddress() const {
+  return address;
+}
+
+int NimBLEAdvertisedDevice::getRSSI() const {
+  return rssi;
+}
+
+std::string NimBLEAdvertisedDevice::getName() const {
+  size_t offset;
+  size_t length;
+  if (findField(0x09, &offset, &length) || findField(0x08, &offset, &length)) {
+    return std::string((const char*)&payload[offset], length);
+  }
+  return "";
+}
+
+const std::vector<uint8_t>& NimBLEAdvertisedDevice::getPayload() const {
+  return payload;
+}
+
+bool NimBLEAdvertisedDevice::haveName() const {
+  size_t offset;
+  size_t length;
+  return findField(0x09, &offset, &length) || findField(0x08, &offset, &length);
+}
+
+bool NimBLEAdvertisedDevice::haveManufacturerData() const {
+  size_t offset;
+  size_t length;
+  return findField(0xff, &offset, &length);
+}
+
+std::string NimBLEAdvertisedDevice::getManufacturerData() const {
+  size_t offset;
+  size_t length;
+  if (findField(0xff, &offset, &length)) {
+    return std::string((const char*)&payload[offset], length);
+  }
+  return "";
+}
+
+bool NimBLEAdvertisedDevice::haveServiceUUID() const {
+  size_t offset;
+  size_t length;
+  return findField(0x02, &offset, &length) || findField(0x03, &offset, &length)
+         || findField(0x06, &offset, &length) || findField(0x07, &offset, &length);
+}
+
+NimBLEUUID NimBLEAdvertisedDevice::getServiceUUID() const {
+  size_t offset;
+  size_t length;
+  if ((findField(0x07, &offset, &length) || findField(0x06, &offset, &length)) && length >= 16) {
+    return NimBLEUUID(&payload[offset], 16);
+  }
+  if ((findField(0x03, &offset, &length) || findField(0x02, &offset, &length)) && length >= 2) {
+    return NimBLEUUID(&payload[offset], 2);
+  }
+  return NimBLEUUID();
+}
+
+bool NimBLEAdvertisedDevice::isAdvertisingService(const NimBLEUUID& uuid) const {
+  const uint8_t types[] = {0x02, 0x03, 0x06, 0x07};
+  for (uint8_t type : types) {
+    size_t offset;
+    size_t length;
+    if (!findField(type, &offset, &length)) {
+      continue;
+    }
+    size_t uuidLength = type < 0x06 ? 2 : 16;
+    for (size_t i = 0; i + uuidLength <= length; i += uuidLength) {
+      if (NimBLEUUID(&payload[offset + i], uuidLength) == uuid) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+bool NimBLEAdvertisedDevice::haveServiceData() const {
+  size_t offset;
+  size_t length;
+  return findField(0x16, &offset, &length) || findField(0x21, &offset, &length);
+}
+
+std::string NimBLEAdvertisedDevice::getServiceData(const NimBLEUUID& uuid) const {
+  uint8_t type = uuid.bitSize() == 128 ? 0x21 : 0x16;
+  size_t uuidLength = uuid.bitSize() / 8;
+  size_t offset;
+  size_t length;
+  size_t start = 0;
+  while (findField(type, &offset, &length, start)) {
+    if (length >= uuidLength && NimBLEUUID(&payload[offset], uuidLength) == uuid) {
+      return std::string((const char*)&payload[offset + uuidLength], length - uuidLength);
+    }
+    start = offset + length;
+  }
+  return "";
+}
+
+std::string NimBLEAdvertisedDevice::toString() const {
+  std::string result = "Name: " + getName() + ", Address: " + address.toString();
+  if (haveManufacturerData()) {
+    std::string manufacturerData = getManufacturerData();
+    result += ", manufacturer data: ";
+    result += dataToHexString((const uint8_t*)manufacturerData.data(), manufacturerData.length());
+  }
+  if (haveServiceUUID()) {
+    result += ", serviceUUID: " + getServiceUUID().toString();
+  }
+  size_t offset;
+  size_t length;
+  if (findField(0x21, &offset, &length) && length >= 16) {
+    result += ", serviceData: UUID: " + NimBLEUUID(&payload[offset], 16).toString() + ", Data: "
+              + dataToHexString(&payload[offset + 16], length - 16);
+  }
+  return result;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// NimBLERemoteCharacteristic
+
+NimBLERemoteCharacteristic::NimBLERemoteCharacteristic(NimBLERemoteService* service, const NimBLEUUID& uuid,
+    uint16_t handle)
+  : service(service),
+    uuid(uuid),
+    handle(handle) {
+}
+
+const NimBLEUUID& NimBLERemoteCharacteristic::getUUID() const {
+  return uuid;
+}
+
+uint16_t NimBLERemoteCharacteristic::getHandle() const {
+  return handle;
+}
+
+NimBLERemoteService* NimBLERemoteCharacteristic::getRemoteService() const {
+  return service;
+}
+
+bool NimBLERemoteCharacteristic::canIndicate() const {
+  // all characteristics of the emulated peripherals are write + indicate (like GDIO and USDIO)
+  return true;
+}
+
+bool NimBLERemoteCharacteristic::canNotify() const {
+  return false;
+}
+
+bool NimBLERemoteCharacteristic::canWrite() const {
+  return true;
+}
+
+bool NimBLERemoteCharacteristic::subscribe(bool notifications, const notify_callback notifyCallback, bool response) {
+  NimBLEHost::Peripheral* peripheral = nullptr;
+  {
+    std::lock_guard<std::recursive_mutex> lock(hostMutex());
+    peripheral = NimBLEHostAccess::peripheralOf(service->client);
+  }
+  if (peripheral == nullptr) {
+    return false;
+  }
+  // CCCD write
+  delayUs(peripheral->linkDelayUs(NimBLEHost::LinkOp::Subscribe, 2));
+
+  std::lock_guard<std::recursive_mutex> lock(hostMutex());
+  if (NimBLEHostAccess::peripheralOf(service->client) != peripheral) {
+    return false;
+  }
+  callback = notifyCallback;
+  return true;
+}
+
+bool NimBLERemoteCharacteristic::unsubscribe(bool response) {
+  std::lock_guard<std::recursive_mutex> lock(hostMutex());
+  callback = nullptr;
+  return true;
+}
+
+bool NimBLERemoteCharacteristic::writeValue(const uint8_t* data, size_t length, bool response) {
+  NimBLEHost::Peripheral* peripheral = nullptr;
+  {
+    std::lock_guard<std::recursive_mutex> lock(hostMutex());
+    peripheral = NimBLEHostAccess::peripheralOf(service->client);
+  }
+  if (peripheral == nullptr) {
+    ESP_LOGE(LOG_TAG, "Disconnected");
+    return false;
+  }
+  delayUs(peripheral->linkDelayUs(NimBLEHost::LinkOp::Write, length));
+  return peripheral->onWrite(uuid, data, length);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// NimBLERemoteService
+
+NimBLERemoteService::NimBLERemoteService(NimBLEClient* client, const NimBLEUUID& uuid, uint16_t handle)
+  : client(client),
+    uuid(uuid),
+    handle(handle) {
+}
+
+NimBLERemoteService::~NimBLERemoteService() {
+  for (NimBLERemoteCharacteristic* characteristic : characteristics) {
+    delete characteristic;
+  }
+}
+
+const NimBLEUUID& NimBLERemoteService::getUUID() const {
+  return uuid;
+}
+
+uint16_t NimBLERemoteService::getHandle() const {
+  return handle;
+}
+
+NimBLEClient* NimBLERemoteService::getClient() const {
+  return client;
+}
+
+NimBLERemoteCharacteristic* NimBLERemoteService::getCharacteristic(const NimBLEUUID& uuid) {
+  NimBLEHost::Peripheral* peripheral = nullptr;
+  {
+    std::lock_guard<std::recursive_mutex> lock(hostMutex());
+    for (NimBLERemoteCharacteristic* characteristic : characteristics) {
+      if (characteristic->uuid == uuid) {
+        return characteristic;
+      }
+    }
+    peripheral = NimBLEHostAccess::peripheralOf(client);
+  }
+  if (peripheral == nullptr) {
+    return nullptr;
+  }
+  delayUs(peripheral->linkDelayUs(NimBLEHost::LinkOp::DiscoverCharacteristic, 0));
+  if (!peripheral->hasCharacteristic(this->uuid, uuid)) {
+    return nullptr;
+  }
+  std::lock_guard<std::recursive_mutex> lock(hostMutex());
+  NimBLERemoteCharacteristic* characteristic = new NimBLERemoteCharacteristic(this, uuid, client->nextHandle++);
+  characteristics.push_back(characteristic);
+  return characteristic;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// NimBLEClient
+
+NimBLEClient::NimBLEClient() {}
+
+NimBLEClient::~NimBLEClient() {
+  deleteServices();
+}
+
+bool NimBLEClient::connect(const NimBLEAddress& address, bool deleteAttributes) {
+  NimBLEHost::Peripheral* target = nullptr;
+  {
+    std::lock_guard<std::recursive_mutex> lock(hostMutex());
+    if (connected) {
+      ESP_LOGE(LOG_TAG, "Client already connected");
+      return false;
+    }
+    if (deleteAttributes) {
+      deleteServices();
+    }
+    peerAddress = address;
+    target = findPeripheral(address);
+  }
+
+  int64_t connectDelay = target ? target->linkDelayUs(NimBLEHost::LinkOp::Connect, 0) : INT64_MAX;
+  if (connectDelay > (int64_t)connectTimeoutMs * 1000) {
+    delayUs((int64_t)connectTimeoutMs * 1000);
+    ESP_LOGE(LOG_TAG, "Connection failed; status=13 ");
+    return false;
+  }
+  delayUs(connectDelay);
+  if (!target->onConnect()) {
+    ESP_LOGE(LOG_TAG, "Connection failed; status=574 ");
+    return false;
+  }
+
+  {
+    std::lock_guard<std::recursive_mutex> lock(hostMutex());
+    connected = true;
+    peripheral = target;
+    connHandle = nextConnHandle++;
+  }
+  // a connection starts on the 1M PHY without data length extension
+  NimBLEHost::LinkParameters requested;
+  requested.interval = maxInterval;
+  requested.latency = latency;
+  requested.supervisionTimeout = supervisionTimeout;
+  NimBLEHostAccess::negotiate(this, requested);
+  if (callbacks) {
+    callbacks->onConnect(this);
+  }
+  return true;
+}
+
+int NimBLEClient::disconnect(uint8_t reason) {
+  std::lock_guard<std::recursive_mutex> lock(hostMutex());
+  if (!connected) {
+    // BLE_HS_ENOTCONN
+    return 7;
+  }
+  // BLE_HS_ERR_HCI_BASE + local host terminated
+  NimBLEHostAccess::terminate(this, 0x200 + 0x16);
+  return 0;
+}
+
+bool NimBLEClient::isConnected() const {
+  std::lock_guard<std::recursive_mutex> lock(hostMutex());
+  return connected;
+}
+
+void NimBLEClient::setClientCallbacks(NimBLEClientCallbacks* callbacks, bool deleteCallbacks) {
+  this->callbacks = callbacks;
+}
+
+void NimBLEClient::setConnectTimeout(uint32_t timeoutMs) {
+  connectTimeoutMs = timeoutMs;
+}
+
+void NimBLEClient::setConnectionParams(uint16_t minInterval, uint16_t maxInterval, uint16_t latency,
+                                       uint16_t timeout, uint16_t scanInterval, uint16_t scanWindow) {
+  std::lock_guard<std::recursive_mutex> lock(hostMutex());
+  this->minInterval = minInterval;
+  this->maxInterval = maxInterval;
+  this->latency = latency;
+  this->supervisionTimeout = timeout;
+}
+
+bool NimBLEClient::updateConnParams(uint16_t minInterval, uint16_t maxInterval, uint16_t latency, uint16_t timeout) {
+  NimBLEHost::LinkParameters requested = currentLink();
+  requested.interval = maxInterval;
+  requested.latency = latency;
+  requested.supervisionTimeout = timeout;
+  return NimBLEHostAccess::negotiate(this, requested);
+}
+
+bool NimBLEClient::setDataLen(uint16_t txOctets) {
+  if (txOctets < 27 || txOctets > 251) {
+    return false;
+  }
+  NimBLEHost::LinkParameters requested = currentLink();
+  requested.dataLength = txOctets;
+  return NimBLEHostAccess::negotiate(this, requested);
+}
+
+bool NimBLEClient::updatePhy(uint8_t txPhysMask, uint8_t rxPhysMask, uint16_t phyOptions) {
+  NimBLEHost::LinkParameters requested = currentLink();
+  requested.phy = (txPhysMask & rxPhysMask & BLE_GAP_LE_PHY_2M_MASK) ? BLE_GAP_LE_PHY_2M : BLE_GAP_LE_PHY_1M;
+  return NimBLEHostAccess::negotiate(this, requested);
+}
+
+NimBLEHost::LinkParameters NimBLEClient::currentLink() {
+  std::lock_guard<std::recursive_mutex> lock(hostMutex());
+  return link;
+}
+
+bool NimBLEClient::getPhy(uint8_t* txPhy, uint8_t* rxPhy) {
+  std::lock_guard<std::recursive_mutex> lock(hostMutex());
+  if (!connected) {
+    return false;
+  }
+  *txPhy = link.phy;
+  *rxPhy = link.phy;
+  return true;
+}
+
+NimBLEAddress NimBLEClient::getPeerAddress() const {
+  return peerAddress;
+}
+
+uint16_t NimBLEClient::getConnHandle() const {
+  return connHandle;
+}
+
+uint16_t NimBLEClient::getMTU() const {
+  return BLE_ATT_MTU_DFLT;
+}
+
+int NimBLEClient::getRssi() const {
+  return isConnected() ? -60 : 0;
+}
+
+NimBLERemoteService* NimBLEClient::getService(const NimBLEUUID& uuid) {
+  NimBLEHost::Peripheral* target = nullptr;
+  {
+    std::lock_guard<std::recursive_mutex> lock(hostMutex());
+    for (NimBLERemoteService* service : services) {
+      if (service->uuid == uuid) {
+        return service;
+      }
+    }
+    target = NimBLEHostAccess::peripheralOf(this);
+  }
+  if (target == nullptr) {
+    return nullptr;
+  }
+  delayUs(target->linkDelayUs(NimBLEHost::LinkOp::DiscoverService, 0));
+  if (!target->hasService(uuid)) {
+    return nullptr;
+  }
+  std::lock_guard<std::recursive_mutex> lock(hostMutex());
+  NimBLERemoteService* service = new NimBLERemoteService(this, uuid, nextHandle++);
+  services.push_back(service);
+  return service;
+}
+
+void NimBLEClient::deleteServices() {
+  std::lock_guard<std::recursive_mutex> lock(hostMutex());
+  for (NimBLERemoteService* service : services) {
+    delete service;
+  }
+  services.clear();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// NimBLEDevice
+
+bool NimBLEDevice::init(const std::string& deviceName) {
+  hostTask();
+  initialized = true;
+  return true;
+}
+
+bool NimBLEDevice::deinit(bool clearAll) {
+  if (clearAll) {
+    NimBLEHostAccess::terminateAll(0x200 + 0x16);
+  }
+  NimBLEHost::flush();
+  initialized = false;
+  return true;
+}
+
+bool NimBLEDevice::isInitialized() {
+  return initialized;
+}
+
+NimBLEClient* NimBLEDevice::createClient() {
+  std::lock_guard<std::recursive_mutex> lock(hostMutex());
+  if (clients.size() >= NIMBLE_MAX_CONNECTIONS) {
+    ESP_LOGE(LOG_TAG, "Unable to create client; already at max: %d", NIMBLE_MAX_CONNECTIONS);
+    return nullptr;
+  }
+  NimBLEClient* client = new NimBLEClient();
+  clients.push_back(client);
+  return client;
+}
+
+bool NimBLEDevice::deleteClient(NimBLEClient* pClient) {
+  {
+    std::lock_guard<std::recursive_mutex> lock(hostMutex());
+    auto it = std::find(clients.begin(), clients.end(), pClient);
+    if (it == clients.end()) {
+      return false;
+    }
+    if (pClient->connected) {
+      NimBLEHostAccess::terminate(pClient, 0x200 + 0x16);
+    }
+    clients.erase(it);
+  }
+  // let a pending onDisconnect run before the client is gone
+  NimBLEHost::flush();
+  delete pClient;
+  return true;
+}
+
+size_t NimBLEDevice::getCreatedClientCount() {
+  std::lock_guard<std::recursive_mutex> lock(hostMutex());
+  return clients.size();
+}
+
+NimBLEClient* NimBLEDevice::getClientByPeerAddress(const NimBLEAddress& peerAddress) {
+  std::lock_guard<std::recursive_mutex> lock(hostMutex());
+  for (NimBLEClient* client : clients) {
+    if (client->peerAddress == peerAddress) {
+      return client;
+    }
+  }
+  return nullptr;
+}
+
+NimBLEClient* NimBLEDevice::getDisconnectedClient() {
+  std::lock_guard<std::recursive_mutex> lock(hostMutex());
+  for (NimBLEClient* client : clients) {
+    if (!client->connected) {
+      return client;
+    }
+  }
+  return nullptr;
+}
+
+bool NimBLEDevice::setPower(int8_t dbm) {
+  txPower = dbm;
+  return true;
+}
+
+int NimBLEDevice::getPower() {
+  return txPower;
+}
+
+extern "C" void ble_hs_sched_reset(int reason) {
+  NimBLEHostAccess::terminateAll(reason);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// NimBLEHost
+
+namespace NimBLEHost {
+
+void addPeripheral(Peripheral* peripheral) {
+  std::lock_guard<std::recursive_mutex> lock(hostMutex());
+  peripherals.push_back(peripheral);
+}
+
+void removePeripheral(Peripheral* peripheral) {
+  {
+    std::lock_guard<std::recursive_mutex> lock(hostMutex());
+    NimBLEClient* client = NimBLEHostAccess::connectedClient(peripheral);
+    if (client) {
+      // BLE_HS_ERR_HCI_BASE + connection timeout
+      NimBLEHostAccess::terminate(client, 0x200 + 0x08);
+    }
+    peripherals.erase(std::remove(peripherals.begin(), peripherals.end(), peripheral), peripherals.end());
+  }
+  flush();
+}
+
+void addScanListener(ScanListener* listener) {
+  std::lock_guard<std::recursive_mutex> lock(hostMutex());
+  scanListeners.push_back(listener);
+}
+
+void removeScanListener(ScanListener* listener) {
+  std::lock_guard<std::recursive_mutex> lock(hostMutex());
+  scanListeners.erase(std::remove(scanListeners.begin(), scanListeners.end(), listener), scanListeners.end());
+}
+
+void indicate(Peripheral* peripheral, const NimBLEUUID& characteristic, const std::vector<uint8_t>& data,
+              int64_t delayUs) {
+  std::vector<uint8_t> value = data;
+  hostTask().post(delayUs, [peripheral, characteristic, value]() mutable {
+    std::lock_guard<std::recursive_mutex> lock(hostMutex());
+    NimBLEHostAccess::deliver(peripheral, characteristic, value);
+  });
+}
+
+void advertise(const NimBLEAdvertisedDevice& advertisedDevice, int64_t delayUs) {
+  hostTask().post(delayUs, [advertisedDevice]() {
+    std::vector<ScanListener*> listeners;
+    {
+      std::lock_guard<std::recursive_mutex> lock(hostMutex());
+      listeners = scanListeners;
+    }
+    for (ScanListener* listener : listeners) {
+      listener->onAdvertisement(&advertisedDevice);
+    }
+  });
+}
+
+void disconnectPeripheral(Peripheral* peripheral, int reason) {
+  std::lock_guard<std::recursive_mutex> lock(hostMutex());
+  NimBLEClient* client = NimBLEHostAccess::connectedClient(peripheral);
+  if (client) {
+    NimBLEHostAccess::terminate(client, 0x200 + reason);
+  }
+}
+
+void post(int64_t delayUs, std::function<void()> function) {
+  hostTask().post(delayUs, std::move(function));
+}
+
+void flush() {
+  hostTask().flush();
+}
+
+} // namespace NimBLEHost
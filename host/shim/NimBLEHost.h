@@ -0,0 +1,112 @@
+#pragma once
+/**
+ * @file NimBLEHost.h
+ * Host (Linux) only: the "air" between the NimBLE client shim and in-process peripherals.
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ *
+ * A Peripheral is registered with its address, clients created through NimBLEDevice connect to it,
+ * discover its services, subscribe to and write its characteristics. The peripheral answers with
+ * indicate() and advertises with advertise(), both are delivered on the "nimble_host" thread.
+ * linkDelayUs() lets a peripheral model the radio: the calling task is blocked for the returned time,
+ * just like a NimBLE client call blocks until the controller has completed the procedure.
+ */
+
+#include "NimBLEDevice.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace NimBLEHost {
+
+enum class LinkOp {
+  Connect,
+  DiscoverService,
+  DiscoverCharacteristic,
+  Subscribe,
+  Write
+};
+
+class Peripheral {
+  public:
+    virtual ~Peripheral() {}
+
+    virtual NimBLEAddress getAddress() const = 0;
+    virtual bool hasService(const NimBLEUUID& service) const = 0;
+    virtual bool hasCharacteristic(const NimBLEUUID& service, const NimBLEUUID& characteristic) const = 0;
+
+    /**
+     * @brief Time in microseconds the client is blocked for the given GATT/GAP procedure
+     *
+     * @param op The procedure
+     * @param length Number of bytes transferred (writes only)
+     */
+    virtual int64_t linkDelayUs(LinkOp op, size_t length) {
+      return 0;
+    }
+
+    /**
+     * @brief Called when a client connects, returning false fails the connect attempt
+     */
+    virtual bool onConnect() {
+      return true;
+    }
+    virtual void onDisconnect() {}
+
+    /**
+     * @brief Called on connect and for every update the client requests, returns the parameters the peripheral
+     * agrees to (e.g. the 1M PHY if it has no 2M PHY)
+     */
+    virtual LinkParameters negotiateLink(const LinkParameters& requested) {
+      return requested;
+    }
+
+    /**
+     * @brief Called when a client writes a characteristic, returning false fails the write
+     */
+    virtual bool onWrite(const NimBLEUUID& characteristic, const uint8_t* data, size_t length) = 0;
+};
+
+class ScanListener {
+  public:
+    virtual ~ScanListener() {}
+    virtual void onAdvertisement(const NimBLEAdvertisedDevice* advertisedDevice) = 0;
+};
+
+void addPeripheral(Peripheral* peripheral);
+void removePeripheral(Peripheral* peripheral);
+
+void addScanListener(ScanListener* listener);
+void removeScanListener(ScanListener* listener);
+
+/**
+ * @brief Sends an indication from the peripheral to the subscribed client after delayUs.
+ * Dropped if the client is not connected or not subscribed at delivery time.
+ */
+void indicate(Peripheral* peripheral, const NimBLEUUID& characteristic, const std::vector<uint8_t>& data,
+              int64_t delayUs = 0);
+
+/**
+ * @brief Broadcasts an advertisement to all scan listeners after delayUs
+ */
+void advertise(const NimBLEAdvertisedDevice& advertisedDevice, int64_t delayUs = 0);
+
+/**
+ * @brief Terminates the connection from the peripheral side (supervision timeout, lock timeout)
+ */
+void disconnectPeripheral(Peripheral* peripheral, int reason = 0x13);
+
+/**
+ * @brief Runs a function on the nimble_host thread after delayUs
+ */
+void post(int64_t delayUs, std::function<void()> function);
+
+/**
+ * @brief Blocks until every event due up to now has been delivered
+ */
+void flush();
+
+} // namespace NimBLEHost
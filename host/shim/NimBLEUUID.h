@@ -0,0 +1,36 @@
+#pragma once
+/**
+ * @file NimBLEUUID.h
+ * Host (Linux) stand-in for the esp-nimble-cpp UUID class.
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ *
+ * Values are kept little endian like ble_uuid_any_t, toString() gives the canonical
+ * lowercase 8-4-4-4-12 notation for 128 bit UUIDs.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class NimBLEUUID {
+  public:
+    NimBLEUUID();
+    NimBLEUUID(const std::string& uuid);
+    NimBLEUUID(const char* uuid);
+    NimBLEUUID(uint16_t uuid);
+    NimBLEUUID(const uint8_t* value, size_t length);
+
+    uint8_t bitSize() const;
+    const uint8_t* getValue() const;
+    std::string toString() const;
+    operator std::string() const;
+
+    bool operator==(const NimBLEUUID& rhs) const;
+    bool operator!=(const NimBLEUUID& rhs) const;
+
+  private:
+    uint8_t value[16] = {0};
+    uint8_t size = 0;
+};
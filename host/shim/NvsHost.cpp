@@ -0,0 +1,518 @@
+/**
+ * @file NvsHost.cpp
+ * Host (Linux) implementation of the NVS stand-in, namespaces and entries live in process memory,
+ * their placement on flash pages is modeled for NvsHost::getFlashStatistics().
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ */
+
+#include "nvs.h"
+#include "nvs_flash.h"
+#include "NvsHost.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Sizes of the default "nvs" partition (0x6000 bytes, 4 kB pages of 126 entries of 32 bytes,
+// one page is kept free for garbage collection)
+const size_t NVS_ENTRY_SIZE = 32;
+const size_t NVS_ENTRIES_PER_PAGE = 126;
+const size_t NVS_PAGE_COUNT = 6;
+
+enum class ItemType : uint8_t {
+  U8   = 0x01,
+  I8   = 0x11,
+  U16  = 0x02,
+  I16  = 0x12,
+  U32  = 0x04,
+  I32  = 0x14,
+  U64  = 0x08,
+  I64  = 0x18,
+  Str  = 0x21,
+  Blob = 0x42
+};
+
+// entries of an item on the page it was written to
+struct Placement {
+  size_t page = NVS_PAGE_COUNT;
+  size_t entries = 0;
+};
+
+struct Item {
+  ItemType type;
+  std::vector<uint8_t> data;
+  Placement placement;
+};
+
+struct Page {
+  bool free = true;
+  // entries programmed since the last erase, and those of them marked erased
+  size_t written = 0;
+  size_t erased = 0;
+  uint32_t eraseCycles = 0;
+};
+
+struct Handle {
+  std::string namespaceName;
+  bool readOnly;
+};
+
+std::recursive_mutex nvsMutex;
+std::map<std::string, std::map<std::string, Item>> namespaces;
+std::map<std::string, Placement> namespaceEntries;
+std::map<nvs_handle_t, Handle> handles;
+nvs_handle_t nextHandle = 1;
+
+std::vector<Page> pages(NVS_PAGE_COUNT);
+size_t activePage = NVS_PAGE_COUNT;
+NvsHost::FlashStatistics statistics;
+NvsHost::FlashTiming timing;
+
+size_t entriesForItem(ItemType type, size_t length) {
+  if (type == ItemType::Str) {
+    return 1 + (length + NVS_ENTRY_SIZE - 1) / NVS_ENTRY_SIZE;
+  }
+  if (type == ItemType::Blob) {
+    // data item (header and data entries) and blob index item
+    return 2 + (length + NVS_ENTRY_SIZE - 1) / NVS_ENTRY_SIZE;
+  }
+  return 1;
+}
+
+void flashOperation(int64_t durationUs) {
+  statistics.flashBusyUs += durationUs;
+  if (timing.blocking && durationUs > 0) {
+    // the flash is busy for every task, like the cache disabled during a write on the target
+    std::this_thread::sleep_for(std::chrono::microseconds(durationUs));
+  }
+}
+
+void programEntries(size_t page, size_t entries) {
+  pages[page].written += entries;
+  // the entries, then their state in the bitmap of the page
+  statistics.flashWrites += 2;
+  statistics.entryWrites += entries;
+  statistics.stateWrites++;
+  flashOperation(entries * timing.entryWriteUs + timing.stateWriteUs);
+}
+
+void eraseEntries(const Placement& placement) {
+  if (placement.page >= NVS_PAGE_COUNT) {
+    return;
+  }
+  pages[placement.page].erased += placement.entries;
+  statistics.flashWrites++;
+  statistics.stateWrites++;
+  flashOperation(timing.stateWriteUs);
+}
+
+void erasePage(size_t page) {
+  pages[page] = Page{true, 0, 0, pages[page].eraseCycles + 1};
+  statistics.pageErases++;
+  flashOperation(timing.pageEraseUs);
+}
+
+size_t freePageCount() {
+  return std::count_if(pages.begin(), pages.end(), [](const Page& page) { return page.free; });
+}
+
+/**
+ * Copies the live entries of the page with the most erased entries to the reserved free page and erases it,
+ * the reserved page becomes the active one.
+ */
+bool collectGarbage() {
+  size_t victim = NVS_PAGE_COUNT;
+  for (size_t i = 0; i < NVS_PAGE_COUNT; i++) {
+    if (!pages[i].free && pages[i].erased > 0 && (victim == NVS_PAGE_COUNT || pages[i].erased > pages[victim].erased)) {
+      victim = i;
+    }
+  }
+  auto spare = std::find_if(pages.begin(), pages.end(), [](const Page& page) { return page.free; });
+  if (victim == NVS_PAGE_COUNT || spare == pages.end()) {
+    return false;
+  }
+  size_t sparePage = spare - pages.begin();
+  pages[sparePage].free = false;
+  statistics.garbageCollections++;
+
+  auto move = [sparePage, victim](Placement& placement) {
+    if (placement.page == victim) {
+      programEntries(sparePage, placement.entries);
+      placement.page = sparePage;
+    }
+  };
+  for (auto& ns : namespaceEntries) {
+    move(ns.second);
+  }
+  for (auto& ns : namespaces) {
+    for (auto& item : ns.second) {
+      move(item.second.placement);
+    }
+  }
+  erasePage(victim);
+  activePage = sparePage;
+  return true;
+}
+
+esp_err_t writeEntries(size_t entries, Placement* placement) {
+  if (entries > NVS_ENTRIES_PER_PAGE) {
+    return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+  }
+  for (size_t attempt = 0; attempt <= NVS_PAGE_COUNT; attempt++) {
+    if (activePage < NVS_PAGE_COUNT && pages[activePage].written + entries <= NVS_ENTRIES_PER_PAGE) {
+      programEntries(activePage, entries);
+      placement->page = activePage;
+      placement->entries = entries;
+      return ESP_OK;
+    }
+    if (freePageCount() > 1) {
+      // one page stays reserved for garbage collection
+      size_t next = activePage < NVS_PAGE_COUNT ? activePage + 1 : 0;
+      while (!pages[next % NVS_PAGE_COUNT].free) {
+        next++;
+      }
+      activePage = next % NVS_PAGE_COUNT;
+      pages[activePage].free = false;
+    } else if (!collectGarbage()) {
+      break;
+    }
+  }
+  return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+}
+
+esp_err_t findNamespace(nvs_handle_t handle, bool write, std::map<std::string, Item>** items) {
+  auto it = handles.find(handle);
+  if (it == handles.end()) {
+    return ESP_ERR_NVS_INVALID_HANDLE;
+  }
+  if (write && it->second.readOnly) {
+    return ESP_ERR_NVS_READ_ONLY;
+  }
+  *items = &namespaces[it->second.namespaceName];
+  return ESP_OK;
+}
+
+esp_err_t checkKey(const char* key) {
+  if (key == nullptr || strlen(key) == 0) {
+    return ESP_ERR_NVS_INVALID_NAME;
+  }
+  if (strlen(key) > NVS_KEY_NAME_MAX_SIZE - 1) {
+    return ESP_ERR_NVS_KEY_TOO_LONG;
+  }
+  return ESP_OK;
+}
+
+esp_err_t setItem(nvs_handle_t handle, const char* key, ItemType type, const void* value, size_t length) {
+  std::lock_guard<std::recursive_mutex> lock(nvsMutex);
+  std::map<std::string, Item>* items = nullptr;
+  esp_err_t err = findNamespace(handle, true, &items);
+  if (err == ESP_OK) {
+    err = checkKey(key);
+  }
+  if (err != ESP_OK) {
+    return err;
+  }
+  statistics.setCalls++;
+  auto it = items->find(key);
+  if (it != items->end() && it->second.type == type && it->second.data.size() == length
+      && (length == 0 || memcmp(it->second.data.data(), value, length) == 0)) {
+    statistics.unchangedSets++;
+    return ESP_OK;
+  }
+  // the new item is written before the old one is erased
+  Placement placement;
+  err = writeEntries(entriesForItem(type, length), &placement);
+  if (err != ESP_OK) {
+    return err;
+  }
+  if (it != items->end()) {
+    eraseEntries(it->second.placement);
+  }
+  Item& item = (*items)[key];
+  item.type = type;
+  item.data.assign((const uint8_t*)value, (const uint8_t*)value + length);
+  item.placement = placement;
+  return ESP_OK;
+}
+
+esp_err_t getItem(nvs_handle_t handle, const char* key, ItemType type, void* value, size_t* length, bool variable) {
+  std::lock_guard<std::recursive_mutex> lock(nvsMutex);
+  std::map<std::string, Item>* items = nullptr;
+  esp_err_t err = findNamespace(handle, false, &items);
+  if (err == ESP_OK) {
+    err = checkKey(key);
+  }
+  if (err != ESP_OK) {
+    return err;
+  }
+  auto it = items->find(key);
+  if (it == items->end() || it->second.type != type) {
+    return ESP_ERR_NVS_NOT_FOUND;
+  }
+  const std::vector<uint8_t>& data = it->second.data;
+  if (variable) {
+    if (value == nullptr) {
+      *length = data.size();
+      return ESP_OK;
+    }
+    if (*length < data.size()) {
+      *length = data.size();
+      return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    *length = data.size();
+  }
+  memcpy(value, data.data(), data.size());
+  return ESP_OK;
+}
+
+template <typename T>
+esp_err_t getScalar(nvs_handle_t handle, const char* key, ItemType type, T* outValue) {
+  if (outValue == nullptr) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  return getItem(handle, key, type, outValue, nullptr, false);
+}
+
+} // namespace
+
+esp_err_t nvs_flash_init(void) {
+  return ESP_OK;
+}
+
+esp_err_t nvs_flash_init_partition(const char* partitionLabel) {
+  return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void) {
+  std::lock_guard<std::recursive_mutex> lock(nvsMutex);
+  for (size_t i = 0; i < NVS_PAGE_COUNT; i++) {
+    if (!pages[i].free) {
+      erasePage(i);
+    }
+  }
+  activePage = NVS_PAGE_COUNT;
+  namespaces.clear();
+  namespaceEntries.clear();
+  return ESP_OK;
+}
+
+esp_err_t nvs_open(const char* namespaceName, nvs_open_mode_t openMode, nvs_handle_t* outHandle) {
+  if (namespaceName == nullptr || strlen(namespaceName) == 0 || outHandle == nullptr) {
+    return ESP_ERR_NVS_INVALID_NAME;
+  }
+  if (strlen(namespaceName) > NVS_KEY_NAME_MAX_SIZE - 1) {
+    return ESP_ERR_NVS_KEY_TOO_LONG;
+  }
+  std::lock_guard<std::recursive_mutex> lock(nvsMutex);
+  if (openMode == NVS_READONLY && namespaces.find(namespaceName) == namespaces.end()) {
+    return ESP_ERR_NVS_NOT_FOUND;
+  }
+  if (openMode == NVS_READWRITE && namespaceEntries.find(namespaceName) == namespaceEntries.end()) {
+    // a new namespace is added to the namespace index
+    Placement placement;
+    esp_err_t err = writeEntries(1, &placement);
+    if (err != ESP_OK) {
+      return err;
+    }
+    namespaceEntries[namespaceName] = placement;
+  }
+  namespaces[namespaceName];
+  *outHandle = nextHandle++;
+  handles[*outHandle] = Handle{namespaceName, openMode == NVS_READONLY};
+  return ESP_OK;
+}
+
+esp_err_t nvs_open_from_partition(const char* partitionLabel, const char* namespaceName, nvs_open_mode_t openMode,
+                                  nvs_handle_t* outHandle) {
+  return nvs_open(namespaceName, openMode, outHandle);
+}
+
+void nvs_close(nvs_handle_t handle) {
+  std::lock_guard<std::recursive_mutex> lock(nvsMutex);
+  handles.erase(handle);
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+  std::lock_guard<std::recursive_mutex> lock(nvsMutex);
+  if (handles.find(handle) == handles.end()) {
+    return ESP_ERR_NVS_INVALID_HANDLE;
+  }
+  // items are written by nvs_set_*, commit has nothing left to do
+  statistics.commits++;
+  return ESP_OK;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char* key) {
+  std::lock_guard<std::recursive_mutex> lock(nvsMutex);
+  std::map<std::string, Item>* items = nullptr;
+  esp_err_t err = findNamespace(handle, true, &items);
+  if (err != ESP_OK) {
+    return err;
+  }
+  auto it = items->find(key);
+  if (it == items->end()) {
+    return ESP_ERR_NVS_NOT_FOUND;
+  }
+  eraseEntries(it->second.placement);
+  items->erase(it);
+  return ESP_OK;
+}
+
+esp_err_t nvs_erase_all(nvs_handle_t handle) {
+  std::lock_guard<std::recursive_mutex> lock(nvsMutex);
+  std::map<std::string, Item>* items = nullptr;
+  esp_err_t err = findNamespace(handle, true, &items);
+  if (err != ESP_OK) {
+    return err;
+  }
+  for (const auto& item : *items) {
+    eraseEntries(item.second.placement);
+  }
+  items->clear();
+  return ESP_OK;
+}
+
+esp_err_t nvs_get_stats(const char* partitionLabel, nvs_stats_t* stats) {
+  if (stats == nullptr) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  std::lock_guard<std::recursive_mutex> lock(nvsMutex);
+  size_t used = 0;
+  for (const auto& ns : namespaces) {
+    // every namespace occupies one entry in the namespace index
+    used++;
+    for (const auto& item : ns.second) {
+      used += item.second.placement.entries;
+    }
+  }
+  stats->total_entries = NVS_ENTRIES_PER_PAGE * NVS_PAGE_COUNT;
+  stats->used_entries = used;
+  stats->free_entries = stats->total_entries - used;
+  stats->available_entries = stats->free_entries > NVS_ENTRIES_PER_PAGE ? stats->free_entries - NVS_ENTRIES_PER_PAGE : 0;
+  stats->namespace_count = namespaces.size();
+  return ESP_OK;
+}
+
+esp_err_t nvs_set_i8(nvs_handle_t handle, const char* key, int8_t value) {
+  return setItem(handle, key, ItemType::I8, &value, sizeof(value));
+}
+
+esp_err_t nvs_set_u8(nvs_handle_t handle, const char* key, uint8_t value) {
+  return setItem(handle, key, ItemType::U8, &value, sizeof(value));
+}
+
+esp_err_t nvs_set_i16(nvs_handle_t handle, const char* key, int16_t value) {
+  return setItem(handle, key, ItemType::I16, &value, sizeof(value));
+}
+
+esp_err_t nvs_set_u16(nvs_handle_t handle, const char* key, uint16_t value) {
+  return setItem(handle, key, ItemType::U16, &value, sizeof(value));
+}
+
+esp_err_t nvs_set_i32(nvs_handle_t handle, const char* key, int32_t value) {
+  return setItem(handle, key, ItemType::I32, &value, sizeof(value));
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char* key, uint32_t value) {
+  return setItem(handle, key, ItemType::U32, &value, sizeof(value));
+}
+
+esp_err_t nvs_set_i64(nvs_handle_t handle, const char* key, int64_t value) {
+  return setItem(handle, key, ItemType::I64, &value, sizeof(value));
+}
+
+esp_err_t nvs_set_u64(nvs_handle_t handle, const char* key, uint64_t value) {
+  return setItem(handle, key, ItemType::U64, &value, sizeof(value));
+}
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char* key, const char* value) {
+  if (value == nullptr) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  return setItem(handle, key, ItemType::Str, value, strlen(value) + 1);
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char* key, const void* value, size_t length) {
+  if (value == nullptr && length > 0) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  return setItem(handle, key, ItemType::Blob, value, length);
+}
+
+esp_err_t nvs_get_i8(nvs_handle_t handle, const char* key, int8_t* outValue) {
+  return getScalar(handle, key, ItemType::I8, outValue);
+}
+
+esp_err_t nvs_get_u8(nvs_handle_t handle, const char* key, uint8_t* outValue) {
+  return getScalar(handle, key, ItemType::U8, outValue);
+}
+
+esp_err_t nvs_get_i16(nvs_handle_t handle, const char* key, int16_t* outValue) {
+  return getScalar(handle, key, ItemType::I16, outValue);
+}
+
+esp_err_t nvs_get_u16(nvs_handle_t handle, const char* key, uint16_t* outValue) {
+  return getScalar(handle, key, ItemType::U16, outValue);
+}
+
+esp_err_t nvs_get_i32(nvs_handle_t handle, const char* key, int32_t* outValue) {
+  return getScalar(handle, key, ItemType::I32, outValue);
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char* key, uint32_t* outValue) {
+  return getScalar(handle, key, ItemType::U32, outValue);
+}
+
+esp_err_t nvs_get_i64(nvs_handle_t handle, const char* key, int64_t* outValue) {
+  return getScalar(handle, key, ItemType::I64, outValue);
+}
+
+esp_err_t nvs_get_u64(nvs_handle_t handle, const char* key, uint64_t* outValue) {
+  return getScalar(handle, key, ItemType::U64, outValue);
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char* key, char* outValue, size_t* length) {
+  if (length == nullptr) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  return getItem(handle, key, ItemType::Str, outValue, length, true);
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char* key, void* outValue, size_t* length) {
+  if (length == nullptr) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  return getItem(handle, key, ItemType::Blob, outValue, length, true);
+}
+
+namespace NvsHost {
+
+FlashStatistics getFlashStatistics() {
+  std::lock_guard<std::recursive_mutex> lock(nvsMutex);
+  FlashStatistics result = statistics;
+  for (const Page& page : pages) {
+    result.maxPageEraseCycles = std::max(result.maxPageEraseCycles, page.eraseCycles);
+  }
+  return result;
+}
+
+void resetFlashStatistics() {
+  std::lock_guard<std::recursive_mutex> lock(nvsMutex);
+  statistics = FlashStatistics();
+}
+
+void setFlashTiming(const FlashTiming& flashTiming) {
+  std::lock_guard<std::recursive_mutex> lock(nvsMutex);
+  timing = flashTiming;
+}
+
+} // namespace NvsHost
@@ -0,0 +1,54 @@
+#pragma once
+/**
+ * @file NvsHost.h
+ * Host (Linux) only: flash model of the NVS stand-in, see nvs.h.
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ *
+ * Entries are placed on the pages of the default partition the way ESP-IDF NVS does: items are appended to
+ * the active page (a blob takes its data entries plus a blob index entry), a replaced or removed item is
+ * marked erased in the entry state bitmap, a full page is followed by the next free one and, when only the
+ * reserved page is left, the page with the most erased entries is garbage collected (live entries copied to
+ * the reserved page, the page erased). A set with the stored value is skipped like ESP-IDF does.
+ * The counters give the flash traffic of a sequence of NVS calls, the timing turns it into the time the
+ * calling task is blocked by the flash.
+ */
+
+#include <cstdint>
+
+namespace NvsHost {
+
+struct FlashStatistics {
+  // nvs_set_* calls, and those of them skipped because the stored value was the same
+  uint64_t setCalls = 0;
+  uint64_t unchangedSets = 0;
+  uint64_t commits = 0;
+  // program operations (item data and entry state bitmap updates) and 32 byte entries programmed
+  uint64_t flashWrites = 0;
+  uint64_t entryWrites = 0;
+  uint64_t stateWrites = 0;
+  uint64_t garbageCollections = 0;
+  uint64_t pageErases = 0;
+  // highest erase count of a single page, not cleared by resetFlashStatistics()
+  uint32_t maxPageEraseCycles = 0;
+  // modeled time of the flash operations above
+  int64_t flashBusyUs = 0;
+};
+
+/**
+ * @brief Flash operation times, typical values of the SPI NOR flash of ESP32 modules
+ */
+struct FlashTiming {
+  int64_t entryWriteUs = 60;
+  int64_t stateWriteUs = 30;
+  int64_t pageEraseUs = 45000;
+  // block the calling task for the modeled time, otherwise the time is only counted
+  bool blocking = false;
+};
+
+FlashStatistics getFlashStatistics();
+void resetFlashStatistics();
+void setFlashTiming(const FlashTiming& timing);
+
+} // namespace NvsHost
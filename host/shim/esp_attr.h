@@ -0,0 +1,8 @@
+#pragma once
+/**
+ * @file esp_attr.h
+ * Host (Linux) stand-in, the placement attributes of ESP-IDF have no meaning on the host.
+ */
+
+#define IRAM_ATTR
+#define DRAM_ATTR
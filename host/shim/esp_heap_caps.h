@@ -0,0 +1,21 @@
+#pragma once
+/**
+ * @file esp_heap_caps.h
+ * Host (Linux) stand-in for the heap capabilities API used by NukiBleEsp32.
+ *
+ * The free size is a notional heap minus the bytes allocated from malloc, only its changes are meaningful.
+ * C++ allocations (operator new) call the ESP-IDF heap hooks when the build defines CONFIG_HEAP_USE_HOOKS.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+#define MALLOC_CAP_8BIT    (1 << 2)
+#define MALLOC_CAP_DEFAULT (1 << 12)
+
+size_t heap_caps_get_free_size(uint32_t caps);
+
+#ifdef CONFIG_HEAP_USE_HOOKS
+extern "C" void esp_heap_trace_alloc_hook(void* ptr, size_t size, uint32_t caps) __attribute__((weak));
+extern "C" void esp_heap_trace_free_hook(void* ptr) __attribute__((weak));
+#endif
@@ -0,0 +1,36 @@
+#pragma once
+/**
+ * @file esp_log.h
+ * Host (Linux) stand-in for the ESP-IDF logging macros, writes to stderr.
+ *
+ * The runtime level defaults to ESP_LOG_INFO (CONFIG_LOG_DEFAULT_LEVEL) and can be changed
+ * per tag with esp_log_level_set(), "*" sets the default for all tags.
+ */
+
+#include <cstdint>
+
+typedef enum {
+  ESP_LOG_NONE,
+  ESP_LOG_ERROR,
+  ESP_LOG_WARN,
+  ESP_LOG_INFO,
+  ESP_LOG_DEBUG,
+  ESP_LOG_VERBOSE
+} esp_log_level_t;
+
+void esp_log_level_set(const char* tag, esp_log_level_t level);
+esp_log_level_t esp_log_level_get(const char* tag);
+void esp_log_write(esp_log_level_t level, const char* tag, const char* format, ...);
+uint32_t esp_log_timestamp(void);
+
+#define ESP_LOG_LEVEL_LOCAL(level, tag, format, ...) do {             \
+    if (esp_log_level_get(tag) >= level) {                            \
+      esp_log_write(level, tag, format, ##__VA_ARGS__);               \
+    }                                                                 \
+  } while (0)
+
+#define ESP_LOGE(tag, format, ...) ESP_LOG_LEVEL_LOCAL(ESP_LOG_ERROR, tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) ESP_LOG_LEVEL_LOCAL(ESP_LOG_WARN, tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) ESP_LOG_LEVEL_LOCAL(ESP_LOG_INFO, tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) ESP_LOG_LEVEL_LOCAL(ESP_LOG_DEBUG, tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) ESP_LOG_LEVEL_LOCAL(ESP_LOG_VERBOSE, tag, format, ##__VA_ARGS__)
@@ -0,0 +1,11 @@
+#pragma once
+/**
+ * @file esp_random.h
+ * Host (Linux) stand-in for the hardware RNG.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+uint32_t esp_random(void);
+void esp_fill_random(void* buf, size_t len);
@@ -0,0 +1,8 @@
+#pragma once
+/**
+ * @file esp_system.h
+ * Host (Linux) stand-in for the ESP-IDF system API used by NukiBleEsp32.
+ */
+
+#include "esp_err.h"
+#include "esp_random.h"
@@ -0,0 +1,14 @@
+#pragma once
+/**
+ * @file esp_task_wdt.h
+ * Host (Linux) stand-in, there is no task watchdog on the host.
+ */
+
+#include "esp_err.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+esp_err_t esp_task_wdt_add(TaskHandle_t task);
+esp_err_t esp_task_wdt_delete(TaskHandle_t task);
+esp_err_t esp_task_wdt_reset(void);
@@ -0,0 +1,9 @@
+#pragma once
+/**
+ * @file esp_timer.h
+ * Host (Linux) stand-in, microseconds since process start from the monotonic clock.
+ */
+
+#include <cstdint>
+
+int64_t esp_timer_get_time(void);
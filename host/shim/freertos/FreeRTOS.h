@@ -0,0 +1,29 @@
+#pragma once
+/**
+ * @file FreeRTOS.h
+ * Host (Linux) stand-in for the FreeRTOS kernel types used by NukiBleEsp32.
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ *
+ * Ticks are milliseconds (configTICK_RATE_HZ = 1000), tasks are std::threads.
+ */
+
+#include <cstdint>
+#include "esp_idf_version.h"
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t StackType_t;
+
+#define configTICK_RATE_HZ 1000
+#define configMAX_PRIORITIES 25
+#define tskNO_AFFINITY 0x7FFFFFFF
+#define portTICK_PERIOD_MS ((TickType_t)1000 / configTICK_RATE_HZ)
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define pdMS_TO_TICKS(xTimeInMs) ((TickType_t)(((TickType_t)(xTimeInMs) * (TickType_t)configTICK_RATE_HZ) / (TickType_t)1000U))
+#define pdFALSE ((BaseType_t)0)
+#define pdTRUE ((BaseType_t)1)
+#define pdPASS (pdTRUE)
+#define pdFAIL (pdFALSE)
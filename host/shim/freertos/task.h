@@ -0,0 +1,29 @@
+#pragma once
+/**
+ * @file task.h
+ * Host (Linux) stand-in for the FreeRTOS task API used by NukiBleEsp32.
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ */
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct tskTaskControlBlock* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+BaseType_t xTaskCreate(TaskFunction_t taskCode, const char* name, uint32_t stackDepth, void* parameters,
+                       UBaseType_t priority, TaskHandle_t* createdTask);
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t taskCode, const char* name, uint32_t stackDepth, void* parameters,
+                                   UBaseType_t priority, TaskHandle_t* createdTask, BaseType_t coreId);
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(const TickType_t ticksToDelay);
+TickType_t xTaskGetTickCount(void);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+char* pcTaskGetName(TaskHandle_t task);
+
+// Only for the calling task. Host threads are not filled with a pattern at creation like FreeRTOS stacks,
+// the high water mark is unknown and reported as 0.
+uint8_t* pxTaskGetStackStart(TaskHandle_t task);
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+#define pcTaskGetTaskName pcTaskGetName
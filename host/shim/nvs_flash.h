@@ -0,0 +1,11 @@
+#pragma once
+/**
+ * @file nvs_flash.h
+ * Host (Linux) stand-in for the NVS flash partition API, see nvs.h.
+ */
+
+#include "esp_err.h"
+
+esp_err_t nvs_flash_init(void);
+esp_err_t nvs_flash_init_partition(const char* partitionLabel);
+esp_err_t nvs_flash_erase(void);
@@ -0,0 +1,185 @@
+/**
+ * @file command_flow_test.cpp
+ * Host (Linux) test: one CommandLoop runs the flows of an emulated Smart Lock and Opener.
+ *
+ * The flows of both devices wait for their answers at the same time. A flow answered with an error report
+ * fails without holding up the flow of the other device, a flow past its deadline ends with TimeOut while the
+ * other one completes, and the device with the expired flow is usable again afterwards.
+ *
+ * usage: nuki_command_flow_test
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ */
+
+#include "NukiLock.h"
+#include "NukiOpener.h"
+#include "BleScanner.h"
+#include "SmartLockEmulator.h"
+#include "OpenerEmulator.h"
+#include "esp_timer.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+int failures = 0;
+
+void expect(const bool condition, const char* check) {
+  if (!condition) {
+    printf("failed: %s\n", check);
+    failures++;
+  }
+}
+
+bool pair(Nuki::NukiBle& client, NukiEmulator::KeyturnerEmulator& emulator, BleScanner::Scanner& scanner) {
+  client.registerBleScanner(&scanner);
+  emulator.setPairingMode(true);
+  int64_t pairingStart = esp_timer_get_time();
+  while (client.pairNuki() != Nuki::PairingResult::Success) {
+    if (esp_timer_get_time() - pairingStart > 30 * 1000 * 1000) {
+      return false;
+    }
+    vTaskDelay(pdMS_TO_TICKS(50));
+  }
+  emulator.setPairingMode(false);
+  client.saveSecurityPincode(1234);
+  return true;
+}
+
+} // namespace
+
+int main() {
+  const int64_t packetUs = 7500;
+  const int64_t answerDelayUs = 200 * 1000;
+
+  esp_log_level_set("*", ESP_LOG_NONE);
+
+  NukiEmulator::LinkProfile profile;
+  profile.connectUs = 6 * packetUs;
+  profile.discoveryUs = 2 * packetUs;
+  profile.subscribeUs = packetUs;
+  profile.writeUs = packetUs;
+  profile.indicationUs = packetUs;
+
+  NukiEmulator::SmartLockEmulator lockEmulator(NimBLEAddress("54:d2:72:00:02:01", 0), 0x2A000001);
+  NukiEmulator::OpenerEmulator openerEmulator(NimBLEAddress("54:d2:72:00:02:02", 0), 0x2B000001);
+  for (NukiEmulator::KeyturnerEmulator* emulator : {(NukiEmulator::KeyturnerEmulator*)&lockEmulator,
+                                                    (NukiEmulator::KeyturnerEmulator*)&openerEmulator}) {
+    emulator->setLinkProfile(profile);
+    emulator->setSecurityPin(1234);
+    emulator->begin();
+    emulator->startAdvertising(100 * 1000);
+  }
+
+  BleScanner::Scanner scanner;
+  scanner.initialize();
+  NukiLock::NukiLock nukiLock("lock", 1);
+  NukiOpener::NukiOpener nukiOpener("opener", 2);
+  nukiLock.initialize();
+  nukiOpener.initialize();
+  nukiLock.unPairNuki();
+  nukiOpener.unPairNuki();
+  // one after the other, an unpaired client takes any device it sees in pairing mode
+  if (!pair(nukiLock, lockEmulator, scanner) || !pair(nukiOpener, openerEmulator, scanner)) {
+    printf("pairing failed\n");
+    return 1;
+  }
+
+  NukiLock::KeyTurnerState emulatedLockState = lockEmulator.getKeyTurnerState();
+  emulatedLockState.configUpdateCount = 7;
+  lockEmulator.setKeyTurnerState(emulatedLockState);
+  NukiOpener::OpenerState emulatedOpenerState = openerEmulator.getOpenerState();
+  emulatedOpenerState.lockState = NukiOpener::LockState::RTOactive;
+  openerEmulator.setOpenerState(emulatedOpenerState);
+
+  // connected before the flows, connecting blocks the loop
+  NukiLock::KeyTurnerState lockState;
+  NukiOpener::OpenerState openerState;
+  expect(nukiLock.requestKeyTurnerState(&lockState) == Nuki::CmdResult::Success, "lock connects");
+  expect(nukiOpener.requestOpenerState(&openerState) == Nuki::CmdResult::Success, "opener connects");
+
+  Nuki::CmdResult lockResult;
+  Nuki::CmdResult openerResult;
+  auto lockCallback = [&lockResult](Nuki::CmdResult result) {
+    lockResult = result;
+  };
+  auto openerCallback = [&openerResult](Nuki::CmdResult result) {
+    openerResult = result;
+  };
+
+  // both devices take answerDelayUs to answer, the loop waits for them at the same time
+  {
+    lockEmulator.setResponseDelay(Nuki::Command::RequestData, answerDelayUs);
+    openerEmulator.setResponseDelay(Nuki::Command::RequestData, answerDelayUs);
+    lockState = NukiLock::KeyTurnerState();
+    openerState = NukiOpener::OpenerState();
+    lockResult = openerResult = Nuki::CmdResult::Failed;
+    Nuki::CommandLoop loop;
+    loop.add(nukiLock.requestKeyTurnerStateFlow(&lockState), lockCallback);
+    loop.add(nukiOpener.requestOpenerStateFlow(&openerState), openerCallback);
+    int64_t startUs = esp_timer_get_time();
+    loop.run();
+    int64_t elapsedUs = esp_timer_get_time() - startUs;
+    expect(lockResult == Nuki::CmdResult::Success, "lock state flow succeeds");
+    expect(openerResult == Nuki::CmdResult::Success, "opener state flow succeeds");
+    expect(lockState.configUpdateCount == 7, "lock state flow returns the lock state");
+    expect(openerState.lockState == NukiOpener::LockState::RTOactive, "opener state flow returns the opener state");
+    expect(elapsedUs < 2 * answerDelayUs, "the answers are waited for at the same time");
+    lockEmulator.setResponseDelay(Nuki::Command::RequestData, 0);
+    openerEmulator.setResponseDelay(Nuki::Command::RequestData, 0);
+  }
+
+  // the lock rejects an unknown lock action with an error report
+  {
+    NukiLock::Action invalidAction{};
+    invalidAction.cmdType = Nuki::CommandType::CommandWithChallengeAndAccept;
+    invalidAction.command = Nuki::Command::LockAction;
+    uint32_t nukiAppId = 1;
+    invalidAction.payload[0] = 0x7f;
+    memcpy(&invalidAction.payload[1], &nukiAppId, sizeof(nukiAppId));
+    invalidAction.payloadLen = 6;
+
+    NukiOpener::Config openerConfig;
+    lockResult = openerResult = Nuki::CmdResult::Failed;
+    Nuki::CommandLoop loop;
+    loop.add(nukiLock.actionFlow(invalidAction), lockCallback);
+    loop.add(nukiOpener.requestConfigFlow(&openerConfig), openerCallback);
+    loop.run();
+    expect(lockResult == Nuki::CmdResult::Failed, "error report fails the lock flow");
+    expect(nukiLock.getLastError() == NukiLock::ErrorCode::K_ERROR_BAD_PARAMETER, "error code of the report is kept");
+    expect(openerResult == Nuki::CmdResult::Success, "opener flow succeeds next to the failing one");
+  }
+
+  // the lock answers the config request after the deadline of its flow
+  {
+    lockEmulator.setResponseDelay(Nuki::Command::RequestConfig, 2000 * 1000);
+    NukiLock::Config lockConfig;
+    NukiOpener::BatteryReport openerBatteryReport;
+    lockResult = openerResult = Nuki::CmdResult::Failed;
+    Nuki::CommandLoop loop;
+    loop.add(nukiLock.requestConfigFlow(&lockConfig), lockCallback, 300);
+    loop.add(nukiOpener.requestBatteryReportFlow(&openerBatteryReport), openerCallback);
+    int64_t startUs = esp_timer_get_time();
+    loop.run();
+    int64_t elapsedUs = esp_timer_get_time() - startUs;
+    expect(lockResult == Nuki::CmdResult::TimeOut, "lock flow ends at its deadline");
+    expect(openerResult == Nuki::CmdResult::Success, "opener flow succeeds next to the expired one");
+    expect(elapsedUs < 1000 * 1000, "the loop does not wait for the late answer");
+    lockEmulator.setResponseDelay(Nuki::Command::RequestConfig, 0);
+
+    lockResult = Nuki::CmdResult::Failed;
+    loop.add(nukiLock.requestConfigFlow(&lockConfig), lockCallback);
+    loop.run();
+    expect(lockResult == Nuki::CmdResult::Success, "lock flow succeeds after the expired one");
+  }
+
+  printf("%d checks failed\n", failures);
+  nukiLock.unPairNuki();
+  nukiOpener.unPairNuki();
+  lockEmulator.end();
+  openerEmulator.end();
+  NimBLEHost::flush();
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,191 @@
+/**
+ * @file command_worker_test.cpp
+ * Host (Linux) test: the queue of a CommandWorker runs calls by priority and drops the least urgent one when full.
+ *
+ * While the worker is busy, a full queue takes a more urgent call in place of its least urgent, latest call,
+ * which completes with CmdResult::Failed and is not run. A call not more urgent than that one is refused. The
+ * queued calls run by priority, in submission order within a priority, and a call past its queue timeout
+ * completes with CmdResult::TimeOut without being run.
+ *
+ * usage: nuki_command_worker_test
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ */
+
+#include "NukiCommandWorker.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include <atomic>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+
+void expect(const bool condition, const char* check) {
+  if (!condition) {
+    printf("failed: %s\n", check);
+    failures++;
+  }
+}
+
+struct Calls {
+  std::mutex mutex;
+  // ids of the calls in the order they ran
+  std::vector<int> run;
+  std::map<int, Nuki::CmdResult> results;
+  std::atomic_int completed{0};
+
+  Nuki::CommandCall call(const int id) {
+    return [this, id]() {
+      std::lock_guard<std::mutex> lock(mutex);
+      run.push_back(id);
+      return Nuki::CmdResult::Success;
+    };
+  }
+
+  Nuki::CommandCallback callback(const int id) {
+    return [this, id](Nuki::CmdResult result) {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        results[id] = result;
+      }
+      completed++;
+    };
+  }
+};
+
+// keeps the worker busy until released
+struct Blocker {
+  std::atomic_bool running{false};
+  std::atomic_bool released{false};
+
+  Nuki::CommandCall call() {
+    return [this]() {
+      running = true;
+      while (!released) {
+        vTaskDelay(pdMS_TO_TICKS(1));
+      }
+      return Nuki::CmdResult::Success;
+    };
+  }
+
+  bool waitUntilRunning() {
+    int64_t startUs = esp_timer_get_time();
+    while (!running) {
+      if (esp_timer_get_time() - startUs > 5 * 1000 * 1000) {
+        return false;
+      }
+      vTaskDelay(pdMS_TO_TICKS(1));
+    }
+    return true;
+  }
+};
+
+bool waitForCompleted(Calls& calls, const int count) {
+  int64_t startUs = esp_timer_get_time();
+  while (calls.completed < count) {
+    if (esp_timer_get_time() - startUs > 5 * 1000 * 1000) {
+      return false;
+    }
+    vTaskDelay(pdMS_TO_TICKS(1));
+  }
+  return true;
+}
+
+} // namespace
+
+int main() {
+  static_assert(NUKI_WORKER_QUEUE_SIZE >= 4, "the test needs room for two calls of each priority");
+  const int half = NUKI_WORKER_QUEUE_SIZE / 2;
+
+  esp_log_level_set("*", ESP_LOG_NONE);
+
+  // a full queue drops its least urgent, latest call for a more urgent one
+  {
+    Nuki::CommandWorker worker("worker_test");
+    Calls calls;
+    Blocker blocker;
+    expect(worker.submit(blocker.call(), nullptr), "blocking call queued");
+    expect(blocker.waitUntilRunning(), "blocking call runs");
+
+    // ids 0 .. half - 1 bulk, half .. QUEUE_SIZE - 1 state queries
+    for (int id = 0; id < NUKI_WORKER_QUEUE_SIZE; id++) {
+      Nuki::CommandPriority priority = id < half ? Nuki::CommandPriority::Bulk : Nuki::CommandPriority::StateQuery;
+      expect(worker.submit(calls.call(id), calls.callback(id), priority), "call queued");
+    }
+    expect(worker.getPendingCount() == NUKI_WORKER_QUEUE_SIZE, "queue full");
+
+    const int lockAction = 100;
+    const int refusedBulk = 101;
+    const int stateQuery = 102;
+    const int refusedStateQuery = 103;
+    expect(worker.submit(calls.call(lockAction), calls.callback(lockAction), Nuki::CommandPriority::LockAction),
+           "lock action queued in a full queue");
+    expect(calls.results.count(half - 1) == 1 && calls.results[half - 1] == Nuki::CmdResult::Failed,
+           "latest bulk call dropped with Failed");
+    expect(!worker.submit(calls.call(refusedBulk), calls.callback(refusedBulk), Nuki::CommandPriority::Bulk),
+           "bulk call refused by a queue full of calls at least as urgent");
+    expect(worker.submit(calls.call(stateQuery), calls.callback(stateQuery), Nuki::CommandPriority::StateQuery),
+           "state query queued in a full queue");
+    expect(calls.results.count(half - 2) == 1 && calls.results[half - 2] == Nuki::CmdResult::Failed,
+           "next latest bulk call dropped with Failed");
+    expect(worker.getPendingCount() == NUKI_WORKER_QUEUE_SIZE, "queue still full");
+
+    // lock actions in place of the remaining bulk calls
+    for (int id = 0; id < half - 2; id++) {
+      expect(worker.submit(calls.call(200 + id), calls.callback(200 + id), Nuki::CommandPriority::LockAction),
+             "lock action queued in place of a bulk call");
+    }
+    expect(!worker.submit(calls.call(refusedStateQuery), calls.callback(refusedStateQuery),
+                          Nuki::CommandPriority::StateQuery),
+           "state query refused by a queue of state queries and lock actions");
+
+    blocker.released = true;
+    // the queued calls and the dropped bulk calls
+    expect(waitForCompleted(calls, NUKI_WORKER_QUEUE_SIZE + half), "queued calls complete");
+
+    std::vector<int> expected;
+    expected.push_back(lockAction);
+    for (int id = 0; id < half - 2; id++) {
+      expected.push_back(200 + id);
+    }
+    for (int id = half; id < NUKI_WORKER_QUEUE_SIZE; id++) {
+      expected.push_back(id);
+    }
+    expected.push_back(stateQuery);
+    std::lock_guard<std::mutex> lock(calls.mutex);
+    expect(calls.run == expected, "calls run by priority, then in submission order");
+    expect(calls.results.count(refusedBulk) == 0 && calls.results.count(refusedStateQuery) == 0,
+           "callback of a refused call not called");
+    for (int id = 0; id < half; id++) {
+      expect(calls.results[id] == Nuki::CmdResult::Failed, "every bulk call dropped with Failed");
+    }
+  }
+
+  // a call past its queue timeout is not run
+  {
+    Nuki::CommandWorker worker("worker_test");
+    Calls calls;
+    Blocker blocker;
+    worker.submit(blocker.call(), nullptr);
+    expect(blocker.waitUntilRunning(), "blocking call runs");
+    expect(worker.submit(calls.call(0), calls.callback(0), Nuki::CommandPriority::StateQuery, 10), "call queued");
+    expect(worker.submit(calls.call(1), calls.callback(1), Nuki::CommandPriority::StateQuery, 5000), "call queued");
+    vTaskDelay(pdMS_TO_TICKS(50));
+    blocker.released = true;
+    expect(waitForCompleted(calls, 2), "queued calls complete");
+    std::lock_guard<std::mutex> lock(calls.mutex);
+    expect(calls.results[0] == Nuki::CmdResult::TimeOut, "expired call completes with TimeOut");
+    expect(calls.results[1] == Nuki::CmdResult::Success, "call within its timeout runs");
+    expect(calls.run == std::vector<int>{1}, "expired call not run");
+  }
+
+  printf("%d checks failed\n", failures);
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,94 @@
+/**
+ * @file list_completion_test.cpp
+ * Host (Linux) test: a state request sent right after a list retrieval gets the current state.
+ *
+ * A list retrieval returns once the last entry arrived, the Status COMPLETE closing the list comes after
+ * the call returned. The command sent next, a state request or another list, must not take that status for its
+ * own answer.
+ *
+ * usage: nuki_list_completion_test [iterations]
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ */
+
+#include "NukiLock.h"
+#include "BleScanner.h"
+#include "SmartLockEmulator.h"
+#include "esp_timer.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <list>
+
+int main(int argc, char** argv) {
+  int iterations = argc > 1 ? atoi(argv[1]) : 10;
+  const int64_t packetUs = 7500;
+  const uint16_t logEntryCount = 5;
+
+  esp_log_level_set("*", ESP_LOG_NONE);
+
+  NukiEmulator::LinkProfile profile;
+  profile.connectUs = 6 * packetUs;
+  profile.discoveryUs = 2 * packetUs;
+  profile.subscribeUs = packetUs;
+  profile.writeUs = packetUs;
+  profile.indicationUs = packetUs;
+
+  NukiEmulator::SmartLockEmulator emulator(NimBLEAddress("54:d2:72:00:00:01", 0), 0x2A000001);
+  emulator.setLinkProfile(profile);
+  emulator.addLogEntries(20);
+  emulator.setPairingMode(true);
+  emulator.begin();
+  emulator.startAdvertising(100 * 1000);
+
+  BleScanner::Scanner scanner;
+  scanner.initialize();
+  NukiLock::NukiLock nukiLock("listtest", 1);
+  nukiLock.initialize();
+  nukiLock.registerBleScanner(&scanner);
+  nukiLock.unPairNuki();
+
+  int64_t pairingStart = esp_timer_get_time();
+  while (nukiLock.pairNuki() != Nuki::PairingResult::Success) {
+    if (esp_timer_get_time() - pairingStart > 30 * 1000 * 1000) {
+      printf("pairing failed\n");
+      return 1;
+    }
+    vTaskDelay(pdMS_TO_TICKS(50));
+  }
+  emulator.setPairingMode(false);
+
+  int failures = 0;
+  for (int i = 0; i < iterations; i++) {
+    NukiLock::KeyTurnerState emulatedState = emulator.getKeyTurnerState();
+    emulatedState.configUpdateCount = i;
+    emulator.setKeyTurnerState(emulatedState);
+
+    // every other iteration a second list right after the first one
+    for (int list = 0; list < 1 + i % 2; list++) {
+      Nuki::CmdResult listResult = nukiLock.retrieveLogEntries(0, logEntryCount, 1, true);
+      std::list<NukiLock::LogEntry> logEntries;
+      nukiLock.getLogEntries(&logEntries);
+      if (listResult != Nuki::CmdResult::Success || logEntries.size() != logEntryCount) {
+        printf("iteration %d: retrieveLogEntries %d, %zu of %u entries\n", i, (int)listResult, logEntries.size(),
+               logEntryCount);
+        failures++;
+      }
+    }
+
+    // right after the list, while its closing status is still on the way
+    NukiLock::KeyTurnerState state;
+    Nuki::CmdResult stateResult = nukiLock.requestKeyTurnerState(&state);
+    if (stateResult != Nuki::CmdResult::Success || state.configUpdateCount != i) {
+      printf("iteration %d: requestKeyTurnerState %d, config update count %u instead of %d\n", i, (int)stateResult,
+             state.configUpdateCount, i);
+      failures++;
+    }
+  }
+
+  printf("%d of %d iterations failed\n", failures, iterations);
+  nukiLock.unPairNuki();
+  emulator.end();
+  return failures == 0 ? 0 : 1;
+}
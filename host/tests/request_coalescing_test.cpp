@@ -0,0 +1,165 @@
+/**
+ * @file request_coalescing_test.cpp
+ * Host (Linux) test: identical state requests share one exchange with an emulated Smart Lock.
+ *
+ * Two tasks requesting the keyturner state at the same time get the answer of one exchange, as do two requests
+ * queued on the command worker behind each other. A write queued between two requests makes the second one
+ * exchange again, the write may have changed the state.
+ *
+ * usage: nuki_request_coalescing_test
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ */
+
+#include "NukiLock.h"
+#include "BleScanner.h"
+#include "SmartLockEmulator.h"
+#include "esp_timer.h"
+
+#include <atomic>
+#include <cstdio>
+#include <future>
+#include <thread>
+
+namespace {
+
+int failures = 0;
+
+void expect(const bool condition, const char* check) {
+  if (!condition) {
+    printf("failed: %s\n", check);
+    failures++;
+  }
+}
+
+} // namespace
+
+int main() {
+  const int64_t packetUs = 7500;
+  const int64_t answerDelayUs = 200 * 1000;
+
+  esp_log_level_set("*", ESP_LOG_NONE);
+
+  NukiEmulator::LinkProfile profile;
+  profile.connectUs = 6 * packetUs;
+  profile.discoveryUs = 2 * packetUs;
+  profile.subscribeUs = packetUs;
+  profile.writeUs = packetUs;
+  profile.indicationUs = packetUs;
+
+  NukiEmulator::SmartLockEmulator emulator(NimBLEAddress("54:d2:72:00:03:01", 0), 0x2A000001);
+  emulator.setLinkProfile(profile);
+  emulator.setSecurityPin(1234);
+  emulator.setPairingMode(true);
+  emulator.begin();
+  emulator.startAdvertising(100 * 1000);
+
+  BleScanner::Scanner scanner;
+  scanner.initialize();
+  NukiLock::NukiLock nukiLock("coalesce", 1);
+  nukiLock.initialize();
+  nukiLock.registerBleScanner(&scanner);
+  nukiLock.unPairNuki();
+
+  int64_t pairingStart = esp_timer_get_time();
+  while (nukiLock.pairNuki() != Nuki::PairingResult::Success) {
+    if (esp_timer_get_time() - pairingStart > 30 * 1000 * 1000) {
+      printf("pairing failed\n");
+      return 1;
+    }
+    vTaskDelay(pdMS_TO_TICKS(50));
+  }
+  emulator.setPairingMode(false);
+  nukiLock.saveSecurityPincode(1234);
+  nukiLock.setRequestCoalescing(true);
+
+  // keyturner state requests the lock received
+  std::atomic_uint stateExchanges{0};
+  emulator.setTraceListener([&stateExchanges](const NukiEmulator::TraceEvent& event) {
+    if (event.type == NukiEmulator::TraceEventType::Write && event.command == Nuki::Command::RequestData
+        && event.argument == (uint16_t)Nuki::Command::KeyturnerStates) {
+      stateExchanges++;
+    }
+  });
+
+  NukiLock::KeyTurnerState emulatedState = emulator.getKeyTurnerState();
+  emulatedState.configUpdateCount = 7;
+  emulator.setKeyTurnerState(emulatedState);
+
+  // the second request is made while the first one waits for the answer
+  {
+    emulator.setResponseDelay(Nuki::Command::RequestData, answerDelayUs);
+    stateExchanges = 0;
+    uint32_t coalesced = nukiLock.getCoalescedRequestCount();
+    NukiLock::KeyTurnerState firstState{};
+    NukiLock::KeyTurnerState secondState{};
+    std::future<Nuki::CmdResult> first = std::async(std::launch::async, [&nukiLock, &firstState]() {
+      return nukiLock.requestKeyTurnerState(&firstState);
+    });
+    vTaskDelay(pdMS_TO_TICKS(answerDelayUs / 2000));
+    Nuki::CmdResult secondResult = nukiLock.requestKeyTurnerState(&secondState);
+    expect(first.get() == Nuki::CmdResult::Success, "first concurrent request succeeds");
+    expect(secondResult == Nuki::CmdResult::Success, "second concurrent request succeeds");
+    expect(stateExchanges == 1, "concurrent requests share one exchange");
+    expect(nukiLock.getCoalescedRequestCount() == coalesced + 1, "the shared request is counted");
+    expect(firstState.configUpdateCount == 7 && secondState.configUpdateCount == 7,
+           "both requests return the state");
+    emulator.setResponseDelay(Nuki::Command::RequestData, 0);
+  }
+
+  // a call keeps the worker busy until both requests are queued
+  auto block = []() {
+    vTaskDelay(pdMS_TO_TICKS(100));
+    return Nuki::CmdResult::Success;
+  };
+
+  // the second queued request reuses the exchange of the first, started after it was submitted
+  {
+    stateExchanges = 0;
+    NukiLock::KeyTurnerState firstState{};
+    NukiLock::KeyTurnerState secondState{};
+    std::future<Nuki::CmdResult> blocked = nukiLock.submit(block);
+    std::future<Nuki::CmdResult> first = nukiLock.submit([&nukiLock, &firstState]() {
+      return nukiLock.requestKeyTurnerState(&firstState);
+    });
+    std::future<Nuki::CmdResult> second = nukiLock.submit([&nukiLock, &secondState]() {
+      return nukiLock.requestKeyTurnerState(&secondState);
+    });
+    blocked.get();
+    expect(first.get() == Nuki::CmdResult::Success, "first queued request succeeds");
+    expect(second.get() == Nuki::CmdResult::Success, "second queued request succeeds");
+    expect(stateExchanges == 1, "queued requests share one exchange");
+    expect(secondState.configUpdateCount == 7, "the reusing request returns the state");
+  }
+
+  // a write between the queued requests
+  {
+    stateExchanges = 0;
+    NukiLock::KeyTurnerState firstState{};
+    NukiLock::KeyTurnerState secondState{};
+    std::future<Nuki::CmdResult> blocked = nukiLock.submit(block);
+    std::future<Nuki::CmdResult> first = nukiLock.submit([&nukiLock, &firstState]() {
+      return nukiLock.requestKeyTurnerState(&firstState);
+    });
+    std::future<Nuki::CmdResult> write = nukiLock.submit([&nukiLock]() {
+      return nukiLock.setLedBrightness(2);
+    });
+    std::future<Nuki::CmdResult> second = nukiLock.submit([&nukiLock, &secondState]() {
+      return nukiLock.requestKeyTurnerState(&secondState);
+    });
+    blocked.get();
+    expect(first.get() == Nuki::CmdResult::Success, "request before the write succeeds");
+    expect(write.get() == Nuki::CmdResult::Success, "write succeeds");
+    expect(second.get() == Nuki::CmdResult::Success, "request after the write succeeds");
+    expect(stateExchanges == 2, "a write in between forces a new exchange");
+  }
+
+  printf("%d checks failed\n", failures);
+  emulator.setTraceListener(nullptr);
+  nukiLock.stopCommandWorker();
+  nukiLock.unPairNuki();
+  emulator.end();
+  NimBLEHost::flush();
+  return failures == 0 ? 0 : 1;
+}
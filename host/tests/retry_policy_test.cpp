@@ -0,0 +1,103 @@
+/**
+ * @file retry_policy_test.cpp
+ * Host (Linux) test: the delays of BackoffRetryPolicy double up to the maximum, half of each random.
+ *
+ * A connect failure waits base * 2^(failedAttempts - 1), a missing client four times as long, both capped at the
+ * maximum. Discovery and subscription failures wait the base delay, a lock that is not present is given up. The
+ * delay returned is within [delay / 2, delay] ("equal jitter") and spreads over that range.
+ *
+ * usage: nuki_retry_policy_test
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ */
+
+#include "NukiRetryPolicy.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <initializer_list>
+
+namespace {
+
+int failures = 0;
+
+void expect(const bool condition, const char* check) {
+  if (!condition) {
+    printf("failed: %s\n", check);
+    failures++;
+  }
+}
+
+// samples the delay of one failure and checks it stays within [delayMs / 2, delayMs] and covers most of it
+void expectDelay(Nuki::RetryPolicy& policy, const Nuki::ConnectFailure failure, const uint8_t failedAttempts,
+                 const int32_t delayMs, const char* check) {
+  const int runs = 2000;
+  int32_t lowest = INT32_MAX;
+  int32_t highest = INT32_MIN;
+  for (int i = 0; i < runs; i++) {
+    int32_t sample = policy.retryDelayMs(failure, failedAttempts);
+    lowest = sample < lowest ? sample : lowest;
+    highest = sample > highest ? sample : highest;
+  }
+  if (lowest < delayMs / 2 || highest > delayMs) {
+    printf("%s: %d .. %d ms, expected within %d .. %d ms\n", check, lowest, highest, delayMs / 2, delayMs);
+    expect(false, check);
+  }
+  // the random half is spread, not a fixed delay
+  if (delayMs >= 8 && highest - lowest < delayMs / 4) {
+    printf("%s: %d .. %d ms, expected jitter over %d .. %d ms\n", check, lowest, highest, delayMs / 2, delayMs);
+    expect(false, check);
+  }
+}
+
+} // namespace
+
+int main() {
+  // the default base (RETRY_BACKOFF_BASE) and maximum (RETRY_BACKOFF_MAX)
+  {
+    Nuki::BackoffRetryPolicy policy;
+    int32_t delayMs = RETRY_BACKOFF_BASE;
+    for (uint8_t failedAttempts = 1; failedAttempts <= 10; failedAttempts++) {
+      expectDelay(policy, Nuki::ConnectFailure::Connect, failedAttempts, delayMs, "connect failure doubles the delay");
+      delayMs = delayMs * 2 > RETRY_BACKOFF_MAX ? RETRY_BACKOFF_MAX : delayMs * 2;
+    }
+    expectDelay(policy, Nuki::ConnectFailure::Connect, 255, RETRY_BACKOFF_MAX, "delay capped at the maximum");
+
+    delayMs = RETRY_BACKOFF_BASE * 4;
+    for (uint8_t failedAttempts = 1; failedAttempts <= 10; failedAttempts++) {
+      expectDelay(policy, Nuki::ConnectFailure::NoClient, failedAttempts, delayMs,
+                  "missing client doubles four times the base delay");
+      delayMs = delayMs * 2 > RETRY_BACKOFF_MAX ? RETRY_BACKOFF_MAX : delayMs * 2;
+    }
+
+    for (uint8_t failedAttempts : {1, 2, 5}) {
+      expectDelay(policy, Nuki::ConnectFailure::Discovery, failedAttempts, RETRY_BACKOFF_BASE,
+                  "discovery failure waits the base delay");
+      expectDelay(policy, Nuki::ConnectFailure::Subscribe, failedAttempts, RETRY_BACKOFF_BASE,
+                  "subscription failure waits the base delay");
+      expect(policy.retryDelayMs(Nuki::ConnectFailure::NotPresent, failedAttempts) == RETRY_GIVE_UP,
+             "lock not present given up");
+    }
+  }
+
+  // a maximum that is not a doubling of the base
+  {
+    Nuki::BackoffRetryPolicy policy(30, 100);
+    expectDelay(policy, Nuki::ConnectFailure::Connect, 1, 30, "custom base delay");
+    expectDelay(policy, Nuki::ConnectFailure::Connect, 2, 60, "custom base delay doubled");
+    expectDelay(policy, Nuki::ConnectFailure::Connect, 3, 100, "custom maximum");
+    expectDelay(policy, Nuki::ConnectFailure::NoClient, 1, 100, "missing client within the custom maximum");
+  }
+
+  // a maximum below the base is raised to it, a zero base never waits
+  {
+    Nuki::BackoffRetryPolicy policy(50, 10);
+    expectDelay(policy, Nuki::ConnectFailure::Connect, 3, 50, "maximum at least the base delay");
+    Nuki::BackoffRetryPolicy noDelay(0, 0);
+    expect(noDelay.retryDelayMs(Nuki::ConnectFailure::Connect, 3) == 0, "zero base delay");
+  }
+
+  printf("%d checks failed\n", failures);
+  return failures == 0 ? 0 : 1;
+}
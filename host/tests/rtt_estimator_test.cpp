@@ -0,0 +1,134 @@
+/**
+ * @file rtt_estimator_test.cpp
+ * Host (Linux) test: the RttEstimator follows the TCP retransmission timer (RFC 6298).
+ *
+ * The first sample sets the average and half of it as the deviation, the following ones move them by 1/8 and
+ * 1/4 of the error. The timeout is the average plus four deviations, doubled by every backOff() until the next
+ * valid sample, and a sample of a retried exchange is discarded (Karn's algorithm).
+ *
+ * usage: nuki_rtt_estimator_test
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ */
+
+#include "NukiRttEstimator.h"
+
+#include <cstdio>
+
+namespace {
+
+int failures = 0;
+
+void expect(const bool condition, const char* check) {
+  if (!condition) {
+    printf("failed: %s\n", check);
+    failures++;
+  }
+}
+
+} // namespace
+
+int main() {
+  const uint32_t defaultMs = 3000;
+  const uint32_t minMs = 10;
+  const uint32_t maxMs = 60000;
+
+  // the default timeout until minSamples samples were taken
+  {
+    Nuki::RttEstimator estimator(3);
+    expect(estimator.getTimeout(defaultMs, minMs, maxMs) == defaultMs, "default timeout without samples");
+    estimator.addSample(100);
+    estimator.addSample(100);
+    expect(estimator.getTimeout(defaultMs, minMs, maxMs) == defaultMs, "default timeout below minSamples");
+    expect(estimator.getTimeout(defaultMs, minMs, 2000) == 2000, "default timeout within the maximum");
+    estimator.addSample(100);
+    expect(estimator.getTimeout(defaultMs, minMs, maxMs) != defaultMs, "estimate once minSamples were taken");
+  }
+
+  // SRTT = R, RTTVAR = R / 2, RTO = SRTT + 4 * RTTVAR (RFC 6298 2.2)
+  {
+    Nuki::RttEstimator estimator(1);
+    estimator.addSample(100);
+    Nuki::RttEstimate estimate = estimator.getEstimate();
+    expect(estimate.samples == 1, "first sample counted");
+    expect(estimate.averageMs == 100, "first sample sets the average");
+    expect(estimate.deviationMs == 50, "first sample sets half of it as the deviation");
+    expect(estimator.getTimeout(defaultMs, minMs, maxMs) == 300, "timeout of the first sample");
+
+    // RTTVAR = 3/4 RTTVAR + 1/4 |SRTT - R|, SRTT = 7/8 SRTT + 1/8 R (RFC 6298 2.3)
+    estimator.addSample(180);
+    estimate = estimator.getEstimate();
+    expect(estimate.averageMs == 110, "average moves by 1/8 of the error");
+    expect(estimate.deviationMs == 57, "deviation moves by 1/4 of the error");
+    expect(estimate.maxMs == 180, "longest sample kept");
+    // (110 * 8 + 4 * 57.5 * 8 + 7) / 8 = 340
+    expect(estimator.getTimeout(defaultMs, minMs, maxMs) == 340, "timeout of the second sample");
+
+    // a steady round trip narrows the deviation
+    for (int i = 0; i < 50; i++) {
+      estimator.addSample(110);
+    }
+    estimate = estimator.getEstimate();
+    expect(estimate.averageMs == 110, "average converges");
+    expect(estimate.deviationMs <= 1, "deviation converges");
+    expect(estimator.getTimeout(defaultMs, minMs, maxMs) <= 116, "timeout converges");
+  }
+
+  // the timeout stays within the given bounds
+  {
+    Nuki::RttEstimator estimator(1);
+    estimator.addSample(1);
+    expect(estimator.getTimeout(defaultMs, minMs, maxMs) == minMs, "timeout at least the minimum");
+    estimator.addSample(100000);
+    expect(estimator.getTimeout(defaultMs, minMs, maxMs) == maxMs, "timeout at most the maximum");
+  }
+
+  // a timeout doubles the timeout until the next valid sample (RFC 6298 5.5)
+  {
+    Nuki::RttEstimator estimator(1);
+    estimator.addSample(100);
+    estimator.backOff();
+    expect(estimator.getTimeout(defaultMs, minMs, maxMs) == 600, "one back off doubles the timeout");
+    estimator.backOff();
+    expect(estimator.getTimeout(defaultMs, minMs, maxMs) == 1200, "two back offs quadruple it");
+    for (int i = 0; i < 10; i++) {
+      estimator.backOff();
+    }
+    expect(estimator.getTimeout(defaultMs, minMs, maxMs) == 300 << RTT_MAX_BACKOFF, "back off is capped");
+    expect(estimator.getTimeout(defaultMs, minMs, 2000) == 2000, "backed off timeout at most the maximum");
+
+    // Karn's algorithm: the answer to a retried exchange may belong to the one that timed out
+    estimator.addSample(10, true);
+    expect(estimator.getEstimate().samples == 1, "sample of a retried exchange discarded");
+    expect(estimator.getTimeout(defaultMs, minMs, maxMs) == 300 << RTT_MAX_BACKOFF,
+           "sample of a retried exchange keeps the back off");
+
+    estimator.addSample(100);
+    expect(estimator.getEstimate().samples == 2, "valid sample counted");
+    expect(estimator.getTimeout(defaultMs, minMs, maxMs) < 600, "valid sample ends the back off");
+  }
+
+  // back off without enough samples keeps the default timeout
+  {
+    Nuki::RttEstimator estimator(8);
+    estimator.backOff();
+    expect(estimator.getTimeout(defaultMs, minMs, maxMs) == defaultMs, "default timeout is not backed off");
+  }
+
+  // reset() drops the samples and the back off
+  {
+    Nuki::RttEstimator estimator(1);
+    estimator.addSample(100);
+    estimator.backOff();
+    estimator.reset();
+    Nuki::RttEstimate estimate = estimator.getEstimate();
+    expect(estimate.samples == 0 && estimate.averageMs == 0 && estimate.deviationMs == 0 && estimate.maxMs == 0,
+           "reset drops the samples");
+    estimator.addSample(100);
+    expect(estimator.getTimeout(defaultMs, minMs, maxMs) == 300, "reset drops the back off");
+  }
+
+  printf("%d checks failed\n", failures);
+  return failures == 0 ? 0 : 1;
+}
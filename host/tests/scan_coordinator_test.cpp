@@ -0,0 +1,127 @@
+/**
+ * @file scan_coordinator_test.cpp
+ * Host (Linux) test: a ScanCoordinator counts suspensions and registered instances.
+ *
+ * Scanning is off from the first suspend() until every suspend() was matched by a resume(). The minimum scan
+ * window between two suspensions is kept only while more than one instance is registered with forPublisher():
+ * a copy of the coordinator held elsewhere does not count, release() ends a registration.
+ *
+ * usage: nuki_scan_coordinator_test
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ */
+
+#include "NukiScanCoordinator.h"
+#include "esp_timer.h"
+
+#include <cstdio>
+#include <memory>
+
+namespace {
+
+int failures = 0;
+
+void expect(const bool condition, const char* check) {
+  if (!condition) {
+    printf("failed: %s\n", check);
+    failures++;
+  }
+}
+
+class FakePublisher : public BleScanner::Publisher {
+  public:
+    void subscribe(BleScanner::Subscriber* subscriber) override {}
+    void unsubscribe(BleScanner::Subscriber* subscriber) override {}
+    void enableScanning(bool enable) override {
+      scanning = enable;
+      switches++;
+    }
+
+    bool scanning = true;
+    int switches = 0;
+};
+
+// time a suspend() right after a resume() takes, the suspend() before it may wait for the window as well
+int64_t suspendAfterResumeMs(Nuki::ScanCoordinator& coordinator) {
+  coordinator.suspend();
+  coordinator.resume();
+  int64_t startUs = esp_timer_get_time();
+  coordinator.suspend();
+  int64_t elapsedMs = (esp_timer_get_time() - startUs) / 1000;
+  coordinator.resume();
+  return elapsedMs;
+}
+
+} // namespace
+
+int main() {
+  const uint32_t windowMs = 100;
+
+  // nested suspensions of one instance
+  {
+    FakePublisher publisher;
+    std::shared_ptr<Nuki::ScanCoordinator> coordinator = Nuki::ScanCoordinator::forPublisher(&publisher);
+    coordinator->suspend();
+    expect(!publisher.scanning, "first suspend stops scanning");
+    coordinator->suspend();
+    coordinator->resume();
+    expect(!publisher.scanning, "scanning stays off until the last resume");
+    coordinator->resume();
+    expect(publisher.scanning, "last resume starts scanning");
+    expect(publisher.switches == 2, "scanning switched once each way");
+    coordinator->resume();
+    expect(publisher.scanning && publisher.switches == 2, "unmatched resume ignored");
+    coordinator->suspend();
+    expect(!publisher.scanning, "suspend after an unmatched resume stops scanning");
+    coordinator->resume();
+    expect(coordinator->getStatistics().suspensions == 2, "suspensions counted");
+    coordinator->release();
+  }
+
+  // forPublisher() shares the coordinator of a publisher while it is held
+  {
+    FakePublisher publisher;
+    FakePublisher otherPublisher;
+    std::shared_ptr<Nuki::ScanCoordinator> first = Nuki::ScanCoordinator::forPublisher(&publisher);
+    std::shared_ptr<Nuki::ScanCoordinator> second = Nuki::ScanCoordinator::forPublisher(&publisher);
+    std::shared_ptr<Nuki::ScanCoordinator> other = Nuki::ScanCoordinator::forPublisher(&otherPublisher);
+    expect(first == second, "instances of one publisher share the coordinator");
+    expect(first != other, "publishers have their own coordinators");
+    first->suspend();
+    first->resume();
+    first->release();
+    second->release();
+    other->release();
+    first.reset();
+    second.reset();
+    std::shared_ptr<Nuki::ScanCoordinator> recreated = Nuki::ScanCoordinator::forPublisher(&publisher);
+    expect(recreated->getStatistics().suspensions == 0, "coordinator created again once released by all");
+    recreated->release();
+  }
+
+  // the minimum scan window is kept between suspensions of several registered instances only
+  {
+    FakePublisher publisher;
+    std::shared_ptr<Nuki::ScanCoordinator> coordinator = Nuki::ScanCoordinator::forPublisher(&publisher);
+    coordinator->setMinScanWindow(windowMs);
+    expect(suspendAfterResumeMs(*coordinator) < windowMs / 2, "single instance does not wait for the window");
+
+    // held elsewhere without a registration
+    std::shared_ptr<Nuki::ScanCoordinator> copy = coordinator;
+    expect(suspendAfterResumeMs(*coordinator) < windowMs / 2, "a copy of the coordinator is not a user");
+    expect(coordinator->getStatistics().windowWaits == 0, "no window waits for a single instance");
+
+    std::shared_ptr<Nuki::ScanCoordinator> second = Nuki::ScanCoordinator::forPublisher(&publisher);
+    expect(suspendAfterResumeMs(*coordinator) >= windowMs - 10, "two instances wait for the window");
+    expect(coordinator->getStatistics().windowWaits == 2, "window waits counted");
+
+    second->release();
+    expect(suspendAfterResumeMs(*coordinator) < windowMs / 2, "released instance is not a user");
+    expect(coordinator->getStatistics().windowWaits == 2, "no window wait after the release");
+    coordinator->release();
+  }
+
+  printf("%d checks failed\n", failures);
+  return failures == 0 ? 0 : 1;
+}
@@ -28,6 +28,7 @@
 #include <algorithm>
 #include <atomic>
 #include <list>
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
 #include <string>
@@ -80,10 +81,26 @@ NukiBle::NukiBle(const std::string& deviceName,
 }
 
 NukiBle::~NukiBle() {
+  stopCommandWorker();
+  vSemaphoreDelete(commandWorkerSemaphore);
+  vSemaphoreDelete(requestSemaphore);
+  vSemaphoreDelete(estimatorSemaphore);
+  vSemaphoreDelete(connectionParametersSemaphore);
+  vSemaphoreDelete(retryStatisticsSemaphore);
   if (bleScanner != nullptr) {
+    resumeScanning();
     bleScanner->unsubscribe(this);
     bleScanner = nullptr;
   }
+  if (scanCoordinator) {
+    scanCoordinator->release();
+    scanCoordinator.reset();
+  }
+  if (pClient != nullptr) {
+    // the link may still drop after this instance is gone
+    pClient->setClientCallbacks(nullptr, false);
+  }
+  vSemaphoreDelete(messageSemaphore);
 }
 
 void NukiBle::initialize(bool initAltConnect) {
@@ -145,6 +162,11 @@ void NukiBle::setPower(esp_power_level_t powerLevel) {
 
 void NukiBle::registerBleScanner(BleScanner::Publisher* bleScanner) {
   this->bleScanner = bleScanner;
+  if (scanCoordinator) {
+    resumeScanning();
+    scanCoordinator->release();
+  }
+  scanCoordinator = ScanCoordinator::forPublisher(bleScanner);
   bleScanner->subscribe(this);
 }
 
@@ -168,6 +190,7 @@ PairingResult NukiBle::pairNuki(AuthorizationIdType idType) {
       ESP_LOGD("NukiBle", "Nuki in pairing mode found");
     }
     if (connectBle(bleAddress, true)) {
+      prefetchState = PrefetchState::None;
       crypto_box_keypair(myPublicKey, myPrivateKey);
 
       PairingState nukiPairingState = PairingState::InitPairing;
@@ -175,7 +198,8 @@ PairingResult NukiBle::pairNuki(AuthorizationIdType idType) {
         nukiPairingState = pairStateMachine(nukiPairingState);
         extendDisconnectTimeout();
         vTaskDelay(pdMS_TO_TICKS(50));
-      } while ((nukiPairingState != PairingState::Success) && (nukiPairingState != PairingState::Timeout));
+      } while ((nukiPairingState != PairingState::Success) && (nukiPairingState != PairingState::Timeout)
+               && CommandLimits::check() == CmdResult::Success);
 
       if (nukiPairingState == PairingState::Success) {
         saveCredentials();
@@ -201,6 +225,9 @@ PairingResult NukiBle::pairNuki(AuthorizationIdType idType) {
 }
 
 void NukiBle::unPairNuki() {
+  prefetchState = PrefetchState::None;
+  // the next lock may differ
+  refreshServices = true;
   deleteCredentials();
   isPaired = false;
   if (debugNukiConnect) {
@@ -218,8 +245,12 @@ void NukiBle::resetHost() {
 
 bool NukiBle::connectBle(const BLEAddress bleAddress, bool pairing) {
   if (altConnect) {
+    if ((pairing ? gdioSubscribed : usdioSubscribed) && pClient && pClient->isConnected()) {
+      // still connected and subscribed to the characteristic needed
+      return true;
+    }
     connecting = true;
-    bleScanner->enableScanning(false);
+    suspendScanning();
     pClient = nullptr;
 
     if (debugNukiConnect) {
@@ -231,24 +262,28 @@ bool NukiBle::connectBle(const BLEAddress bleAddress, bool pairing) {
     }
 
     uint8_t connectRetry = 0;
+    uint32_t attemptTimeoutMs = connectAttemptTimeout();
+    uint8_t attempts = connectAttempts(attemptTimeoutMs);
 
-    while (connectRetry < connectRetries) {
+    while (connectRetry < attempts && CommandLimits::check() == CmdResult::Success) {
       if(NimBLEDevice::getCreatedClientCount())
       {
         pClient = NimBLEDevice::getClientByPeerAddress(bleAddress);
         if(pClient){
           if(!pClient->isConnected()) {
-            if(!pClient->connect(bleAddress, refreshServices)) {
+            pClient->setConnectTimeout(CommandLimits::clampWait(attemptTimeoutMs));
+            applyConnectionParameters(pClient);
+            int64_t connectStartMs = esp_timer_get_time() / 1000;
+            if(!connectClient(bleAddress)) {
               if (debugNukiConnect) {
                 ESP_LOGD("NukiBle", "[%s] Reconnect failed", deviceName.c_str());
               }
-              connectRetry++;
-              #ifndef NUKI_NO_WDT_RESET
-              esp_task_wdt_reset();
-              #endif
-              vTaskDelay(pdMS_TO_TICKS(10));
+              if (!retryConnect(ConnectFailure::Connect, ++connectRetry, attempts, pairing)) {
+                break;
+              }
               continue;
             } else {
+              addConnectSample(connectStartMs);
               refreshServices = false;
             }
             if (debugNukiConnect) {
@@ -264,20 +299,17 @@ bool NukiBle::connectBle(const BLEAddress bleAddress, bool pairing) {
           if (debugNukiConnect) {
             ESP_LOGD("NukiBle", "[%s] Max clients reached - no more connections available", deviceName.c_str());
           }
-          connectRetry++;
-          #ifndef NUKI_NO_WDT_RESET
-          esp_task_wdt_reset();
-          #endif
-          vTaskDelay(pdMS_TO_TICKS(10));
+          if (!retryConnect(ConnectFailure::NoClient, ++connectRetry, attempts, pairing)) {
+            break;
+          }
           continue;
         }
 
         pClient = NimBLEDevice::createClient();
         pClient->setClientCallbacks(this);
-        pClient->setConnectionParams(12,12,0,600,64,64);
-        
-        ESP_LOGD("NukiBle", "[%s] Connect timeout %d ms", deviceName.c_str(), connectTimeoutSec * 1000);
-        pClient->setConnectTimeout(connectTimeoutSec * 1000);
+
+        ESP_LOGD("NukiBle", "[%s] Connect timeout %d ms", deviceName.c_str(), attemptTimeoutMs);
+        pClient->setConnectTimeout(CommandLimits::clampWait(attemptTimeoutMs));
 
         vTaskDelay(pdMS_TO_TICKS(300));
 
@@ -292,27 +324,27 @@ bool NukiBle::connectBle(const BLEAddress bleAddress, bool pairing) {
           if (debugNukiConnect) {
             ESP_LOGD("NukiBle", "[%s] Failed to create client", deviceName.c_str());
           }
-          connectRetry++;
-          #ifndef NUKI_NO_WDT_RESET
-          esp_task_wdt_reset();
-          #endif
-          vTaskDelay(pdMS_TO_TICKS(10));
+          if (!retryConnect(ConnectFailure::NoClient, ++connectRetry, attempts, pairing)) {
+            break;
+          }
           continue;
         }
       }
 
       if(!pClient->isConnected()) {
-        if (!pClient->connect(bleAddress, refreshServices)) {
+        pClient->setConnectTimeout(CommandLimits::clampWait(attemptTimeoutMs));
+        applyConnectionParameters(pClient);
+        int64_t connectStartMs = esp_timer_get_time() / 1000;
+        if (!connectClient(bleAddress)) {
           if (debugNukiConnect) {
             ESP_LOGD("NukiBle", "[%s] Failed to connect", deviceName.c_str());
           }
-          connectRetry++;
-          #ifndef NUKI_NO_WDT_RESET
-          esp_task_wdt_reset();
-          #endif
-          vTaskDelay(pdMS_TO_TICKS(10));
+          if (!retryConnect(ConnectFailure::Connect, ++connectRetry, attempts, pairing)) {
+            break;
+          }
           continue;
         } else {
+          addConnectSample(connectStartMs);
           refreshServices = false;
         }
       }
@@ -321,45 +353,32 @@ bool NukiBle::connectBle(const BLEAddress bleAddress, bool pairing) {
         ESP_LOGD("NukiBle", "[%s] Connected to: %s RSSI: %d", deviceName.c_str(), pClient->getPeerAddress().toString().c_str(), pClient->getRssi());
       }
 
-      if(pairing) {
-        if (!registerOnGdioChar()) {
-          if (debugNukiConnect) {
-            ESP_LOGD("NukiBle", "[%s] Failed to connect on registering GDIO", deviceName.c_str());
-          }
-          connectRetry++;
-          #ifndef NUKI_NO_WDT_RESET
-          esp_task_wdt_reset();
-          #endif
-          vTaskDelay(pdMS_TO_TICKS(10));
-          continue;
+      if (!subscribeFor(pairing)) {
+        if (debugNukiConnect) {
+          ESP_LOGD("NukiBle", "[%s] Failed to connect on registering %s", deviceName.c_str(), pairing ? "GDIO" : "USDIO");
         }
-      } else {
-        if (!registerOnUsdioChar()) {
-          if (debugNukiConnect) {
-            ESP_LOGD("NukiBle", "[%s] Failed to connect on registering USDIO", deviceName.c_str());
-          }
-          connectRetry++;
-          #ifndef NUKI_NO_WDT_RESET
-          esp_task_wdt_reset();
-          #endif
-          vTaskDelay(pdMS_TO_TICKS(10));
-          continue;
+        if (!retryConnect(registerFailure, ++connectRetry, attempts, pairing)) {
+          break;
         }
+        continue;
       }
 
-      bleScanner->enableScanning(true);
+      resumeScanning();
       connecting = false;
       return true;
     }
 
-    bleScanner->enableScanning(true);
+    resumeScanning();
     connecting = false;
     return false;
   }
   else
   {
+    if (pClient->isConnected() && subscribeFor(pairing)) {
+      return true;
+    }
     connecting = true;
-    bleScanner->enableScanning(false);
+    suspendScanning();
     if (!pClient->isConnected()) {
       if (debugNukiConnect) {
         #if (ESP_IDF_VERSION < ESP_IDF_VERSION_VAL(5, 0, 0))
@@ -370,35 +389,41 @@ bool NukiBle::connectBle(const BLEAddress bleAddress, bool pairing) {
       }
 
       uint8_t connectRetry = 0;
-      pClient->setConnectTimeout(connectTimeoutSec * 1000);
-      while (connectRetry < connectRetries) {
+      uint32_t attemptTimeoutMs = connectAttemptTimeout();
+      uint8_t attempts = connectAttempts(attemptTimeoutMs);
+      while (connectRetry < attempts && CommandLimits::check() == CmdResult::Success) {
         if (debugNukiConnect) {
           ESP_LOGD("NukiBle", "connection attempt %d", connectRetry);
         }
-        if (pClient->connect(bleAddress, true)) {
-          if (pClient->isConnected() && registerOnGdioChar() && registerOnUsdioChar()) {  //doublecheck if is connected otherwise registering gdio crashes esp
-            bleScanner->enableScanning(true);
+        pClient->setConnectTimeout(CommandLimits::clampWait(attemptTimeoutMs));
+        applyConnectionParameters(pClient);
+        int64_t connectStartMs = esp_timer_get_time() / 1000;
+        ConnectFailure failure = ConnectFailure::Connect;
+        // the services discovered on an earlier connection are reused unless registering failed
+        if (connectClient(bleAddress)) {
+          addConnectSample(connectStartMs);
+          bool connected = pClient->isConnected();
+          if (connected && subscribeFor(pairing)) {  //doublecheck if is connected otherwise registering gdio crashes esp
+            refreshServices = false;
+            resumeScanning();
             connecting = false;
             return true;
           } else {
             ESP_LOGW("NukiBle", "BLE register on pairing or data Service/Char failed");
+            if (connected) {
+              failure = registerFailure;
+            }
           }
         } else {
           pClient->disconnect();
-          ESP_LOGW("NukiBle", "BLE Connect failed, %d retries left", connectRetries - connectRetry - 1);
+          ESP_LOGW("NukiBle", "BLE Connect failed, %d retries left", attempts - connectRetry - 1);
+        }
+        if (!retryConnect(failure, ++connectRetry, attempts, pairing)) {
+          break;
         }
-        connectRetry++;
-        #ifndef NUKI_NO_WDT_RESET
-        esp_task_wdt_reset();
-        #endif
-        vTaskDelay(pdMS_TO_TICKS(10));
       }
-    } else {
-      bleScanner->enableScanning(true);
-      connecting = false;
-      return true;
     }
-    bleScanner->enableScanning(true);
+    resumeScanning();
     connecting = false;
     ESP_LOGW("NukiBle", "BLE Connect failed");
     return false;
@@ -406,6 +431,16 @@ bool NukiBle::connectBle(const BLEAddress bleAddress, bool pairing) {
 }
 
 void NukiBle::updateConnectionState() {
+  if (warmUpRequested.exchange(false) && !connecting && !(pClient && pClient->isConnected())) {
+    prepare();
+  }
+  if (keepConnected && updateKeptConnection()) {
+    return;
+  }
+  if (sessionDepth > 0) {
+    // pinned by a session
+    return;
+  }
   if (connecting) {
     if (altConnect) {
       return;
@@ -470,6 +505,225 @@ void NukiBle::disconnect()
   }
 }
 
+Nuki::CmdResult NukiBle::warmUp() {
+  Nuki::CmdResult limitResult = CommandLimits::check();
+  if (limitResult != Nuki::CmdResult::Success) {
+    return limitResult;
+  }
+  if (!isPaired) {
+    return Nuki::CmdResult::NotPaired;
+  }
+  if (!takeNukiBleSemaphore("warm up")) {
+    limitResult = CommandLimits::check();
+    return limitResult != Nuki::CmdResult::Success ? limitResult : Nuki::CmdResult::Failed;
+  }
+  bool connected = connectBle(bleAddress, false);
+  if (connected) {
+    extendDisconnectTimeout();
+    if (challengePrefetch) {
+      prefetchChallenge();
+    }
+  }
+  giveNukiBleSemaphore();
+  if (debugNukiConnect) {
+    ESP_LOGD("NukiBle", "[%s] Warm up %s", deviceName.c_str(), connected ? "done" : "failed");
+  }
+  limitResult = CommandLimits::check();
+  return connected ? Nuki::CmdResult::Success
+                   : (limitResult != Nuki::CmdResult::Success ? limitResult : Nuki::CmdResult::Failed);
+}
+
+bool NukiBle::prepare() {
+  bool queued = false;
+  if (!warmUpQueued.compare_exchange_strong(queued, true)) {
+    // the queued warm up connects soon enough
+    return true;
+  }
+  if (!submit([this]() { return warmUp(); }, [this](CmdResult) { warmUpQueued = false; }, CommandPriority::Bulk)) {
+    warmUpQueued = false;
+    return false;
+  }
+  return true;
+}
+
+void NukiBle::setWarmUpOnStatusChange(bool enable) {
+  warmUpOnStatusChange = enable;
+}
+
+bool NukiBle::updateKeptConnection() {
+  int64_t nowMs = esp_timer_get_time() / 1000;
+  if (keepConnectedIdleBudgetMs > 0 && nowMs - lastCommandMs > keepConnectedIdleBudgetMs) {
+    return false;
+  }
+  if (connecting || reconnectQueued) {
+    return true;
+  }
+  if (pClient && pClient->isConnected()) {
+    if (nowMs - lastStartTimeout > KEEP_CONNECTED_KEEPALIVE_INTERVAL) {
+      sendKeepAlive();
+    }
+    return true;
+  }
+  if (!isPaired || nowMs - lastReconnectMs < KEEP_CONNECTED_RECONNECT_INTERVAL) {
+    return true;
+  }
+  lastReconnectMs = nowMs;
+  reconnectQueued = true;
+  if (!submit([this]() { return reconnect(); }, [this](CmdResult) { reconnectQueued = false; },
+              CommandPriority::Bulk)) {
+    reconnectQueued = false;
+  }
+  return true;
+}
+
+void NukiBle::sendKeepAlive() {
+  // a running command keeps the connection busy itself
+  #ifndef NUKI_MUTEX_RECURSIVE
+  if (xSemaphoreTake(nukiBleSemaphore, 0) != pdTRUE) {
+  #else
+  if (xSemaphoreTakeRecursive(nukiBleSemaphore, 0) != pdTRUE) {
+  #endif
+    return;
+  }
+  owner = "keep alive";
+  // a challenge waiting for the next command is replaced by a fresh one
+  PrefetchState ready = PrefetchState::Ready;
+  prefetchState.compare_exchange_strong(ready, PrefetchState::None);
+  // a lost answer would otherwise hold back every following keep alive
+  PrefetchState state = prefetchState;
+  if ((state == PrefetchState::Pending || state == PrefetchState::Dropped)
+      && (esp_timer_get_time() / 1000) - prefetchSentMs > CMD_TIMEOUT) {
+    prefetchState.compare_exchange_strong(state, PrefetchState::None);
+  }
+  if (prefetchState == PrefetchState::None) {
+    if (debugNukiConnect) {
+      logMessage("Keep alive");
+    }
+    prefetchChallenge();
+    if (prefetchState == PrefetchState::Pending) {
+      keepAliveCount++;
+      extendDisconnectTimeout();
+    }
+  }
+  giveNukiBleSemaphore();
+}
+
+CmdResult NukiBle::reconnect() {
+  // short enough for a command of another task to get the semaphore in time
+  CommandLimits limits(KEEP_CONNECTED_RECONNECT_TIMEOUT);
+  if (!keepConnected || !takeNukiBleSemaphore("reconnect")) {
+    return CmdResult::Failed;
+  }
+  bool connected = connectBle(bleAddress, false);
+  if (connected) {
+    reconnectCount++;
+    extendDisconnectTimeout();
+  }
+  giveNukiBleSemaphore();
+  if (debugNukiConnect) {
+    ESP_LOGD("NukiBle", "[%s] Background reconnect %s", deviceName.c_str(), connected ? "done" : "failed");
+  }
+  return connected ? CmdResult::Success : CmdResult::Failed;
+}
+
+void NukiBle::setKeepConnected(bool enable, uint32_t idleBudgetMs) {
+  keepConnectedIdleBudgetMs = idleBudgetMs;
+  lastCommandMs = esp_timer_get_time() / 1000;
+  lastReconnectMs = 0;
+  keepConnected = enable;
+}
+
+ConnectionStatistics NukiBle::getConnectionStatistics() const {
+  ConnectionStatistics statistics;
+  int64_t sinceMs = connectedSinceMs;
+  statistics.connected = sinceMs > 0;
+  statistics.uptimeMs = sinceMs > 0 ? (esp_timer_get_time() / 1000) - sinceMs : 0;
+  statistics.totalUptimeMs = pastUptimeMs + statistics.uptimeMs;
+  statistics.connects = connectCount;
+  statistics.disconnects = disconnectCount;
+  statistics.backgroundReconnects = reconnectCount;
+  statistics.keepAlives = keepAliveCount;
+  statistics.discoveryMs = discoveryMs;
+  return statistics;
+}
+
+void NukiBle::setConnectionProfile(const ConnectionProfile profile) {
+  ConnectionParameters parameters;
+  switch (profile) {
+    case ConnectionProfile::LowLatency:
+      parameters.minInterval = 6;
+      parameters.maxInterval = 9;
+      parameters.supervisionTimeout = 300;
+      break;
+    case ConnectionProfile::Balanced:
+      break;
+    case ConnectionProfile::LowPower:
+      parameters.minInterval = 80;
+      parameters.maxInterval = 100;
+      parameters.latency = 4;
+      break;
+  }
+  setConnectionParameters(parameters);
+}
+
+bool NukiBle::setConnectionParameters(const ConnectionParameters& parameters) {
+  // limits of the Bluetooth Core Specification, the link is lost before the supervision timeout otherwise
+  if (parameters.minInterval < 6 || parameters.maxInterval > 3200 || parameters.minInterval > parameters.maxInterval
+      || parameters.latency > 499 || parameters.supervisionTimeout < 10 || parameters.supervisionTimeout > 3200
+      || (uint32_t)parameters.supervisionTimeout * 4 <= (uint32_t)(1 + parameters.latency) * parameters.maxInterval) {
+    ESP_LOGW("NukiBle", "[%s] Invalid connection parameters", deviceName.c_str());
+    return false;
+  }
+  xSemaphoreTake(connectionParametersSemaphore, portMAX_DELAY);
+  connectionParameters = parameters;
+  xSemaphoreGive(connectionParametersSemaphore);
+  return true;
+}
+
+ConnectionParameters NukiBle::getConnectionParameters() {
+  xSemaphoreTake(connectionParametersSemaphore, portMAX_DELAY);
+  ConnectionParameters parameters = connectionParameters;
+  xSemaphoreGive(connectionParametersSemaphore);
+  return parameters;
+}
+
+CmdResult NukiBle::updateConnectionParameters() {
+  if (!takeNukiBleSemaphore("connection update")) {
+    CmdResult limitResult = CommandLimits::check();
+    return limitResult != CmdResult::Success ? limitResult : CmdResult::Failed;
+  }
+  bool updated = false;
+  if (pClient != nullptr && pClient->isConnected()) {
+    ConnectionParameters parameters = getConnectionParameters();
+    updated = pClient->updateConnParams(parameters.minInterval, parameters.maxInterval, parameters.latency,
+                                        parameters.supervisionTimeout);
+    requestLinkOptions(pClient, parameters);
+  }
+  giveNukiBleSemaphore();
+  if (debugNukiConnect) {
+    ESP_LOGD("NukiBle", "[%s] Connection parameter update %s", deviceName.c_str(), updated ? "requested" : "failed");
+  }
+  return updated ? CmdResult::Success : CmdResult::Failed;
+}
+
+void NukiBle::applyConnectionParameters(BLEClient* client) {
+  ConnectionParameters parameters = getConnectionParameters();
+  client->setConnectionParams(parameters.minInterval, parameters.maxInterval, parameters.latency,
+                              parameters.supervisionTimeout, 64, 64);
+}
+
+void NukiBle::requestLinkOptions(BLEClient* client, const ConnectionParameters& parameters) {
+  // both are negotiated with the lock, which keeps the defaults if it does not support them
+  #ifndef NUKI_NO_2M_PHY
+  if (parameters.phy2M && !client->updatePhy(BLE_GAP_LE_PHY_2M_MASK, BLE_GAP_LE_PHY_2M_MASK)) {
+    ESP_LOGD("NukiBle", "[%s] 2M PHY request failed", deviceName.c_str());
+  }
+  #endif
+  if (parameters.dataLengthExtension && !client->setDataLen(CONNECTION_MAX_DATA_LENGTH)) {
+    ESP_LOGD("NukiBle", "[%s] Data length request failed", deviceName.c_str());
+  }
+}
+
 void NukiBle::setDisconnectTimeout(uint32_t timeoutMs) {
   timeoutDuration = timeoutMs;
 }
@@ -494,7 +748,6 @@ void NukiBle::onResult(const BLEAdvertisedDevice* advertisedDevice) {
       lastReceivedBeaconTs = (esp_timer_get_time() / 1000);
 
       std::string manufacturerData = advertisedDevice->getManufacturerData();
-      uint8_t* manufacturerDataPtr = (uint8_t*)manufacturerData.data();
       bool isKeyTurnerUUID = true;
       std::string serviceUUID = deviceServiceUUID.toString();
 
@@ -530,6 +783,10 @@ void NukiBle::onResult(const BLEAdvertisedDevice* advertisedDevice) {
               eventHandler->notify(EventType::KeyTurnerStatusUpdated);
             }
 
+            if (warmUpOnStatusChange && !statusUpdated) {
+              // queued by updateConnectionState(), the scan callback must not wait for the worker
+              warmUpRequested = true;
+            }
             statusUpdated = true;
           }
           else if (statusUpdated)
@@ -583,42 +840,12 @@ Nuki::CmdResult NukiBle::retrieveKeypadEntries(const uint16_t offset, const uint
   action.payloadLen = sizeof(payload);
 
   listOfKeyPadEntries.clear();
-  nrOfReceivedKeypadCodes = 0;
-  keypadCodeCountReceived = false;
 
-  int64_t timeNow = (esp_timer_get_time() / 1000);
   Nuki::CmdResult result = executeAction(action);
-
   if (result == Nuki::CmdResult::Success) {
-    //wait for return of Keypad Code Count (0x0044)
-    while (!keypadCodeCountReceived) {
-      if ((esp_timer_get_time() / 1000) - timeNow > GENERAL_TIMEOUT) {
-        ESP_LOGW("NukiBle", "Receive keypad count timeout");
-        if (altConnect) {
-          disconnect();
-        }
-        return CmdResult::TimeOut;
-      }
-      vTaskDelay(pdMS_TO_TICKS(10));
-    }
     if (debugNukiCommand) {
-      ESP_LOGD("NukiBle", "Keypad code count %d", getKeypadEntryCount());
-    }
-
-    //wait for return of Keypad Codes (0x0045)
-    timeNow = (esp_timer_get_time() / 1000);
-    while (nrOfReceivedKeypadCodes < getKeypadEntryCount()) {
-      if ((esp_timer_get_time() / 1000) - timeNow > GENERAL_TIMEOUT) {
-        ESP_LOGW("NukiBle", "Receive keypadcodes timeout");
-        if (altConnect) {
-          disconnect();
-        }
-        return CmdResult::TimeOut;
-      }
-      vTaskDelay(pdMS_TO_TICKS(10));
-    }
-    if (debugNukiCommand) {
-      ESP_LOGD("NukiBle", "%d codes received", nrOfReceivedKeypadCodes);
+      ESP_LOGD("NukiBle", "Keypad code count %u, %u codes received", getKeypadEntryCount(),
+               (unsigned int)listOfKeyPadEntries.size());
     }
   } else {
     ESP_LOGW("NukiBle", "Retrieve keypad codes from lock failed");
@@ -984,50 +1211,54 @@ void NukiBle::getMacAddress(char* macAddress) {
 }
 
 bool NukiBle::retrieveCredentials() {
+  if (takeNukiBleSemaphore("retr cred")) {
+    bool retrieved = readCredentials();
+    giveNukiBleSemaphore();
+    return retrieved;
+  }
+  return true;
+}
+
+bool NukiBle::readCredentials() {
   //TODO check on empty (invalid) credentials?
   unsigned char buff[6];
 
-  if (takeNukiBleSemaphore("retr cred")) {
-    if ((preferences.getBytes(BLE_ADDRESS_STORE_NAME, buff, 6) > 0)
-        && (preferences.getBytes(SECRET_KEY_STORE_NAME, secretKeyK, 32) > 0)
-        && (preferences.getBytes(AUTH_ID_STORE_NAME, authorizationId, 4) > 0)
-      ) {
-      bleAddress = BLEAddress(buff, 0);
-
-      if (debugNukiConnect) {
-        ESP_LOGD("NukiBle", "[%s] Credentials retrieved :", deviceName.c_str());
-        printBuffer(secretKeyK, sizeof(secretKeyK), false, SECRET_KEY_STORE_NAME, debugNukiHexData);
-        ESP_LOGD("NukiBle", "bleAddress: %s", bleAddress.toString().c_str());
-        printBuffer(authorizationId, sizeof(authorizationId), false, AUTH_ID_STORE_NAME, debugNukiHexData);
-      }
+  if ((preferences.getBytes(BLE_ADDRESS_STORE_NAME, buff, 6) > 0)
+      && (preferences.getBytes(SECRET_KEY_STORE_NAME, secretKeyK, 32) > 0)
+      && (preferences.getBytes(AUTH_ID_STORE_NAME, authorizationId, 4) > 0)
+    ) {
+    bleAddress = BLEAddress(buff, 0);
 
-      if (isCharArrayEmpty(secretKeyK, sizeof(secretKeyK)) || isCharArrayEmpty(authorizationId, sizeof(authorizationId))) {
-        ESP_LOGW("NukiBle", "secret key OR authorizationId is empty: not paired");
-        giveNukiBleSemaphore();
-        return false;
-      }
+    if (debugNukiConnect) {
+      ESP_LOGD("NukiBle", "[%s] Credentials retrieved :", deviceName.c_str());
+      printBuffer(secretKeyK, sizeof(secretKeyK), false, SECRET_KEY_STORE_NAME, debugNukiHexData);
+      ESP_LOGD("NukiBle", "bleAddress: %s", bleAddress.toString().c_str());
+      printBuffer(authorizationId, sizeof(authorizationId), false, AUTH_ID_STORE_NAME, debugNukiHexData);
+    }
 
-      smartLockUltra = preferences.getBool(ULTRA_STORE_NAME, false);
+    if (isCharArrayEmpty(secretKeyK, sizeof(secretKeyK)) || isCharArrayEmpty(authorizationId, sizeof(authorizationId))) {
+      ESP_LOGW("NukiBle", "secret key OR authorizationId is empty: not paired");
+      return false;
+    }
 
-      if (isLockUltra()) {
-        preferences.getBytes(ULTRA_PINCODE_STORE_NAME, &ultraPinCode, 4);
+    smartLockUltra = preferences.getBool(ULTRA_STORE_NAME, false);
 
-        if (ultraPinCode == 0) {
-          ESP_LOGW("NukiBle", "Pincode is 000000, probably not defined");
-        }
-      } else {
-        preferences.getBytes(SECURITY_PINCODE_STORE_NAME, &pinCode, 2);
+    if (isLockUltra()) {
+      preferences.getBytes(ULTRA_PINCODE_STORE_NAME, &ultraPinCode, 4);
 
-        if (pinCode == 0) {
-          ESP_LOGW("NukiBle", "Pincode is 000000, probably not defined");
-        }
+      if (ultraPinCode == 0) {
+        ESP_LOGW("NukiBle", "Pincode is 000000, probably not defined");
       }
     } else {
-      ESP_LOGE("NukiBle", "Error getting data from NVS");
-      giveNukiBleSemaphore();
-      return false;
+      preferences.getBytes(SECURITY_PINCODE_STORE_NAME, &pinCode, 2);
+
+      if (pinCode == 0) {
+        ESP_LOGW("NukiBle", "Pincode is 000000, probably not defined");
+      }
     }
-    giveNukiBleSemaphore();
+  } else {
+    ESP_LOGE("NukiBle", "Error getting data from NVS");
+    return false;
   }
   return true;
 }
@@ -1306,6 +1537,7 @@ bool NukiBle::sendEncryptedMessage(Command commandIdentifier, const unsigned cha
     if(encryptPairing) {
       if (connectBle(bleAddress, true)) {
         printBuffer((uint8_t*)dataToSend, sizeof(dataToSend), false, "Sending encrypted pairing message", debugNukiHexData);
+        recordFrame(FrameDirection::Sent, commandIdentifier, payload, payloadLen);
         encryptPairing = false;
         recieveEncrypted = true;
         return pGdioCharacteristic->writeValue((uint8_t*)dataToSend, sizeof(dataToSend), true);
@@ -1315,7 +1547,13 @@ bool NukiBle::sendEncryptedMessage(Command commandIdentifier, const unsigned cha
     } else {
       if (connectBle(bleAddress, false)) {
         printBuffer((uint8_t*)dataToSend, sizeof(dataToSend), false, "Sending encrypted message", debugNukiHexData);
-        return pUsdioCharacteristic->writeValue((uint8_t*)dataToSend, sizeof(dataToSend), true);
+        recordFrame(FrameDirection::Sent, commandIdentifier, payload, payloadLen);
+        if (pUsdioCharacteristic->writeValue((uint8_t*)dataToSend, sizeof(dataToSend), true)) {
+          return true;
+        }
+        // the reused attributes may be stale, e.g. after a firmware update of the lock
+        refreshServices = true;
+        return false;
       } else {
         ESP_LOGW("NukiBle", "Send encr msg failed due to unable to connect");
       }
@@ -1346,6 +1584,7 @@ bool NukiBle::sendPlainMessage(Command commandIdentifier, const unsigned char* p
   }
 
   if (connectBle(bleAddress, true)) {
+    recordFrame(FrameDirection::Sent, commandIdentifier, payload, payloadLen);
     return pGdioCharacteristic->writeValue((uint8_t*)dataToSend, payloadLen + 4, true);
   } else {
     ESP_LOGW("NukiBle", "Send plain msg failed due to unable to connect");
@@ -1353,7 +1592,18 @@ bool NukiBle::sendPlainMessage(Command commandIdentifier, const unsigned char* p
   return false;
 }
 
+bool NukiBle::subscribeFor(const bool pairing) {
+  // pairing messages are exchanged on GDIO, every other command on USDIO
+  if (pairing) {
+    return gdioSubscribed || registerOnGdioChar();
+  }
+  return usdioSubscribed || registerOnUsdioChar();
+}
+
 bool NukiBle::registerOnGdioChar() {
+  // the cause if a service or characteristic is missing
+  registerFailure = ConnectFailure::Discovery;
+  int64_t discoveryStartUs = esp_timer_get_time();
   // Obtain a reference to the KeyTurner Pairing service
   if (isLockUltra()) {
     pKeyturnerPairingService = pClient->getService(pairingServiceUltraUUID);
@@ -1367,20 +1617,23 @@ bool NukiBle::registerOnGdioChar() {
     } else {
       pGdioCharacteristic = pKeyturnerPairingService->getCharacteristic(gdioUUID);
     }
+    discoveryMs = (esp_timer_get_time() - discoveryStartUs) / 1000;
     if (pGdioCharacteristic != nullptr) {
       if (pGdioCharacteristic->canIndicate()) {
         using namespace std::placeholders;
         NimBLERemoteCharacteristic::notify_callback callback = std::bind(&NukiBle::notifyCallback, this, _1, _2, _3, _4);
         if(!pGdioCharacteristic->subscribe(false, callback, true)) {
           ESP_LOGW("NukiBle", "Unable to subscribe to GDIO characteristic");
+          registerFailure = ConnectFailure::Subscribe;
           refreshServices = true;
           disconnect();
           return false;
         }
+        // subscribe() with response returns once the lock confirmed the CCCD write
+        gdioSubscribed = true;
         if (debugNukiCommunication) {
           ESP_LOGD("NukiBle", "GDIO characteristic registered");
         }
-        vTaskDelay(pdMS_TO_TICKS(100));
         return true;
       } else {
         if (debugNukiCommunication) {
@@ -1406,25 +1659,31 @@ bool NukiBle::registerOnGdioChar() {
 }
 
 bool NukiBle::registerOnUsdioChar() {
+  // the cause if a service or characteristic is missing
+  registerFailure = ConnectFailure::Discovery;
+  int64_t discoveryStartUs = esp_timer_get_time();
   // Obtain a reference to the KeyTurner service
   pKeyturnerDataService = pClient->getService(deviceServiceUUID);
   if (pKeyturnerDataService != nullptr) {
     //Obtain reference to NDIO char
     pUsdioCharacteristic = pKeyturnerDataService->getCharacteristic(userDataUUID);
+    discoveryMs = (esp_timer_get_time() - discoveryStartUs) / 1000;
     if (pUsdioCharacteristic != nullptr) {
       if (pUsdioCharacteristic->canIndicate()) {
         using namespace std::placeholders;
         NimBLERemoteCharacteristic::notify_callback callback = std::bind(&NukiBle::notifyCallback, this, _1, _2, _3, _4);
         if(!pUsdioCharacteristic->subscribe(false, callback, true)) {
           ESP_LOGW("NukiBle", "Unable to subscribe to USDIO characteristic");
+          registerFailure = ConnectFailure::Subscribe;
           refreshServices = true;
           disconnect();
           return false;
         }
+        // subscribe() with response returns once the lock confirmed the CCCD write
+        usdioSubscribed = true;
         if (debugNukiCommunication) {
           ESP_LOGD("NukiBle", "USDIO characteristic registered");
         }
-        vTaskDelay(pdMS_TO_TICKS(100));
         return true;
       } else {
         if (debugNukiCommunication) {
@@ -1451,6 +1710,7 @@ bool NukiBle::registerOnUsdioChar() {
 }
 
 void NukiBle::notifyCallback(BLERemoteCharacteristic* pBLERemoteCharacteristic, uint8_t* recData, size_t length, bool isNotify) {
+  ProfiledScope profiledScope(resourceProfiler, ProfiledCall::ReturnMessage, Command::Empty);
   lastHeartbeat = (esp_timer_get_time() / 1000);
   if (debugNukiCommunication) {
     ESP_LOGD("NukiBle", "Notify callback for characteristic: %s of length: %d", pBLERemoteCharacteristic->getUUID().toString().c_str(), length);
@@ -1464,6 +1724,8 @@ void NukiBle::notifyCallback(BLERemoteCharacteristic* pBLERemoteCharacteristic,
     if (crcCheckOke) {
       unsigned char plainData[200];
       memcpy(plainData, &recData[2], length - 4);
+      recordFrame(FrameDirection::Received, (Command)returnCode, plainData, length - 4);
+      profiledScope.setCommand((Command)returnCode);
       handleReturnMessage((Command)returnCode, plainData, length - 4);
     }
   } else if (pBLERemoteCharacteristic->getUUID() == userDataUUID || (pBLERemoteCharacteristic->getUUID() == gdioUltraUUID && recieveEncrypted)) {
@@ -1499,9 +1761,64 @@ void NukiBle::notifyCallback(BLERemoteCharacteristic* pBLERemoteCharacteristic,
       memcpy(&returnCode, &decrData[4], 2);
       unsigned char payload[sizeof(decrData) - 8];
       memcpy(&payload, &decrData[6], sizeof(payload));
-      handleReturnMessage((Command)returnCode, payload, sizeof(payload));
+      recordFrame(FrameDirection::Received, (Command)returnCode, payload, sizeof(payload));
+      profiledScope.setCommand((Command)returnCode);
+      if (!handlePrefetchAnswer((Command)returnCode, payload, sizeof(payload))
+          && !handleListAnswer((Command)returnCode, payload, sizeof(payload))) {
+        handleReturnMessage((Command)returnCode, payload, sizeof(payload));
+      }
     }
   }
+  xSemaphoreGive(messageSemaphore);
+  #ifdef NUKI_COMMAND_FLOWS
+  SemaphoreHandle_t flowWake = flowWakeSemaphore;
+  if (flowWake != nullptr) {
+    xSemaphoreGive(flowWake);
+  }
+  #endif
+}
+
+void NukiBle::recordFrame(FrameDirection direction, Command command, const unsigned char* data, uint16_t dataLen) {
+  if (!sessionRecorder) {
+    return;
+  }
+  int64_t timestampUs = esp_timer_get_time();
+  if (direction == FrameDirection::Sent) {
+    // the payload carries the security pin, the challenge and new keypad codes
+    sessionRecorder->recordFrame(direction, timestampUs, command, nullptr, dataLen);
+    return;
+  }
+  const size_t codeOffset = offsetof(KeypadEntry, code);
+  if (command == Command::KeypadCode && dataLen >= codeOffset + sizeof(KeypadEntry::code)) {
+    unsigned char redacted[dataLen];
+    memcpy(redacted, data, dataLen);
+    memset(&redacted[codeOffset], 0, sizeof(KeypadEntry::code));
+    sessionRecorder->recordFrame(direction, timestampUs, command, redacted, dataLen);
+    return;
+  }
+  sessionRecorder->recordFrame(direction, timestampUs, command, data, dataLen);
+}
+
+void NukiBle::setSessionRecorder(SessionRecorder* recorder) {
+  sessionRecorder = recorder;
+}
+
+void NukiBle::replayReturnMessage(Command returnCode, unsigned char* data, uint16_t dataLen) {
+  ProfiledScope profiledScope(resourceProfiler, ProfiledCall::ReturnMessage, returnCode);
+  if (!handlePrefetchAnswer(returnCode, data, dataLen) && !handleListAnswer(returnCode, data, dataLen)) {
+    handleReturnMessage(returnCode, data, dataLen);
+  }
+  xSemaphoreGive(messageSemaphore);
+  #ifdef NUKI_COMMAND_FLOWS
+  SemaphoreHandle_t flowWake = flowWakeSemaphore;
+  if (flowWake != nullptr) {
+    xSemaphoreGive(flowWake);
+  }
+  #endif
+}
+
+void NukiBle::setResourceProfiler(ResourceProfiler* profiler) {
+  resourceProfiler = profiler;
 }
 
 void NukiBle::handleReturnMessage(Command returnCode, unsigned char* data, uint16_t dataLen) {
@@ -1560,6 +1877,12 @@ void NukiBle::handleReturnMessage(Command returnCode, unsigned char* data, uint1
     case Command::Status : {
       printBuffer((uint8_t*)data, dataLen, false, "status", debugNukiHexData);
       receivedStatus = data[0];
+      if (receivedStatus == 0) {
+        int64_t accepted = acceptedMs.exchange(0);
+        if (accepted != 0) {
+          completionSampleMs = (esp_timer_get_time() / 1000) - accepted;
+        }
+      }
       if (debugNukiCommunication) {
         if (receivedStatus == 0) {
           ESP_LOGD("NukiBle", "command COMPLETE");
@@ -1625,7 +1948,6 @@ void NukiBle::handleReturnMessage(Command returnCode, unsigned char* data, uint1
     }
     case Command::KeypadCodeCount : {
       memcpy(&nrOfKeypadCodes, data, 2);
-      keypadCodeCountReceived = true;
       printBuffer((uint8_t*)data, dataLen, false, "keypadCodeCount", debugNukiHexData);
       if (debugNukiReadableData) {
         uint16_t count = 0;
@@ -1639,7 +1961,6 @@ void NukiBle::handleReturnMessage(Command returnCode, unsigned char* data, uint1
       KeypadEntry keypadEntry;
       memcpy(&keypadEntry, data, dataLen);
       listOfKeyPadEntries.push_back(keypadEntry);
-      nrOfReceivedKeypadCodes++;
 
       printBuffer((uint8_t*)data, dataLen, false, "keypadCode", debugNukiHexData);
       if (debugNukiReadableData) {
@@ -1656,8 +1977,12 @@ void NukiBle::handleReturnMessage(Command returnCode, unsigned char* data, uint1
   }
 }
 
-void NukiBle::onConnect(BLEClient*) {
+void NukiBle::onConnect(BLEClient* client) {
+  requestLinkOptions(client, getConnectionParameters());
+  lastLinkMs = esp_timer_get_time() / 1000;
   extendDisconnectTimeout();
+  connectedSinceMs = esp_timer_get_time() / 1000;
+  connectCount++;
   if (debugNukiConnect) {
     ESP_LOGD("NukiBle", "BLE connected");
   }
@@ -1665,6 +1990,18 @@ void NukiBle::onConnect(BLEClient*) {
 
 void NukiBle::onDisconnect(BLEClient*, int reason)
 {
+  gdioSubscribed = false;
+  usdioSubscribed = false;
+  lastLinkMs = esp_timer_get_time() / 1000;
+  int64_t sinceMs = connectedSinceMs.exchange(0);
+  if (sinceMs > 0) {
+    pastUptimeMs += (esp_timer_get_time() / 1000) - sinceMs;
+    disconnectCount++;
+  }
+  // a challenge is only valid on the connection it was requested on
+  prefetchState = PrefetchState::None;
+  // the rest of a list does not come anymore
+  listState = ListState::None;
   countDisconnects = 0;
   if (debugNukiConnect) {
     ESP_LOGD("NukiBle", "BLE disconnected");
@@ -1685,11 +2022,26 @@ const bool NukiBle::isLockUltra() const {
 };
 
 bool NukiBle::takeNukiBleSemaphore(std::string taker) {
-  #ifndef NUKI_MUTEX_RECURSIVE
-  bool result = xSemaphoreTake(nukiBleSemaphore, NUKI_SEMAPHORE_TIMEOUT / portTICK_PERIOD_MS) == pdTRUE;
-  #else
-  bool result = xSemaphoreTakeRecursive(nukiBleSemaphore, NUKI_SEMAPHORE_TIMEOUT / portTICK_PERIOD_MS) == pdTRUE;
-  #endif
+  // a deadline shortens the wait, a cancellation token splits it up, see CommandLimits
+  int64_t waitEndMs = (esp_timer_get_time() / 1000) + CommandLimits::clampWait(NUKI_SEMAPHORE_TIMEOUT);
+  bool result = false;
+  while (1) {
+    int64_t waitMs = waitEndMs - (esp_timer_get_time() / 1000);
+    if (waitMs < 0) {
+      waitMs = 0;
+    }
+    if (CommandLimits::isCancellable() && waitMs > CANCEL_CHECK_INTERVAL) {
+      waitMs = CANCEL_CHECK_INTERVAL;
+    }
+    #ifndef NUKI_MUTEX_RECURSIVE
+    result = xSemaphoreTake(nukiBleSemaphore, pdMS_TO_TICKS(waitMs)) == pdTRUE;
+    #else
+    result = xSemaphoreTakeRecursive(nukiBleSemaphore, pdMS_TO_TICKS(waitMs)) == pdTRUE;
+    #endif
+    if (result || (esp_timer_get_time() / 1000) >= waitEndMs || CommandLimits::check() != CmdResult::Success) {
+      break;
+    }
+  }
 
   if (!result) {
     ESP_LOGD("NukiBle", "%s FAILED to take Nuki semaphore. Owner %s", taker.c_str(), owner.c_str());
@@ -1709,6 +2061,945 @@ void NukiBle::giveNukiBleSemaphore() {
   #endif
 }
 
+bool NukiBle::submit(CommandCall call, CommandCallback callback, const CommandPriority priority,
+                     const uint32_t timeoutMs, const CancellationToken& token) {
+  startCommandWorker();
+  xSemaphoreTake(commandWorkerSemaphore, portMAX_DELAY);
+  bool result = commandWorker != nullptr && commandWorker->submit(call, callback, priority, timeoutMs, token);
+  xSemaphoreGive(commandWorkerSemaphore);
+  return result;
+}
+
+std::future<CmdResult> NukiBle::submit(CommandCall call, const CommandPriority priority, const uint32_t timeoutMs,
+                                       const CancellationToken& token) {
+  std::shared_ptr<std::promise<CmdResult>> promise = std::make_shared<std::promise<CmdResult>>();
+  std::future<CmdResult> future = promise->get_future();
+  if (!submit(call, [promise](CmdResult result) { promise->set_value(result); }, priority, timeoutMs, token)) {
+    promise->set_value(CmdResult::Failed);
+  }
+  return future;
+}
+
+CmdResult NukiBle::executeQueued(CommandCall call, const CommandPriority priority, const uint32_t timeoutMs,
+                                 const CancellationToken& token) {
+  xSemaphoreTake(commandWorkerSemaphore, portMAX_DELAY);
+  bool onWorker = commandWorker != nullptr && commandWorker->isWorkerTask();
+  xSemaphoreGive(commandWorkerSemaphore);
+  if (onWorker) {
+    // waiting for the queue would wait for this task
+    CommandLimits limits(0, token);
+    return call();
+  }
+  return submit(call, priority, timeoutMs, token).get();
+}
+
+void NukiBle::beginSession() {
+  sessionDepth++;
+  extendDisconnectTimeout();
+}
+
+void NukiBle::endSession(bool disconnect) {
+  if (--sessionDepth > 0) {
+    return;
+  }
+  if (!disconnect) {
+    extendDisconnectTimeout();
+  } else if (altConnect) {
+    this->disconnect();
+  } else if (pClient && pClient->isConnected()) {
+    pClient->disconnect();
+  }
+}
+
+CmdResult NukiBle::runSession(const std::vector<CommandCall>& calls, std::vector<CmdResult>* results,
+                              bool stopOnError) {
+  CmdResult sessionResult = CmdResult::Success;
+  beginSession();
+  for (const CommandCall& call : calls) {
+    CmdResult result = call();
+    if (results) {
+      results->push_back(result);
+    }
+    if (result != CmdResult::Success && sessionResult == CmdResult::Success) {
+      sessionResult = result;
+      if (stopOnError) {
+        break;
+      }
+    }
+  }
+  endSession();
+  return sessionResult;
+}
+
+void NukiBle::setRequestCoalescing(bool enable) {
+  coalesceRequests = enable;
+}
+
+uint32_t NukiBle::getCoalescedRequestCount() const {
+  return coalescedRequestCount;
+}
+
+Nuki::CmdResult NukiBle::coalesceRequest(const Command request, const std::function<Nuki::CmdResult()>& exchange) {
+  if (!coalesceRequests) {
+    return exchange();
+  }
+  // a call queued on the worker asked for the data when it was submitted
+  int64_t requestedUs = CommandWorker::currentSubmitTime();
+  if (requestedUs == 0) {
+    requestedUs = esp_timer_get_time();
+  }
+
+  xSemaphoreTake(requestSemaphore, portMAX_DELAY);
+  uint32_t generation = requestGeneration;
+  auto inFlight = inFlightRequests.find(request);
+  while (inFlight != inFlightRequests.end() && inFlight->second->generation == generation) {
+    std::shared_ptr<SharedRequest> shared = inFlight->second;
+    coalescedRequestCount++;
+    xSemaphoreGive(requestSemaphore);
+    if (debugNukiCommunication) {
+      logMessageVar("Waiting for the same request in flight", (unsigned int)request);
+    }
+    uint32_t waitMs = CommandLimits::isCancellable() ? CANCEL_CHECK_INTERVAL : MESSAGE_WAIT_TIMEOUT;
+    while (xSemaphoreTake(shared->done, pdMS_TO_TICKS(CommandLimits::clampWait(waitMs))) != pdTRUE) {
+      Nuki::CmdResult limitResult = CommandLimits::check();
+      if (limitResult != Nuki::CmdResult::Success) {
+        return limitResult;
+      }
+      #ifndef NUKI_NO_WDT_RESET
+      esp_task_wdt_reset();
+      #endif
+    }
+    // wake the next waiter
+    xSemaphoreGive(shared->done);
+    if (!shared->ownerLimited) {
+      return shared->result;
+    }
+    // cancelled or timed out for the task that made the exchange, run it again if this one still may
+    Nuki::CmdResult limitResult = CommandLimits::check();
+    if (limitResult != Nuki::CmdResult::Success) {
+      return limitResult;
+    }
+    xSemaphoreTake(requestSemaphore, portMAX_DELAY);
+    generation = requestGeneration;
+    inFlight = inFlightRequests.find(request);
+  }
+  if (lastRequestGeneration != generation) {
+    lastRequestStartUs.clear();
+    lastRequestGeneration = generation;
+  }
+  auto last = lastRequestStartUs.find(request);
+  if (last != lastRequestStartUs.end() && last->second >= requestedUs) {
+    coalescedRequestCount++;
+    xSemaphoreGive(requestSemaphore);
+    if (debugNukiCommunication) {
+      logMessageVar("Request answered by an exchange after it was queued", (unsigned int)request);
+    }
+    return Nuki::CmdResult::Success;
+  }
+  std::shared_ptr<SharedRequest> shared = std::make_shared<SharedRequest>();
+  shared->generation = generation;
+  inFlightRequests[request] = shared;
+  xSemaphoreGive(requestSemaphore);
+
+  int64_t startUs = esp_timer_get_time();
+  Nuki::CmdResult result = exchange();
+
+  xSemaphoreTake(requestSemaphore, portMAX_DELAY);
+  shared->result = result;
+  shared->ownerLimited = result != Nuki::CmdResult::Success && CommandLimits::check() != Nuki::CmdResult::Success;
+  inFlight = inFlightRequests.find(request);
+  if (inFlight != inFlightRequests.end() && inFlight->second == shared) {
+    inFlightRequests.erase(inFlight);
+  }
+  // a command in between may have changed the data (or the answer may predate it)
+  if (result == Nuki::CmdResult::Success && requestGeneration == generation && lastRequestGeneration == generation) {
+    lastRequestStartUs[request] = startUs;
+  }
+  xSemaphoreGive(requestSemaphore);
+  xSemaphoreGive(shared->done);
+  return result;
+}
+
+void NukiBle::setChallengePrefetch(bool enable) {
+  challengePrefetch = enable;
+  if (!enable) {
+    PrefetchState ready = PrefetchState::Ready;
+    prefetchState.compare_exchange_strong(ready, PrefetchState::None);
+  }
+}
+
+uint32_t NukiBle::getPrefetchedChallengeCount() const {
+  return prefetchedChallengeCount;
+}
+
+void NukiBle::prefetchChallenge() {
+  // the answer of a prefetch is only received while the USDIO subscription lasts
+  if (prefetchState != PrefetchState::None || pClient == nullptr || !pClient->isConnected() || !usdioSubscribed) {
+    return;
+  }
+  if (debugNukiCommunication) {
+    logMessage("************************ PREFETCHING CHALLENGE ************************");
+  }
+  prefetchSentMs = esp_timer_get_time() / 1000;
+  prefetchState = PrefetchState::Pending;
+  unsigned char payload[sizeof(Command)] = {0x04, 0x00};  //challenge
+  if (!sendEncryptedMessage(Command::RequestData, payload, sizeof(Command))) {
+    prefetchState = PrefetchState::None;
+  }
+}
+
+bool NukiBle::takePrefetchedChallenge(const bool challenged, const bool wait) {
+  PrefetchState state = prefetchState;
+  if (state == PrefetchState::None) {
+    return false;
+  }
+  if (state == PrefetchState::Dropped) {
+    // the lock did not answer, nothing left to drop
+    if ((esp_timer_get_time() / 1000) - prefetchSentMs > CMD_TIMEOUT) {
+      prefetchState.compare_exchange_strong(state, PrefetchState::None);
+    }
+    return false;
+  }
+  if (!challenged || (!wait && state == PrefetchState::Pending)) {
+    // the challenge belongs to the next command, do not rely on it surviving another one
+    while (state != PrefetchState::None && state != PrefetchState::Dropped
+           && !prefetchState.compare_exchange_weak(state, state == PrefetchState::Pending ? PrefetchState::Dropped
+                                                                                        : PrefetchState::None)) {
+    }
+    return false;
+  }
+
+  while (prefetchState == PrefetchState::Pending) {
+    int64_t waitMs = CMD_TIMEOUT + 1 - ((esp_timer_get_time() / 1000) - prefetchSentMs);
+    if (waitMs <= 0) {
+      state = PrefetchState::Pending;
+      prefetchState.compare_exchange_strong(state, PrefetchState::Dropped);
+      break;
+    }
+    if (CommandLimits::check() != CmdResult::Success) {
+      // executeAction() gives up, the answer may still come
+      state = PrefetchState::Pending;
+      prefetchState.compare_exchange_strong(state, PrefetchState::Dropped);
+      break;
+    }
+    if (waitMs > MESSAGE_WAIT_TIMEOUT) {
+      waitMs = MESSAGE_WAIT_TIMEOUT;
+    }
+    if (CommandLimits::isCancellable() && waitMs > CANCEL_CHECK_INTERVAL) {
+      waitMs = CANCEL_CHECK_INTERVAL;
+    }
+    xSemaphoreTake(messageSemaphore, pdMS_TO_TICKS(CommandLimits::clampWait(waitMs)));
+    #ifndef NUKI_NO_WDT_RESET
+    esp_task_wdt_reset();
+    #endif
+  }
+
+  state = PrefetchState::Ready;
+  if (!prefetchState.compare_exchange_strong(state, PrefetchState::None)) {
+    return false;
+  }
+  memcpy(challengeNonceK, prefetchedChallenge, sizeof(challengeNonceK));
+  prefetchedChallengeCount++;
+  if (debugNukiCommunication) {
+    logMessage("************************ USING PREFETCHED CHALLENGE ************************");
+  }
+  return true;
+}
+
+bool NukiBle::handlePrefetchAnswer(Command returnCode, unsigned char* data, uint16_t dataLen) {
+  PrefetchState state = prefetchState;
+  if (state != PrefetchState::Pending && state != PrefetchState::Dropped) {
+    return false;
+  }
+  // the lock answers in order, the first challenge or error report for a data request is the prefetch answer
+  if (returnCode == Command::Challenge && dataLen >= sizeof(prefetchedChallenge)) {
+    memcpy(prefetchedChallenge, data, sizeof(prefetchedChallenge));
+    while ((state == PrefetchState::Pending || state == PrefetchState::Dropped)
+           && !prefetchState.compare_exchange_weak(state, state == PrefetchState::Pending ? PrefetchState::Ready
+                                                                                        : PrefetchState::None)) {
+    }
+    return true;
+  }
+  if (returnCode == Command::ErrorReport && dataLen >= 3
+      && (Command)(((uint16_t)data[2] << 8) | data[1]) == Command::RequestData) {
+    ESP_LOGW("NukiBle", "Challenge prefetch failed, error: %02x", data[0]);
+    prefetchState = PrefetchState::None;
+    return true;
+  }
+  return false;
+}
+
+void NukiBle::beginListRequest(const Command command, const unsigned char* payload) {
+  switch (command) {
+    case Command::RequestLogEntries : {
+      // start index(4) count(2) sort order(1) total count(1), the count is only sent if requested
+      uint32_t startIndex = 0;
+      memcpy(&startIndex, payload, 4);
+      memcpy(&listRequestedCount, &payload[4], 2);
+      listCountCommand = Command::LogEntryCount;
+      listEntryCommand = Command::LogEntry;
+      // log entries are numbered across the whole history, only index 0 (newest or oldest) is a known position
+      listOffset = startIndex == 0 ? 0 : -1;
+      break;
+    }
+    case Command::RequestAuthorizationEntries :
+    case Command::RequestKeypadCodes : {
+      // offset(2) count(2)
+      uint16_t offset = 0;
+      memcpy(&offset, payload, 2);
+      memcpy(&listRequestedCount, &payload[2], 2);
+      listCountCommand = command == Command::RequestKeypadCodes ? Command::KeypadCodeCount
+                                                                 : Command::AuthorizationEntryCount;
+      listEntryCommand = command == Command::RequestKeypadCodes ? Command::KeypadCode : Command::AuthorizationEntry;
+      listOffset = offset;
+      break;
+    }
+    case Command::RequestTimeControlEntries : {
+      listRequestedCount = UINT16_MAX;
+      listCountCommand = Command::TimeControlEntryCount;
+      listEntryCommand = Command::TimeControlEntry;
+      listOffset = 0;
+      break;
+    }
+    default:
+      endListRequest();
+      listEntryCommand = Command::Empty;
+      return;
+  }
+  listExpectedCount = -1;
+  listReceivedCount = 0;
+  listFailed = false;
+  listLastMessageMs = esp_timer_get_time() / 1000;
+  // the closing status of the previous list comes before the first answer to this one
+  listDropClose = true;
+  if (listState.exchange(ListState::Receiving) != ListState::Draining) {
+    listDropClose = false;
+  }
+}
+
+void NukiBle::endListRequest() {
+  // the closing status of an earlier list may still come, handleListAnswer() drops it
+  ListState state = ListState::Receiving;
+  listState.compare_exchange_strong(state, ListState::None);
+}
+
+Nuki::CmdResult NukiBle::checkListEntries() {
+  if (listState == ListState::Receiving) {
+    int expected = listExpectedCount;
+    if (expected >= 0 && listReceivedCount >= expected) {
+      // done without waiting for the closing status, handleListAnswer() drops it
+      ListState state = ListState::Receiving;
+      listState.compare_exchange_strong(state, ListState::Draining);
+    } else {
+      Nuki::CmdResult limitResult = CommandLimits::check();
+      if (limitResult != Nuki::CmdResult::Success) {
+        listState = ListState::None;
+        abandonExchange(true);
+        return limitResult;
+      }
+      if ((esp_timer_get_time() / 1000) - listLastMessageMs > GENERAL_TIMEOUT) {
+        ESP_LOGW("NukiBle", "Receive list entries timeout, %d of %d received", (int)listReceivedCount, expected);
+        listState = ListState::None;
+        if (altConnect) {
+          disconnect();
+        }
+        return Nuki::CmdResult::TimeOut;
+      }
+      return Nuki::CmdResult::Working;
+    }
+  }
+  if (listFailed) {
+    return Nuki::CmdResult::Failed;
+  }
+  if (debugNukiCommand && listEntryCommand != Command::Empty) {
+    ESP_LOGD("NukiBle", "%d list entries received", (int)listReceivedCount);
+  }
+  return Nuki::CmdResult::Success;
+}
+
+uint32_t NukiBle::listWaitMs() {
+  int64_t waitMs = GENERAL_TIMEOUT + 1 - ((esp_timer_get_time() / 1000) - listLastMessageMs);
+  if (waitMs > MESSAGE_WAIT_TIMEOUT) {
+    waitMs = MESSAGE_WAIT_TIMEOUT;
+  }
+  if (CommandLimits::isCancellable() && waitMs > CANCEL_CHECK_INTERVAL) {
+    waitMs = CANCEL_CHECK_INTERVAL;
+  }
+  return waitMs > 0 ? CommandLimits::clampWait(waitMs) : 0;
+}
+
+Nuki::CmdResult NukiBle::waitForListEntries() {
+  Nuki::CmdResult result;
+  while ((result = checkListEntries()) == Nuki::CmdResult::Working) {
+    xSemaphoreTake(messageSemaphore, pdMS_TO_TICKS(listWaitMs()));
+    #ifndef NUKI_NO_WDT_RESET
+    esp_task_wdt_reset();
+    #endif
+  }
+  return result;
+}
+
+bool NukiBle::handleListAnswer(Command returnCode, unsigned char* data, uint16_t dataLen) {
+  ListState state = listState;
+  if (state == ListState::None) {
+    return false;
+  }
+  bool completeStatus = returnCode == Command::Status && dataLen >= 1
+                        && data[0] == (uint8_t)CommandStatus::Complete;
+  if (state == ListState::Draining) {
+    // the lock answers in order, only the message right after the last entry can close the list
+    listState = ListState::None;
+    return completeStatus;
+  }
+
+  if (listDropClose.exchange(false) && completeStatus) {
+    return true;
+  }
+  listLastMessageMs = esp_timer_get_time() / 1000;
+  if (returnCode == listEntryCommand) {
+    handleReturnMessage(returnCode, data, dataLen);
+    listReceivedCount++;
+    return true;
+  }
+  if (returnCode == listCountCommand) {
+    handleReturnMessage(returnCode, data, dataLen);
+    int32_t total = -1;
+    if (returnCode == Command::LogEntryCount && dataLen >= 3) {
+      // logging enabled(1) count(2)
+      uint16_t count = 0;
+      memcpy(&count, &data[1], 2);
+      total = count;
+    } else if (returnCode == Command::TimeControlEntryCount && dataLen >= 1) {
+      total = data[0];
+    } else if (dataLen >= 2) {
+      uint16_t count = 0;
+      memcpy(&count, data, 2);
+      total = count;
+    }
+    if (total >= 0 && listOffset >= 0) {
+      listExpectedCount = std::min<int32_t>(listRequestedCount, std::max<int32_t>(total - listOffset, 0));
+    }
+    return true;
+  }
+  if (completeStatus) {
+    // closes the list, executeAction() only needs the receipt of a message
+    listState = ListState::None;
+    return true;
+  }
+  if (returnCode == Command::ErrorReport) {
+    listFailed = true;
+    listState = ListState::None;
+  }
+  return false;
+}
+
+void NukiBle::setAdaptiveTimeouts(bool enable) {
+  adaptiveTimeouts = enable;
+}
+
+TimingEstimates NukiBle::getTimingEstimates() {
+  TimingEstimates estimates;
+  xSemaphoreTake(estimatorSemaphore, portMAX_DELAY);
+  estimates.connect = connectEstimator.getEstimate();
+  estimates.challenge = challengeEstimator.getEstimate();
+  estimates.completion = completionEstimator.getEstimate();
+  xSemaphoreGive(estimatorSemaphore);
+  return estimates;
+}
+
+uint32_t NukiBle::commandStateTimeout() {
+  // the answer to a command takes as long as the lock needs for it, only the challenge is a plain round trip
+  if (!adaptiveTimeouts || nukiCommandState != CommandState::ChallengeSent) {
+    return CMD_TIMEOUT;
+  }
+  xSemaphoreTake(estimatorSemaphore, portMAX_DELAY);
+  uint32_t timeoutMs = challengeEstimator.getTimeout(CMD_TIMEOUT, ADAPTIVE_CHALLENGE_TIMEOUT_MIN, CMD_TIMEOUT);
+  xSemaphoreGive(estimatorSemaphore);
+  return timeoutMs;
+}
+
+uint32_t NukiBle::connectAttemptTimeout() {
+  uint32_t fixedMs = connectTimeoutSec * 1000;
+  if (!adaptiveTimeouts) {
+    return fixedMs;
+  }
+  xSemaphoreTake(estimatorSemaphore, portMAX_DELAY);
+  uint32_t timeoutMs = connectEstimator.getTimeout(fixedMs, ADAPTIVE_CONNECT_TIMEOUT_MIN, ADAPTIVE_CONNECT_TIMEOUT_MAX);
+  xSemaphoreGive(estimatorSemaphore);
+  return timeoutMs;
+}
+
+uint8_t NukiBle::connectAttempts(const uint32_t attemptTimeoutMs) {
+  if (!adaptiveTimeouts || attemptTimeoutMs == 0) {
+    return connectRetries;
+  }
+  // about the time of the configured attempts, at most four times as many
+  uint32_t attempts = (uint32_t)connectRetries * connectTimeoutSec * 1000 / attemptTimeoutMs;
+  if (attempts < 1) {
+    attempts = 1;
+  }
+  if (attempts > (uint32_t)connectRetries * 4) {
+    attempts = (uint32_t)connectRetries * 4;
+  }
+  return attempts > UINT8_MAX ? UINT8_MAX : attempts;
+}
+
+void NukiBle::setRetryPolicy(RetryPolicy* policy) {
+  retryPolicy = policy != nullptr ? policy : &defaultRetryPolicy;
+}
+
+RetryStatistics NukiBle::getRetryStatistics() {
+  xSemaphoreTake(retryStatisticsSemaphore, portMAX_DELAY);
+  RetryStatistics statistics = retryStatistics;
+  xSemaphoreGive(retryStatisticsSemaphore);
+  return statistics;
+}
+
+ScanStatistics NukiBle::getScanStatistics() {
+  if (!scanCoordinator) {
+    return ScanStatistics();
+  }
+  return scanCoordinator->getStatistics();
+}
+
+void NukiBle::setMinScanWindow(const uint32_t windowMs) {
+  if (scanCoordinator) {
+    scanCoordinator->setMinScanWindow(windowMs);
+  }
+}
+
+void NukiBle::suspendScanning() {
+  if (!scanSuspended && scanCoordinator) {
+    scanCoordinator->suspend();
+    scanSuspended = true;
+  }
+}
+
+void NukiBle::resumeScanning() {
+  if (scanSuspended) {
+    scanCoordinator->resume();
+    scanSuspended = false;
+  }
+}
+
+bool NukiBle::connectClient(const BLEAddress& bleAddress) {
+  if (scanCoordinator && !scanCoordinator->tryBeginConnect()) {
+    // another instance connects, scanning goes on until it is done and the scan window has passed
+    bool suspended = scanSuspended;
+    resumeScanning();
+    bool turn = scanCoordinator->beginConnect();
+    if (suspended) {
+      suspendScanning();
+    }
+    if (!turn) {
+      if (debugNukiConnect) {
+        ESP_LOGD("NukiBle", "[%s] No turn to connect", deviceName.c_str());
+      }
+      return false;
+    }
+  }
+  bool connected = pClient->connect(bleAddress, refreshServices);
+  if (scanCoordinator) {
+    scanCoordinator->endConnect();
+  }
+  return connected;
+}
+
+bool NukiBle::lockSilent(const bool pairing) {
+  // the pairing advertisement is not tracked, and without a beacon or connection so far the presence is unknown
+  int64_t lastHeardMs = std::max<int64_t>(lastReceivedBeaconTs, lastLinkMs);
+  if (pairing || !isPaired || lastHeardMs == 0) {
+    return false;
+  }
+  return (esp_timer_get_time() / 1000) - lastHeardMs > HEARTBEAT_TIMEOUT;
+}
+
+bool NukiBle::retryConnect(const ConnectFailure failure, const uint8_t failedAttempts, const uint8_t attempts,
+                           const bool pairing) {
+  xSemaphoreTake(retryStatisticsSemaphore, portMAX_DELAY);
+  switch (failure) {
+    case ConnectFailure::NoClient:
+      retryStatistics.noClient++;
+      break;
+    case ConnectFailure::Connect:
+    case ConnectFailure::NotPresent:
+      retryStatistics.connect++;
+      break;
+    case ConnectFailure::Discovery:
+      retryStatistics.discovery++;
+      break;
+    case ConnectFailure::Subscribe:
+      retryStatistics.subscribe++;
+      break;
+  }
+  xSemaphoreGive(retryStatisticsSemaphore);
+  #ifndef NUKI_NO_WDT_RESET
+  esp_task_wdt_reset();
+  #endif
+
+  int32_t delayMs = 0;
+  if (failedAttempts < attempts && CommandLimits::check() == CmdResult::Success) {
+    delayMs = retryPolicy.load()->retryDelayMs(lockSilent(pairing) ? ConnectFailure::NotPresent : failure,
+                                               failedAttempts);
+    if (delayMs < 0) {
+      ESP_LOGW("NukiBle", "[%s] Connecting given up", deviceName.c_str());
+      xSemaphoreTake(retryStatisticsSemaphore, portMAX_DELAY);
+      retryStatistics.givenUp++;
+      xSemaphoreGive(retryStatisticsSemaphore);
+      return false;
+    }
+    if (debugNukiConnect) {
+      ESP_LOGD("NukiBle", "[%s] Connect attempt %d failed, retrying in %d ms", deviceName.c_str(), failedAttempts,
+               (int)delayMs);
+    }
+    // scanning goes on (and other instances connect) while waiting
+    bool suspended = scanSuspended;
+    resumeScanning();
+    // a deadline shortens the wait, a cancellation token splits it up, see CommandLimits
+    int64_t waitEndMs = (esp_timer_get_time() / 1000) + CommandLimits::clampWait(delayMs);
+    int64_t waitMs;
+    while ((waitMs = waitEndMs - (esp_timer_get_time() / 1000)) > 0 && CommandLimits::check() == CmdResult::Success) {
+      vTaskDelay(pdMS_TO_TICKS(waitMs > CANCEL_CHECK_INTERVAL ? CANCEL_CHECK_INTERVAL : waitMs));
+    }
+    if (suspended) {
+      suspendScanning();
+    }
+  }
+
+  bool retry = failedAttempts < attempts && CommandLimits::check() == CmdResult::Success;
+  xSemaphoreTake(retryStatisticsSemaphore, portMAX_DELAY);
+  retryStatistics.backoffMs += delayMs;
+  if (retry) {
+    retryStatistics.retries++;
+  } else {
+    retryStatistics.exhausted++;
+  }
+  xSemaphoreGive(retryStatisticsSemaphore);
+  return retry;
+}
+
+void NukiBle::addConnectSample(const int64_t startMs) {
+  xSemaphoreTake(estimatorSemaphore, portMAX_DELAY);
+  connectEstimator.addSample((esp_timer_get_time() / 1000) - startMs);
+  xSemaphoreGive(estimatorSemaphore);
+}
+
+void NukiBle::addChallengeSample() {
+  // one sample per challenge request, the state may be checked again before it changes
+  if (challengeSampleSentMs == timeNow) {
+    return;
+  }
+  challengeSampleSentMs = timeNow;
+  xSemaphoreTake(estimatorSemaphore, portMAX_DELAY);
+  challengeEstimator.addSample((esp_timer_get_time() / 1000) - timeNow, challengeRetried);
+  xSemaphoreGive(estimatorSemaphore);
+  challengeRetried = false;
+}
+
+void NukiBle::takeCompletionSample() {
+  // the complete status usually comes after executeAction() returned, it is taken on the next command
+  int64_t sampleMs = completionSampleMs.exchange(-1);
+  if (sampleMs >= 0) {
+    xSemaphoreTake(estimatorSemaphore, portMAX_DELAY);
+    completionEstimator.addSample(sampleMs);
+    xSemaphoreGive(estimatorSemaphore);
+  }
+}
+
+void NukiBle::startCommandWorker(const uint32_t stackSize, const UBaseType_t priority, const BaseType_t coreId) {
+  xSemaphoreTake(commandWorkerSemaphore, portMAX_DELAY);
+  if (commandWorker == nullptr) {
+    commandWorker = new CommandWorker(deviceName, stackSize, priority, coreId);
+  }
+  xSemaphoreGive(commandWorkerSemaphore);
+}
+
+void NukiBle::stopCommandWorker() {
+  xSemaphoreTake(commandWorkerSemaphore, portMAX_DELAY);
+  CommandWorker* worker = commandWorker;
+  commandWorker = nullptr;
+  xSemaphoreGive(commandWorkerSemaphore);
+  // outside of the semaphore, the dropped calls may submit again (and fail)
+  CommandWorker::destroy(worker);
+}
+
+uint32_t NukiBle::messageWaitMs() {
+  // the state machines time out commandStateTimeout() after timeNow
+  int64_t waitMs = commandStateTimeout() + 1 - ((esp_timer_get_time() / 1000) - timeNow);
+  if (waitMs > MESSAGE_WAIT_TIMEOUT) {
+    waitMs = MESSAGE_WAIT_TIMEOUT;
+  }
+  if (CommandLimits::isCancellable() && waitMs > CANCEL_CHECK_INTERVAL) {
+    waitMs = CANCEL_CHECK_INTERVAL;
+  }
+  return waitMs > 0 ? CommandLimits::clampWait(waitMs) : 0;
+}
+
+void NukiBle::waitForMessage() {
+  uint32_t waitMs = messageWaitMs();
+  if (waitMs > 0) {
+    xSemaphoreTake(messageSemaphore, pdMS_TO_TICKS(waitMs));
+  }
+}
+
+void NukiBle::abandonExchange(const bool answersPending) {
+  nukiCommandState = CommandState::Idle;
+  lastMsgCodeReceived = Command::Empty;
+  endListRequest();
+  if (answersPending) {
+    // a late answer would be taken for the answer of the next command
+    if (altConnect) {
+      disconnect();
+    } else if (pClient && pClient->isConnected()) {
+      pClient->disconnect();
+    }
+  }
+}
+
+Nuki::CmdResult NukiBle::checkActionPreconditions(const bool semaphoreTaken) {
+  Nuki::CmdResult limitResult = CommandLimits::check();
+  if (limitResult != Nuki::CmdResult::Success) {
+    return limitResult;
+  }
+  if (!altConnect) {
+    if ((esp_timer_get_time() / 1000) - lastHeartbeat > HEARTBEAT_TIMEOUT) {
+      logMessage("Lock Heartbeat timeout, command failed", 1);
+      return Nuki::CmdResult::Error;
+    }
+  }
+  if (debugNukiConnect) {
+    logMessage("************************ CHECK PAIRED ************************");
+  }
+  if (semaphoreTaken ? readCredentials() : retrieveCredentials()) {
+    if (debugNukiConnect) {
+      logMessage("Credentials retrieved from preferences, ready for commands");
+    }
+  } else {
+    if (debugNukiConnect) {
+      logMessage("Credentials NOT retrieved from preferences, first pair with the lock");
+    }
+    return Nuki::CmdResult::NotPaired;
+  }
+  return Nuki::CmdResult::Success;
+}
+
+void NukiBle::startAction(const Command command, const unsigned char* payload, const bool challenged,
+                          const bool waitForPrefetch) {
+  lastCommandMs = esp_timer_get_time() / 1000;
+  // drop a wake up of a message received before this action
+  xSemaphoreTake(messageSemaphore, 0);
+  takeCompletionSample();
+  beginListRequest(command, payload);
+  if (command != Command::RequestData && command != Command::RequestConfig
+      && command != Command::RequestAdvancedConfig) {
+    // the command may change what the read-only requests return, see coalesceRequest()
+    requestGeneration++;
+  }
+  if (takePrefetchedChallenge(challenged, waitForPrefetch) && nukiCommandState == CommandState::Idle) {
+    nukiCommandState = CommandState::ChallengeRespReceived;
+  }
+}
+
+Nuki::CmdResult NukiBle::endAction(const Nuki::CmdResult result) {
+  if (result == Nuki::CmdResult::Success && challengePrefetch) {
+    prefetchChallenge();
+  }
+  giveNukiBleSemaphore();
+
+  if (altConnect && (result == Nuki::CmdResult::Error || result == Nuki::CmdResult::Failed)) {
+    disconnect();
+  }
+  return result;
+}
+
+bool NukiBle::sendExchangeMessage(const Command command, const unsigned char* payload, const uint8_t payloadLen,
+                                  const CommandState nextState) {
+  bool challenge = nextState == CommandState::ChallengeSent;
+  if (debugNukiCommunication) {
+    if (challenge) {
+      logMessage("************************ SENDING CHALLENGE ************************");
+    } else {
+      logMessageVar("************************ SENDING COMMAND ************************", (unsigned int)command);
+    }
+  }
+  lastMsgCodeReceived = Command::Empty;
+  crcCheckOke = false;
+
+  if (!sendEncryptedMessage(command, payload, payloadLen)) {
+    failCommand(Nuki::CmdResult::Failed, challenge ? "************************ SENDING CHALLENGE FAILED ************************"
+                                                   : "************************ SENDING COMMAND FAILED ************************");
+    return false;
+  }
+  timeNow = (esp_timer_get_time() / 1000);
+  nukiCommandState = nextState;
+  return true;
+}
+
+bool NukiBle::sendChallengeRequest() {
+  unsigned char payload[sizeof(Command)] = {0x04, 0x00};  //challenge
+  return sendExchangeMessage(Command::RequestData, payload, sizeof(Command), CommandState::ChallengeSent);
+}
+
+Nuki::CmdResult NukiBle::checkAnswer(const ExpectedAnswer expected) {
+  if (expected == ExpectedAnswer::Challenge && lastMsgCodeReceived != Command::Empty) {
+    addChallengeSample();
+  }
+  if ((esp_timer_get_time() / 1000) - timeNow > commandStateTimeout()) {
+    if (expected == ExpectedAnswer::Challenge) {
+      xSemaphoreTake(estimatorSemaphore, portMAX_DELAY);
+      challengeEstimator.backOff();
+      xSemaphoreGive(estimatorSemaphore);
+      challengeRetried = true;
+    }
+    return failCommand(Nuki::CmdResult::TimeOut,
+                       expected == ExpectedAnswer::Accepted ? "************************ ACCEPT FAILED TIMEOUT ************************"
+                                                            : "************************ COMMAND FAILED TIMEOUT ************************", 2);
+  }
+  if (lastMsgCodeReceived == Command::ErrorReport) {
+    if (errorCode == 69) {
+      return failCommand(Nuki::CmdResult::Lock_Busy, "************************ COMMAND FAILED LOCK BUSY ************************");
+    }
+    return failCommand(Nuki::CmdResult::Failed, "************************ COMMAND FAILED ************************");
+  }
+
+  const char* successMessage = nullptr;
+  switch (expected) {
+    case ExpectedAnswer::Challenge: {
+      if (lastMsgCodeReceived == Command::Challenge) {
+        nukiCommandState = CommandState::ChallengeRespReceived;
+        lastMsgCodeReceived = Command::Empty;
+      }
+      break;
+    }
+    case ExpectedAnswer::Message: {
+      if (lastMsgCodeReceived != Command::Empty) {
+        successMessage = "************************ COMMAND DONE ************************";
+      }
+      break;
+    }
+    case ExpectedAnswer::ValidMessage: {
+      if (crcCheckOke) {
+        successMessage = "************************ DATA RECEIVED ************************";
+      }
+      break;
+    }
+    case ExpectedAnswer::Accepted: {
+      if (lastMsgCodeReceived == Command::Status && (CommandStatus)receivedStatus == CommandStatus::Accepted) {
+        timeNow = (esp_timer_get_time() / 1000);
+        acceptedMs = timeNow;
+        nukiCommandState = CommandState::CmdAccepted;
+        lastMsgCodeReceived = Command::Empty;
+      } else if (lastMsgCodeReceived == Command::Status && (CommandStatus)receivedStatus == CommandStatus::Complete) {
+        //accept was skipped on lock because ie unlock command when lock allready unlocked?
+        successMessage = "************************ COMMAND SUCCESS (SKIPPED) ************************";
+      }
+      break;
+    }
+    case ExpectedAnswer::Complete: {
+      // an accepted action returns without waiting for the motor, lastMsgCodeReceived was reset on ACCEPTED
+      if (lastMsgCodeReceived == Command::Empty
+          || (lastMsgCodeReceived == Command::Status && (CommandStatus)receivedStatus == CommandStatus::Complete)) {
+        successMessage = "************************ COMMAND SUCCESS ************************";
+      }
+      break;
+    }
+  }
+  if (successMessage == nullptr) {
+    return Nuki::CmdResult::Working;
+  }
+  if (debugNukiCommunication) {
+    logMessage(successMessage);
+  }
+  nukiCommandState = CommandState::Idle;
+  lastMsgCodeReceived = Command::Empty;
+  return Nuki::CmdResult::Success;
+}
+
+Nuki::CmdResult NukiBle::failCommand(const Nuki::CmdResult result, const char* message, const int level) {
+  if (level < 4 || debugNukiCommunication) {
+    logMessage(message, level);
+  }
+  if (altConnect) {
+    disconnect();
+  }
+  nukiCommandState = CommandState::Idle;
+  lastMsgCodeReceived = Command::Empty;
+  return result;
+}
+
+#ifdef NUKI_COMMAND_FLOWS
+Nuki::CommandFlow NukiBle::answerFlow(const ExpectedAnswer expected) {
+  CommandState waitingState = nukiCommandState;
+  while (1) {
+    Nuki::CmdResult result = CommandLimits::check();
+    if (result != Nuki::CmdResult::Success) {
+      logMessage(result == Nuki::CmdResult::Cancelled ? "************************ COMMAND CANCELLED ************************"
+                                                      : "************************ COMMAND DEADLINE PASSED ************************", 2);
+      abandonExchange(true);
+      co_return result;
+    }
+    extendDisconnectTimeout();
+    result = checkAnswer(expected);
+    if (result != Nuki::CmdResult::Working) {
+      co_return result;
+    }
+    if (nukiCommandState != waitingState) {
+      co_return Nuki::CmdResult::Success;
+    }
+    co_await FlowWait{messageWaitMs()};
+  }
+}
+
+Nuki::CmdResult NukiBle::takeFlowOwnership(const int64_t startMs) {
+  Nuki::CmdResult limitResult = CommandLimits::check();
+  if (limitResult != Nuki::CmdResult::Success) {
+    return limitResult;
+  }
+  // the flows of a loop run on one task, a recursive mutex would let two of them in
+  bool active = false;
+  if (flowActive.compare_exchange_strong(active, true)) {
+    #ifndef NUKI_MUTEX_RECURSIVE
+    bool taken = xSemaphoreTake(nukiBleSemaphore, 0) == pdTRUE;
+    #else
+    bool taken = xSemaphoreTakeRecursive(nukiBleSemaphore, 0) == pdTRUE;
+    #endif
+    if (taken) {
+      owner = "exec flow";
+      return Nuki::CmdResult::Success;
+    }
+    flowActive = false;
+  }
+  if ((esp_timer_get_time() / 1000) - startMs > NUKI_SEMAPHORE_TIMEOUT) {
+    ESP_LOGD("NukiBle", "exec flow FAILED to take Nuki semaphore. Owner %s", owner.c_str());
+    return Nuki::CmdResult::Failed;
+  }
+  return Nuki::CmdResult::Working;
+}
+
+NukiBle::FlowOwnership::FlowOwnership(NukiBle* ble, SemaphoreHandle_t wakeSemaphore)
+  : ble(ble) {
+  ble->flowWakeSemaphore = wakeSemaphore;
+}
+
+NukiBle::FlowOwnership::~FlowOwnership() {
+  if (!owned) {
+    return;
+  }
+  // destroyed in the middle of the exchange
+  ble->abandonExchange((ble->nukiCommandState != CommandState::Idle
+                        && ble->nukiCommandState != CommandState::ChallengeRespReceived)
+                       || ble->listState == ListState::Receiving);
+  release();
+  ble->giveNukiBleSemaphore();
+}
+
+void NukiBle::FlowOwnership::release() {
+  owned = false;
+  ble->flowWakeSemaphore = nullptr;
+  ble->flowActive = false;
+}
+#endif
+
 int NukiBle::getRssi() const {
   return rssi;
 }
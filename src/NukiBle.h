@@ -14,6 +14,13 @@
 #include "NimBLEDevice.h"
 #include "NukiConstants.h"
 #include "NukiDataTypes.h"
+#include "NukiResourceProfiler.h"
+#include "NukiRetryPolicy.h"
+#include "NukiRttEstimator.h"
+#include "NukiScanCoordinator.h"
+#include "NukiSessionRecorder.h"
+#include "NukiCommandWorker.h"
+#include "NukiCommandFlow.h"
 
 #include <Preferences.h>
 #include <BleInterfaces.h>
@@ -25,15 +32,44 @@
 #include "esp_timer.h"
 
 #include <atomic>
+#include <functional>
+#include <future>
 #include <list>
+#include <map>
+#include <memory>
 #include <cstdint>
 #include <cstring>
 #include <string>
+#include <vector>
 
 #define GENERAL_TIMEOUT 3000
 #define CMD_TIMEOUT 10000
 #define PAIRING_TIMEOUT 30000
 #define HEARTBEAT_TIMEOUT 30000
+// longest wait for a message of the lock in executeAction() before the state machine and the WDT are serviced
+#define MESSAGE_WAIT_TIMEOUT 1000
+// longest wait of a command with a CancellationToken before it checks the token
+#define CANCEL_CHECK_INTERVAL 100
+// a flow waiting for a lock used by another task or flow checks this often whether it is free
+#define FLOW_ACQUIRE_INTERVAL 10
+// bounds of the timeouts derived from measured durations, see setAdaptiveTimeouts()
+#define ADAPTIVE_CHALLENGE_TIMEOUT_MIN 1000
+#define ADAPTIVE_CONNECT_TIMEOUT_MIN 500
+#define ADAPTIVE_CONNECT_TIMEOUT_MAX 5000
+// keep-connected mode (see setKeepConnected()): longest silence on a kept connection, the lock drops an idle
+// connection after about 20 s
+#define KEEP_CONNECTED_KEEPALIVE_INTERVAL 10000
+// pause after a failed background reconnect
+#define KEEP_CONNECTED_RECONNECT_INTERVAL 5000
+// limit of a background reconnect, below NUKI_SEMAPHORE_TIMEOUT so a command of another task still gets the lock
+#define KEEP_CONNECTED_RECONNECT_TIMEOUT 800
+// link layer payload requested with data length extension (see ConnectionParameters)
+#define CONNECTION_MAX_DATA_LENGTH 251
+
+// the 2M PHY needs a BLE 5 controller, the one of the ESP32 is BLE 4.2
+#if defined(CONFIG_IDF_TARGET_ESP32) && !defined(NUKI_NO_2M_PHY)
+#define NUKI_NO_2M_PHY
+#endif
 
 #ifdef CONFIG_IDF_TARGET_ESP32P4
 typedef enum {
@@ -108,6 +144,72 @@ class NukiBle : public BLEClientCallbacks, public BleScanner::Subscriber {
      */
     void updateConnectionState();
 
+    /**
+     * @brief Connects to the lock and subscribes to its messages ahead of a command without sending one, e.g.
+     * when a presence sensor fires, so the command that follows only pays the encrypted exchange. With
+     * setChallengePrefetch(true) the challenge of that command is requested as well. The connection is released
+     * by updateConnectionState() after the disconnect timeout like after a command. Blocks until connected.
+     *
+     * @return Success once connected, Failed if the lock could not be reached, NotPaired without credentials
+     */
+    Nuki::CmdResult warmUp();
+
+    /**
+     * @brief warmUp() on the command worker, returns right away (see submit())
+     *
+     * @return false if it could not be queued
+     */
+    bool prepare();
+
+    /**
+     * @brief Calls prepare() when an advertisement of the lock starts to flag a state change, i.e. someone
+     * operated it and the application is likely to request its state. Disabled by default. The scan callback
+     * only flags the warm-up, the next updateConnectionState() queues it.
+     */
+    void setWarmUpOnStatusChange(bool enable);
+
+    /**
+     * @brief Keeps the connection to the lock open between commands, so a command skips connect, service
+     * discovery and subscription. updateConnectionState() (which has to run in a loop or task then) sends a
+     * challenge request every KEEP_CONNECTED_KEEPALIVE_INTERVAL while no command is sent, so the lock does not
+     * drop the connection, and reconnects on the command worker when it was dropped anyway. The challenge is
+     * used by the next challenged command like a prefetched one (see setChallengePrefetch()).
+     * Costs battery of the lock, disabled by default.
+     *
+     * @param idleBudgetMs Time without commands after which the connection is released to the disconnect
+     * timeout again (until the next command), 0 to hold it until the mode is disabled
+     */
+    void setKeepConnected(bool enable, uint32_t idleBudgetMs = 0);
+
+    /**
+     * @brief Connection state, uptime and counters since construction
+     */
+    ConnectionStatistics getConnectionStatistics() const;
+
+    /**
+     * @brief Selects the connection parameters requested on the following connects (Balanced by default),
+     * updateConnectionParameters() applies them to the current connection
+     */
+    void setConnectionProfile(const ConnectionProfile profile);
+
+    /**
+     * @brief Custom connection parameters, used like a profile
+     *
+     * @return false if the parameters are out of range, the previous ones are kept then
+     */
+    bool setConnectionParameters(const ConnectionParameters& parameters);
+
+    ConnectionParameters getConnectionParameters();
+
+    /**
+     * @brief Asks the lock to switch the current connection to the parameters set by setConnectionProfile() or
+     * setConnectionParameters(), e.g. LowLatency for the commands of a session and LowPower while the
+     * connection idles in keep-connected mode. The lock applies them a few connection events later.
+     *
+     * @return CmdResult::Success if requested, CmdResult::Failed if not connected or the request failed
+     */
+    CmdResult updateConnectionParameters();
+
     /**
      * @brief Set the BLE Disconnect Timeout, if longer than ~20 sec the lock will disconnect by itself
      * if there is no BLE communication
@@ -172,7 +274,7 @@ class NukiBle : public BLEClientCallbacks, public BleScanner::Subscriber {
     uint16_t getKeypadEntryCount();
 
     /**
-     * @brief Request the lock via BLE to send the existing keypad entries
+     * @brief Request the lock via BLE to send the existing keypad entries, returns once all of them were received
      *
      * @param offset The start offset to be read.
      * @param count The number of entries to be read, starting at the specified offset.
@@ -194,7 +296,8 @@ class NukiBle : public BLEClientCallbacks, public BleScanner::Subscriber {
     Nuki::CmdResult deleteKeypadEntry(uint16_t id);
 
     /**
-     * @brief Request the lock via BLE to send the existing authorizationentries
+     * @brief Request the lock via BLE to send the existing authorizationentries, returns once all of them were
+     * received
      *
      * @param offset The start offset to be read.
      * @param count The number of entries to be read, starting at the specified offset.
@@ -316,6 +419,7 @@ class NukiBle : public BLEClientCallbacks, public BleScanner::Subscriber {
     /**
      * @brief Registers the BLE scanner to be used for scanning for advertisements from the lock.
      * BleScanner::Publisher is defined in dependent library https://github.com/I-Connect/BleScanner.git
+     * Instances registered with the same scanner suspend scanning and connect in turn, see setMinScanWindow().
      *
      * @param bleScanner the publisher of the BLE scanner
      */
@@ -383,6 +487,178 @@ class NukiBle : public BLEClientCallbacks, public BleScanner::Subscriber {
      * @param enable Set to true to enable command debug logging
      */
     void setDebugCommand(bool enable);
+
+    /**
+     * @brief Registers a recorder receiving every message exchanged with the lock, nullptr stops recording
+     *
+     * @param recorder e.g. a SessionFileRecorder, must outlive the registration
+     */
+    void setSessionRecorder(SessionRecorder* recorder);
+
+    /**
+     * @brief Handles a message as if it was received from the lock, used to replay recorded sessions
+     *
+     * @param returnCode Command identifier of the message
+     * @param data Payload (decrypted, without command identifier and CRC)
+     * @param dataLen Payload length
+     */
+    void replayReturnMessage(Command returnCode, unsigned char* data, uint16_t dataLen);
+
+    /**
+     * @brief Registers a profiler measuring stack and heap use of every command, nullptr stops profiling
+     *
+     * @param profiler must outlive the registration, see NukiResourceProfiler.h
+     */
+    void setResourceProfiler(ResourceProfiler* profiler);
+
+    /**
+     * @brief Runs a call on the command worker task of this instance and returns without waiting for it,
+     * e.g. submit([&]() { return nukiLock.lockAction(LockAction::Unlock); }, [](CmdResult result) { ... },
+     * CommandPriority::LockAction);
+     * The worker is started with the default settings by the first call, see startCommandWorker()
+     *
+     * @param call Blocking call of this instance (output parameters have to outlive it)
+     * @param callback Gets the result on the worker task, may be nullptr
+     * @param priority Queued calls run by priority, then in submission order
+     * @param timeoutMs Longest time the call may wait in the queue (CmdResult::TimeOut), 0 for no limit
+     * @param token Cancels the call (CmdResult::Cancelled), queued or running, see CommandLimits
+     * @return false if the queue (NUKI_WORKER_QUEUE_SIZE) is full of calls at least as urgent or the worker
+     * could not be started, the callback is not called then
+     */
+    bool submit(CommandCall call, CommandCallback callback, const CommandPriority priority = CommandPriority::StateQuery,
+                const uint32_t timeoutMs = 0, const CancellationToken& token = CancellationToken::none());
+
+    /**
+     * @brief Like submit(call, callback, ...), the result is delivered through the returned future
+     * (CmdResult::Failed right away if the call could not be queued)
+     */
+    std::future<CmdResult> submit(CommandCall call, const CommandPriority priority = CommandPriority::StateQuery,
+                                  const uint32_t timeoutMs = 0, const CancellationToken& token = CancellationToken::none());
+
+    /**
+     * @brief Runs a call through the queue of the command worker and waits for its result. Unlike a direct call,
+     * which fails after NUKI_SEMAPHORE_TIMEOUT while another task holds the lock, it waits for its turn by
+     * priority. Called from the worker task (a callback) the call runs right away.
+     */
+    CmdResult executeQueued(CommandCall call, const CommandPriority priority = CommandPriority::StateQuery,
+                            const uint32_t timeoutMs = 0, const CancellationToken& token = CancellationToken::none());
+
+    /**
+     * @brief Pins the BLE connection until the matching endSession(): updateConnectionState() does not
+     * disconnect on the disconnect timeout, so the connection and subscription of the first command are used by
+     * the following ones. Sessions nest and apply to the commands of every task.
+     */
+    void beginSession();
+
+    /**
+     * @brief Releases the connection pinned by beginSession(), the disconnect timeout starts again
+     *
+     * @param disconnect Disconnect right away instead, e.g. to let the lock advertise its new state
+     */
+    void endSession(bool disconnect = false);
+
+    /**
+     * @brief Runs calls of this instance one after the other in a session (one connection and subscription),
+     * e.g. runSession({[&]() { return nukiLock.lockAction(LockAction::Lock); },
+     *                  [&]() { return nukiLock.requestKeyTurnerState(&state); }}, &results);
+     *
+     * @param calls Blocking calls of this instance
+     * @param results Gets the result of every call that was run, in order, may be nullptr
+     * @param stopOnError Do not run the calls following a call that did not succeed
+     * @return CmdResult::Success if every call succeeded, otherwise the first other result
+     */
+    CmdResult runSession(const std::vector<CommandCall>& calls, std::vector<CmdResult>* results = nullptr,
+                         bool stopOnError = false);
+
+    /**
+     * @brief Whether identical read-only requests (states, battery report, config, advanced config) share one
+     * exchange with the lock: a request made while the same request is in flight on another task waits for it
+     * and gets its result, a call queued on the command worker reuses the result of an exchange started after
+     * it was submitted. Disabled by default.
+     */
+    void setRequestCoalescing(bool enable);
+
+    /**
+     * @brief Number of requests answered by the exchange of another request since construction
+     */
+    uint32_t getCoalescedRequestCount() const;
+
+    /**
+     * @brief Whether a command that succeeded requests the challenge of the next command from the lock right
+     * away, while the connection is still up. A challenged command (lock action, config write, keypad /
+     * authorization change, log request, ...) following it skips its own challenge round trip. The prefetched
+     * challenge is dropped on a disconnect, an error report, a command without challenge and by (un)pairing.
+     * Costs an exchange after the last command of a batch, disabled by default.
+     */
+    void setChallengePrefetch(bool enable);
+
+    /**
+     * @brief Number of challenged commands that used a prefetched challenge since construction
+     */
+    uint32_t getPrefetchedChallengeCount() const;
+
+    /**
+     * @brief Whether the challenge and connect timeouts follow the durations measured with this lock (disabled
+     * by default). Once enough samples were taken, the state machines wait for a challenge the smoothed round
+     * trip time plus four deviations (at least ADAPTIVE_CHALLENGE_TIMEOUT_MIN, at most CMD_TIMEOUT), doubled
+     * after every challenge timeout until the next answer. A connect attempt gets the connect time estimate
+     * (ADAPTIVE_CONNECT_TIMEOUT_MIN to ADAPTIVE_CONNECT_TIMEOUT_MAX), the number of attempts is adjusted so the
+     * attempts take about as long as setConnectRetries() attempts of setConnectTimeout(): a lock with a good link
+     * fails fast and is retried more often, a lock at the edge of range gets longer attempts. The answers to the
+     * commands themselves, which take as long as the lock needs for them, always get CMD_TIMEOUT. Disabled, the
+     * fixed CMD_TIMEOUT and setConnectTimeout() / setConnectRetries() are used.
+     */
+    void setAdaptiveTimeouts(bool enable);
+
+    /**
+     * @brief Durations measured with this lock since construction
+     */
+    TimingEstimates getTimingEstimates();
+
+    /**
+     * @brief Decides whether and after which delay a failed connect attempt is repeated, within the attempts of
+     * setConnectRetries() (see setAdaptiveTimeouts()) and the deadline of the command. nullptr restores the
+     * default BackoffRetryPolicy. The policy is called on the task of the command and has to outlive its use.
+     */
+    void setRetryPolicy(RetryPolicy* policy);
+
+    /**
+     * @brief Failed connect attempts by cause, retries and backoff since construction
+     */
+    RetryStatistics getRetryStatistics();
+
+    /**
+     * @brief Scanning suspended for connects, and connects that waited for a scan window or for the connect of
+     * another instance, since the first instance registered the BLE scanner. Shared by all instances registered
+     * with the same scanner, see registerBleScanner().
+     */
+    ScanStatistics getScanStatistics();
+
+    /**
+     * @brief Sets how long scanning runs at least between two connects of the instances registered with the
+     * same BLE scanner (default SCAN_MIN_WINDOW ms), so beacons are not missed while several locks connect in turn
+     *
+     * @param windowMs minimum scan window in ms, 0 to connect right away
+     */
+    void setMinScanWindow(const uint32_t windowMs);
+
+    /**
+     * @brief Starts the command worker task, without effect if it is running
+     *
+     * @param stackSize Stack of the task in bytes, has to fit the deepest command and the callbacks
+     * @param priority FreeRTOS priority of the task
+     * @param coreId Core of the task, tskNO_AFFINITY for any
+     */
+    void startCommandWorker(const uint32_t stackSize = NUKI_WORKER_STACK_SIZE,
+                            const UBaseType_t priority = NUKI_WORKER_PRIORITY,
+                            const BaseType_t coreId = tskNO_AFFINITY);
+
+    /**
+     * @brief Waits for the running call of the worker, completes the queued ones with CmdResult::Failed and
+     * ends the task (also done on destruction). Called from a call or callback of the worker (e.g. by deleting
+     * the instance there), the task ends once the callback returned.
+     */
+    void stopCommandWorker();
     
   protected:
     bool connectBle(const BLEAddress bleAddress, bool pairing);
@@ -394,6 +670,24 @@ class NukiBle : public BLEClientCallbacks, public BleScanner::Subscriber {
     template <typename TDeviceAction>
     Nuki::CmdResult executeAction(const TDeviceAction action);
 
+    /**
+     * @brief Runs the exchange of a read-only request unless it can share the one of an identical request,
+     * see setRequestCoalescing(). The data of the request is in the members afterwards in both cases.
+     *
+     * @param request Identifies the request, e.g. the requested command
+     * @param exchange Sends the request and waits for the answer (executeAction)
+     */
+    Nuki::CmdResult coalesceRequest(const Command request, const std::function<Nuki::CmdResult()>& exchange);
+
+    #ifdef NUKI_COMMAND_FLOWS
+    /**
+     * @brief executeAction() as a flow for a CommandLoop, it suspends instead of blocking while it waits for the
+     * lock to answer or to be free. Read-only requests are not shared with concurrent ones (setRequestCoalescing).
+     */
+    template <typename TDeviceAction>
+    Nuki::CommandFlow executeActionFlow(const TDeviceAction action);
+    #endif
+
     template <typename TDeviceAction>
     Nuki::CmdResult cmdStateMachine(const TDeviceAction action);
 
@@ -429,6 +723,215 @@ class NukiBle : public BLEClientCallbacks, public BleScanner::Subscriber {
     std::string owner = "free";
     void giveNukiBleSemaphore();
 
+    // exchange of a read-only request, waiters take and give back done once result is set
+    struct SharedRequest {
+      SemaphoreHandle_t done = xSemaphoreCreateBinary();
+      Nuki::CmdResult result = Nuki::CmdResult::Failed;
+      uint32_t generation = 0;
+      // the result came from the deadline or cancellation of the task that made the exchange
+      bool ownerLimited = false;
+      ~SharedRequest() {
+        vSemaphoreDelete(done);
+      }
+    };
+    bool coalesceRequests = false;
+    std::atomic_uint coalescedRequestCount{0};
+    std::map<Command, std::shared_ptr<SharedRequest>> inFlightRequests;
+    // start of the last successful exchange per request
+    std::map<Command, int64_t> lastRequestStartUs;
+    // incremented by every command which is not a read-only request, older results are not shared anymore
+    std::atomic_uint requestGeneration{0};
+    uint32_t lastRequestGeneration = 0;
+    SemaphoreHandle_t requestSemaphore = xSemaphoreCreateMutex();
+
+    // Pending: challenge requested after a command, Ready: received, Dropped: the answer is still to come
+    // but not to be used
+    enum class PrefetchState : uint8_t {
+      None,
+      Pending,
+      Ready,
+      Dropped
+    };
+    bool challengePrefetch = false;
+    std::atomic<PrefetchState> prefetchState{PrefetchState::None};
+    int64_t prefetchSentMs = 0;
+    unsigned char prefetchedChallenge[32] = {0x00};
+    std::atomic_uint prefetchedChallengeCount{0};
+    void prefetchChallenge();
+    bool takePrefetchedChallenge(const bool challenged, const bool wait);
+    bool handlePrefetchAnswer(Command returnCode, unsigned char* data, uint16_t dataLen);
+
+    // Receiving: entries of a list request still to come, Draining: all entries received, the closing status
+    // may still come (also after the next command was sent)
+    enum class ListState : uint8_t {
+      None,
+      Receiving,
+      Draining
+    };
+    std::atomic<ListState> listState{ListState::None};
+    Command listCountCommand = Command::Empty;
+    Command listEntryCommand = Command::Empty;
+    uint16_t listRequestedCount = 0;
+    // -1 if the number of entries sent does not follow from the count (log entries from a given index)
+    int32_t listOffset = 0;
+    std::atomic_int listExpectedCount{-1};
+    std::atomic_int listReceivedCount{0};
+    std::atomic_bool listFailed{false};
+    // a list request was sent while the closing status of the previous one was still due
+    std::atomic_bool listDropClose{false};
+    std::atomic_llong listLastMessageMs{0};
+    void beginListRequest(const Command command, const unsigned char* payload);
+    // the list request of the current command failed or there is none
+    void endListRequest();
+    // Working while entries are still to come
+    Nuki::CmdResult checkListEntries();
+    uint32_t listWaitMs();
+    Nuki::CmdResult waitForListEntries();
+    bool handleListAnswer(Command returnCode, unsigned char* data, uint16_t dataLen);
+
+    std::atomic_int sessionDepth{0};
+
+    std::atomic_bool keepConnected{false};
+    uint32_t keepConnectedIdleBudgetMs = 0;
+    // start of the last command, the idle budget of the keep-connected mode counts from it
+    std::atomic_llong lastCommandMs{0};
+    std::atomic_bool reconnectQueued{false};
+    int64_t lastReconnectMs = 0;
+    // false once the idle budget is used up, the connection is left to the disconnect timeout then
+    bool updateKeptConnection();
+    void sendKeepAlive();
+    Nuki::CmdResult reconnect();
+
+    std::atomic_llong connectedSinceMs{0};
+    std::atomic<uint64_t> pastUptimeMs{0};
+    std::atomic_uint connectCount{0};
+    std::atomic_uint disconnectCount{0};
+    std::atomic_uint reconnectCount{0};
+    std::atomic_uint keepAliveCount{0};
+    std::atomic_uint discoveryMs{0};
+
+    std::atomic_bool warmUpQueued{false};
+    bool warmUpOnStatusChange = false;
+    // set by onResult(), taken by updateConnectionState()
+    std::atomic_bool warmUpRequested{false};
+
+    CommandWorker* commandWorker = nullptr;
+    SemaphoreHandle_t commandWorkerSemaphore = xSemaphoreCreateMutex();
+
+    // given for every message of the lock, wakes executeAction()
+    SemaphoreHandle_t messageSemaphore = xSemaphoreCreateBinary();
+    uint32_t messageWaitMs();
+    void waitForMessage();
+    // gives up the exchange in progress on a deadline or cancellation, see CommandLimits
+    void abandonExchange(const bool answersPending);
+
+    // steps of executeAction() and executeActionFlow() around the exchange, the semaphore is held in between.
+    // A flow checks the preconditions with the semaphore taken, the loop running it may hold it for another flow.
+    Nuki::CmdResult checkActionPreconditions(const bool semaphoreTaken = false);
+    void startAction(const Command command, const unsigned char* payload, const bool challenged,
+                     const bool waitForPrefetch);
+    Nuki::CmdResult endAction(const Nuki::CmdResult result);
+
+    // what the exchange waits for after a message was sent
+    enum class ExpectedAnswer : uint8_t {
+      Challenge,
+      // any answer to a plain request
+      Message,
+      // any answer with a valid CRC
+      ValidMessage,
+      // accepted status, or the complete status of an action the lock skipped
+      Accepted,
+      Complete
+    };
+    bool sendExchangeMessage(const Command command, const unsigned char* payload, const uint8_t payloadLen,
+                             const CommandState nextState);
+    bool sendChallengeRequest();
+    template <typename TDeviceAction>
+    bool sendActionCommand(const TDeviceAction& action, const bool sendPinCode);
+    /**
+     * @brief Working until the expected answer came (the state of the exchange advances to the next step) or the
+     * exchange is over: Success after its last answer, otherwise TimeOut, Failed or Lock_Busy
+     */
+    Nuki::CmdResult checkAnswer(const ExpectedAnswer expected);
+    Nuki::CmdResult failCommand(const Nuki::CmdResult result, const char* message, const int level = 4);
+
+    #ifdef NUKI_COMMAND_FLOWS
+    template <typename TDeviceAction>
+    Nuki::CommandFlow exchangeFlow(const TDeviceAction action);
+    // Success once the expected answer came, see checkAnswer()
+    Nuki::CommandFlow answerFlow(const ExpectedAnswer expected);
+    // Working while the semaphore is taken by another task or flow
+    Nuki::CmdResult takeFlowOwnership(const int64_t startMs);
+
+    // a flow holding the semaphore, frees it if the flow is destroyed before its end
+    class FlowOwnership {
+      public:
+        FlowOwnership(NukiBle* ble, SemaphoreHandle_t wakeSemaphore);
+        ~FlowOwnership();
+        // the flow ends normally, endAction() gives the semaphore
+        void release();
+
+      private:
+        NukiBle* ble;
+        bool owned = true;
+    };
+    std::atomic_bool flowActive{false};
+    // wakes the CommandLoop of the flow holding the semaphore for every message of the lock
+    std::atomic<SemaphoreHandle_t> flowWakeSemaphore{nullptr};
+    #endif
+
+    bool adaptiveTimeouts = false;
+    RttEstimator connectEstimator;
+    RttEstimator challengeEstimator;
+    RttEstimator completionEstimator;
+    // send time of the challenge request the last sample was taken for
+    int64_t challengeSampleSentMs = 0;
+    // the last challenge request timed out, the answer to the next one may be its late answer
+    bool challengeRetried = false;
+    // accepted status of the running lock action, and its duration once the complete status came
+    std::atomic_llong acceptedMs{0};
+    std::atomic_llong completionSampleMs{-1};
+    // the estimators are read by getTimingEstimates() on any task
+    SemaphoreHandle_t estimatorSemaphore = xSemaphoreCreateMutex();
+
+    BackoffRetryPolicy defaultRetryPolicy;
+    std::atomic<RetryPolicy*> retryPolicy{&defaultRetryPolicy};
+    RetryStatistics retryStatistics;
+    // read by getRetryStatistics() on any task
+    SemaphoreHandle_t retryStatisticsSemaphore = xSemaphoreCreateMutex();
+    // cause of the last failure of registerOnGdioChar() / registerOnUsdioChar()
+    ConnectFailure registerFailure = ConnectFailure::Discovery;
+    // last connect or disconnect, the lock was present then without advertising
+    std::atomic_llong lastLinkMs{0};
+    // nothing was received from the (paired) lock for HEARTBEAT_TIMEOUT
+    bool lockSilent(const bool pairing);
+    // counts the failed attempt and waits as the retry policy decides, false to stop connecting
+    bool retryConnect(const ConnectFailure failure, const uint8_t failedAttempts, const uint8_t attempts,
+                      const bool pairing);
+
+    // shared by the instances registered with the same BLE scanner
+    std::shared_ptr<ScanCoordinator> scanCoordinator;
+    // this instance holds a suspension of scanning
+    bool scanSuspended = false;
+    void suspendScanning();
+    void resumeScanning();
+    // connects the client in the turn of this instance, NimBLE runs one connect procedure at a time
+    bool connectClient(const BLEAddress& bleAddress);
+
+    ConnectionParameters connectionParameters;
+    // the parameters are set on any task and read before every connect
+    SemaphoreHandle_t connectionParametersSemaphore = xSemaphoreCreateMutex();
+    // sets the interval, latency and supervision timeout the next connect of the client requests
+    void applyConnectionParameters(BLEClient* client);
+    // asks for the 2M PHY and data length extension on a connected client
+    void requestLinkOptions(BLEClient* client, const ConnectionParameters& parameters);
+    uint32_t commandStateTimeout();
+    uint32_t connectAttemptTimeout();
+    uint8_t connectAttempts(const uint32_t attemptTimeoutMs);
+    void addConnectSample(const int64_t startMs);
+    void addChallengeSample();
+    void takeCompletionSample();
+
     bool altConnect = false;
     bool connecting = false;
     bool statusUpdated = false;
@@ -446,15 +949,24 @@ class NukiBle : public BLEClientCallbacks, public BleScanner::Subscriber {
     void onDisconnect(BLEClient*, int reason) override;
     void disconnect();
     void onResult(const BLEAdvertisedDevice* advertisedDevice) override;
+    // subscribes to the characteristic the messages of a command (pairing: GDIO, otherwise USDIO) arrive on,
+    // unless this connection already did
+    bool subscribeFor(const bool pairing);
     bool registerOnGdioChar();
     bool registerOnUsdioChar();
+    // subscriptions made on the current connection, reset by onDisconnect()
+    std::atomic_bool gdioSubscribed{false};
+    std::atomic_bool usdioSubscribed{false};
 
     bool sendPlainMessage(Command commandIdentifier, const unsigned char* payload, const uint8_t payloadLen);
     bool sendEncryptedMessage(Command commandIdentifier, const unsigned char* payload, const uint8_t payloadLen);
 
     void notifyCallback(BLERemoteCharacteristic* pBLERemoteCharacteristic, uint8_t* pData, size_t length, bool isNotify);
+    void recordFrame(FrameDirection direction, Command command, const unsigned char* data, uint16_t dataLen);
     void saveCredentials();
     bool retrieveCredentials();
+    // retrieveCredentials() with the semaphore taken by the caller
+    bool readCredentials();
     void deleteCredentials();
     Nuki::PairingState pairStateMachine(const Nuki::PairingState nukiPairingState);
     Nuki::PairingState nukiPairingResultState = Nuki::PairingState::InitPairing;
@@ -493,7 +1005,9 @@ class NukiBle : public BLEClientCallbacks, public BleScanner::Subscriber {
     BleScanner::Publisher* bleScanner = nullptr;
     bool isPaired = false;
 
-    Nuki::SmartlockEventHandler* eventHandler;
+    Nuki::SmartlockEventHandler* eventHandler = nullptr;
+    Nuki::SessionRecorder* sessionRecorder = nullptr;
+    Nuki::ResourceProfiler* resourceProfiler = nullptr;
 
     uint8_t receivedStatus;
     bool crcCheckOke;
@@ -510,8 +1024,6 @@ class NukiBle : public BLEClientCallbacks, public BleScanner::Subscriber {
     unsigned char sentNonce[crypto_secretbox_NONCEBYTES] = {};
 
     uint16_t nrOfKeypadCodes = 0;
-    uint8_t nrOfReceivedKeypadCodes = 0;
-    bool keypadCodeCountReceived = false;
     uint16_t logEntryCount = 0;
     bool loggingEnabled = false;
     std::atomic_int rssi;
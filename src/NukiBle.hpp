@@ -11,34 +11,31 @@
 namespace Nuki {
 template<typename TDeviceAction>
 Nuki::CmdResult NukiBle::executeAction(const TDeviceAction action) {
-  if (!altConnect) {
-    if ((esp_timer_get_time() / 1000) - lastHeartbeat > HEARTBEAT_TIMEOUT) {
-      logMessage("Lock Heartbeat timeout, command failed", 1);
-      return Nuki::CmdResult::Error;
-    }
-  }
-  if (debugNukiConnect) {
-    logMessage("************************ CHECK PAIRED ************************");
-  }
-  if (retrieveCredentials()) {
-    if (debugNukiConnect) {
-      logMessage("Credentials retrieved from preferences, ready for commands");
-    }
-  } else {
-    if (debugNukiConnect) {
-      logMessage("Credentials NOT retrieved from preferences, first pair with the lock");
-    }
-    return Nuki::CmdResult::NotPaired;
+  Nuki::CmdResult limitResult = checkActionPreconditions();
+  if (limitResult != Nuki::CmdResult::Success) {
+    return limitResult;
   }
 
   if (takeNukiBleSemaphore("exec Action")) {
+    ProfiledScope profiledScope(resourceProfiler, ProfiledCall::ExecuteAction, action.command);
     if (debugNukiCommunication) {
       logMessageVar("Start executing", (unsigned int)action.command);
     }
+    startAction(action.command, action.payload, action.cmdType != Nuki::CommandType::Command, true);
 
     while (1) {
+      limitResult = CommandLimits::check();
+      if (limitResult != Nuki::CmdResult::Success) {
+        logMessage(limitResult == Nuki::CmdResult::Cancelled ? "************************ COMMAND CANCELLED ************************"
+                                                              : "************************ COMMAND DEADLINE PASSED ************************", 2);
+        abandonExchange(nukiCommandState == CommandState::ChallengeSent || nukiCommandState == CommandState::CmdSent
+                        || nukiCommandState == CommandState::CmdAccepted);
+        giveNukiBleSemaphore();
+        return limitResult;
+      }
       extendDisconnectTimeout();
-      
+
+      CommandState previousState = nukiCommandState;
       Nuki::CmdResult result;
       if (action.cmdType == Nuki::CommandType::Command) {
         result = cmdStateMachine(action);
@@ -59,93 +56,42 @@ Nuki::CmdResult NukiBle::executeAction(const TDeviceAction action) {
         return Nuki::CmdResult::Failed;
       }
       if (result != Nuki::CmdResult::Working) {
-        giveNukiBleSemaphore();
-
-        if (altConnect && (result == Nuki::CmdResult::Error || result == Nuki::CmdResult::Failed)) {
-          disconnect();
+        if (result == Nuki::CmdResult::Success) {
+          // the first message of a list request completes the command, wait for the rest of the list
+          result = waitForListEntries();
+        } else {
+          endListRequest();
         }
-        return result;
+        return endAction(result);
       }
       #ifndef NUKI_NO_WDT_RESET
       esp_task_wdt_reset();
       #endif
-      vTaskDelay(pdMS_TO_TICKS(10));
+      if (nukiCommandState == previousState) {
+        // nothing to do until the lock answers or the state times out
+        waitForMessage();
+      }
     }
   }
-  return Nuki::CmdResult::Failed;
+  limitResult = CommandLimits::check();
+  return limitResult != Nuki::CmdResult::Success ? limitResult : Nuki::CmdResult::Failed;
 }
 
 template <typename TDeviceAction>
 Nuki::CmdResult NukiBle::cmdStateMachine(const TDeviceAction action) {
-  extendDisconnectTimeout();  
+  extendDisconnectTimeout();
   switch (nukiCommandState) {
     case CommandState::Idle: {
-      if (debugNukiCommunication) {
-        logMessageVar("************************ SENDING COMMAND ************************", (unsigned int)action.command);
-      }
-      lastMsgCodeReceived = Command::Empty;
-
-      if (sendEncryptedMessage(Command::RequestData, action.payload, action.payloadLen)) {
-        timeNow = (esp_timer_get_time() / 1000);
-        nukiCommandState = CommandState::CmdSent;
-      } else {
-        if (debugNukiCommunication) {
-          logMessage("************************ SENDING COMMAND FAILED ************************");
-        }
-        if (altConnect) {
-          disconnect();
-        }
-        nukiCommandState = CommandState::Idle;
-        lastMsgCodeReceived = Command::Empty;
+      if (!sendExchangeMessage(Command::RequestData, action.payload, action.payloadLen, CommandState::CmdSent)) {
         return Nuki::CmdResult::Failed;
       }
       break;
     }
     case CommandState::CmdSent: {
-      if ((esp_timer_get_time() / 1000) - timeNow > CMD_TIMEOUT) {
-        logMessage("************************ COMMAND FAILED TIMEOUT************************", 2);
-        if (altConnect) {
-          disconnect();
-        }
-        nukiCommandState = CommandState::Idle;
-        return Nuki::CmdResult::TimeOut;
-      } else if (lastMsgCodeReceived != Command::ErrorReport && lastMsgCodeReceived != Command::Empty) {
-        if (debugNukiCommunication) {
-          logMessage("************************ COMMAND DONE ************************");
-        }
-        nukiCommandState = CommandState::Idle;
-        lastMsgCodeReceived = Command::Empty;
-        return Nuki::CmdResult::Success;
-      } else if (lastMsgCodeReceived == Command::ErrorReport && errorCode != 69) {
-        if (debugNukiCommunication) {
-          logMessage("************************ COMMAND FAILED ************************");
-        }
-        if (altConnect) {
-          disconnect();
-        }
-        nukiCommandState = CommandState::Idle;
-        lastMsgCodeReceived = Command::Empty;
-        return Nuki::CmdResult::Failed;
-      } else if (lastMsgCodeReceived == Command::ErrorReport && errorCode == 69) {
-        if (debugNukiCommunication) {
-          logMessage("************************ COMMAND FAILED LOCK BUSY ************************");
-        }
-        if (altConnect) {
-          disconnect();
-        }
-        nukiCommandState = CommandState::Idle;
-        lastMsgCodeReceived = Command::Empty;
-        return Nuki::CmdResult::Lock_Busy;
-      }
+      return checkAnswer(ExpectedAnswer::Message);
     }
-    break;
     default: {
-      logMessage("Unknown request command state", 2);
-      if (altConnect) {
-        disconnect();
-      }
-      return Nuki::CmdResult::Failed;
-      break;
+      return failCommand(Nuki::CmdResult::Failed, "Unknown request command state", 2);
     }
   }
   return Nuki::CmdResult::Working;
@@ -156,134 +102,25 @@ Nuki::CmdResult NukiBle::cmdChallStateMachine(const TDeviceAction action, const
   extendDisconnectTimeout();
   switch (nukiCommandState) {
     case CommandState::Idle: {
-      if (debugNukiCommunication) {
-        logMessage("************************ SENDING CHALLENGE ************************");
-      }
-      lastMsgCodeReceived = Command::Empty;
-      unsigned char payload[sizeof(Command)] = {0x04, 0x00};  //challenge
-
-      if (sendEncryptedMessage(Command::RequestData, payload, sizeof(Command))) {
-        timeNow = (esp_timer_get_time() / 1000);
-        nukiCommandState = CommandState::ChallengeSent;
-      } else {
-        if (debugNukiCommunication) {
-          logMessage("************************ SENDING CHALLENGE FAILED ************************");
-        }
-        if (altConnect) {
-          disconnect();
-        }
-        nukiCommandState = CommandState::Idle;
-        lastMsgCodeReceived = Command::Empty;
+      if (!sendChallengeRequest()) {
         return Nuki::CmdResult::Failed;
       }
       break;
     }
     case CommandState::ChallengeSent: {
-      if (debugNukiCommunication) {
-        logMessage("************************ RECEIVING CHALLENGE RESPONSE************************");
-      }
-      if ((esp_timer_get_time() / 1000) - timeNow > CMD_TIMEOUT) {
-        logMessage("************************ COMMAND FAILED TIMEOUT ************************", 2);
-        if (altConnect) {
-          disconnect();
-        }
-        nukiCommandState = CommandState::Idle;
-        return Nuki::CmdResult::TimeOut;
-      } else if (lastMsgCodeReceived == Command::Challenge) {
-        nukiCommandState = CommandState::ChallengeRespReceived;
-        lastMsgCodeReceived = Command::Empty;
-      }
-      break;
+      return checkAnswer(ExpectedAnswer::Challenge);
     }
     case CommandState::ChallengeRespReceived: {
-      if (debugNukiCommunication) {
-        logMessageVar("************************ SENDING COMMAND ************************", (unsigned int)action.command);
-      }
-      lastMsgCodeReceived = Command::Empty;
-      crcCheckOke = false;
-      //add received challenge nonce to payload
-      uint8_t payloadLen = action.payloadLen + sizeof(challengeNonceK);
-      if (sendPinCode) {
-        if (isLockUltra()) {
-          payloadLen = payloadLen + 4;  
-        } else {
-          payloadLen = payloadLen + 2;
-        }
-      }
-      unsigned char payload[payloadLen];
-      memcpy(payload, action.payload, action.payloadLen);
-      memcpy(&payload[action.payloadLen], challengeNonceK, sizeof(challengeNonceK));
-      if (sendPinCode) {
-        if (isLockUltra()) {
-          memcpy(&payload[action.payloadLen + sizeof(challengeNonceK)], &ultraPinCode, 4);
-        } else {
-          memcpy(&payload[action.payloadLen + sizeof(challengeNonceK)], &pinCode, 2);
-        }        
-      }
-
-      if (sendEncryptedMessage(action.command, payload, payloadLen)) {
-        timeNow = (esp_timer_get_time() / 1000);
-        nukiCommandState = CommandState::CmdSent;
-      } else {
-        if (debugNukiCommunication) {
-          logMessage("************************ SENDING COMMAND FAILED ************************");
-        }
-        if (altConnect) {
-          disconnect();
-        }
-        nukiCommandState = CommandState::Idle;
-        lastMsgCodeReceived = Command::Empty;
+      if (!sendActionCommand(action, sendPinCode)) {
         return Nuki::CmdResult::Failed;
       }
       break;
     }
     case CommandState::CmdSent: {
-      if (debugNukiCommunication) {
-        logMessage("************************ RECEIVING DATA ************************");
-      }
-      if ((esp_timer_get_time() / 1000) - timeNow > CMD_TIMEOUT) {
-        logMessage("************************ COMMAND FAILED TIMEOUT ************************", 2);
-        if (altConnect) {
-          disconnect();
-        }
-        nukiCommandState = CommandState::Idle;
-        return Nuki::CmdResult::TimeOut;
-      } else if (lastMsgCodeReceived == Command::ErrorReport && errorCode != 69) {
-        if (debugNukiCommunication) {
-            logMessage("************************ SENDING COMMAND FAILED ************************");
-        }
-        if (altConnect) {
-          disconnect();
-        }
-        nukiCommandState = CommandState::Idle;
-        lastMsgCodeReceived = Command::Empty;
-        return Nuki::CmdResult::Failed;
-      } else if (lastMsgCodeReceived == Command::ErrorReport && errorCode == 69) {
-        if (debugNukiCommunication) {
-          logMessage("************************ COMMAND FAILED LOCK BUSY ************************");
-        }
-        if (altConnect) {
-          disconnect();
-        }
-        nukiCommandState = CommandState::Idle;
-        lastMsgCodeReceived = Command::Empty;
-        return Nuki::CmdResult::Lock_Busy;
-      } else if (crcCheckOke) {
-        if (debugNukiCommunication) {
-          logMessage("************************ DATA RECEIVED ************************");
-        }
-        nukiCommandState = CommandState::Idle;
-        return Nuki::CmdResult::Success;
-      }
-      break;
+      return checkAnswer(ExpectedAnswer::ValidMessage);
     }
     default:
-      logMessage("Unknown request command state", 2);
-      if (altConnect) {
-        disconnect();
-      }
-      return Nuki::CmdResult::Failed;
-      break;
+      return failCommand(Nuki::CmdResult::Failed, "Unknown request command state", 2);
   }
   return Nuki::CmdResult::Working;
 }
@@ -293,148 +130,131 @@ Nuki::CmdResult NukiBle::cmdChallAccStateMachine(const TDeviceAction action) {
   extendDisconnectTimeout();
   switch (nukiCommandState) {
     case CommandState::Idle: {
-      if (debugNukiCommunication) {
-        logMessage("************************ SENDING CHALLENGE ************************");
-      }
-      lastMsgCodeReceived = Command::Empty;
-      unsigned char payload[sizeof(Command)] = {0x04, 0x00};  //challenge
-
-      if (sendEncryptedMessage(Command::RequestData, payload, sizeof(Command))) {
-        timeNow = (esp_timer_get_time() / 1000);
-        nukiCommandState = CommandState::ChallengeSent;
-      } else {
-        if (debugNukiCommunication) {
-          logMessage("************************ SENDING CHALLENGE FAILED ************************");
-        }
-        if (altConnect) {
-          disconnect();
-        }
-        nukiCommandState = CommandState::Idle;
-        lastMsgCodeReceived = Command::Empty;
+      if (!sendChallengeRequest()) {
         return Nuki::CmdResult::Failed;
       }
       break;
     }
     case CommandState::ChallengeSent: {
-      if (debugNukiCommunication) {
-        logMessage("************************ RECEIVING CHALLENGE RESPONSE************************");
-      }
-      if ((esp_timer_get_time() / 1000) - timeNow > CMD_TIMEOUT) {
-        logMessage("************************ COMMAND FAILED TIMEOUT ************************", 2);
-        if (altConnect) {
-          disconnect();
-        }
-        nukiCommandState = CommandState::Idle;
-        return Nuki::CmdResult::TimeOut;
-      } else if (lastMsgCodeReceived == Command::Challenge) {
-        nukiCommandState = CommandState::ChallengeRespReceived;
-        lastMsgCodeReceived = Command::Empty;
-      }
-      break;
+      return checkAnswer(ExpectedAnswer::Challenge);
     }
     case CommandState::ChallengeRespReceived: {
-      if (debugNukiCommunication) {
-        logMessageVar("************************ SENDING COMMAND ************************", (unsigned int)action.command);
-      }
-      lastMsgCodeReceived = Command::Empty;
-      //add received challenge nonce to payload
-      uint8_t payloadLen = action.payloadLen + sizeof(challengeNonceK);
-      unsigned char payload[payloadLen];
-      memcpy(payload, action.payload, action.payloadLen);
-      memcpy(&payload[action.payloadLen], challengeNonceK, sizeof(challengeNonceK));
-
-      if (sendEncryptedMessage(action.command, payload, action.payloadLen + sizeof(challengeNonceK))) {
-        timeNow = (esp_timer_get_time() / 1000);
-        nukiCommandState = CommandState::CmdSent;
-      } else {
-        if (debugNukiCommunication) {
-          logMessage("************************ SENDING COMMAND FAILED ************************");
-        }
-        if (altConnect) {
-          disconnect();
-        }
-        nukiCommandState = CommandState::Idle;
-        lastMsgCodeReceived = Command::Empty;
+      if (!sendActionCommand(action, false)) {
         return Nuki::CmdResult::Failed;
       }
       break;
     }
     case CommandState::CmdSent: {
-      if (debugNukiCommunication) {
-        logMessage("************************ RECEIVING ACCEPT ************************");
-      }
-      if ((esp_timer_get_time() / 1000) - timeNow > CMD_TIMEOUT) {
-        logMessage("************************ ACCEPT FAILED TIMEOUT ************************", 2);
-        if (altConnect) {
-          disconnect();
-        }
-        nukiCommandState = CommandState::Idle;
-        return Nuki::CmdResult::TimeOut;
-      } else if (lastMsgCodeReceived == Command::Status && (CommandStatus)receivedStatus == CommandStatus::Accepted) {
-        timeNow = (esp_timer_get_time() / 1000);
-        nukiCommandState = CommandState::CmdAccepted;
-        lastMsgCodeReceived = Command::Empty;
-      } else if (lastMsgCodeReceived == Command::Status && (CommandStatus)receivedStatus == CommandStatus::Complete) {
-        //accept was skipped on lock because ie unlock command when lock allready unlocked?
-        if (debugNukiCommunication) {
-          logMessage("************************ COMMAND SUCCESS (SKIPPED) ************************");
-        }
-        nukiCommandState = CommandState::Idle;
-        lastMsgCodeReceived = Command::Empty;
-        return Nuki::CmdResult::Success;
-      }
-      break;
+      return checkAnswer(ExpectedAnswer::Accepted);
     }
     case CommandState::CmdAccepted: {
-      if (debugNukiCommunication) {
-        logMessage("************************ RECEIVING COMPLETE ************************");
-      }
-      if ((esp_timer_get_time() / 1000) - timeNow > CMD_TIMEOUT) {
-        logMessage("************************ COMMAND FAILED TIMEOUT ************************", 2);
-        if (altConnect) {
-          disconnect();
-        }
-        nukiCommandState = CommandState::Idle;
-        return Nuki::CmdResult::TimeOut;
-      } else if (lastMsgCodeReceived == Command::ErrorReport && errorCode != 69) {
-        if (debugNukiCommunication) {
-            logMessage("************************ SENDING COMMAND FAILED ************************");
-        }
-        if (altConnect) {
-          disconnect();
-        }
-        nukiCommandState = CommandState::Idle;
-        lastMsgCodeReceived = Command::Empty;
-        return Nuki::CmdResult::Failed;
-      } else if (lastMsgCodeReceived == Command::ErrorReport && errorCode == 69) {
-        if (debugNukiCommunication) {
-          logMessage("************************ COMMAND FAILED LOCK BUSY ************************");
-        }
-        if (altConnect) {
-          disconnect();
-        }
-        nukiCommandState = CommandState::Idle;
-        lastMsgCodeReceived = Command::Empty;
-        return Nuki::CmdResult::Lock_Busy;
-      } else if ((CommandStatus)lastMsgCodeReceived == CommandStatus::Complete) {
-        if (debugNukiCommunication) {
-          logMessage("************************ COMMAND SUCCESS ************************");
-        }
-        nukiCommandState = CommandState::Idle;
-        lastMsgCodeReceived = Command::Empty;
-        return Nuki::CmdResult::Success;
-      }
-      break;
+      return checkAnswer(ExpectedAnswer::Complete);
     }
     default:
-      logMessage("Unknown request command state", 2);
-      if (altConnect) {
-        disconnect();
-      }
-      return Nuki::CmdResult::Failed;
-      break;
+      return failCommand(Nuki::CmdResult::Failed, "Unknown request command state", 2);
   }
   return Nuki::CmdResult::Working;
 }
-  
-}
\ No newline at end of file
+
+template <typename TDeviceAction>
+bool NukiBle::sendActionCommand(const TDeviceAction& action, const bool sendPinCode) {
+  //add received challenge nonce to payload
+  uint8_t payloadLen = action.payloadLen + sizeof(challengeNonceK);
+  if (sendPinCode) {
+    if (isLockUltra()) {
+      payloadLen = payloadLen + 4;
+    } else {
+      payloadLen = payloadLen + 2;
+    }
+  }
+  unsigned char payload[payloadLen];
+  memcpy(payload, action.payload, action.payloadLen);
+  memcpy(&payload[action.payloadLen], challengeNonceK, sizeof(challengeNonceK));
+  if (sendPinCode) {
+    if (isLockUltra()) {
+      memcpy(&payload[action.payloadLen + sizeof(challengeNonceK)], &ultraPinCode, 4);
+    } else {
+      memcpy(&payload[action.payloadLen + sizeof(challengeNonceK)], &pinCode, 2);
+    }
+  }
+  return sendExchangeMessage(action.command, payload, payloadLen, CommandState::CmdSent);
+}
+
+#ifdef NUKI_COMMAND_FLOWS
+template <typename TDeviceAction>
+Nuki::CommandFlow NukiBle::executeActionFlow(const TDeviceAction action) {
+  FlowContext* context = co_await CurrentFlowContext{};
+  // the blocking semaphore wait would stop the other flows of the loop, poll instead
+  Nuki::CmdResult result;
+  int64_t acquireStartMs = esp_timer_get_time() / 1000;
+  while ((result = takeFlowOwnership(acquireStartMs)) == Nuki::CmdResult::Working) {
+    co_await FlowWait{FLOW_ACQUIRE_INTERVAL};
+  }
+  if (result != Nuki::CmdResult::Success) {
+    co_return result;
+  }
+  FlowOwnership ownership(this, context->wakeSemaphore);
+  result = checkActionPreconditions(true);
+  if (result != Nuki::CmdResult::Success) {
+    co_return result;
+  }
+  if (debugNukiCommunication) {
+    logMessageVar("Start executing flow", (unsigned int)action.command);
+  }
+  startAction(action.command, action.payload, action.cmdType != Nuki::CommandType::Command, false);
+
+  result = co_await exchangeFlow(action);
+  if (result == Nuki::CmdResult::Success) {
+    while ((result = checkListEntries()) == Nuki::CmdResult::Working) {
+      co_await FlowWait{listWaitMs()};
+    }
+  } else {
+    endListRequest();
+  }
+  ownership.release();
+  co_return endAction(result);
+}
+
+template <typename TDeviceAction>
+Nuki::CommandFlow NukiBle::exchangeFlow(const TDeviceAction action) {
+  Nuki::CmdResult result;
+  if (action.cmdType == Nuki::CommandType::Command) {
+    if (!sendExchangeMessage(Command::RequestData, action.payload, action.payloadLen, CommandState::CmdSent)) {
+      co_return Nuki::CmdResult::Failed;
+    }
+    co_return co_await answerFlow(ExpectedAnswer::Message);
+  }
+  if (action.cmdType != Nuki::CommandType::CommandWithChallenge
+      && action.cmdType != Nuki::CommandType::CommandWithChallengeAndAccept
+      && action.cmdType != Nuki::CommandType::CommandWithChallengeAndPin) {
+    logMessage("Unknown cmd type", 2);
+    disconnect();
+    co_return Nuki::CmdResult::Failed;
+  }
+
+  // Idle unless startAction() took a prefetched challenge
+  if (nukiCommandState == CommandState::Idle) {
+    if (!sendChallengeRequest()) {
+      co_return Nuki::CmdResult::Failed;
+    }
+    result = co_await answerFlow(ExpectedAnswer::Challenge);
+    if (result != Nuki::CmdResult::Success) {
+      co_return result;
+    }
+  }
+  if (!sendActionCommand(action, action.cmdType == Nuki::CommandType::CommandWithChallengeAndPin)) {
+    co_return Nuki::CmdResult::Failed;
+  }
+  if (action.cmdType != Nuki::CommandType::CommandWithChallengeAndAccept) {
+    co_return co_await answerFlow(ExpectedAnswer::ValidMessage);
+  }
+  result = co_await answerFlow(ExpectedAnswer::Accepted);
+  if (result != Nuki::CmdResult::Success || nukiCommandState != CommandState::CmdAccepted) {
+    // failed, or completed without an accepted status
+    co_return result;
+  }
+  co_return co_await answerFlow(ExpectedAnswer::Complete);
+}
+#endif
+
+}
@@ -0,0 +1,142 @@
+/**
+ * @file NukiCommandFlow.cpp
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ */
+
+#include "NukiCommandFlow.h"
+
+#ifdef NUKI_COMMAND_FLOWS
+
+#include <esp_task_wdt.h>
+#include "esp_timer.h"
+
+#include <utility>
+
+// longest wait of run() before it services the WDT
+#define FLOW_LOOP_MAX_WAIT 1000
+
+namespace Nuki {
+
+CommandFlow::CommandFlow(std::coroutine_handle<promise_type> handle)
+  : handle(handle) {}
+
+CommandFlow::CommandFlow(CommandFlow&& other) noexcept
+  : handle(std::exchange(other.handle, nullptr)) {}
+
+CommandFlow& CommandFlow::operator=(CommandFlow&& other) noexcept {
+  if (this != &other) {
+    if (handle) {
+      handle.destroy();
+    }
+    handle = std::exchange(other.handle, nullptr);
+  }
+  return *this;
+}
+
+CommandFlow::~CommandFlow() {
+  if (handle) {
+    handle.destroy();
+  }
+}
+
+bool CommandFlow::done() const {
+  return !handle || handle.done();
+}
+
+CmdResult CommandFlow::result() const {
+  return handle && handle.done() ? handle.promise().result : CmdResult::Failed;
+}
+
+void FlowWait::await_suspend(std::coroutine_handle<CommandFlow::promise_type> handle) noexcept {
+  FlowContext* context = handle.promise().context;
+  context->leaf = handle;
+  context->wakeUs = esp_timer_get_time() + (int64_t)timeoutMs * 1000;
+}
+
+CommandLoop::CommandLoop() {
+  wakeSemaphore = xSemaphoreCreateBinary();
+}
+
+CommandLoop::~CommandLoop() {
+  flows.clear();
+  vSemaphoreDelete(wakeSemaphore);
+}
+
+void CommandLoop::add(CommandFlow flow, CommandCallback callback, const uint32_t timeoutMs,
+                      const CancellationToken& token) {
+  RunningFlow running{std::move(flow), callback, std::make_unique<FlowContext>(),
+                      timeoutMs > 0 ? esp_timer_get_time() + (int64_t)timeoutMs * 1000 : 0, token};
+  running.context->wakeSemaphore = wakeSemaphore;
+  flows.push_back(std::move(running));
+}
+
+void CommandLoop::run() {
+  while (poll(FLOW_LOOP_MAX_WAIT) > 0) {
+    #ifndef NUKI_NO_WDT_RESET
+    esp_task_wdt_reset();
+    #endif
+  }
+}
+
+size_t CommandLoop::poll(const uint32_t waitMs) {
+  resumeReady(false);
+  if (flows.empty()) {
+    return 0;
+  }
+
+  int64_t now = esp_timer_get_time();
+  int64_t wakeUs = now + (int64_t)waitMs * 1000;
+  for (const RunningFlow& running : flows) {
+    if (running.context->wakeUs < wakeUs) {
+      wakeUs = running.context->wakeUs;
+    }
+  }
+  int64_t sleepMs = (wakeUs - now + 999) / 1000;
+  bool messageReceived = xSemaphoreTake(wakeSemaphore, pdMS_TO_TICKS(sleepMs > 0 ? sleepMs : 0)) == pdTRUE;
+  resumeReady(messageReceived);
+  return flows.size();
+}
+
+size_t CommandLoop::getPendingCount() const {
+  return flows.size();
+}
+
+void CommandLoop::resumeReady(const bool messageReceived) {
+  int64_t now = esp_timer_get_time();
+  auto it = flows.begin();
+  while (it != flows.end()) {
+    if (!it->started || messageReceived || now >= it->context->wakeUs) {
+      resume(*it);
+    }
+    if (it->flow.done()) {
+      CommandCallback callback = it->callback;
+      CmdResult result = it->flow.result();
+      it = flows.erase(it);
+      if (callback) {
+        callback(result);
+      }
+    } else {
+      it++;
+    }
+  }
+}
+
+void CommandLoop::resume(RunningFlow& running) {
+  // the deadline and token of the flow apply while it runs, like the limits of a blocking call
+  CommandLimits limits(running.token, running.deadlineUs);
+  if (!running.started) {
+    running.started = true;
+    running.flow.handle.promise().context = running.context.get();
+    running.flow.handle.resume();
+  } else if (running.context->leaf) {
+    std::coroutine_handle<> leaf = running.context->leaf;
+    running.context->leaf = nullptr;
+    leaf.resume();
+  }
+}
+
+} // namespace Nuki
+
+#endif
@@ -0,0 +1,207 @@
+#pragma once
+/**
+ * @file NukiCommandFlow.h
+ * Coroutine form of the commands of NukiBle, for one task running the commands of several devices
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ *
+ * A CommandFlow is a command (e.g. NukiLock::lockActionFlow()) written as send -> co_await answer. It suspends
+ * while the lock has not answered instead of blocking its task, a CommandLoop runs the flows it was given on the
+ * calling task and resumes a flow when a message of a lock arrives or its wait times out. Connecting and writing
+ * to the lock still block the loop, only the waits for answers are shared.
+ *
+ * Flows need C++20 coroutines (ESP-IDF 5 compiles with them), NUKI_COMMAND_FLOWS is defined if they are
+ * available. Without them, or with NUKI_NO_COMMAND_FLOWS defined, only the blocking commands are built.
+ */
+
+#if !defined(NUKI_NO_COMMAND_FLOWS) && defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#define NUKI_COMMAND_FLOWS 1
+#endif
+
+#ifdef NUKI_COMMAND_FLOWS
+
+#include "NukiCommandWorker.h"
+#include "NukiDataTypes.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include <coroutine>
+#include <list>
+#include <memory>
+
+namespace Nuki {
+
+// where a CommandLoop resumes a flow, shared by the flows the top level flow awaits
+struct FlowContext {
+  // innermost suspended flow
+  std::coroutine_handle<> leaf;
+  // esp_timer time at which the wait of the flow ends
+  int64_t wakeUs = 0;
+  // given for every message of a lock a flow of the loop waits for
+  SemaphoreHandle_t wakeSemaphore = nullptr;
+};
+
+class CommandFlow {
+  public:
+    struct promise_type {
+      CmdResult result = CmdResult::Failed;
+      FlowContext* context = nullptr;
+      std::coroutine_handle<> continuation;
+
+      CommandFlow get_return_object() {
+        return CommandFlow(std::coroutine_handle<promise_type>::from_promise(*this));
+      }
+      std::suspend_always initial_suspend() noexcept {
+        return {};
+      }
+      auto final_suspend() noexcept {
+        struct FinalAwaiter {
+          bool await_ready() noexcept {
+            return false;
+          }
+          std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+            // back to the awaiting flow, a top level flow returns to CommandLoop
+            if (handle.promise().continuation) {
+              return handle.promise().continuation;
+            }
+            return std::noop_coroutine();
+          }
+          void await_resume() noexcept {}
+        };
+        return FinalAwaiter{};
+      }
+      void return_value(const CmdResult value) {
+        result = value;
+      }
+      void unhandled_exception() {
+        result = CmdResult::Error;
+      }
+    };
+
+    CommandFlow(CommandFlow&& other) noexcept;
+    CommandFlow& operator=(CommandFlow&& other) noexcept;
+    CommandFlow(const CommandFlow&) = delete;
+    CommandFlow& operator=(const CommandFlow&) = delete;
+    ~CommandFlow();
+
+    bool done() const;
+    /**
+     * @brief Result of the completed flow, CmdResult::Failed before
+     */
+    CmdResult result() const;
+
+    // awaiting a flow runs it within the context of the awaiting one
+    bool await_ready() const noexcept {
+      return !handle || handle.done();
+    }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> awaiting) noexcept {
+      handle.promise().context = awaiting.promise().context;
+      handle.promise().continuation = awaiting;
+      return handle;
+    }
+    CmdResult await_resume() const noexcept {
+      return result();
+    }
+
+  private:
+    friend class CommandLoop;
+    explicit CommandFlow(std::coroutine_handle<promise_type> handle);
+    std::coroutine_handle<promise_type> handle;
+};
+
+/**
+ * @brief Suspends the flow until a message of a lock arrives or timeoutMs passed, the flow checks itself what
+ * it waits for after resuming
+ */
+struct FlowWait {
+  uint32_t timeoutMs;
+
+  bool await_ready() const noexcept {
+    return false;
+  }
+  void await_suspend(std::coroutine_handle<CommandFlow::promise_type> handle) noexcept;
+  void await_resume() const noexcept {}
+};
+
+/**
+ * @brief Gives the flow its FlowContext without suspending it
+ */
+struct CurrentFlowContext {
+  FlowContext* context = nullptr;
+
+  bool await_ready() const noexcept {
+    return false;
+  }
+  bool await_suspend(std::coroutine_handle<CommandFlow::promise_type> handle) noexcept {
+    context = handle.promise().context;
+    return false;
+  }
+  FlowContext* await_resume() const noexcept {
+    return context;
+  }
+};
+
+/**
+ * @brief Runs flows on the calling task, e.g.
+ * Nuki::CommandLoop loop;
+ * loop.add(nukiLock.lockActionFlow(NukiLock::LockAction::Unlock), [](Nuki::CmdResult result) { ... });
+ * loop.add(nukiOpener.requestOpenerStateFlow(&openerState));
+ * loop.run();
+ * Flows are added and run on one task. A flow destroyed before its completion (by the destruction of the loop)
+ * frees the lock it was using but may leave the connection in the middle of an exchange.
+ */
+class CommandLoop {
+  public:
+    CommandLoop();
+    ~CommandLoop();
+    CommandLoop(const CommandLoop&) = delete;
+    CommandLoop& operator=(const CommandLoop&) = delete;
+
+    /**
+     * @brief Adds a flow, it starts with the next run() or poll()
+     *
+     * @param flow Flow to run
+     * @param callback Gets the result of the flow on the task of the loop, may be nullptr
+     * @param timeoutMs Time the flow may take from now, 0 for no deadline (see CommandLimits)
+     * @param token Cancels the flow
+     */
+    void add(CommandFlow flow, CommandCallback callback = nullptr, const uint32_t timeoutMs = 0,
+             const CancellationToken& token = CancellationToken::none());
+
+    /**
+     * @brief Runs the flows until all of them completed
+     */
+    void run();
+
+    /**
+     * @brief Resumes the flows which can go on, then waits up to waitMs for a message or the end of a wait of a
+     * flow and resumes those
+     *
+     * @return Number of flows not completed yet
+     */
+    size_t poll(const uint32_t waitMs);
+
+    size_t getPendingCount() const;
+
+  private:
+    struct RunningFlow {
+      CommandFlow flow;
+      CommandCallback callback;
+      std::unique_ptr<FlowContext> context;
+      // esp_timer time of the deadline, 0 for none
+      int64_t deadlineUs;
+      CancellationToken token;
+      bool started = false;
+    };
+
+    void resume(RunningFlow& running);
+    void resumeReady(const bool messageReceived);
+
+    std::list<RunningFlow> flows;
+    SemaphoreHandle_t wakeSemaphore = nullptr;
+};
+
+} // namespace Nuki
+
+#endif
@@ -0,0 +1,276 @@
+/**
+ * @file NukiCommandWorker.cpp
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ */
+
+#include "NukiCommandWorker.h"
+
+#include <esp_task_wdt.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include <algorithm>
+
+// the idle worker wakes up this often to reset the WDT it is subscribed to
+#define WORKER_IDLE_WAIT 1000
+
+namespace Nuki {
+
+namespace {
+
+thread_local int64_t runningCallSubmittedUs = 0;
+// innermost CommandLimits of the task
+thread_local CommandLimits* taskLimits = nullptr;
+
+} // namespace
+
+CancellationToken::CancellationToken()
+  : cancelled(std::make_shared<std::atomic_bool>(false)) {}
+
+CancellationToken::CancellationToken(std::shared_ptr<std::atomic_bool> cancelled)
+  : cancelled(cancelled) {}
+
+CancellationToken CancellationToken::none() {
+  return CancellationToken(nullptr);
+}
+
+bool CancellationToken::isNone() const {
+  return !cancelled;
+}
+
+void CancellationToken::cancel() {
+  if (cancelled) {
+    *cancelled = true;
+  }
+}
+
+bool CancellationToken::isCancelled() const {
+  return cancelled && *cancelled;
+}
+
+CommandLimits::CommandLimits(const uint32_t timeoutMs, const CancellationToken& token)
+  : deadlineUs(timeoutMs > 0 ? esp_timer_get_time() + (int64_t)timeoutMs * 1000 : 0),
+    token(token),
+    outer(taskLimits) {
+  taskLimits = this;
+}
+
+CommandLimits::CommandLimits(const CancellationToken& token, const int64_t deadlineUs)
+  : deadlineUs(deadlineUs),
+    token(token),
+    outer(taskLimits) {
+  taskLimits = this;
+}
+
+CommandLimits::~CommandLimits() {
+  taskLimits = outer;
+}
+
+CmdResult CommandLimits::check() {
+  int64_t now = esp_timer_get_time();
+  for (CommandLimits* limits = taskLimits; limits; limits = limits->outer) {
+    if (limits->token.isCancelled()) {
+      return CmdResult::Cancelled;
+    }
+    if (limits->deadlineUs > 0 && now > limits->deadlineUs) {
+      return CmdResult::TimeOut;
+    }
+  }
+  return CmdResult::Success;
+}
+
+uint32_t CommandLimits::clampWait(const uint32_t waitMs) {
+  int64_t now = esp_timer_get_time();
+  int64_t result = waitMs;
+  for (CommandLimits* limits = taskLimits; limits; limits = limits->outer) {
+    if (limits->deadlineUs > 0 && (limits->deadlineUs - now) / 1000 + 1 < result) {
+      result = (limits->deadlineUs - now) / 1000 + 1;
+    }
+  }
+  return result > 0 ? result : 1;
+}
+
+bool CommandLimits::isCancellable() {
+  for (CommandLimits* limits = taskLimits; limits; limits = limits->outer) {
+    if (!limits->token.isNone()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+CommandWorker::CommandWorker(const std::string& name, const uint32_t stackSize, const UBaseType_t priority,
+                             const BaseType_t coreId) {
+  pendingSemaphore = xSemaphoreCreateMutex();
+  wakeSemaphore = xSemaphoreCreateBinary();
+  stoppedSemaphore = xSemaphoreCreateBinary();
+  if (xTaskCreatePinnedToCore(&CommandWorker::taskEntry, name.c_str(), stackSize, this, priority, &task, coreId)
+      != pdPASS) {
+    ESP_LOGE("NukiBle", "Unable to create command worker task %s", name.c_str());
+    task = nullptr;
+    stopped = true;
+  }
+}
+
+CommandWorker::~CommandWorker() {
+  stop();
+  vSemaphoreDelete(stoppedSemaphore);
+  vSemaphoreDelete(wakeSemaphore);
+  vSemaphoreDelete(pendingSemaphore);
+}
+
+bool CommandWorker::submit(CommandCall call, CommandCallback callback, const CommandPriority priority,
+                           const uint32_t timeoutMs, const CancellationToken& token) {
+  int64_t submittedUs = esp_timer_get_time();
+  int64_t deadlineUs = timeoutMs > 0 ? submittedUs + (int64_t)timeoutMs * 1000 : 0;
+  CommandCallback droppedCallback = nullptr;
+
+  xSemaphoreTake(pendingSemaphore, portMAX_DELAY);
+  if (stopping || stopped) {
+    xSemaphoreGive(pendingSemaphore);
+    return false;
+  }
+  if (pending.size() >= NUKI_WORKER_QUEUE_SIZE) {
+    if (pending.back().priority <= priority) {
+      xSemaphoreGive(pendingSemaphore);
+      return false;
+    }
+    droppedCallback = pending.back().callback;
+    pending.pop_back();
+  }
+  auto position = std::find_if(pending.begin(), pending.end(), [priority](const PendingCommand& command) {
+    return command.priority > priority;
+  });
+  pending.insert(position, {call, callback, priority, deadlineUs, submittedUs, token});
+  xSemaphoreGive(pendingSemaphore);
+  xSemaphoreGive(wakeSemaphore);
+
+  if (droppedCallback) {
+    ESP_LOGW("NukiBle", "Command queue full, dropped a less urgent call");
+    droppedCallback(CmdResult::Failed);
+  }
+  return true;
+}
+
+bool CommandWorker::isWorkerTask() {
+  return task != nullptr && xTaskGetCurrentTaskHandle() == task;
+}
+
+int64_t CommandWorker::currentSubmitTime() {
+  return runningCallSubmittedUs;
+}
+
+size_t CommandWorker::getPendingCount() {
+  xSemaphoreTake(pendingSemaphore, portMAX_DELAY);
+  size_t count = pending.size();
+  xSemaphoreGive(pendingSemaphore);
+  return count;
+}
+
+void CommandWorker::stop() {
+  xSemaphoreTake(pendingSemaphore, portMAX_DELAY);
+  bool running = !stopping && !stopped;
+  stopping = true;
+  xSemaphoreGive(pendingSemaphore);
+  if (!running) {
+    return;
+  }
+  xSemaphoreGive(wakeSemaphore);
+  // a callback stopping its own worker cannot wait for it, the task ends after the callback
+  if (!isWorkerTask()) {
+    xSemaphoreTake(stoppedSemaphore, portMAX_DELAY);
+  }
+}
+
+void CommandWorker::destroy(CommandWorker* worker) {
+  if (worker == nullptr) {
+    return;
+  }
+  if (!worker->isWorkerTask()) {
+    delete worker;
+    return;
+  }
+  // run() is further up the stack of the calling task
+  xSemaphoreTake(worker->pendingSemaphore, portMAX_DELAY);
+  worker->deleteWhenStopped = true;
+  xSemaphoreGive(worker->pendingSemaphore);
+  worker->stop();
+}
+
+void CommandWorker::taskEntry(void* parameters) {
+  ((CommandWorker*)parameters)->run();
+}
+
+void CommandWorker::run() {
+  #ifndef NUKI_NO_WDT_RESET
+  esp_task_wdt_add(nullptr);
+  #endif
+
+  while (1) {
+    xSemaphoreTake(wakeSemaphore, pdMS_TO_TICKS(WORKER_IDLE_WAIT));
+    #ifndef NUKI_NO_WDT_RESET
+    esp_task_wdt_reset();
+    #endif
+
+    while (1) {
+      xSemaphoreTake(pendingSemaphore, portMAX_DELAY);
+      if (stopping || pending.empty()) {
+        xSemaphoreGive(pendingSemaphore);
+        break;
+      }
+      PendingCommand command = pending.front();
+      pending.pop_front();
+      xSemaphoreGive(pendingSemaphore);
+
+      CmdResult result;
+      if (command.token.isCancelled()) {
+        result = CmdResult::Cancelled;
+      } else if (command.deadlineUs > 0 && esp_timer_get_time() > command.deadlineUs) {
+        result = CmdResult::TimeOut;
+      } else {
+        CommandLimits limits(0, command.token);
+        runningCallSubmittedUs = command.submittedUs;
+        result = command.call();
+        runningCallSubmittedUs = 0;
+      }
+      if (command.callback) {
+        command.callback(result);
+      }
+      #ifndef NUKI_NO_WDT_RESET
+      esp_task_wdt_reset();
+      #endif
+    }
+
+    xSemaphoreTake(pendingSemaphore, portMAX_DELAY);
+    if (stopping) {
+      std::list<PendingCommand> dropped;
+      dropped.swap(pending);
+      stopped = true;
+      xSemaphoreGive(pendingSemaphore);
+
+      for (PendingCommand& command : dropped) {
+        if (command.callback) {
+          command.callback(CmdResult::Failed);
+        }
+      }
+      #ifndef NUKI_NO_WDT_RESET
+      esp_task_wdt_delete(nullptr);
+      #endif
+      xSemaphoreTake(pendingSemaphore, portMAX_DELAY);
+      bool deleteWorker = deleteWhenStopped;
+      xSemaphoreGive(pendingSemaphore);
+      if (deleteWorker) {
+        delete this;
+      } else {
+        xSemaphoreGive(stoppedSemaphore);
+      }
+      vTaskDelete(nullptr);
+      return;
+    }
+    xSemaphoreGive(pendingSemaphore);
+  }
+}
+
+} // namespace Nuki
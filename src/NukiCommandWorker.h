@@ -0,0 +1,207 @@
+#pragma once
+/**
+ * @file NukiCommandWorker.h
+ * Task running the blocking calls of a NukiBle instance in the background
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ *
+ * NukiBle::submit() queues a call (any public command of NukiLock / NukiOpener, wrapped in a lambda) and
+ * returns immediately. The worker task of the instance runs the calls one after the other and passes the result
+ * to the callback of the call, on the worker task. The queue is ordered by CommandPriority (submission order
+ * within a priority), so an urgent lock action runs right after the call in progress instead of waiting for
+ * queued background work. A full queue drops its least urgent, latest call (CmdResult::Failed) for a more
+ * urgent one. A call that is still queued when its timeout has passed completes with CmdResult::TimeOut
+ * without being run. Calls made directly from other tasks still work, they are serialized with the worker by
+ * the semaphore of NukiBle like before.
+ *
+ * CommandLimits gives the commands a task makes a deadline and a CancellationToken, the calls of the worker get
+ * the token they were submitted with.
+ */
+
+#include "NukiDataTypes.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include <atomic>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+
+#ifndef NUKI_WORKER_STACK_SIZE
+#define NUKI_WORKER_STACK_SIZE 8192
+#endif
+#ifndef NUKI_WORKER_PRIORITY
+#define NUKI_WORKER_PRIORITY 5
+#endif
+#ifndef NUKI_WORKER_QUEUE_SIZE
+#define NUKI_WORKER_QUEUE_SIZE 16
+#endif
+
+namespace Nuki {
+
+enum class CommandPriority : uint8_t {
+  LockAction  = 0,
+  StateQuery  = 1,
+  ConfigWrite = 2,
+  Bulk        = 3
+};
+
+typedef std::function<CmdResult()> CommandCall;
+typedef std::function<void(CmdResult)> CommandCallback;
+
+/**
+ * @brief Cancels the commands it was given to, copies share the state. Cancelled commands return
+ * CmdResult::Cancelled: a queued call is not run, a running one gives up at the next step of its exchange with
+ * the lock.
+ */
+class CancellationToken {
+  public:
+    CancellationToken();
+    void cancel();
+    bool isCancelled() const;
+
+    /**
+     * @brief A token nobody can cancel, the default of the calls taking one
+     */
+    static CancellationToken none();
+    bool isNone() const;
+
+  private:
+    explicit CancellationToken(std::shared_ptr<std::atomic_bool> cancelled);
+
+    std::shared_ptr<std::atomic_bool> cancelled;
+};
+
+/**
+ * @brief Deadline and cancellation of the commands the calling task makes while the object exists, e.g.
+ * {
+ *   Nuki::CommandLimits limits(1500, token);
+ *   nukiLock.lockAction(LockAction::Unlock);
+ * }
+ * A command past the deadline returns CmdResult::TimeOut, a cancelled one CmdResult::Cancelled, the connection
+ * is dropped if the lock may still answer. Nested limits add up, the earliest deadline counts.
+ */
+class CommandLimits {
+  public:
+    /**
+     * @param timeoutMs Time from now the commands may take, 0 for no deadline
+     * @param token Cancels the commands
+     */
+    CommandLimits(const uint32_t timeoutMs, const CancellationToken& token = CancellationToken::none());
+    ~CommandLimits();
+    CommandLimits(const CommandLimits&) = delete;
+    CommandLimits& operator=(const CommandLimits&) = delete;
+
+    /**
+     * @brief CmdResult::Success while the commands of the calling task may go on, otherwise CmdResult::TimeOut
+     * or CmdResult::Cancelled
+     */
+    static CmdResult check();
+
+    /**
+     * @brief waitMs shortened to the time left until the deadline of the calling task (at least 1)
+     */
+    static uint32_t clampWait(const uint32_t waitMs);
+
+    /**
+     * @brief Whether the commands of the calling task were given a token (not CancellationToken::none()), i.e.
+     * waits should be short to notice a cancellation
+     */
+    static bool isCancellable();
+
+  private:
+    // CommandLoop installs the limits of a flow again on every resume, with the deadline as esp_timer time
+    friend class CommandLoop;
+    CommandLimits(const CancellationToken& token, const int64_t deadlineUs);
+
+    int64_t deadlineUs;
+    CancellationToken token;
+    CommandLimits* outer;
+};
+
+class CommandWorker {
+  public:
+    /**
+     * @param name Name of the worker task
+     * @param stackSize Stack of the worker task in bytes, has to fit the deepest command and the callbacks
+     * @param priority FreeRTOS priority of the worker task
+     * @param coreId Core of the worker task, tskNO_AFFINITY for any
+     */
+    CommandWorker(const std::string& name, const uint32_t stackSize = NUKI_WORKER_STACK_SIZE,
+                  const UBaseType_t priority = NUKI_WORKER_PRIORITY, const BaseType_t coreId = tskNO_AFFINITY);
+
+    /**
+     * @brief Stops the worker, see stop()
+     */
+    virtual ~CommandWorker();
+
+    /**
+     * @brief Queues a call
+     *
+     * @param call Runs on the worker task
+     * @param callback Gets the result of call on the worker task, may be nullptr
+     * @param priority Position in the queue, LockAction first
+     * @param timeoutMs Longest time the call may wait in the queue, 0 for no limit
+     * @param token Cancels the call, it runs within CommandLimits with this token
+     * @return false if the queue is full of calls at least as urgent or the worker is stopped, the callback is
+     * not called then
+     */
+    bool submit(CommandCall call, CommandCallback callback, const CommandPriority priority = CommandPriority::StateQuery,
+                const uint32_t timeoutMs = 0, const CancellationToken& token = CancellationToken::none());
+
+    /**
+     * @brief Whether the calling task is the worker task, i.e. inside of a call or callback
+     */
+    bool isWorkerTask();
+
+    /**
+     * @brief esp_timer time at which the call running on the calling task was submitted, 0 if the calling task
+     * is not running a call of a worker
+     */
+    static int64_t currentSubmitTime();
+
+    /**
+     * @brief Number of queued calls, without the running one
+     */
+    size_t getPendingCount();
+
+    /**
+     * @brief Waits for the running call, completes the queued calls with CmdResult::Failed and ends the task
+     */
+    void stop();
+
+    /**
+     * @brief Stops and deletes the worker. Called from a call or callback of the worker it does not wait, the
+     * worker is deleted by its task once the callback returned.
+     */
+    static void destroy(CommandWorker* worker);
+
+  private:
+    struct PendingCommand {
+      CommandCall call;
+      CommandCallback callback;
+      CommandPriority priority;
+      // esp_timer time after which the call is not started anymore, 0 for none
+      int64_t deadlineUs;
+      int64_t submittedUs;
+      CancellationToken token;
+    };
+
+    static void taskEntry(void* parameters);
+    void run();
+
+    std::list<PendingCommand> pending;
+    bool stopping = false;
+    bool stopped = false;
+    // destroy() was called on the worker task
+    bool deleteWhenStopped = false;
+    TaskHandle_t task = nullptr;
+    SemaphoreHandle_t pendingSemaphore = nullptr;
+    SemaphoreHandle_t wakeSemaphore = nullptr;
+    SemaphoreHandle_t stoppedSemaphore = nullptr;
+};
+
+} // namespace Nuki
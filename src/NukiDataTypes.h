@@ -38,9 +38,52 @@ enum CmdResult : uint8_t {
   Working   = 4,
   NotPaired = 5,
   Lock_Busy = 6,
+  Cancelled = 7,
   Error     = 99
 };
 
+struct ConnectionStatistics {
+  bool connected = false;
+  // of the current connection, 0 while disconnected
+  uint32_t uptimeMs = 0;
+  // of all connections, including the current one
+  uint64_t totalUptimeMs = 0;
+  uint32_t connects = 0;
+  uint32_t disconnects = 0;
+  // made by the keep-connected mode after the connection was dropped
+  uint32_t backgroundReconnects = 0;
+  uint32_t keepAlives = 0;
+  // lookup of the service and characteristic on the last subscription, close to 0 when they were reused from an
+  // earlier connection or served by the GATT cache of NimBLE
+  uint32_t discoveryMs = 0;
+};
+
+enum class ConnectionProfile : uint8_t {
+  // 7.5 - 11.25 ms interval, for commands that should complete as fast as possible
+  LowLatency,
+  // 15 ms interval, the default
+  Balanced,
+  // 100 - 125 ms interval and the lock may skip 4 events, for connections held open by the keep-connected mode
+  LowPower
+};
+
+/**
+ * @brief BLE connection parameters requested from the lock, see NukiBle::setConnectionParameters()
+ */
+struct ConnectionParameters {
+  // connection interval range in 1.25 ms units, 6 - 3200
+  uint16_t minInterval = 12;
+  uint16_t maxInterval = 12;
+  // connection events the lock may skip while it has nothing to send, 0 - 499
+  uint16_t latency = 0;
+  // supervision timeout in 10 ms units, 10 - 3200 and longer than (1 + latency) * maxInterval * 2
+  uint16_t supervisionTimeout = 600;
+  // asks for the 2M PHY, the connection stays on the 1M PHY if the ESP or the lock does not have it
+  bool phy2M = true;
+  // asks for 251 byte link layer packets instead of 27 byte ones (data length extension)
+  bool dataLengthExtension = true;
+};
+
 enum class PairingResult : uint8_t {
   Pairing,
   Success,
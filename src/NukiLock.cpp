@@ -24,7 +24,58 @@ NukiLock::NukiLock(const std::string& deviceName, const uint32_t deviceId)
     errorCode = (uint8_t)ErrorCode::ERROR_UNKNOWN;
 }
 
+NukiLock::~NukiLock() {
+  stopCommandWorker();
+}
+
 Nuki::CmdResult NukiLock::lockAction(const LockAction lockAction, const uint32_t nukiAppId, const uint8_t flags, const char* nameSuffix, const uint8_t nameSuffixLen) {
+  return executeAction(createLockAction(lockAction, nukiAppId, flags, nameSuffix, nameSuffixLen));
+}
+
+#ifdef NUKI_COMMAND_FLOWS
+Nuki::CommandFlow NukiLock::lockActionFlow(const LockAction lockAction, const uint32_t nukiAppId, const uint8_t flags, const char* nameSuffix, const uint8_t nameSuffixLen) {
+  // the action is built now, nameSuffix does not have to outlive the call
+  return executeActionFlow(createLockAction(lockAction, nukiAppId, flags, nameSuffix, nameSuffixLen));
+}
+
+Nuki::CommandFlow NukiLock::requestKeyTurnerStateFlow(KeyTurnerState* retrievedKeyTurnerState) {
+  Nuki::CmdResult result = co_await executeActionFlow(createKeyTurnerStateRequest());
+  if (result == Nuki::CmdResult::Success) {
+    memcpy(retrievedKeyTurnerState, &keyTurnerState, sizeof(KeyTurnerState));
+  }
+  co_return result;
+}
+
+Nuki::CommandFlow NukiLock::requestBatteryReportFlow(BatteryReport* retrievedBatteryReport) {
+  Nuki::CmdResult result = co_await executeActionFlow(createBatteryReportRequest());
+  if (result == Nuki::CmdResult::Success) {
+    memcpy(retrievedBatteryReport, &batteryReport, sizeof(batteryReport));
+  }
+  co_return result;
+}
+
+Nuki::CommandFlow NukiLock::requestConfigFlow(Config* retrievedConfig) {
+  Nuki::CmdResult result = co_await executeActionFlow(createConfigRequest());
+  if (result == Nuki::CmdResult::Success) {
+    memcpy(retrievedConfig, &config, sizeof(Config));
+  }
+  co_return result;
+}
+
+Nuki::CommandFlow NukiLock::requestAdvancedConfigFlow(AdvancedConfig* retrievedAdvancedConfig) {
+  Nuki::CmdResult result = co_await executeActionFlow(createAdvancedConfigRequest());
+  if (result == Nuki::CmdResult::Success) {
+    memcpy(retrievedAdvancedConfig, &advancedConfig, sizeof(AdvancedConfig));
+  }
+  co_return result;
+}
+
+Nuki::CommandFlow NukiLock::actionFlow(const Action& action) {
+  return executeActionFlow(action);
+}
+#endif
+
+Action NukiLock::createLockAction(const LockAction lockAction, const uint32_t nukiAppId, const uint8_t flags, const char* nameSuffix, const uint8_t nameSuffixLen) {
   Action action{};
   unsigned char payload[sizeof(LockAction) + 4 + 1 + 20] = {0};
   memcpy(payload, &lockAction, sizeof(LockAction));
@@ -45,8 +96,7 @@ Nuki::CmdResult NukiLock::lockAction(const LockAction lockAction, const uint32_t
   action.command = Command::LockAction;
   memcpy(action.payload, &payload, payloadLen);
   action.payloadLen = payloadLen;
-
-  return executeAction(action);
+  return action;
 }
 
 Nuki::CmdResult NukiLock::keypadAction(KeypadActionSource source, uint32_t code, KeypadAction keypadAction) {
@@ -65,15 +115,9 @@ Nuki::CmdResult NukiLock::keypadAction(KeypadActionSource source, uint32_t code,
 }
 
 Nuki::CmdResult NukiLock::requestKeyTurnerState(KeyTurnerState* retrievedKeyTurnerState) {
-  Action action{};
-  uint16_t payload = (uint16_t)Command::KeyturnerStates;
-
-  action.cmdType = Nuki::CommandType::Command;
-  action.command = Command::RequestData;
-  memcpy(&action.payload[0], &payload, sizeof(payload));
-  action.payloadLen = sizeof(payload);
+  Action action = createKeyTurnerStateRequest();
 
-  Nuki::CmdResult result = executeAction(action);
+  Nuki::CmdResult result = coalesceRequest(Command::KeyturnerStates, [&]() { return executeAction(action); });
   if (result == Nuki::CmdResult::Success) {
     // printBuffer((uint8_t*)&retrievedKeyTurnerState, sizeof(retrievedKeyTurnerState), false, "retrieved Keyturner state", debugNukiHexData);
     memcpy(retrievedKeyTurnerState, &keyTurnerState, sizeof(KeyTurnerState));
@@ -85,17 +129,22 @@ void NukiLock::retrieveKeyTunerState(KeyTurnerState* retrievedKeyTurnerState) {
   memcpy(retrievedKeyTurnerState, &keyTurnerState, sizeof(KeyTurnerState));
 }
 
-
-Nuki::CmdResult NukiLock::requestBatteryReport(BatteryReport* retrievedBatteryReport) {
+Action NukiLock::createKeyTurnerStateRequest() {
   Action action{};
-  uint16_t payload = (uint16_t)Command::BatteryReport;
+  uint16_t payload = (uint16_t)Command::KeyturnerStates;
 
   action.cmdType = Nuki::CommandType::Command;
   action.command = Command::RequestData;
   memcpy(&action.payload[0], &payload, sizeof(payload));
   action.payloadLen = sizeof(payload);
+  return action;
+}
 
-  Nuki::CmdResult result = executeAction(action);
+
+Nuki::CmdResult NukiLock::requestBatteryReport(BatteryReport* retrievedBatteryReport) {
+  Action action = createBatteryReportRequest();
+
+  Nuki::CmdResult result = coalesceRequest(Command::BatteryReport, [&]() { return executeAction(action); });
   if (result == Nuki::CmdResult::Success) {
     memcpy(retrievedBatteryReport, &batteryReport, sizeof(batteryReport));
   }
@@ -104,11 +153,9 @@ Nuki::CmdResult NukiLock::requestBatteryReport(BatteryReport* retrievedBatteryRe
 
 
 Nuki::CmdResult NukiLock::requestConfig(Config* retrievedConfig) {
-  Action action{};
-  action.cmdType = Nuki::CommandType::CommandWithChallenge;
-  action.command = Command::RequestConfig;
+  Action action = createConfigRequest();
 
-  Nuki::CmdResult result = executeAction(action);
+  Nuki::CmdResult result = coalesceRequest(Command::RequestConfig, [&]() { return executeAction(action); });
   if (result == Nuki::CmdResult::Success) {
     memcpy(retrievedConfig, &config, sizeof(Config));
   }
@@ -116,17 +163,40 @@ Nuki::CmdResult NukiLock::requestConfig(Config* retrievedConfig) {
 }
 
 Nuki::CmdResult NukiLock::requestAdvancedConfig(AdvancedConfig* retrievedAdvancedConfig) {
-  Action action{};
-  action.cmdType = Nuki::CommandType::CommandWithChallenge;
-  action.command = Command::RequestAdvancedConfig;
+  Action action = createAdvancedConfigRequest();
 
-  Nuki::CmdResult result = executeAction(action);
+  Nuki::CmdResult result = coalesceRequest(Command::RequestAdvancedConfig, [&]() { return executeAction(action); });
   if (result == Nuki::CmdResult::Success) {
     memcpy(retrievedAdvancedConfig, &advancedConfig, sizeof(AdvancedConfig));
   }
   return result;
 }
 
+Action NukiLock::createBatteryReportRequest() {
+  Action action{};
+  uint16_t payload = (uint16_t)Command::BatteryReport;
+
+  action.cmdType = Nuki::CommandType::Command;
+  action.command = Command::RequestData;
+  memcpy(&action.payload[0], &payload, sizeof(payload));
+  action.payloadLen = sizeof(payload);
+  return action;
+}
+
+Action NukiLock::createConfigRequest() {
+  Action action{};
+  action.cmdType = Nuki::CommandType::CommandWithChallenge;
+  action.command = Command::RequestConfig;
+  return action;
+}
+
+Action NukiLock::createAdvancedConfigRequest() {
+  Action action{};
+  action.cmdType = Nuki::CommandType::CommandWithChallenge;
+  action.command = Command::RequestAdvancedConfig;
+  return action;
+}
+
 
 //basic config change methods
 Nuki::CmdResult NukiLock::setName(const std::string& name) {
@@ -17,6 +17,11 @@ class NukiLock : public Nuki::NukiBle {
   public:
     NukiLock(const std::string& deviceName, const uint32_t deviceId);
 
+    /**
+     * @brief Stops the command worker while the calls it runs can still use this class
+     */
+    virtual ~NukiLock();
+
 
     /**
      * @brief Sends lock action cmd via BLE to the lock
@@ -31,6 +36,50 @@ class NukiLock : public Nuki::NukiBle {
     Nuki::CmdResult lockAction(const LockAction lockAction, const uint32_t nukiAppId = 1, const uint8_t flags = 0,
                               const char* nameSuffix = nullptr, const uint8_t nameSuffixLen = 0);
 
+    #ifdef NUKI_COMMAND_FLOWS
+    /**
+     * @brief lockAction() as a flow for a CommandLoop (see NukiCommandFlow.h)
+     */
+    Nuki::CommandFlow lockActionFlow(const LockAction lockAction, const uint32_t nukiAppId = 1, const uint8_t flags = 0,
+                                     const char* nameSuffix = nullptr, const uint8_t nameSuffixLen = 0);
+
+    /**
+     * @brief requestKeyTurnerState() as a flow for a CommandLoop (see NukiCommandFlow.h)
+     *
+     * @param retrievedKeyTurnerState Has to exist until the flow completed
+     */
+    Nuki::CommandFlow requestKeyTurnerStateFlow(KeyTurnerState* retrievedKeyTurnerState);
+
+    /**
+     * @brief requestBatteryReport() as a flow for a CommandLoop (see NukiCommandFlow.h)
+     *
+     * @param retrievedBatteryReport Has to exist until the flow completed
+     */
+    Nuki::CommandFlow requestBatteryReportFlow(BatteryReport* retrievedBatteryReport);
+
+    /**
+     * @brief requestConfig() as a flow for a CommandLoop (see NukiCommandFlow.h)
+     *
+     * @param retrievedConfig Has to exist until the flow completed
+     */
+    Nuki::CommandFlow requestConfigFlow(Config* retrievedConfig);
+
+    /**
+     * @brief requestAdvancedConfig() as a flow for a CommandLoop (see NukiCommandFlow.h)
+     *
+     * @param retrievedAdvancedConfig Has to exist until the flow completed
+     */
+    Nuki::CommandFlow requestAdvancedConfigFlow(AdvancedConfig* retrievedAdvancedConfig);
+
+    /**
+     * @brief Any command as a flow for a CommandLoop (see NukiCommandFlow.h), for the commands without a flow of
+     * their own. The answer is kept like by the blocking command, e.g. the log entries for getLogEntries().
+     *
+     * @param action Command type, command and payload as the blocking command sends them
+     */
+    Nuki::CommandFlow actionFlow(const Action& action);
+    #endif
+
     /**
      * @brief Send a keypad action entry to the lock via BLE
      * @param source 0x00 = arrow key, 0x01 = code
@@ -420,7 +469,8 @@ class NukiLock : public Nuki::NukiBle {
     Nuki::CmdResult removeTimeControlEntry(uint8_t entryId);
 
     /**
-     * @brief Request the lock via BLE to send the existing time control entries
+     * @brief Request the lock via BLE to send the existing time control entries, returns once all of them were
+     * received
      *
      */
     Nuki::CmdResult retrieveTimeControlEntries();
@@ -440,7 +490,7 @@ class NukiLock : public Nuki::NukiBle {
     void getLogEntries(std::list<LogEntry>* requestedLogEntries);
 
     /**
-     * @brief Request the lock via BLE to send the log entries
+     * @brief Request the lock via BLE to send the log entries, returns once all of them were received
      *
      * @param startIndex Startindex of first log msg to be send
      * @param count The number of log entries to be read, starting at the specified start index.
@@ -507,6 +557,12 @@ class NukiLock : public Nuki::NukiBle {
 
 
   private:
+    Action createLockAction(const LockAction lockAction, const uint32_t nukiAppId, const uint8_t flags,
+                            const char* nameSuffix, const uint8_t nameSuffixLen);
+    Action createKeyTurnerStateRequest();
+    Action createBatteryReportRequest();
+    Action createConfigRequest();
+    Action createAdvancedConfigRequest();
     Nuki::CmdResult setConfig(NewConfig newConfig);
     Nuki::CmdResult setFromConfig(const Config config);
     Nuki::CmdResult setAdvancedConfig(NewAdvancedConfig newAdvancedConfig);
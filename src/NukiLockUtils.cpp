@@ -36,6 +36,9 @@ void cmdResultToString(const CmdResult state, char* str) {
     case CmdResult::NotPaired:
       strcpy(str, "notPaired");
       break;
+    case CmdResult::Cancelled:
+      strcpy(str, "cancelled");
+      break;
     case CmdResult::Error:
       strcpy(str, "error");
       break;
@@ -23,9 +23,60 @@ NukiOpener::NukiOpener(const std::string& deviceName, const uint32_t deviceId)
   errorCode = (uint8_t)ErrorCode::ERROR_UNKNOWN;
 }
 
+NukiOpener::~NukiOpener() {
+  stopCommandWorker();
+}
+
 Nuki::CmdResult NukiOpener::lockAction(const LockAction lockAction, const uint32_t nukiAppId, const uint8_t flags, const char* nameSuffix, const uint8_t nameSuffixLen) {
+  return executeAction(createLockAction(lockAction, nukiAppId, flags, nameSuffix, nameSuffixLen));
+}
+
+#ifdef NUKI_COMMAND_FLOWS
+Nuki::CommandFlow NukiOpener::lockActionFlow(const LockAction lockAction, const uint32_t nukiAppId, const uint8_t flags, const char* nameSuffix, const uint8_t nameSuffixLen) {
+  // the action is built now, nameSuffix does not have to outlive the call
+  return executeActionFlow(createLockAction(lockAction, nukiAppId, flags, nameSuffix, nameSuffixLen));
+}
+
+Nuki::CommandFlow NukiOpener::requestOpenerStateFlow(OpenerState* state) {
+  Nuki::CmdResult result = co_await executeActionFlow(createOpenerStateRequest());
+  if (result == Nuki::CmdResult::Success) {
+    memcpy(state, &openerState, sizeof(OpenerState));
+  }
+  co_return result;
+}
+
+Nuki::CommandFlow NukiOpener::requestBatteryReportFlow(BatteryReport* retrievedBatteryReport) {
+  Nuki::CmdResult result = co_await executeActionFlow(createBatteryReportRequest());
+  if (result == Nuki::CmdResult::Success) {
+    memcpy(retrievedBatteryReport, &batteryReport, sizeof(batteryReport));
+  }
+  co_return result;
+}
+
+Nuki::CommandFlow NukiOpener::requestConfigFlow(Config* retrievedConfig) {
+  Nuki::CmdResult result = co_await executeActionFlow(createConfigRequest());
+  if (result == Nuki::CmdResult::Success) {
+    memcpy(retrievedConfig, &config, sizeof(Config));
+  }
+  co_return result;
+}
+
+Nuki::CommandFlow NukiOpener::requestAdvancedConfigFlow(AdvancedConfig* retrievedAdvancedConfig) {
+  Nuki::CmdResult result = co_await executeActionFlow(createAdvancedConfigRequest());
+  if (result == Nuki::CmdResult::Success) {
+    memcpy(retrievedAdvancedConfig, &advancedConfig, sizeof(AdvancedConfig));
+  }
+  co_return result;
+}
+
+Nuki::CommandFlow NukiOpener::actionFlow(const Action& action) {
+  return executeActionFlow(action);
+}
+#endif
+
+Action NukiOpener::createLockAction(const LockAction lockAction, const uint32_t nukiAppId, const uint8_t flags, const char* nameSuffix, const uint8_t nameSuffixLen) {
   Action action{};
-  
+
   if((lockAction == LockAction::ActivateCM || lockAction == LockAction::DeactivateCM) && nukiAppId != 1)
   {
       ContinuousModeAction continuousModeAction;
@@ -37,8 +88,6 @@ Nuki::CmdResult NukiOpener::lockAction(const LockAction lockAction, const uint32
       action.command = Command::ContinuousModeAction;
       memcpy(action.payload, &payload, sizeof(ContinuousModeAction));
       action.payloadLen = sizeof(ContinuousModeAction);
-
-      return executeAction(action);    
   }
   else
   {
@@ -58,22 +107,15 @@ Nuki::CmdResult NukiOpener::lockAction(const LockAction lockAction, const uint32
       action.command = Command::LockAction;
       memcpy(action.payload, &payload, payloadLen);
       action.payloadLen = payloadLen;
-
-      return executeAction(action);
   }
+  return action;
 }
 
 
 Nuki::CmdResult NukiOpener::requestOpenerState(OpenerState* state) {
-  Action action{};
-  uint16_t payload = (uint16_t)Command::KeyturnerStates;
-
-  action.cmdType = Nuki::CommandType::Command;
-  action.command = Command::RequestData;
-  memcpy(&action.payload[0], &payload, sizeof(payload));
-  action.payloadLen = sizeof(payload);
+  Action action = createOpenerStateRequest();
 
-  Nuki::CmdResult result = executeAction(action);
+  Nuki::CmdResult result = coalesceRequest(Command::KeyturnerStates, [&]() { return executeAction(action); });
   if (result == Nuki::CmdResult::Success) {
     // printBuffer((uint8_t*)&retrievedKeyTurnerState, sizeof(retrievedKeyTurnerState), false, "retreived Keyturner state", debugNukiHexData);
     memcpy(state, &openerState, sizeof(OpenerState));
@@ -85,17 +127,22 @@ void NukiOpener::retrieveOpenerState(OpenerState* state) {
   memcpy(state, &openerState, sizeof(OpenerState));
 }
 
-
-Nuki::CmdResult NukiOpener::requestBatteryReport(BatteryReport* retrievedBatteryReport) {
+Action NukiOpener::createOpenerStateRequest() {
   Action action{};
-  uint16_t payload = (uint16_t)Command::BatteryReport;
+  uint16_t payload = (uint16_t)Command::KeyturnerStates;
 
   action.cmdType = Nuki::CommandType::Command;
   action.command = Command::RequestData;
   memcpy(&action.payload[0], &payload, sizeof(payload));
   action.payloadLen = sizeof(payload);
+  return action;
+}
 
-  Nuki::CmdResult result = executeAction(action);
+
+Nuki::CmdResult NukiOpener::requestBatteryReport(BatteryReport* retrievedBatteryReport) {
+  Action action = createBatteryReportRequest();
+
+  Nuki::CmdResult result = coalesceRequest(Command::BatteryReport, [&]() { return executeAction(action); });
   if (result == Nuki::CmdResult::Success) {
     memcpy(retrievedBatteryReport, &batteryReport, sizeof(batteryReport));
   }
@@ -104,11 +151,9 @@ Nuki::CmdResult NukiOpener::requestBatteryReport(BatteryReport* retrievedBattery
 
 
 Nuki::CmdResult NukiOpener::requestConfig(Config* retrievedConfig) {
-  Action action{};
-  action.cmdType = Nuki::CommandType::CommandWithChallenge;
-  action.command = Command::RequestConfig;
+  Action action = createConfigRequest();
 
-  Nuki::CmdResult result = executeAction(action);
+  Nuki::CmdResult result = coalesceRequest(Command::RequestConfig, [&]() { return executeAction(action); });
   if (result == Nuki::CmdResult::Success) {
     memcpy(retrievedConfig, &config, sizeof(Config));
   }
@@ -116,17 +161,40 @@ Nuki::CmdResult NukiOpener::requestConfig(Config* retrievedConfig) {
 }
 
 Nuki::CmdResult NukiOpener::requestAdvancedConfig(AdvancedConfig* retrievedAdvancedConfig) {
-  Action action{};
-  action.cmdType = Nuki::CommandType::CommandWithChallenge;
-  action.command = Command::RequestAdvancedConfig;
+  Action action = createAdvancedConfigRequest();
 
-  Nuki::CmdResult result = executeAction(action);
+  Nuki::CmdResult result = coalesceRequest(Command::RequestAdvancedConfig, [&]() { return executeAction(action); });
   if (result == Nuki::CmdResult::Success) {
     memcpy(retrievedAdvancedConfig, &advancedConfig, sizeof(AdvancedConfig));
   }
   return result;
 }
 
+Action NukiOpener::createBatteryReportRequest() {
+  Action action{};
+  uint16_t payload = (uint16_t)Command::BatteryReport;
+
+  action.cmdType = Nuki::CommandType::Command;
+  action.command = Command::RequestData;
+  memcpy(&action.payload[0], &payload, sizeof(payload));
+  action.payloadLen = sizeof(payload);
+  return action;
+}
+
+Action NukiOpener::createConfigRequest() {
+  Action action{};
+  action.cmdType = Nuki::CommandType::CommandWithChallenge;
+  action.command = Command::RequestConfig;
+  return action;
+}
+
+Action NukiOpener::createAdvancedConfigRequest() {
+  Action action{};
+  action.cmdType = Nuki::CommandType::CommandWithChallenge;
+  action.command = Command::RequestAdvancedConfig;
+  return action;
+}
+
 
 //basic config change methods
 Nuki::CmdResult NukiOpener::setName(const std::string& name) {
@@ -15,6 +15,11 @@ class NukiOpener : public Nuki::NukiBle {
   public:
     NukiOpener(const std::string& deviceName, const uint32_t deviceId);
 
+    /**
+     * @brief Stops the command worker while the calls it runs can still use this class
+     */
+    virtual ~NukiOpener();
+
     /**
      * @brief Sends lock action cmd via BLE to the opener
      *
@@ -28,6 +33,50 @@ class NukiOpener : public Nuki::NukiBle {
     Nuki::CmdResult lockAction(const LockAction lockAction, const uint32_t nukiAppId = 1, const uint8_t flags = 0,
                               const char* nameSuffix = nullptr, const uint8_t nameSuffixLen = 0);
 
+    #ifdef NUKI_COMMAND_FLOWS
+    /**
+     * @brief lockAction() as a flow for a CommandLoop (see NukiCommandFlow.h)
+     */
+    Nuki::CommandFlow lockActionFlow(const LockAction lockAction, const uint32_t nukiAppId = 1, const uint8_t flags = 0,
+                                     const char* nameSuffix = nullptr, const uint8_t nameSuffixLen = 0);
+
+    /**
+     * @brief requestOpenerState() as a flow for a CommandLoop (see NukiCommandFlow.h)
+     *
+     * @param state Has to exist until the flow completed
+     */
+    Nuki::CommandFlow requestOpenerStateFlow(OpenerState* state);
+
+    /**
+     * @brief requestBatteryReport() as a flow for a CommandLoop (see NukiCommandFlow.h)
+     *
+     * @param retrievedBatteryReport Has to exist until the flow completed
+     */
+    Nuki::CommandFlow requestBatteryReportFlow(BatteryReport* retrievedBatteryReport);
+
+    /**
+     * @brief requestConfig() as a flow for a CommandLoop (see NukiCommandFlow.h)
+     *
+     * @param retrievedConfig Has to exist until the flow completed
+     */
+    Nuki::CommandFlow requestConfigFlow(Config* retrievedConfig);
+
+    /**
+     * @brief requestAdvancedConfig() as a flow for a CommandLoop (see NukiCommandFlow.h)
+     *
+     * @param retrievedAdvancedConfig Has to exist until the flow completed
+     */
+    Nuki::CommandFlow requestAdvancedConfigFlow(AdvancedConfig* retrievedAdvancedConfig);
+
+    /**
+     * @brief Any command as a flow for a CommandLoop (see NukiCommandFlow.h), for the commands without a flow of
+     * their own. The answer is kept like by the blocking command, e.g. the log entries for getLogEntries().
+     *
+     * @param action Command type, command and payload as the blocking command sends them
+     */
+    Nuki::CommandFlow actionFlow(const Action& action);
+    #endif
+
 
     /**
      * @brief Requests keyturner state from Opener via BLE
@@ -339,7 +388,8 @@ class NukiOpener : public Nuki::NukiBle {
     Nuki::CmdResult removeTimeControlEntry(uint8_t entryId);
 
     /**
-     * @brief Request the opener via BLE to send the existing time control entries
+     * @brief Request the opener via BLE to send the existing time control entries, returns once all of them were
+     * received
      *
      */
     Nuki::CmdResult retrieveTimeControlEntries();
@@ -359,7 +409,7 @@ class NukiOpener : public Nuki::NukiBle {
     void getLogEntries(std::list<LogEntry>* requestedLogEntries);
 
     /**
-    * @brief Request the opener via BLE to send the log entries
+    * @brief Request the opener via BLE to send the log entries, returns once all of them were received
     *
     * @param startIndex Startindex of first log msg to be send
     * @param count The number of log entries to be read, starting at the specified start index.
@@ -414,6 +464,12 @@ class NukiOpener : public Nuki::NukiBle {
 
 
   private:
+    Action createLockAction(const LockAction lockAction, const uint32_t nukiAppId, const uint8_t flags,
+                            const char* nameSuffix, const uint8_t nameSuffixLen);
+    Action createOpenerStateRequest();
+    Action createBatteryReportRequest();
+    Action createConfigRequest();
+    Action createAdvancedConfigRequest();
     Nuki::CmdResult setConfig(NewConfig newConfig);
     Nuki::CmdResult setFromConfig(const Config config);
     Nuki::CmdResult setAdvancedConfig(NewAdvancedConfig newAdvancedConfig);
@@ -0,0 +1,195 @@
+/**
+ * @file NukiResourceProfiler.cpp
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ */
+
+#include "NukiResourceProfiler.h"
+
+#include "freertos/task.h"
+#include "esp_heap_caps.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+
+#include <algorithm>
+
+#if defined(__SANITIZE_ADDRESS__)
+#define NO_SANITIZE_ADDRESS __attribute__((no_sanitize_address))
+#else
+#define NO_SANITIZE_ADDRESS
+#endif
+
+namespace Nuki {
+
+namespace {
+
+const uint8_t STACK_PROBE_PATTERN = 0x5A;
+
+thread_local ProfiledScope* activeScope = nullptr;
+
+/**
+ * Fills [bottom, own frame - STACK_PROBE_REDZONE) and returns the end of the filled range, the stack of
+ * the caller and of this function stay untouched.
+ */
+__attribute__((noinline)) NO_SANITIZE_ADDRESS uint8_t* fillStack(uint8_t* bottom) {
+  uint8_t* top = (uint8_t*)__builtin_frame_address(0) - STACK_PROBE_REDZONE;
+  for (volatile uint8_t* p = bottom; p < top; p++) {
+    *p = STACK_PROBE_PATTERN;
+  }
+  return top;
+}
+
+__attribute__((noinline)) NO_SANITIZE_ADDRESS uint8_t* deepestStackUse(uint8_t* bottom, uint8_t* top) {
+  for (volatile uint8_t* p = bottom; p < top; p++) {
+    if (*p != STACK_PROBE_PATTERN) {
+      return (uint8_t*)p;
+    }
+  }
+  return top;
+}
+
+} // namespace
+
+ProfiledScope::ProfiledScope(ResourceProfiler* profiler, const ProfiledCall call, const Command command)
+  : profiler(profiler),
+    call(call),
+    command(command) {
+  if (profiler) {
+    profiler->begin(this);
+  }
+}
+
+ProfiledScope::~ProfiledScope() {
+  if (profiler) {
+    profiler->end(this);
+  }
+}
+
+void ProfiledScope::setCommand(const Command command) {
+  this->command = command;
+}
+
+ResourceProfiler::ResourceProfiler(const uint32_t stackProbeBytes)
+  : stackProbeBytes(stackProbeBytes) {
+  usageSemaphore = xSemaphoreCreateMutex();
+}
+
+ResourceProfiler::~ResourceProfiler() {
+  vSemaphoreDelete(usageSemaphore);
+}
+
+ProfiledScope* ResourceProfiler::currentScope() {
+  return activeScope;
+}
+
+uint32_t ResourceProfiler::getStackProbeBytes() const {
+  return stackProbeBytes;
+}
+
+void ResourceProfiler::begin(ProfiledScope* scope) {
+  TaskHandle_t task = xTaskGetCurrentTaskHandle();
+  uint8_t* stackStart = pxTaskGetStackStart(task);
+  scope->entryStack = (uint8_t*)__builtin_frame_address(0);
+
+  // below the high water mark the stack still holds the fill pattern of FreeRTOS, keep it
+  uint8_t* bottom = stackStart + uxTaskGetStackHighWaterMark(task) * sizeof(StackType_t);
+  scope->probeAtHighWaterMark = true;
+  if (scope->entryStack - bottom > (ptrdiff_t)stackProbeBytes) {
+    bottom = scope->entryStack - stackProbeBytes;
+    scope->probeAtHighWaterMark = false;
+  }
+  if (bottom + STACK_PROBE_REDZONE < scope->entryStack) {
+    scope->probeBottom = bottom;
+    scope->probeTop = fillStack(bottom);
+  }
+
+  scope->freeHeapBefore = heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+  scope->parent = activeScope;
+  activeScope = scope;
+}
+
+void ResourceProfiler::end(ProfiledScope* scope) {
+  activeScope = scope->parent;
+  int32_t retainedBytes = (int32_t)((int64_t)scope->freeHeapBefore - heap_caps_get_free_size(MALLOC_CAP_DEFAULT));
+
+  TaskHandle_t task = xTaskGetCurrentTaskHandle();
+  uint32_t taskStackFree = uxTaskGetStackHighWaterMark(task) * sizeof(StackType_t);
+  uint32_t stackBytes = STACK_PROBE_REDZONE;
+  if (scope->probeTop > scope->probeBottom) {
+    uint8_t* deepest = deepestStackUse(scope->probeBottom, scope->probeTop);
+    if (deepest == scope->probeBottom && scope->probeAtHighWaterMark) {
+      // the call went below the old high water mark
+      uint8_t* highWaterMark = pxTaskGetStackStart(task) + taskStackFree;
+      if (highWaterMark < deepest) {
+        deepest = highWaterMark;
+      }
+    }
+    if (scope->entryStack - deepest > STACK_PROBE_REDZONE) {
+      stackBytes = scope->entryStack - deepest;
+    }
+  }
+
+  if (scope->parent) {
+    scope->parent->allocations += scope->allocations;
+    scope->parent->allocatedBytes += scope->allocatedBytes;
+  }
+
+  xSemaphoreTake(usageSemaphore, portMAX_DELAY);
+  ResourceUsage& entry = usage[std::make_pair(scope->call, scope->command)];
+  entry.calls++;
+  entry.peakStackBytes = std::max(entry.peakStackBytes, stackBytes);
+  entry.minTaskStackFreeBytes = std::min(entry.minTaskStackFreeBytes, taskStackFree);
+  entry.peakHeapAllocations = std::max(entry.peakHeapAllocations, scope->allocations);
+  entry.peakHeapBytes = std::max(entry.peakHeapBytes, scope->allocatedBytes);
+  entry.totalHeapAllocations += scope->allocations;
+  entry.totalHeapBytes += scope->allocatedBytes;
+  entry.peakHeapRetainedBytes = std::max(entry.peakHeapRetainedBytes, retainedBytes);
+  xSemaphoreGive(usageSemaphore);
+}
+
+void ResourceProfiler::getUsage(std::list<ResourceUsageEntry>* entries) {
+  xSemaphoreTake(usageSemaphore, portMAX_DELAY);
+  for (const auto& item : usage) {
+    entries->push_back({item.first.first, item.first.second, item.second});
+  }
+  xSemaphoreGive(usageSemaphore);
+}
+
+void ResourceProfiler::logUsage() {
+  std::list<ResourceUsageEntry> entries;
+  getUsage(&entries);
+  ESP_LOGI("NukiBle", "call     command  calls  stack  task free  allocs  bytes  retained");
+  for (const ResourceUsageEntry& entry : entries) {
+    ESP_LOGI("NukiBle", "%-8s 0x%04x %6u %6u %10u %7u %6u %9d",
+             entry.call == ProfiledCall::ExecuteAction ? "execute" : "receive", (unsigned int)entry.command,
+             (unsigned int)entry.usage.calls, (unsigned int)entry.usage.peakStackBytes,
+             (unsigned int)entry.usage.minTaskStackFreeBytes, (unsigned int)entry.usage.peakHeapAllocations,
+             (unsigned int)entry.usage.peakHeapBytes, (int)entry.usage.peakHeapRetainedBytes);
+  }
+}
+
+void ResourceProfiler::reset() {
+  xSemaphoreTake(usageSemaphore, portMAX_DELAY);
+  usage.clear();
+  xSemaphoreGive(usageSemaphore);
+}
+
+void IRAM_ATTR ResourceProfiler::countHeapAllocation(void* ptr, size_t size, uint32_t caps) {
+  ProfiledScope* scope = activeScope;
+  if (scope) {
+    scope->countAllocation(size);
+  }
+}
+
+} // namespace Nuki
+
+#if defined(NUKI_PROFILE_HEAP_HOOKS) && defined(CONFIG_HEAP_USE_HOOKS)
+// called by the heap of ESP-IDF for every allocation of every task
+extern "C" void IRAM_ATTR esp_heap_trace_alloc_hook(void* ptr, size_t size, uint32_t caps) {
+  Nuki::ResourceProfiler::countHeapAllocation(ptr, size, caps);
+}
+
+extern "C" void IRAM_ATTR esp_heap_trace_free_hook(void* ptr) {
+}
+#endif
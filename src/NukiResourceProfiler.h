@@ -0,0 +1,150 @@
+#pragma once
+/**
+ * @file NukiResourceProfiler.h
+ * Stack and heap high water marks of the library, per command
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ *
+ * A ResourceProfiler registered with NukiBle::setResourceProfiler() measures every executeAction() call on the
+ * calling task (keyed by the command of the action) and every received message on the BLE task (keyed by the
+ * command of the message, Command::Empty if it could not be decoded), to size task stacks from data.
+ *
+ * Stack: before a call the unused stack below the stack pointer is filled with a pattern (at most
+ * stackProbeBytes, never below the FreeRTOS high water mark of the task so uxTaskGetStackHighWaterMark() stays
+ * valid), afterwards the deepest overwritten byte gives the peak depth of the call. Depths below
+ * STACK_PROBE_REDZONE cannot be told apart and are reported as STACK_PROBE_REDZONE.
+ *
+ * Heap: allocations and allocated bytes are counted on the profiled task by the ESP-IDF heap hooks
+ * (CONFIG_HEAP_USE_HOOKS, without them the counts stay 0). A firmware links one definition of each hook: with
+ * NUKI_PROFILE_HEAP_HOOKS this file defines esp_heap_trace_alloc_hook / esp_heap_trace_free_hook, so the
+ * application must not define them as well. An application with its own hooks builds without
+ * NUKI_PROFILE_HEAP_HOOKS and calls ResourceProfiler::countHeapAllocation() from its alloc hook instead. The
+ * change of the free heap (heap_caps) is reported as well, it includes allocations of other tasks running at the
+ * same time.
+ *
+ * Profiling costs a fill and a scan of up to stackProbeBytes per call: do not leave it enabled in production.
+ */
+
+#include "NukiConstants.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <utility>
+
+#define STACK_PROBE_REDZONE 256
+
+namespace Nuki {
+
+enum class ProfiledCall : uint8_t {
+  ExecuteAction  = 0,
+  ReturnMessage  = 1
+};
+
+struct ResourceUsage {
+  uint32_t calls = 0;
+  // deepest stack use of a single call, in bytes below the stack pointer at its start
+  uint32_t peakStackBytes = 0;
+  // smallest uxTaskGetStackHighWaterMark() of the task seen after a call, in bytes
+  uint32_t minTaskStackFreeBytes = UINT32_MAX;
+  uint32_t peakHeapAllocations = 0;
+  uint32_t peakHeapBytes = 0;
+  uint64_t totalHeapAllocations = 0;
+  uint64_t totalHeapBytes = 0;
+  // largest drop of the free heap over a single call (memory kept after the call)
+  int32_t peakHeapRetainedBytes = 0;
+};
+
+struct ResourceUsageEntry {
+  ProfiledCall call;
+  Command command;
+  ResourceUsage usage;
+};
+
+class ResourceProfiler;
+
+/**
+ * @brief Measures one call, created on the stack of the profiled function
+ */
+class ProfiledScope {
+  public:
+    ProfiledScope(ResourceProfiler* profiler, const ProfiledCall call, const Command command);
+    ~ProfiledScope();
+
+    /**
+     * @brief Sets the command once it is known (received messages are decrypted inside the scope)
+     */
+    void setCommand(const Command command);
+
+    // called from the heap hooks, has to stay inline (IRAM)
+    inline void countAllocation(const size_t size) {
+      allocations++;
+      allocatedBytes += size;
+    }
+
+  private:
+    ResourceProfiler* profiler;
+    ProfiledCall call;
+    Command command;
+    ProfiledScope* parent = nullptr;
+    uint8_t* entryStack = nullptr;
+    uint8_t* probeBottom = nullptr;
+    uint8_t* probeTop = nullptr;
+    // the probed range starts at the high water mark of the task, not at stackProbeBytes
+    bool probeAtHighWaterMark = false;
+    size_t freeHeapBefore = 0;
+    uint32_t allocations = 0;
+    uint32_t allocatedBytes = 0;
+
+    friend class ResourceProfiler;
+};
+
+class ResourceProfiler {
+  public:
+    /**
+     * @param stackProbeBytes Stack below the stack pointer checked per call, deeper use is reported as this value
+     */
+    explicit ResourceProfiler(const uint32_t stackProbeBytes = 8192);
+    virtual ~ResourceProfiler();
+
+    /**
+     * @brief Copies the usage of every command seen so far, executeAction calls first
+     */
+    void getUsage(std::list<ResourceUsageEntry>* entries);
+
+    /**
+     * @brief Logs the usage of every command (ESP_LOGI)
+     */
+    void logUsage();
+
+    void reset();
+
+    uint32_t getStackProbeBytes() const;
+
+    /**
+     * @brief The scope running on the calling task, nullptr outside of a profiled call
+     */
+    static ProfiledScope* currentScope();
+
+    /**
+     * @brief Counts an allocation for the scope running on the calling task, for an esp_heap_trace_alloc_hook of
+     * the application (the library then has to be built without NUKI_PROFILE_HEAP_HOOKS). Runs in IRAM, from any
+     * task and with the heap locked: the hook may call it, nothing else is needed on free.
+     */
+    static void countHeapAllocation(void* ptr, size_t size, uint32_t caps);
+
+  private:
+    void begin(ProfiledScope* scope);
+    void end(ProfiledScope* scope);
+
+    uint32_t stackProbeBytes;
+    SemaphoreHandle_t usageSemaphore = nullptr;
+    std::map<std::pair<ProfiledCall, Command>, ResourceUsage> usage;
+
+    friend class ProfiledScope;
+};
+
+} // namespace Nuki
@@ -0,0 +1,42 @@
+/**
+ * @file NukiRetryPolicy.cpp
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ */
+
+#include "NukiRetryPolicy.h"
+#include "esp_random.h"
+
+namespace Nuki {
+
+BackoffRetryPolicy::BackoffRetryPolicy(const uint32_t baseDelayMs, const uint32_t maxDelayMs)
+  : baseDelayMs(baseDelayMs), maxDelayMs(maxDelayMs < baseDelayMs ? baseDelayMs : maxDelayMs) {}
+
+int32_t BackoffRetryPolicy::retryDelayMs(const ConnectFailure failure, const uint8_t failedAttempts) {
+  uint32_t delayMs = baseDelayMs;
+  switch (failure) {
+    case ConnectFailure::NotPresent:
+      return RETRY_GIVE_UP;
+    case ConnectFailure::Discovery:
+    case ConnectFailure::Subscribe:
+      break;
+    case ConnectFailure::NoClient:
+      delayMs = baseDelayMs * 4;
+      [[fallthrough]];
+    case ConnectFailure::Connect:
+      // delay * 2^(failedAttempts - 1), without overflowing
+      for (uint8_t i = 1; i < failedAttempts && delayMs < maxDelayMs; i++) {
+        delayMs *= 2;
+      }
+      break;
+  }
+  if (delayMs > maxDelayMs) {
+    delayMs = maxDelayMs;
+  }
+  // equal jitter: the half of the delay is random
+  uint32_t half = delayMs / 2;
+  return half + (half > 0 ? esp_random() % (half + 1) : 0);
+}
+
+} // namespace Nuki
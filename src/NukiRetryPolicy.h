@@ -0,0 +1,90 @@
+#pragma once
+/**
+ * @file NukiRetryPolicy.h
+ * Decides whether and when NukiBle::connectBle() tries again after a failed connect attempt
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ *
+ * The default BackoffRetryPolicy waits an exponentially growing time between the attempts, half of it random
+ * ("equal jitter"), so gateways that lost the lock at the same moment do not retry in step and collide again.
+ * A lock not heard for HEARTBEAT_TIMEOUT is not retried at all.
+ */
+
+#include <cstdint>
+
+// the delay of the first retry of BackoffRetryPolicy, doubled by every further failure up to the maximum
+#define RETRY_BACKOFF_BASE 20
+#define RETRY_BACKOFF_MAX 1000
+// returned by RetryPolicy::retryDelayMs() to stop connecting
+#define RETRY_GIVE_UP -1
+
+namespace Nuki {
+
+enum class ConnectFailure : uint8_t {
+  // all NimBLE clients (NIMBLE_MAX_CONNECTIONS) are used by other connections
+  NoClient,
+  // the connect attempt timed out or was rejected
+  Connect,
+  // a service or characteristic was not found, the attributes are discovered again on the next attempt
+  Discovery,
+  // subscribing to GDIO / USDIO failed
+  Subscribe,
+  // any of the above while nothing was received from the lock for HEARTBEAT_TIMEOUT
+  NotPresent
+};
+
+/**
+ * @brief Counters of NukiBle::connectBle() since construction, see NukiBle::getRetryStatistics()
+ */
+struct RetryStatistics {
+  // failed attempts by cause
+  uint32_t noClient = 0;
+  uint32_t connect = 0;
+  uint32_t discovery = 0;
+  uint32_t subscribe = 0;
+  // attempts made after a failed one
+  uint32_t retries = 0;
+  // connects stopped by the policy (e.g. the lock is not present) and connects that ran out of attempts or time
+  uint32_t givenUp = 0;
+  uint32_t exhausted = 0;
+  // time waited between attempts
+  uint64_t backoffMs = 0;
+};
+
+class RetryPolicy {
+  public:
+    virtual ~RetryPolicy() {}
+
+    /**
+     * @brief Called on the task of the command after a failed attempt, while attempts and time are left
+     *
+     * @param failure Cause of the failed attempt
+     * @param failedAttempts Attempts of this connect that failed so far, from 1
+     * @return Delay before the next attempt in ms, RETRY_GIVE_UP to stop connecting
+     */
+    virtual int32_t retryDelayMs(const ConnectFailure failure, const uint8_t failedAttempts) = 0;
+};
+
+class BackoffRetryPolicy : public RetryPolicy {
+  public:
+    /**
+     * @param baseDelayMs Delay of the first retry, half of it random
+     * @param maxDelayMs Longest delay
+     */
+    explicit BackoffRetryPolicy(const uint32_t baseDelayMs = RETRY_BACKOFF_BASE,
+                                const uint32_t maxDelayMs = RETRY_BACKOFF_MAX);
+
+    /**
+     * @brief Gives up on a lock that is not present. Discovery and subscription failures are retried after the
+     * base delay, the attributes are discovered again anyway. Connect failures back off exponentially, NoClient
+     * likewise from four times the base delay, as a client is only freed by another connection.
+     */
+    int32_t retryDelayMs(const ConnectFailure failure, const uint8_t failedAttempts) override;
+
+  private:
+    uint32_t baseDelayMs;
+    uint32_t maxDelayMs;
+};
+
+} // namespace Nuki
@@ -0,0 +1,72 @@
+/**
+ * @file NukiRttEstimator.cpp
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ */
+
+#include "NukiRttEstimator.h"
+
+namespace Nuki {
+
+RttEstimator::RttEstimator(const uint32_t minSamples)
+  : minSamples(minSamples) {}
+
+void RttEstimator::addSample(const int64_t durationMs, const bool retried) {
+  if (retried) {
+    return;
+  }
+  backOffs = 0;
+  int64_t sampleEighths = (durationMs > 0 ? durationMs : 0) * 8;
+  if (samples == 0) {
+    averageEighths = sampleEighths;
+    deviationEighths = sampleEighths / 2;
+  } else {
+    int64_t error = sampleEighths - averageEighths;
+    averageEighths += error / 8;
+    deviationEighths += ((error < 0 ? -error : error) - deviationEighths) / 4;
+  }
+  samples++;
+  if (durationMs > maxMs) {
+    maxMs = durationMs;
+  }
+}
+
+void RttEstimator::backOff() {
+  if (backOffs < RTT_MAX_BACKOFF) {
+    backOffs++;
+  }
+}
+
+uint32_t RttEstimator::getTimeout(const uint32_t defaultMs, const uint32_t minMs, const uint32_t maxMs) const {
+  int64_t timeoutMs = defaultMs;
+  if (samples >= minSamples) {
+    timeoutMs = ((averageEighths + 4 * deviationEighths + 7) / 8) << backOffs;
+  }
+  if (timeoutMs < minMs) {
+    timeoutMs = minMs;
+  }
+  if (timeoutMs > maxMs) {
+    timeoutMs = maxMs;
+  }
+  return timeoutMs;
+}
+
+RttEstimate RttEstimator::getEstimate() const {
+  RttEstimate estimate;
+  estimate.samples = samples;
+  estimate.averageMs = averageEighths / 8;
+  estimate.deviationMs = deviationEighths / 8;
+  estimate.maxMs = maxMs;
+  return estimate;
+}
+
+void RttEstimator::reset() {
+  samples = 0;
+  averageEighths = 0;
+  deviationEighths = 0;
+  maxMs = 0;
+  backOffs = 0;
+}
+
+} // namespace Nuki
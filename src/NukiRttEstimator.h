@@ -0,0 +1,81 @@
+#pragma once
+/**
+ * @file NukiRttEstimator.h
+ * Smoothed duration estimate of a step of the exchange with a lock, and the timeout derived from it
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ *
+ * The estimate follows the TCP retransmission timer (RFC 6298): an exponentially weighted moving average of the
+ * samples (weight 1/8) and of their deviation from it (weight 1/4), the timeout is the average plus four times
+ * the deviation. Until minSamples samples were taken the default timeout of the caller is used, so a few early
+ * samples cannot shorten it.
+ *
+ * A timeout doubles the timeout until the next valid sample (RFC 6298 5.5). The answer to a retried exchange may
+ * belong to the one that timed out, so its sample is discarded (Karn's algorithm).
+ */
+
+#include <cstdint>
+
+// a backed off timeout is at most 2^RTT_MAX_BACKOFF times the estimate
+#define RTT_MAX_BACKOFF 4
+
+namespace Nuki {
+
+struct RttEstimate {
+  uint32_t samples = 0;
+  // smoothed average and mean deviation
+  uint32_t averageMs = 0;
+  uint32_t deviationMs = 0;
+  uint32_t maxMs = 0;
+};
+
+/**
+ * @brief Estimates of a NukiBle instance, see NukiBle::setAdaptiveTimeouts()
+ */
+struct TimingEstimates {
+  // pClient->connect() of a successful attempt
+  RttEstimate connect;
+  // challenge request sent until the challenge (or an error report) arrived
+  RttEstimate challenge;
+  // accepted status until the complete status of a lock action, measured only
+  RttEstimate completion;
+};
+
+class RttEstimator {
+  public:
+    /**
+     * @param minSamples Samples needed before the estimate replaces the default timeout
+     */
+    explicit RttEstimator(const uint32_t minSamples = 8);
+
+    /**
+     * @param retried The exchange was sent again after a timeout, the sample is discarded (Karn's algorithm)
+     */
+    void addSample(const int64_t durationMs, const bool retried = false);
+
+    /**
+     * @brief Doubles the timeout after it ran out, until the next valid sample (at most RTT_MAX_BACKOFF times)
+     */
+    void backOff();
+
+    /**
+     * @brief Average plus four deviations, doubled for every backOff(), within minMs and maxMs. defaultMs
+     * (within minMs and maxMs as well) while there are not enough samples.
+     */
+    uint32_t getTimeout(const uint32_t defaultMs, const uint32_t minMs, const uint32_t maxMs) const;
+
+    RttEstimate getEstimate() const;
+    void reset();
+
+  private:
+    uint32_t minSamples;
+    uint32_t samples = 0;
+    // in 1/8 ms, like the integer arithmetic of the TCP timer
+    int64_t averageEighths = 0;
+    int64_t deviationEighths = 0;
+    uint32_t maxMs = 0;
+    uint8_t backOffs = 0;
+};
+
+} // namespace Nuki
@@ -0,0 +1,151 @@
+/**
+ * @file NukiScanCoordinator.cpp
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ */
+
+#include "NukiScanCoordinator.h"
+#include "NukiCommandWorker.h"
+#include "esp_timer.h"
+#include "freertos/task.h"
+
+#include <map>
+
+// longest single wait for the connect turn before the CommandLimits are checked again
+#define SCAN_WAIT_INTERVAL 100
+
+namespace Nuki {
+
+std::shared_ptr<ScanCoordinator> ScanCoordinator::forPublisher(BleScanner::Publisher* publisher) {
+  static SemaphoreHandle_t registrySemaphore = xSemaphoreCreateMutex();
+  static std::map<BleScanner::Publisher*, std::weak_ptr<ScanCoordinator>> coordinators;
+
+  xSemaphoreTake(registrySemaphore, portMAX_DELAY);
+  std::shared_ptr<ScanCoordinator> coordinator = coordinators[publisher].lock();
+  if (!coordinator) {
+    coordinator = std::shared_ptr<ScanCoordinator>(new ScanCoordinator(publisher));
+    coordinators[publisher] = coordinator;
+  }
+  // drop the entries of released coordinators
+  for (auto it = coordinators.begin(); it != coordinators.end();) {
+    if (it->second.expired()) {
+      it = coordinators.erase(it);
+    } else {
+      it++;
+    }
+  }
+  xSemaphoreGive(registrySemaphore);
+
+  xSemaphoreTake(coordinator->stateSemaphore, portMAX_DELAY);
+  coordinator->users++;
+  xSemaphoreGive(coordinator->stateSemaphore);
+  return coordinator;
+}
+
+void ScanCoordinator::release() {
+  xSemaphoreTake(stateSemaphore, portMAX_DELAY);
+  if (users > 0) {
+    users--;
+  }
+  xSemaphoreGive(stateSemaphore);
+}
+
+ScanCoordinator::ScanCoordinator(BleScanner::Publisher* publisher)
+  : publisher(publisher) {
+  createdMs = esp_timer_get_time() / 1000;
+  stateSemaphore = xSemaphoreCreateMutex();
+  connectSemaphore = xSemaphoreCreateMutex();
+}
+
+ScanCoordinator::~ScanCoordinator() {
+  vSemaphoreDelete(stateSemaphore);
+  vSemaphoreDelete(connectSemaphore);
+}
+
+void ScanCoordinator::suspend() {
+  xSemaphoreTake(stateSemaphore, portMAX_DELAY);
+  // the window keeps scanning for the locks of the other instances sharing the coordinator
+  if (suspendCount == 0 && resumedMs >= 0 && users > 1) {
+    int64_t remainingMs = resumedMs + minScanWindowMs - (esp_timer_get_time() / 1000);
+    if (remainingMs > 0) {
+      xSemaphoreGive(stateSemaphore);
+      int64_t waitStartMs = esp_timer_get_time() / 1000;
+      vTaskDelay(pdMS_TO_TICKS(CommandLimits::clampWait(remainingMs)));
+      xSemaphoreTake(stateSemaphore, portMAX_DELAY);
+      statistics.windowWaits++;
+      statistics.windowWaitMs += (esp_timer_get_time() / 1000) - waitStartMs;
+    }
+  }
+  if (suspendCount++ == 0) {
+    publisher->enableScanning(false);
+    suspendedSinceMs = esp_timer_get_time() / 1000;
+    statistics.suspensions++;
+  }
+  xSemaphoreGive(stateSemaphore);
+}
+
+void ScanCoordinator::resume() {
+  xSemaphoreTake(stateSemaphore, portMAX_DELAY);
+  if (suspendCount > 0 && --suspendCount == 0) {
+    publisher->enableScanning(true);
+    resumedMs = esp_timer_get_time() / 1000;
+    uint32_t suspendedMs = resumedMs - suspendedSinceMs;
+    statistics.suspendedMs += suspendedMs;
+    if (suspendedMs > statistics.longestSuspensionMs) {
+      statistics.longestSuspensionMs = suspendedMs;
+    }
+    suspendedSinceMs = 0;
+  }
+  xSemaphoreGive(stateSemaphore);
+}
+
+bool ScanCoordinator::tryBeginConnect() {
+  return xSemaphoreTake(connectSemaphore, 0) == pdTRUE;
+}
+
+bool ScanCoordinator::beginConnect() {
+  if (tryBeginConnect()) {
+    return true;
+  }
+  // a deadline shortens the wait, a cancellation token splits it up, see CommandLimits
+  int64_t waitStartMs = esp_timer_get_time() / 1000;
+  int64_t waitEndMs = waitStartMs + CommandLimits::clampWait(SCAN_CONNECT_SLOT_TIMEOUT);
+  bool result = false;
+  int64_t waitMs;
+  while (!result && (waitMs = waitEndMs - (esp_timer_get_time() / 1000)) > 0
+         && CommandLimits::check() == CmdResult::Success) {
+    result = xSemaphoreTake(connectSemaphore, pdMS_TO_TICKS(waitMs > SCAN_WAIT_INTERVAL ? SCAN_WAIT_INTERVAL : waitMs))
+             == pdTRUE;
+  }
+  xSemaphoreTake(stateSemaphore, portMAX_DELAY);
+  statistics.connectWaits++;
+  statistics.connectWaitMs += (esp_timer_get_time() / 1000) - waitStartMs;
+  xSemaphoreGive(stateSemaphore);
+  return result;
+}
+
+void ScanCoordinator::endConnect() {
+  xSemaphoreGive(connectSemaphore);
+}
+
+void ScanCoordinator::setMinScanWindow(const uint32_t windowMs) {
+  xSemaphoreTake(stateSemaphore, portMAX_DELAY);
+  minScanWindowMs = windowMs;
+  xSemaphoreGive(stateSemaphore);
+}
+
+ScanStatistics ScanCoordinator::getStatistics() {
+  xSemaphoreTake(stateSemaphore, portMAX_DELAY);
+  ScanStatistics result = statistics;
+  int64_t nowMs = esp_timer_get_time() / 1000;
+  if (suspendCount > 0) {
+    result.suspendedMs += nowMs - suspendedSinceMs;
+  }
+  xSemaphoreGive(stateSemaphore);
+  result.elapsedMs = nowMs - createdMs;
+  result.lostDutyCyclePermille = result.elapsedMs > 0 ? result.suspendedMs * 1000 / result.elapsedMs : 0;
+  return result;
+}
+
+} // namespace Nuki
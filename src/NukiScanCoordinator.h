@@ -0,0 +1,104 @@
+#pragma once
+/**
+ * @file NukiScanCoordinator.h
+ * Shares the scanner of several NukiBle instances between scanning and connecting
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ *
+ * NimBLE stops scanning to connect and runs one connect procedure at a time. The instances registered with the
+ * same BleScanner::Publisher share one ScanCoordinator: scanning is suspended while any of them connects and
+ * resumed once the last one is done, the connect procedures run one after the other, and between two
+ * suspensions scanning runs for at least the minimum scan window, so beacon flips of the other locks are not missed
+ * while the instances connect in turn. A single instance connects without waiting for the window.
+ */
+
+#include <BleInterfaces.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include <cstdint>
+#include <memory>
+
+// scanning runs at least this long between two suspensions, see ScanCoordinator::setMinScanWindow()
+#define SCAN_MIN_WINDOW 100
+// longest wait for the connect procedure of another instance
+#define SCAN_CONNECT_SLOT_TIMEOUT 10000
+
+namespace Nuki {
+
+/**
+ * @brief Counters of a ScanCoordinator since its creation
+ */
+struct ScanStatistics {
+  uint64_t elapsedMs = 0;
+  // scanning suspended for connects, including a running suspension
+  uint64_t suspendedMs = 0;
+  uint32_t suspensions = 0;
+  uint32_t longestSuspensionMs = 0;
+  // suspendedMs of elapsedMs
+  uint16_t lostDutyCyclePermille = 0;
+  // connects that waited for the end of the minimum scan window, and for the connect of another instance
+  uint32_t windowWaits = 0;
+  uint64_t windowWaitMs = 0;
+  uint32_t connectWaits = 0;
+  uint64_t connectWaitMs = 0;
+};
+
+class ScanCoordinator {
+  public:
+    /**
+     * @brief The coordinator of a publisher, created for the first instance registering it and shared with the
+     * following ones while any of them holds it. Counts the instance as a user until it calls release().
+     */
+    static std::shared_ptr<ScanCoordinator> forPublisher(BleScanner::Publisher* publisher);
+
+    /**
+     * @brief Ends the registration of an instance made by forPublisher()
+     */
+    void release();
+
+    ~ScanCoordinator();
+    ScanCoordinator(const ScanCoordinator&) = delete;
+    ScanCoordinator& operator=(const ScanCoordinator&) = delete;
+
+    /**
+     * @brief Suspends scanning until every suspend() was matched by a resume(). If scanning was resumed less
+     * than the minimum scan window ago and other instances share the coordinator, waits for the rest of the
+     * window first (within the CommandLimits of the calling task).
+     */
+    void suspend();
+    void resume();
+
+    /**
+     * @brief Waits until no other instance runs a connect procedure, endConnect() releases the turn
+     *
+     * @return false if the wait timed out or the CommandLimits of the calling task ran out
+     */
+    bool beginConnect();
+    // takes the turn if no other instance runs a connect procedure, without waiting
+    bool tryBeginConnect();
+    void endConnect();
+
+    void setMinScanWindow(const uint32_t windowMs);
+    ScanStatistics getStatistics();
+
+  private:
+    explicit ScanCoordinator(BleScanner::Publisher* publisher);
+
+    BleScanner::Publisher* publisher;
+    uint32_t minScanWindowMs = SCAN_MIN_WINDOW;
+    // instances registered by forPublisher() and not released
+    uint32_t users = 0;
+    uint32_t suspendCount = 0;
+    int64_t createdMs = 0;
+    int64_t suspendedSinceMs = 0;
+    // -1 until the first resume
+    int64_t resumedMs = -1;
+    ScanStatistics statistics;
+    SemaphoreHandle_t stateSemaphore = nullptr;
+    SemaphoreHandle_t connectSemaphore = nullptr;
+};
+
+} // namespace Nuki
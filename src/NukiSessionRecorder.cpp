@@ -0,0 +1,168 @@
+/**
+ * @file NukiSessionRecorder.cpp
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ */
+
+#include "NukiSessionRecorder.h"
+
+#include "esp_log.h"
+
+#include <cstring>
+
+namespace Nuki {
+
+namespace {
+
+const uint8_t SESSION_FILE_MAGIC[4] = {'N', 'K', 'S', 'R'};
+const uint8_t SESSION_FILE_VERSION = 1;
+const size_t SESSION_FILE_HEADER_LENGTH = 8;
+
+size_t encodeVarint(uint64_t value, uint8_t* buffer) {
+  size_t length = 0;
+  do {
+    uint8_t byte = value & 0x7F;
+    value >>= 7;
+    buffer[length++] = value ? (byte | 0x80) : byte;
+  } while (value);
+  return length;
+}
+
+bool readVarint(FILE* file, uint64_t* value) {
+  *value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    int byte = fgetc(file);
+    if (byte == EOF) {
+      return false;
+    }
+    *value |= (uint64_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace
+
+SessionFileRecorder::SessionFileRecorder(const char* path) {
+  fileSemaphore = xSemaphoreCreateMutex();
+  file = fopen(path, "wb");
+  if (file == nullptr) {
+    ESP_LOGE("NukiBle", "Unable to create session recording %s", path);
+    return;
+  }
+  uint8_t header[SESSION_FILE_HEADER_LENGTH] = {};
+  memcpy(header, SESSION_FILE_MAGIC, sizeof(SESSION_FILE_MAGIC));
+  header[4] = SESSION_FILE_VERSION;
+  fwrite(header, 1, sizeof(header), file);
+}
+
+SessionFileRecorder::~SessionFileRecorder() {
+  close();
+  vSemaphoreDelete(fileSemaphore);
+}
+
+bool SessionFileRecorder::isOpen() const {
+  return file != nullptr;
+}
+
+void SessionFileRecorder::close() {
+  xSemaphoreTake(fileSemaphore, portMAX_DELAY);
+  if (file) {
+    fclose(file);
+    file = nullptr;
+  }
+  xSemaphoreGive(fileSemaphore);
+}
+
+uint32_t SessionFileRecorder::getFrameCount() const {
+  return frameCount;
+}
+
+void SessionFileRecorder::recordFrame(const FrameDirection direction, const int64_t timestampUs,
+                                      const Command command, const uint8_t* data, const uint16_t dataLen) {
+  xSemaphoreTake(fileSemaphore, portMAX_DELAY);
+  if (file) {
+    uint8_t header[3 + 10 + 3];
+    header[0] = (uint8_t)direction;
+    header[1] = (uint16_t)command & 0xFF;
+    header[2] = (uint16_t)command >> 8;
+    // frames of the BLE task and the sending task can be recorded slightly out of order
+    int64_t deltaUs = lastTimestampUs < 0 || timestampUs < lastTimestampUs ? 0 : timestampUs - lastTimestampUs;
+    size_t headerLen = 3;
+    headerLen += encodeVarint(deltaUs, &header[headerLen]);
+    headerLen += encodeVarint(dataLen, &header[headerLen]);
+    fwrite(header, 1, headerLen, file);
+    if (direction == FrameDirection::Received && dataLen > 0) {
+      fwrite(data, 1, dataLen, file);
+    }
+    if (lastTimestampUs < timestampUs) {
+      lastTimestampUs = timestampUs;
+    }
+    frameCount++;
+  }
+  xSemaphoreGive(fileSemaphore);
+}
+
+SessionFileReader::SessionFileReader(const char* path) {
+  file = fopen(path, "rb");
+  if (file == nullptr) {
+    ESP_LOGE("NukiBle", "Unable to open session recording %s", path);
+    return;
+  }
+  uint8_t header[SESSION_FILE_HEADER_LENGTH];
+  if (fread(header, 1, sizeof(header), file) != sizeof(header)
+      || memcmp(header, SESSION_FILE_MAGIC, sizeof(SESSION_FILE_MAGIC)) != 0
+      || header[4] != SESSION_FILE_VERSION) {
+    ESP_LOGE("NukiBle", "%s is not a session recording", path);
+    fclose(file);
+    file = nullptr;
+  }
+}
+
+SessionFileReader::~SessionFileReader() {
+  if (file) {
+    fclose(file);
+  }
+}
+
+bool SessionFileReader::isOpen() const {
+  return file != nullptr;
+}
+
+bool SessionFileReader::next(SessionFrame* frame) {
+  if (file == nullptr) {
+    return false;
+  }
+  uint8_t header[3];
+  uint64_t deltaUs = 0;
+  uint64_t length = 0;
+  if (fread(header, 1, sizeof(header), file) != sizeof(header) || !readVarint(file, &deltaUs)
+      || !readVarint(file, &length) || length > UINT16_MAX || header[0] > (uint8_t)FrameDirection::Sent) {
+    return false;
+  }
+  timestampUs += deltaUs;
+  frame->direction = (FrameDirection)header[0];
+  frame->timestampUs = timestampUs;
+  frame->command = (Command)(header[1] | (header[2] << 8));
+  frame->length = length;
+  frame->data.clear();
+  if (frame->direction == FrameDirection::Received) {
+    frame->data.resize(length);
+    if (length > 0 && fread(frame->data.data(), 1, length, file) != length) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void SessionFileReader::rewind() {
+  if (file) {
+    fseek(file, SESSION_FILE_HEADER_LENGTH, SEEK_SET);
+    timestampUs = 0;
+  }
+}
+
+} // namespace Nuki
@@ -0,0 +1,111 @@
+#pragma once
+/**
+ * @file NukiSessionRecorder.h
+ * Capture of the messages exchanged with a Nuki device, and a compact binary file format to store them
+ *
+ * Created: 2026
+ * License: GNU GENERAL PUBLIC LICENSE (see LICENSE)
+ *
+ * A SessionRecorder registered with NukiBle::setSessionRecorder() receives every message after decryption
+ * (received) or before encryption (sent). SessionFileRecorder stores them in a file that can be read back
+ * with SessionFileReader and fed into NukiBle::replayReturnMessage(), e.g. to replay traces of real locks
+ * as a regression benchmark of the receive path.
+ *
+ * File format (little endian):
+ *   header: "NKSR" version(1) reserved(3)
+ *   frame:  direction(1) command(2) time since previous frame in us(varint) length(varint) payload
+ * NukiBle passes sent frames without their payload, they carry the challenge and the security pin, and
+ * received keypad codes with the code zeroed. The other received frames are decrypted, they show names, log
+ * entries and the configuration of the lock: treat recordings like credentials.
+ */
+
+#include "NukiConstants.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace Nuki {
+
+enum class FrameDirection : uint8_t {
+  Received = 0,
+  Sent     = 1
+};
+
+class SessionRecorder {
+  public:
+    virtual ~SessionRecorder() {};
+
+    /**
+     * @brief Called for every message, from the task sending or the BLE task receiving it
+     *
+     * @param direction Received from or sent to the device
+     * @param timestampUs esp_timer_get_time() of the message
+     * @param command Command identifier
+     * @param data Payload without command identifier and CRC (plain text), nullptr for sent frames
+     * @param dataLen Payload length, of sent frames as well
+     */
+    virtual void recordFrame(const FrameDirection direction, const int64_t timestampUs, const Command command,
+                             const uint8_t* data, const uint16_t dataLen) = 0;
+};
+
+struct SessionFrame {
+  FrameDirection direction;
+  // microseconds since the first frame of the recording
+  int64_t timestampUs;
+  Command command;
+  uint16_t length;
+  // empty for sent frames
+  std::vector<uint8_t> data;
+};
+
+class SessionFileRecorder : public SessionRecorder {
+  public:
+    /**
+     * @brief Creates (or truncates) the recording, on the ESP the path has to be on a mounted file system
+     */
+    explicit SessionFileRecorder(const char* path);
+    virtual ~SessionFileRecorder();
+
+    bool isOpen() const;
+    void close();
+    uint32_t getFrameCount() const;
+
+    void recordFrame(const FrameDirection direction, const int64_t timestampUs, const Command command,
+                     const uint8_t* data, const uint16_t dataLen) override;
+
+  private:
+    FILE* file = nullptr;
+    SemaphoreHandle_t fileSemaphore = nullptr;
+    int64_t lastTimestampUs = -1;
+    uint32_t frameCount = 0;
+};
+
+class SessionFileReader {
+  public:
+    explicit SessionFileReader(const char* path);
+    virtual ~SessionFileReader();
+
+    /**
+     * @brief Returns false if the file cannot be opened or is not a recording
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief Reads the next frame, returns false at the end of the recording or on a truncated frame
+     */
+    bool next(SessionFrame* frame);
+
+    /**
+     * @brief Starts reading at the first frame again
+     */
+    void rewind();
+
+  private:
+    FILE* file = nullptr;
+    int64_t timestampUs = 0;
+};
+
+} // namespace Nuki